@@ -0,0 +1,68 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <BandwidthLimiter.h>
+using namespace Common;
+
+#include <QMutexLocker>
+
+/**
+  * @class Common::BandwidthLimiter
+  *
+  * Limit the rate of the transfers in one direction (upload or download): a global limit for all the peers and a limit per peer.
+  * Each peer has its own token bucket, the bucket of each peer has the global bucket as parent.
+  * The rates are given in [B/s], 0 means no limit.
+  */
+
+BandwidthLimiter::BandwidthLimiter(quint32 rate, quint32 ratePerPeer) :
+   ratePerPeer(ratePerPeer)
+{
+   this->globalBucket.setRate(rate);
+}
+
+void BandwidthLimiter::setRates(quint32 rate, quint32 ratePerPeer)
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (this->globalBucket.getRate() != rate)
+      this->globalBucket.setRate(rate);
+
+   if (this->ratePerPeer != ratePerPeer)
+   {
+      this->ratePerPeer = ratePerPeer;
+      foreach (QSharedPointer<TokenBucket> bucket, this->peerBuckets)
+         bucket->setRate(ratePerPeer);
+   }
+}
+
+/**
+  * The bucket of a peer is kept as long as the limiter exists.
+  */
+QSharedPointer<TokenBucket> BandwidthLimiter::getPeerBucket(const Hash& peerID)
+{
+   QMutexLocker locker(&this->mutex);
+
+   QSharedPointer<TokenBucket> bucket = this->peerBuckets.value(peerID);
+   if (bucket.isNull())
+   {
+      bucket = QSharedPointer<TokenBucket>(new TokenBucket(&this->globalBucket));
+      bucket->setRate(this->ratePerPeer);
+      this->peerBuckets.insert(peerID, bucket);
+   }
+   return bucket;
+}
@@ -0,0 +1,49 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_BANDWIDTHLIMITER_H
+#define COMMON_BANDWIDTHLIMITER_H
+
+#include <QMutex>
+#include <QHash>
+#include <QSharedPointer>
+
+#include <Common/Uncopyable.h>
+#include <Common/Hash.h>
+#include <Common/TokenBucket.h>
+
+namespace Common
+{
+   class BandwidthLimiter : Common::Uncopyable
+   {
+   public:
+      BandwidthLimiter(quint32 rate = 0, quint32 ratePerPeer = 0);
+
+      void setRates(quint32 rate, quint32 ratePerPeer);
+      QSharedPointer<TokenBucket> getPeerBucket(const Hash& peerID);
+
+   private:
+      QMutex mutex;
+
+      TokenBucket globalBucket;
+      quint32 ratePerPeer; // [B/s], 0 means no limit.
+      QHash<Hash, QSharedPointer<TokenBucket> > peerBuckets;
+   };
+}
+
+#endif
@@ -0,0 +1,76 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <BlockCompressor.h>
+using namespace Common;
+
+#include <QtEndian>
+
+/**
+  * @class Common::BlockCompressor
+  *
+  * Cut a stream of data in blocks and compress the ones which are compressible, see 'BlockDecompressor' to decode them.
+  * Each block has a header of 'HEADER_SIZE' bytes (big-endian): the size of the block data and the flag 'COMPRESSED_FLAG'.
+  * The data of a compressed block are the result of 'qCompress(..)' (zlib).
+  * A block is sent compressed only if its compressed size is below 'maxRatio' times its size. When it isn't the case the data
+  * are probably already compressed (video, archive, ..), the next 'nbBlocksToSkip' blocks are then sent without trying to compress them.
+  */
+
+/**
+  * @param maxRatio 0 means the blocks are never compressed.
+  */
+BlockCompressor::BlockCompressor(double maxRatio, int nbBlocksToSkip) :
+   MAX_RATIO(maxRatio), NB_BLOCKS_TO_SKIP(nbBlocksToSkip), nbBlocksToSkip(0)
+{
+}
+
+/**
+  * Return the given data as a sequence of blocks.
+  */
+QByteArray BlockCompressor::encode(const char* data, int size)
+{
+   QByteArray blocks;
+   blocks.reserve(size + (size / MAX_BLOCK_SIZE + 1) * HEADER_SIZE);
+
+   for (int offset = 0; offset < size; offset += MAX_BLOCK_SIZE)
+      this->appendBlock(blocks, data + offset, size - offset < MAX_BLOCK_SIZE ? size - offset : MAX_BLOCK_SIZE);
+
+   return blocks;
+}
+
+void BlockCompressor::appendBlock(QByteArray& blocks, const char* data, int size)
+{
+   uchar header[HEADER_SIZE];
+
+   if (this->MAX_RATIO > 0.0 && this->nbBlocksToSkip == 0)
+   {
+      const QByteArray compressedData = qCompress(reinterpret_cast<const uchar*>(data), size, COMPRESSION_LEVEL);
+      if (compressedData.size() < this->MAX_RATIO * size && compressedData.size() <= MAX_BLOCK_SIZE)
+      {
+         qToBigEndian<quint32>(COMPRESSED_FLAG | compressedData.size(), header);
+         blocks.append(reinterpret_cast<const char*>(header), HEADER_SIZE).append(compressedData);
+         return;
+      }
+      this->nbBlocksToSkip = this->NB_BLOCKS_TO_SKIP;
+   }
+   else if (this->nbBlocksToSkip > 0)
+      this->nbBlocksToSkip--;
+
+   qToBigEndian<quint32>(size, header);
+   blocks.append(reinterpret_cast<const char*>(header), HEADER_SIZE).append(data, size);
+}
@@ -0,0 +1,50 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_BLOCKCOMPRESSOR_H
+#define COMMON_BLOCKCOMPRESSOR_H
+
+#include <QByteArray>
+
+#include <Common/Uncopyable.h>
+
+namespace Common
+{
+   class BlockCompressor : Common::Uncopyable
+   {
+   public:
+      static const int HEADER_SIZE = 4; // [B].
+      static const quint32 COMPRESSED_FLAG = 0x80000000;
+      static const int MAX_BLOCK_SIZE = 1024 * 1024; // [B]. Applied to the data before and after the compression.
+      static const int COMPRESSION_LEVEL = 1; // The fastest zlib level.
+
+      BlockCompressor(double maxRatio, int nbBlocksToSkip);
+
+      QByteArray encode(const char* data, int size);
+
+   private:
+      void appendBlock(QByteArray& blocks, const char* data, int size);
+
+      const double MAX_RATIO;
+      const int NB_BLOCKS_TO_SKIP;
+
+      int nbBlocksToSkip; // The number of blocks to send without trying to compress them.
+   };
+}
+
+#endif
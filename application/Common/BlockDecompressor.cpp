@@ -0,0 +1,114 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <BlockDecompressor.h>
+using namespace Common;
+
+#include <cstring>
+
+#include <QtEndian>
+
+#include <BlockCompressor.h>
+
+/**
+  * @class Common::BlockDecompressor
+  *
+  * Decode the blocks made by 'BlockCompressor'. The blocks can be given in pieces of any size, see 'feed(..)'.
+  * A block is decoded only when it has been entirely received and when the data of the previous block have been read.
+  */
+
+BlockDecompressor::BlockDecompressor() :
+   outputPosition(0), error(false)
+{
+}
+
+void BlockDecompressor::feed(const char* data, int size)
+{
+   this->input.append(data, size);
+}
+
+/**
+  * Read the decoded data.
+  * @return The number of bytes read, 0 if a block hasn't been entirely received or if there is an error, see 'hasError()'.
+  */
+int BlockDecompressor::read(char* data, int maxSize)
+{
+   if (this->outputPosition >= this->output.size())
+      this->decodeNextBlock();
+
+   const int size = qMin(maxSize, this->output.size() - this->outputPosition);
+   if (size <= 0)
+      return 0;
+
+   memcpy(data, this->output.constData() + this->outputPosition, size);
+   this->outputPosition += size;
+   return size;
+}
+
+/**
+  * Return true if a corrupted block has been received, the next data can't be decoded.
+  */
+bool BlockDecompressor::hasError() const
+{
+   return this->error;
+}
+
+void BlockDecompressor::decodeNextBlock()
+{
+   this->output.clear();
+   this->outputPosition = 0;
+
+   if (this->error || this->input.size() < BlockCompressor::HEADER_SIZE)
+      return;
+
+   const quint32 header = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(this->input.constData()));
+   const bool compressed = header & BlockCompressor::COMPRESSED_FLAG;
+   const int size = header & ~BlockCompressor::COMPRESSED_FLAG;
+
+   if (size > BlockCompressor::MAX_BLOCK_SIZE)
+   {
+      this->error = true;
+      return;
+   }
+
+   if (this->input.size() < BlockCompressor::HEADER_SIZE + size)
+      return;
+
+   if (compressed)
+   {
+      // The first four bytes given by 'qCompress(..)' are the size of the uncompressed data, it's checked before 'qUncompress(..)' allocates it.
+      if (size < 4 || qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(this->input.constData()) + BlockCompressor::HEADER_SIZE) > static_cast<quint32>(BlockCompressor::MAX_BLOCK_SIZE))
+      {
+         this->error = true;
+         return;
+      }
+
+      this->output = qUncompress(reinterpret_cast<const uchar*>(this->input.constData()) + BlockCompressor::HEADER_SIZE, size);
+      if (this->output.isEmpty())
+      {
+         this->error = true;
+         return;
+      }
+   }
+   else
+   {
+      this->output = this->input.mid(BlockCompressor::HEADER_SIZE, size);
+   }
+
+   this->input.remove(0, BlockCompressor::HEADER_SIZE + size);
+}
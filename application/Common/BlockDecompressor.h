@@ -0,0 +1,47 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_BLOCKDECOMPRESSOR_H
+#define COMMON_BLOCKDECOMPRESSOR_H
+
+#include <QByteArray>
+
+#include <Common/Uncopyable.h>
+
+namespace Common
+{
+   class BlockDecompressor : Common::Uncopyable
+   {
+   public:
+      BlockDecompressor();
+
+      void feed(const char* data, int size);
+      int read(char* data, int maxSize);
+      bool hasError() const;
+
+   private:
+      void decodeNextBlock();
+
+      QByteArray input; // The received blocks not yet decoded.
+      QByteArray output; // The decoded data not yet read.
+      int outputPosition;
+      bool error;
+   };
+}
+
+#endif
@@ -22,6 +22,10 @@ SOURCES += Hash.cpp \
     ZeroCopyStreamQIODevice.cpp \
     Settings.cpp \
     TransferRateCalculator.cpp \
+    TokenBucket.cpp \
+    BandwidthLimiter.cpp \
+    BlockCompressor.cpp \
+    BlockDecompressor.cpp \
     ProtoHelper.cpp \
     Timeoutable.cpp \
     PersistentData.cpp \
@@ -43,6 +47,10 @@ HEADERS += Hashes.h \
     ZeroCopyStreamQIODevice.h \
     Settings.h \
     TransferRateCalculator.h \
+    TokenBucket.h \
+    BandwidthLimiter.h \
+    BlockCompressor.h \
+    BlockDecompressor.h \
     ProtoHelper.h \
     Timeoutable.h \
     Version.h \
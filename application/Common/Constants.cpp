@@ -15,6 +15,7 @@ using namespace Common;
 #endif
 
 const QString Constants::FILE_CACHE("cache." + FILE_EXTENSION); ///< The name of the file cache saved in the local data directory.
+const QString Constants::FILE_CACHE_JOURNAL("cache_journal.bin"); ///< The changes made to the file cache since it was last saved. Always in binary format.
 const QString Constants::FILE_QUEUE("queue." + FILE_EXTENSION); ///< This file contains the current downloads.
 
 const QString Constants::CORE_SETTINGS_FILENAME("core_settings.txt");
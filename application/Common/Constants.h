@@ -31,6 +31,7 @@ namespace Common
       static const QString FILE_EXTENSION;
 
       static const QString FILE_CACHE;
+      static const QString FILE_CACHE_JOURNAL;
       static const QString FILE_QUEUE;
 
       static const QString CORE_SETTINGS_FILENAME;
@@ -25,7 +25,6 @@ using namespace Common;
 #include <QDirIterator>
 #include <QStringBuilder>
 #include <QtGlobal>
-#include <QRegExp>
 #include <QHostAddress>
 #include <QNetworkInterface>
 
@@ -320,12 +319,14 @@ QString Global::dirName(const QString& path)
    return QDir(path).dirName();
 }
 
-QString Global::toLowerAndRemoveAccents(const QString& str)
+namespace
 {
-   QString strLower = str.toLower();
-
-   for (int i = 0; i < strLower.size(); i++)
-      switch (strLower[i].unicode())
+   /**
+     * Return the letter without its accent, for example 'é' -> 'e'. The letter must be in lower case.
+     */
+   ushort removeAccent(ushort c)
+   {
+      switch (c)
       {
       case 0x00E0: // à .
       case 0x00E1: // á.
@@ -333,40 +334,70 @@ QString Global::toLowerAndRemoveAccents(const QString& str)
       case 0x00E3: // ã.
       case 0x00E4: // ä.
       case 0x00E5: // å.
-         strLower[i] = 'a';
-         break;
+         return 'a';
       case 0x00E7: // ç.
-         strLower[i] = 'c';
-         break;
+         return 'c';
       case 0x00E8: // è.
       case 0x00E9: // é.
       case 0x00EA: // ê.
       case 0x00EB: // ë.
-         strLower[i] = 'e';
-         break;
+         return 'e';
       case 0x00EC: // ì.
       case 0x00ED: // í.
       case 0x00EE: // î.
       case 0x00EF: // ï.
-         strLower[i] = 'i';
-         break;
+         return 'i';
       case 0x00F1: // ñ.
-         strLower[i] = 'n';
-         break;
+         return 'n';
       case 0x00F2: // ò.
       case 0x00F3: // ó.
       case 0x00F4: // ô.
       case 0x00F5: // õ.
       case 0x00F6: // ö.
-         strLower[i] = 'o';
-         break;
+         return 'o';
       case 0x00F9: // ù.
       case 0x00FA: // ú.
       case 0x00FB: // û.
       case 0x00FC: // ü.
-         strLower[i] = 'u';
-         break;
+         return 'u';
+      default:
+         return c;
       }
+   }
+
+   /**
+     * The characters of the words for 'Global::splitInWords(..)' : each UTF-16 code unit is mapped to its lower case form without accent.
+     * The word separators are mapped to 0, they are the same as the regular expression "(\\W+|_)" : all the characters except
+     * the letters, the numbers and the marks, plus '_'. A surrogate is a separator, like for 'QRegExp'.
+     */
+   class WordCharacters
+   {
+   public:
+      WordCharacters()
+      {
+         for (int i = 0; i <= 0xFFFF; i++)
+         {
+            const QChar c = QChar(static_cast<ushort>(i)).toLower();
+            this->table[i] = c.isLetterOrNumber() || c.isMark() ? removeAccent(c.unicode()) : 0;
+         }
+         this->table['_'] = 0;
+      }
+
+      inline ushort fold(QChar c) const { return this->table[c.unicode()]; }
+
+   private:
+      ushort table[0x10000];
+   };
+
+   const WordCharacters wordCharacters; // Built when the library is loaded, thus it can be read by any thread without lock.
+}
+
+QString Global::toLowerAndRemoveAccents(const QString& str)
+{
+   QString strLower = str.toLower();
+
+   for (int i = 0; i < strLower.size(); i++)
+      strLower[i] = removeAccent(strLower[i].unicode());
 
    return strLower;
 }
@@ -375,13 +406,69 @@ QString Global::toLowerAndRemoveAccents(const QString& str)
   * Take raw terms in a string and split, trim and filter to
   * return a list of keyword.
   * Some character or word can be removed.
-  * Maybe a class 'WordSplitter' should be created.
   * @example " The little  DUCK " => ["the", "little", "duck"].
+  * @see splitInWords(const QString&, QString&, QVector<QStringRef>&) to avoid the allocation of each word.
   */
 QStringList Global::splitInWords(const QString& words)
 {
-   const static QRegExp regExp("(\\W+|_)");
-   return Global::toLowerAndRemoveAccents(words).split(regExp, QString::SkipEmptyParts);
+   QString buffer;
+   QVector<QStringRef> wordRefs;
+   Global::splitInWords(words, buffer, wordRefs);
+
+   QStringList result;
+   result.reserve(wordRefs.size());
+   for (int i = 0; i < wordRefs.size(); i++)
+      result << wordRefs[i].toString();
+   return result;
+}
+
+/**
+  * Same as 'splitInWords(const QString&)' but the words are put into 'buffer' and referenced by 'result'.
+  * The same buffer and result can be given for each call, then no memory is allocated once they are big enough.
+  * The words are read with a table, see 'WordCharacters', instead of a regular expression.
+  * @param buffer The content is replaced, the references of 'result' are valid as long as the buffer isn't modified.
+  */
+void Global::splitInWords(const QString& words, QString& buffer, QVector<QStringRef>& result)
+{
+   result.resize(0);
+   if (result.capacity() < words.size() / 2 + 1)
+      result.reserve(words.size() / 2 + 1); // The maximum number of words, it also keeps the capacity of 'result' when it's resized.
+
+   buffer.resize(words.size());
+   const QChar* source = words.constData();
+   QChar* destination = buffer.data();
+
+   int wordBegin = -1;
+   for (int i = 0; i < words.size(); i++)
+   {
+      const ushort c = wordCharacters.fold(source[i]);
+      if (c != 0)
+      {
+         destination[i] = c;
+         if (wordBegin == -1)
+            wordBegin = i;
+      }
+      else if (wordBegin != -1)
+      {
+         result << QStringRef(&buffer, wordBegin, i - wordBegin);
+         wordBegin = -1;
+      }
+   }
+
+   if (wordBegin != -1)
+      result << QStringRef(&buffer, wordBegin, words.size() - wordBegin);
+}
+
+/**
+  * Return a reference to each string, they are valid as long as the list isn't modified.
+  */
+QVector<QStringRef> Global::toStringRefs(const QStringList& strings)
+{
+   QVector<QStringRef> result;
+   result.reserve(strings.size());
+   for (int i = 0; i < strings.size(); i++)
+      result << QStringRef(&strings[i]);
+   return result;
 }
 
 /**
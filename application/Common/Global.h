@@ -21,6 +21,7 @@
 
 #include <QString>
 #include <QList>
+#include <QVector>
 #include <QMutableListIterator>
 
 class QHostAddress;
@@ -61,6 +62,8 @@ namespace Common
 
       static QString toLowerAndRemoveAccents(const QString& str);
       static QStringList splitInWords(const QString& words);
+      static void splitInWords(const QString& words, QString& buffer, QVector<QStringRef>& result);
+      static QVector<QStringRef> toStringRefs(const QStringList& strings);
       static int strcmpi(const std::string& s1, const std::string& s2);
 
       static quint32 hashStringToInt(const QString& str);
@@ -105,6 +108,13 @@ using namespace Common;
 template <typename T>
 void Global::sortedAdd(T* item, QList<T*>& list, bool (*lesserThan)(const T&, const T&))
 {
+   // The items are often added in order, for example when a directory is restored or scanned.
+   if (list.isEmpty() || (lesserThan ? lesserThan(*list.last(), *item) : *list.last() < *item))
+   {
+      list << item;
+      return;
+   }
+
    for (QMutableListIterator<T*> i(list); i.hasNext(); i.next())
    {
       T* e = i.peekNext();
@@ -19,6 +19,8 @@
 #include <Common/Network/MessageHeader.h>
 using namespace Common;
 
+#include <QtEndian>
+
 #include <Protos/common.pb.h>
 #include <Protos/core_protocol.pb.h>
 #include <Protos/gui_protocol.pb.h>
@@ -30,15 +32,17 @@ using namespace Common;
   *
   * Contains all type of messages that can be exchange between cores and between gui and core.
   * Can read or write header message.
+  * A request and all its responses carry the same request ID, thus a response can be matched with its request even if
+  * several requests are pipelined over the same TCP connection and answered in a different order.
   * See the *.proto files in "/application/Protos" for more information.
   */
 
 MessageHeader::MessageHeader() :
-   type(NULL_MESS), size(0)
+   type(NULL_MESS), size(0), requestID(0)
 {}
 
-MessageHeader::MessageHeader(MessageType type, quint32 size, const Hash senderID) :
-   type(type), size(size), senderID(senderID)
+MessageHeader::MessageHeader(MessageType type, quint32 size, const Hash senderID, quint32 requestID) :
+   type(type), size(size), senderID(senderID), requestID(requestID)
 {}
 
 const Hash& MessageHeader::getSenderID() const
@@ -56,6 +60,11 @@ MessageHeader::MessageType MessageHeader::getType() const
    return this->type;
 }
 
+quint32 MessageHeader::getRequestID() const
+{
+   return this->requestID;
+}
+
 bool MessageHeader::isNull() const
 {
    return this->type == NULL_MESS;
@@ -71,7 +80,7 @@ QString MessageHeader::toStr() const
    if (this->isNull())
       return QString("MessageHeader : <null>");
    else
-      return QString("MessageHeader : type = %1, size = %2, senderID = %3").arg(messToStr(static_cast<MessageType>(this->type))).arg(this->size).arg(this->senderID.toStr());
+      return QString("MessageHeader : type = %1, size = %2, senderID = %3, requestID = %4").arg(messToStr(static_cast<MessageType>(this->type))).arg(this->size).arg(this->senderID.toStr()).arg(this->requestID);
 }
 
 QString MessageHeader::messToStr(MessageType type)
@@ -138,52 +147,45 @@ MessageHeader MessageHeader::readHeader(QIODevice& device, bool skipReadData)
 }
 
 /**
-  * @remarks The buffer size must be at least the header size (28 bytes).
+  * @remarks The buffer size must be at least the header size (32 bytes).
   */
 MessageHeader MessageHeader::readHeader(const char* data)
 {
-   MessageHeader header;
-
-   QByteArray array = QByteArray::fromRawData(data, HEADER_SIZE);
-   QDataStream stream(&array, QIODevice::ReadOnly);
-
-   quint32 type;
-   stream >> type;
-   header.type = static_cast<MessageType>(type);
+   const uchar* pos = reinterpret_cast<const uchar*>(data);
 
-   stream >> header.size;
-   stream >> header.senderID;
+   MessageHeader header;
+   header.type = static_cast<MessageType>(qFromBigEndian<quint32>(pos));
+   header.size = qFromBigEndian<quint32>(pos + 4);
+   header.senderID = Hash(data + 8);
+   header.requestID = qFromBigEndian<quint32>(pos + 8 + Hash::HASH_SIZE);
 
    return header;
 }
 
 void MessageHeader::writeHeader(QIODevice& device, const MessageHeader& header)
 {
-   QDataStream stream(&device);
-   MessageHeader::writeHeader(stream, header);
+   char buffer[HEADER_SIZE];
+   MessageHeader::writeHeader(buffer, header);
+   device.write(buffer, HEADER_SIZE);
 }
 
+/**
+  * Same format as 'QDataStream' : the integers are written in big-endian.
+  * @remarks The buffer size must be at least the header size (32 bytes).
+  */
 void MessageHeader::writeHeader(char* buffer, const MessageHeader& header)
 {
-   // We can't use 'fromRawData' because QByteArray can't modify the given buffer.
-   // QByteArray array = QByteArray::fromRawData(buffer, HEADER_SIZE);
+   uchar* pos = reinterpret_cast<uchar*>(buffer);
 
-   QByteArray array(HEADER_SIZE, 0);
-   QDataStream stream(&array, QIODevice::WriteOnly);
-   MessageHeader::writeHeader(stream, header);
-   memcpy(buffer, array.data(), HEADER_SIZE);
-}
-
-inline void MessageHeader::writeHeader(QDataStream& stream, const MessageHeader& header)
-{
-   stream << header.type;
-   stream << header.size;
-   stream << header.senderID;
+   qToBigEndian<quint32>(header.type, pos);
+   qToBigEndian<quint32>(header.size, pos + 4);
+   memcpy(buffer + 8, header.senderID.getData(), Hash::HASH_SIZE);
+   qToBigEndian<quint32>(header.requestID, pos + 8 + Hash::HASH_SIZE);
 }
 
 #ifdef Q_OS_DARWIN
 // For GCC 4.2.
-const int MessageHeader::HEADER_SIZE(sizeof(MessageType) + sizeof(quint32) + Hash::HASH_SIZE);
+const int MessageHeader::HEADER_SIZE(sizeof(MessageType) + sizeof(quint32) + Hash::HASH_SIZE + sizeof(quint32));
 #else
-const int MessageHeader::HEADER_SIZE(sizeof(MessageHeader::type) + sizeof(MessageHeader::size) + Hash::HASH_SIZE);
+const int MessageHeader::HEADER_SIZE(sizeof(MessageHeader::type) + sizeof(MessageHeader::size) + Hash::HASH_SIZE + sizeof(MessageHeader::requestID));
 #endif
@@ -95,11 +95,12 @@ namespace Common
       };      
 
       MessageHeader();
-      MessageHeader(MessageType type, quint32 size, const Hash senderID);
+      MessageHeader(MessageType type, quint32 size, const Hash senderID, quint32 requestID = 0);
 
       const Hash& getSenderID() const;
       quint32 getSize() const;
       MessageType getType() const;
+      quint32 getRequestID() const;
 
       bool isNull() const;
       void setNull();
@@ -113,11 +114,10 @@ namespace Common
       static void writeHeader(char* buffer, const MessageHeader& header);
 
    private:
-      static void writeHeader(QDataStream& stream, const MessageHeader& header);
-
       MessageType type;
       quint32 size;
       Hash senderID;
+      quint32 requestID; ///< Identify a request and its responses when several requests are pipelined over the same connection, 0 if not used.
 
    public:
       static const int HEADER_SIZE;
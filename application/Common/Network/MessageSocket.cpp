@@ -25,7 +25,6 @@ using namespace Common;
 #include <Protos/core_protocol.pb.h>
 #include <Protos/gui_protocol.pb.h>
 
-#include <ZeroCopyStreamQIODevice.h>
 #include <ProtoHelper.h>
 #include <Global.h>
 
@@ -103,31 +102,47 @@ Hash MessageSocket::getRemoteID() const
   */
 void MessageSocket::send(MessageHeader::MessageType type, const google::protobuf::Message& message)
 {
-   this->send(type, &message);
+   this->send(type, &message, 0);
 }
 
 void MessageSocket::send(MessageHeader::MessageType type)
 {
-   this->send(type, 0);
+   this->send(type, 0, 0);
 }
 
-void MessageSocket::send(MessageHeader::MessageType type, const google::protobuf::Message* message)
+/**
+  * Send a message which belongs to a pipelined request, see 'MessageHeader::getRequestID()'.
+  */
+void MessageSocket::send(MessageHeader::MessageType type, const google::protobuf::Message& message, quint32 requestID)
+{
+   this->send(type, &message, requestID);
+}
+
+void MessageSocket::send(MessageHeader::MessageType type, const google::protobuf::Message* message, quint32 requestID)
 {
    if (!this->listening)
       return;
 
-   MessageHeader header(type, message ? message->ByteSize() : 0, this->localID);
+   const int bodySize = message ? message->ByteSize() : 0;
+   MessageHeader header(type, bodySize, this->localID, requestID);
 
    MESSAGE_SOCKET_LOG_DEBUG(QString("Socket[%1]::send : %2 to %3\n%4").arg(this->num).arg(header.toStr()).arg(this->remoteID.toStr()).arg(message ? ProtoHelper::getDebugStr(*message) : "<empty message>"));
 
-   MessageHeader::writeHeader(*this->socket, header);
+   // The header and the body are serialized in the same buffer and written with a single call.
+   const int messageSize = MessageHeader::HEADER_SIZE + bodySize;
+   if (this->sendBuffer.size() < messageSize)
+      this->sendBuffer.resize(messageSize);
 
+   char* buffer = this->sendBuffer.data();
+   MessageHeader::writeHeader(buffer, header);
    if (message)
-   {
-      ZeroCopyOutputStreamQIODevice outputStream(this->socket);
-      if (!message->SerializeToZeroCopyStream(&outputStream))
-         MESSAGE_SOCKET_LOG_ERROR(QString("Unable to send\n%1").arg(ProtoHelper::getDebugStr(*message)));
-   }
+      message->SerializeWithCachedSizesToArray(reinterpret_cast<google::protobuf::uint8*>(buffer + MessageHeader::HEADER_SIZE)); // 'ByteSize()' has been called above.
+
+   if (this->socket->write(buffer, messageSize) != messageSize)
+      MESSAGE_SOCKET_LOG_ERROR(QString("Unable to send\n%1").arg(message ? ProtoHelper::getDebugStr(*message) : "<empty message>"));
+
+   if (this->sendBuffer.size() > MAX_BUFFER_SIZE_KEPT)
+      this->sendBuffer.clear();
 
    if (this->socket->state() == QAbstractSocket::ConnectedState)
       this->socket->flush();
@@ -184,6 +199,14 @@ bool MessageSocket::isListening() const
    return this->listening;
 }
 
+/**
+  * The header of the message being read, only valid during a call to 'onNewMessage(..)'.
+  */
+const MessageHeader& MessageSocket::getCurrentHeader() const
+{
+   return this->currentHeader;
+}
+
 void MessageSocket::dataReceivedSlot()
 {
    while (!this->socket->atEnd() && this->listening)
@@ -276,13 +299,20 @@ bool MessageSocket::readMessage()
    }
 }
 
+/**
+  * The body of the message is read in a buffer kept between the messages and parsed from there.
+  */
 bool MessageSocket::readProtoMessage(google::protobuf::Message& message)
 {
-   bool readOK = false;
-   {
-      ZeroCopyInputStreamQIODevice inputStream(this->socket);
-      readOK = message.ParseFromBoundedZeroCopyStream(&inputStream, this->currentHeader.getSize());
-   }
+   const int bodySize = static_cast<int>(this->currentHeader.getSize());
+   if (this->receiveBuffer.size() < bodySize)
+      this->receiveBuffer.resize(bodySize);
+
+   char* buffer = this->receiveBuffer.data();
+   const bool readOK = this->socket->read(buffer, bodySize) == bodySize && message.ParseFromArray(buffer, bodySize);
+
+   if (this->receiveBuffer.size() > MAX_BUFFER_SIZE_KEPT)
+      this->receiveBuffer.clear();
 
    if (readOK)
    {
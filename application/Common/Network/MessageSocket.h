@@ -20,6 +20,7 @@
 #define COMMON_MESSAGE_SOCKET_H
 
 #include <QString>
+#include <QByteArray>
 #include <QTcpSocket>
 #include <QAbstractSocket>
 #include <QHostAddress>
@@ -43,6 +44,10 @@ namespace Common
    class MessageSocket : public QObject, Uncopyable
    {
       Q_OBJECT
+
+      // The buffers used to send and receive the messages are kept between two messages unless they become larger than this size.
+      static const int MAX_BUFFER_SIZE_KEPT = 64 * 1024; // [byte].
+
    protected:
       class ILogger
       {
@@ -65,8 +70,10 @@ namespace Common
 
       virtual void send(MessageHeader::MessageType type, const google::protobuf::Message& message);
       virtual void send(MessageHeader::MessageType type);
+   protected:
+      void send(MessageHeader::MessageType type, const google::protobuf::Message& message, quint32 requestID);
    private:
-      virtual void send(MessageHeader::MessageType type, const google::protobuf::Message* message);
+      virtual void send(MessageHeader::MessageType type, const google::protobuf::Message* message, quint32 requestID);
 
    public:
       virtual void startListening();
@@ -85,6 +92,7 @@ namespace Common
 
    protected:
       bool isListening() const;
+      const MessageHeader& getCurrentHeader() const;
 
    private slots:
       void dataReceivedSlot();
@@ -120,6 +128,9 @@ namespace Common
 
       MessageHeader currentHeader;
 
+      QByteArray sendBuffer;
+      QByteArray receiveBuffer;
+
 #ifdef DEBUG
       // To identify the sockets in debug mode.
    protected:
@@ -19,6 +19,8 @@
 #include <Common/PersistentData.h>
 using namespace Common;
 
+#include <limits>
+
 #include <QFile>
 #include <QDir>
 #include <QtDebug>
@@ -147,7 +149,16 @@ try
    }
    else
    {
-      data.ParsePartialFromFileDescriptor(file.handle());
+      // The file is mapped into memory to be parsed directly without being copied through a buffer.
+      const qint64 size = file.size();
+      uchar* mappedData = size > 0 && size <= std::numeric_limits<int>::max() ? file.map(0, size) : 0;
+      if (mappedData)
+      {
+         data.ParsePartialFromArray(mappedData, size);
+         file.unmap(mappedData);
+      }
+      else
+         data.ParsePartialFromFileDescriptor(file.handle());
    }
 #endif
 }
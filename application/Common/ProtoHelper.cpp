@@ -21,6 +21,7 @@ using namespace Common;
 
 #include <QRegExp>
 #include <QStringList>
+#include <QVector>
 
 void ProtoHelper::setLang(Protos::Common::Language& langMess, const QLocale& locale)
 {
@@ -115,6 +116,39 @@ QString ProtoHelper::getRelativePath(const Protos::Common::Entry& entry, bool ap
    return path;
 }
 
+/**
+  * Put back the path and the shared directory into each entry of a compact result, the tables are removed.
+  * The indexes outside of the tables are ignored. See 'Protos.Common.FindResult'.
+  */
+void ProtoHelper::expandFindResult(Protos::Common::FindResult& result)
+{
+   // Each path of the table begins with some bytes of the previous one.
+   QVector<std::string> paths(result.path_size());
+   for (int i = 0; i < paths.size(); i++)
+   {
+      if (i > 0)
+         paths[i].assign(paths[i-1], 0, result.path(i).common_prefix());
+      paths[i].append(result.path(i).suffix());
+   }
+
+   for (int i = 0; i < result.entry_size(); i++)
+   {
+      Protos::Common::FindResult_EntryLevel* entryLevel = result.mutable_entry(i);
+
+      if (entryLevel->has_path_index() && entryLevel->path_index() < static_cast<quint32>(paths.size()))
+         entryLevel->mutable_entry()->set_path(paths[entryLevel->path_index()]);
+
+      if (entryLevel->has_shared_dir_index() && entryLevel->shared_dir_index() < static_cast<quint32>(result.shared_dir_size()))
+         entryLevel->mutable_entry()->mutable_shared_dir()->CopyFrom(result.shared_dir(entryLevel->shared_dir_index()));
+
+      entryLevel->clear_path_index();
+      entryLevel->clear_shared_dir_index();
+   }
+
+   result.clear_path();
+   result.clear_shared_dir();
+}
+
 QString ProtoHelper::getDebugStr(const google::protobuf::Message& mess)
 {
    std::string debugString = mess.DebugString();
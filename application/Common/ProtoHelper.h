@@ -63,6 +63,8 @@ namespace Common
         */
       static QString getRelativePath(const Protos::Common::Entry& entry, bool appendFilename = true);
 
+      static void expandFindResult(Protos::Common::FindResult& result);
+
       static QString getDebugStr(const google::protobuf::Message& mess);
    };
 }
@@ -23,6 +23,8 @@
 #include <QFile>
 #include <QDir>
 #include <QElapsedTimer>
+#include <QTcpServer>
+#include <QTcpSocket>
 
 #include <Protos/common.pb.h>
 #include <Protos/core_settings.pb.h>
@@ -31,6 +33,9 @@
 #include <PersistentData.h>
 #include <Settings.h>
 #include <Global.h>
+#include <TokenBucket.h>
+#include <BlockCompressor.h>
+#include <BlockDecompressor.h>
 #include <ZeroCopyStreamQIODevice.h>
 using namespace Common;
 
@@ -111,6 +116,21 @@ void Tests::splitInWords()
     QCOMPARE(Global::splitInWords("ABC DEF"), QStringList() << "abc" << "def");
     QCOMPARE(Global::splitInWords(QString::fromUtf8("àéè")), QStringList() << "aee");
     QCOMPARE(Global::splitInWords("abc%_-[]def"), QStringList() << "abc" << "def");
+    QCOMPARE(Global::splitInWords(""), QStringList());
+    QCOMPARE(Global::splitInWords(" _-. "), QStringList());
+    QCOMPARE(Global::splitInWords(QString::fromUtf8("Ça Ü Éé2010")), QStringList() << "ca" << "u" << "ee2010");
+    QCOMPARE(Global::splitInWords(QString::fromUtf8("Пётр-Ильич")), QStringList() << QString::fromUtf8("пётр") << QString::fromUtf8("ильич"));
+
+    // The same buffers are used for each call.
+    QString buffer;
+    QVector<QStringRef> words;
+    Global::splitInWords("The little  DUCK", buffer, words);
+    QCOMPARE(words.size(), 3);
+    QCOMPARE(words[0].toString(), QString("the"));
+    QCOMPARE(words[2].toString(), QString("duck"));
+    Global::splitInWords("a", buffer, words);
+    QCOMPARE(words.size(), 1);
+    QCOMPARE(words[0].toString(), QString("a"));
 }
 
 void Tests::hashStringToInt()
@@ -292,7 +312,8 @@ void Tests::messageHeader()
       0x34, -0x59,  0x38,  0x37,
      -0x2C,  0x22, -0x09, -0x55,
      -0x5E,  0x74,  0x0D, -0x7C,
-      0x09, -0x54,  0x60, -0x21
+      0x09, -0x54,  0x60, -0x21,
+      0x00,  0x00,  0x01,  0x02
    };
 
    const QString peerID("2d73736f34a73837d422f7aba2740d8409ac60df");
@@ -304,6 +325,7 @@ void Tests::messageHeader()
    QCOMPARE(header.getType(), MessageHeader::CORE_IM_ALIVE);
    QCOMPARE(header.getSize(), 42u);
    QCOMPARE(header.getSenderID().toStr(), peerID);
+   QCOMPARE(header.getRequestID(), 258u);
 
    // We use a larger buffer to check if the last four bytes has been alterate.
    char buffer[MessageHeader::HEADER_SIZE + 4];
@@ -314,6 +336,179 @@ void Tests::messageHeader()
    QVERIFY(qstrncmp(buffer + MessageHeader::HEADER_SIZE, "\0\0\0\0", 4) == 0);
 }
 
+/**
+  * Send one second of data through a loopback connection at a limited rate.
+  * The achieved rate must be close to the limit and the data must arrive regularly.
+  */
+void Tests::tokenBucketPacingOnLoopback()
+{
+   const quint32 RATE = 512 * 1024; // [B/s].
+   const int TOTAL = RATE;
+
+   QTcpServer server;
+   QVERIFY(server.listen(QHostAddress::LocalHost));
+   QTcpSocket sender;
+   sender.connectToHost(QHostAddress::LocalHost, server.serverPort());
+   QVERIFY(sender.waitForConnected(1000));
+   QVERIFY(server.waitForNewConnection(1000));
+   QTcpSocket* receiver = server.nextPendingConnection();
+
+   TokenBucket bucket;
+   bucket.setRate(RATE);
+
+   const QByteArray data(bucket.getSliceSize(TOTAL), 'x');
+
+   QElapsedTimer timer;
+   timer.start();
+   qint64 lastReception = 0;
+   qint64 maxGap = 0;
+   int bytesReceived = 0;
+
+   for (int bytesSent = 0; bytesSent < TOTAL;)
+   {
+      const int sliceSize = bucket.getSliceSize(TOTAL - bytesSent);
+      QVERIFY(sliceSize <= data.size());
+      QCOMPARE(sender.write(data.constData(), sliceSize), static_cast<qint64>(sliceSize));
+      QVERIFY(sender.waitForBytesWritten(1000));
+      bytesSent += sliceSize;
+
+      while (bytesReceived < bytesSent)
+      {
+         if (receiver->bytesAvailable() == 0)
+            QVERIFY(receiver->waitForReadyRead(1000));
+         bytesReceived += receiver->readAll().size();
+
+         const qint64 now = timer.elapsed();
+         maxGap = qMax(maxGap, now - lastReception);
+         lastReception = now;
+      }
+
+      TokenBucket::sleep(bucket.consume(sliceSize));
+   }
+
+   const qint64 elapsed = timer.elapsed();
+   const int rate = 1000LL * TOTAL / elapsed;
+   qDebug() << "Elapsed time:" << elapsed << "ms, rate:" << Global::formatByteSize(rate) << "/s, max gap:" << maxGap << "ms";
+
+   QVERIFY(rate < RATE * 1.1);
+   QVERIFY(rate > RATE * 0.9);
+   QVERIFY(maxGap < 50);
+}
+
+/**
+  * Two children consume concurrently from a parent, the parent limit must be respected and shared.
+  */
+void Tests::tokenBucketHierarchy()
+{
+   const quint32 RATE = 256 * 1024; // [B/s].
+   const int TOTAL = RATE;
+
+   TokenBucket parent;
+   parent.setRate(RATE);
+   TokenBucket child1(&parent);
+   child1.setRate(RATE * 4);
+   TokenBucket child2(&parent);
+
+   QCOMPARE(child1.getSliceSize(TOTAL), parent.getSliceSize(TOTAL));
+   QCOMPARE(child2.getSliceSize(TOTAL), parent.getSliceSize(TOTAL));
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int consumed1 = 0;
+   int consumed2 = 0;
+   while (consumed1 + consumed2 < TOTAL)
+   {
+      const bool first = consumed1 <= consumed2;
+      TokenBucket& child = first ? child1 : child2;
+      int& consumed = first ? consumed1 : consumed2;
+
+      const int sliceSize = child.getSliceSize(TOTAL - consumed1 - consumed2);
+      consumed += sliceSize;
+      TokenBucket::sleep(child.consume(sliceSize));
+   }
+
+   const qint64 elapsed = timer.elapsed();
+   const int rate = 1000LL * TOTAL / elapsed;
+   qDebug() << "Elapsed time:" << elapsed << "ms, rate:" << Global::formatByteSize(rate) << "/s";
+
+   QVERIFY(rate < RATE * 1.1);
+   QVERIFY(rate > RATE * 0.9);
+   QVERIFY(qAbs(consumed1 - consumed2) <= parent.getSliceSize(TOTAL));
+}
+
+/**
+  * At a very low rate the delay to wait is long, it must be possible to wait it by short steps.
+  */
+void Tests::tokenBucketLongDelayBySteps()
+{
+   TokenBucket bucket;
+   bucket.setRate(1);
+
+   const int delay = bucket.consume(bucket.getSliceSize(1024 * 1024));
+   QVERIFY(delay >= 1000 * 1000);
+
+   QElapsedTimer timer;
+   timer.start();
+   const int remainingDelay = TokenBucket::sleepStep(delay);
+   const qint64 elapsed = timer.elapsed();
+
+   QVERIFY(elapsed < 1000);
+   QVERIFY(remainingDelay >= delay - 1000);
+   QCOMPARE(TokenBucket::sleepStep(0), 0);
+}
+
+/**
+  * Some compressible data followed by some random data are encoded then decoded by slices of various sizes.
+  */
+void Tests::compressAndDecompressBlocks()
+{
+   const int TEXT_SIZE = 3 * 1024 * 1024 + 42;
+   const int RANDOM_SIZE = 256 * 1024;
+
+   QByteArray data;
+   while (data.size() < TEXT_SIZE)
+      data.append(QString("Line %1 of a text which compresses well.\n").arg(data.size()).toAscii());
+   data.truncate(TEXT_SIZE);
+   for (int i = 0; i < RANDOM_SIZE; i++)
+      data.append(static_cast<char>(qrand()));
+
+   BlockCompressor compressor(0.8, 4);
+   const QByteArray blocks = compressor.encode(data.constData(), TEXT_SIZE).append(compressor.encode(data.constData() + TEXT_SIZE, RANDOM_SIZE));
+   qDebug() << "Size:" << data.size() << ", encoded size:" << blocks.size();
+   QVERIFY(blocks.size() < TEXT_SIZE / 2 + RANDOM_SIZE);
+
+   BlockDecompressor decompressor;
+   QByteArray decodedData;
+   char buffer[10000];
+   for (int offset = 0; offset < blocks.size();)
+   {
+      const int sliceSize = qMin(1 + qrand() % 5000, blocks.size() - offset);
+      decompressor.feed(blocks.constData() + offset, sliceSize);
+      offset += sliceSize;
+
+      while (int bytesRead = decompressor.read(buffer, 1 + qrand() % sizeof(buffer)))
+         decodedData.append(buffer, bytesRead);
+   }
+
+   QVERIFY(!decompressor.hasError());
+   QVERIFY(decodedData == data);
+}
+
+void Tests::decompressCorruptedBlock()
+{
+   const QByteArray data(100000, 'a');
+   BlockCompressor compressor(0.8, 4);
+   QByteArray blocks = compressor.encode(data.constData(), data.size());
+   blocks[BlockCompressor::HEADER_SIZE + 10] = ~blocks[BlockCompressor::HEADER_SIZE + 10];
+
+   BlockDecompressor decompressor;
+   decompressor.feed(blocks.constData(), blocks.size());
+   char buffer[1024];
+   QCOMPARE(decompressor.read(buffer, sizeof(buffer)), 0);
+   QVERIFY(decompressor.hasError());
+}
+
 void Tests::readAndWriteWithZeroCopyStreamQIODevice()
 {
    QString filePath(QDir::tempPath().append("/test.bin"));
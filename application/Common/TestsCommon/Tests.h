@@ -58,6 +58,15 @@ private slots:
 
    void messageHeader();
 
+   // TokenBucket class.
+   void tokenBucketPacingOnLoopback();
+   void tokenBucketHierarchy();
+   void tokenBucketLongDelayBySteps();
+
+   // BlockCompressor and BlockDecompressor classes.
+   void compressAndDecompressBlocks();
+   void decompressCorruptedBlock();
+
    // ZeroCopyOutputStreamQIODevice and ZeroCopyInputStreamQIODevice classes.
    void readAndWriteWithZeroCopyStreamQIODevice();
 
@@ -0,0 +1,142 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <TokenBucket.h>
+using namespace Common;
+
+#include <QThread>
+#include <QMutexLocker>
+
+namespace
+{
+   // 'QThread::msleep(..)' is protected.
+   class Sleeper : public QThread
+   {
+   public:
+      static void msleep(unsigned long ms) { QThread::msleep(ms); }
+   };
+}
+
+/**
+  * @class Common::TokenBucket
+  *
+  * Limit a transfer rate. The bucket is filled with tokens at the given rate, one token per byte, and can hold
+  * at most the tokens of 'BURST_DURATION'. Each byte transferred consumes a token, when there is no more token
+  * the transfer must wait for the delay returned by 'consume(..)'.
+  * A bucket can have a parent, for example a bucket per peer with a global bucket as parent. The bytes consumed
+  * from a bucket are also consumed from its parent, thus the slowest of them gives the pace.
+  * To keep a steady pace the data should be transferred by slices, see 'getSliceSize(..)'.
+  * An instance of 'TokenBucket' can be shared among several threads.
+  */
+
+TokenBucket::TokenBucket(TokenBucket* parent) :
+   parent(parent), rate(0), tokens(0)
+{
+   this->timer.start();
+}
+
+/**
+  * @param rate [B/s], 0 means no limit.
+  */
+void TokenBucket::setRate(quint32 rate)
+{
+   QMutexLocker locker(&this->mutex);
+
+   this->rate = rate;
+   this->tokens = 0;
+   this->timer.start();
+}
+
+quint32 TokenBucket::getRate() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->rate;
+}
+
+/**
+  * Return the amount of bytes which should be transferred at once, it's never greater than the given size.
+  * It corresponds to 'SLICE_DURATION' at the lowest rate of the bucket and its parents.
+  */
+int TokenBucket::getSliceSize(int size) const
+{
+   this->mutex.lock();
+   if (this->rate != 0)
+      size = qMin<qint64>(size, qMax<qint64>(MIN_SLICE_SIZE, static_cast<qint64>(this->rate) * SLICE_DURATION / 1000));
+   this->mutex.unlock();
+
+   return this->parent ? this->parent->getSliceSize(size) : size;
+}
+
+/**
+  * Consume some tokens from the bucket and from its parents.
+  * @return The time to wait before transferring more bytes [ms], 0 if there is no limit or if there are some tokens remaining.
+  */
+int TokenBucket::consume(int bytes)
+{
+   int delay = 0;
+
+   this->mutex.lock();
+   if (this->rate != 0)
+   {
+      this->refill();
+      this->tokens -= bytes;
+      if (this->tokens < 0)
+         delay = (-this->tokens * 1000 + this->rate - 1) / this->rate;
+   }
+   this->mutex.unlock();
+
+   return this->parent ? qMax(delay, this->parent->consume(bytes)) : delay;
+}
+
+/**
+  * Sleep the current thread, typically during the delay returned by 'consume(..)'.
+  * A transfer which can be stopped must use 'sleepStep(..)' instead.
+  */
+void TokenBucket::sleep(int ms)
+{
+   if (ms > 0)
+      Sleeper::msleep(ms);
+}
+
+/**
+  * Sleep the current thread during the given delay but not longer than 'MAX_SLEEP_DURATION'.
+  * At a low rate the delay returned by 'consume(..)' can be long, a transfer has to call this method until
+  * the remaining delay is 0 and check between the calls if it must stop.
+  * @return The remaining delay [ms].
+  */
+int TokenBucket::sleepStep(int ms)
+{
+   if (ms <= 0)
+      return 0;
+
+   int duration = ms;
+   if (duration > MAX_SLEEP_DURATION)
+      duration = MAX_SLEEP_DURATION;
+
+   Sleeper::msleep(duration);
+   return ms - duration;
+}
+
+void TokenBucket::refill()
+{
+   const qint64 burst = qMax<qint64>(MIN_SLICE_SIZE, static_cast<qint64>(this->rate) * BURST_DURATION / 1000);
+   const qint64 elapsed = this->timer.nsecsElapsed();
+   this->timer.start();
+
+   this->tokens = qMin(burst, this->tokens + static_cast<qint64>(static_cast<double>(elapsed) * this->rate / 1000000000.0));
+}
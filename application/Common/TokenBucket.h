@@ -0,0 +1,61 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef COMMON_TOKENBUCKET_H
+#define COMMON_TOKENBUCKET_H
+
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include <Common/Uncopyable.h>
+
+namespace Common
+{
+   class TokenBucket : Common::Uncopyable
+   {
+      static const int BURST_DURATION = 50; // [ms].
+      static const int SLICE_DURATION = 10; // [ms].
+      static const int MIN_SLICE_SIZE = 1024; // [B].
+      static const int MAX_SLEEP_DURATION = 100; // [ms].
+
+   public:
+      TokenBucket(TokenBucket* parent = 0);
+
+      void setRate(quint32 rate);
+      quint32 getRate() const;
+
+      int getSliceSize(int size) const;
+      int consume(int bytes);
+
+      static void sleep(int ms);
+      static int sleepStep(int ms);
+
+   private:
+      void refill();
+
+      TokenBucket* const parent;
+
+      mutable QMutex mutex;
+      QElapsedTimer timer;
+
+      quint32 rate; // [B/s], 0 means no limit.
+      qint64 tokens; // [B], can be negative when more bytes than allowed have been consumed.
+   };
+}
+
+#endif
@@ -144,6 +144,7 @@ void Core::checkSettingsIntegrity()
 
    this->checkSetting("minimum_duration_when_hashing", 100u, 30u * 1000u);
    this->checkSetting("scan_period_unwatchable_dirs", 1000u, 60u * 60u * 1000u);
+   this->checkSetting("full_scan_period_unwatchable_dirs", 1000u, 24u * 60u * 60u * 1000u);
    QRegExp unfinishedSuffixExp("^\\.\\S+$");
    if (!unfinishedSuffixExp.exactMatch(SETTINGS.get<QString>("unfinished_suffix_term")))
    {
@@ -158,6 +159,7 @@ void Core::checkSettingsIntegrity()
    this->checkSetting("idle_socket_timeout", 1000u, 60u * 60u * 1000u);
    this->checkSetting("max_number_idle_socket", 0u, 10u);
    this->checkSetting("get_hashes_timeout", 1000u, 60u * 1000u);
+   this->checkSetting("max_number_pipelined_requests", 1u, 1000u);
 
    this->checkSetting("number_of_downloader", 1u, 10u);
    this->checkSetting("lan_speed", 1024u * 1024u, 1024u * 1024u * 1024u);
@@ -167,16 +169,31 @@ void Core::checkSettingsIntegrity()
    this->checkSetting("peer_imalive_period", 1000u, 60u * 1000u);
    this->checkSetting("save_queue_period", 1000u, 4294967295u);
    this->checkSetting("ban_duration_corrupted_data", 0u, 60u * 60u * 1000u);
+   if (SETTINGS.get<quint32>("download_rate_limit") != 0) // 0 means no limit, a lower rate than 1 KiB/s would stall the transfers.
+      this->checkSetting("download_rate_limit", 1024u, 4294967295u);
+   if (SETTINGS.get<quint32>("download_rate_limit_per_peer") != 0)
+      this->checkSetting("download_rate_limit_per_peer", 1024u, 4294967295u);
+   this->checkSetting("too_many_connections_back_off", 0u, 60u * 60u * 1000u);
 
    this->checkSetting("upload_lifetime", 0u, 30u * 1000u);
    this->checkSetting("upload_min_nb_thread", 1u, 1000u);
    this->checkSetting("upload_thread_lifetime", 0u, 60u * 60u * 1000u);
+   if (SETTINGS.get<quint32>("upload_rate_limit") != 0)
+      this->checkSetting("upload_rate_limit", 1024u, 4294967295u);
+   if (SETTINGS.get<quint32>("upload_rate_limit_per_peer") != 0)
+      this->checkSetting("upload_rate_limit_per_peer", 1024u, 4294967295u);
+   this->checkSetting("number_of_uploader", 1u, 100u);
+   this->checkSetting("upload_queue_size", 0u, 10000u);
+   this->checkSetting("upload_queue_timeout", 0u, 60u * 1000u);
+   this->checkSetting("upload_compression_ratio", 0.0, 1.0);
+   this->checkSetting("upload_compression_nb_blocks_to_skip", 0u, 10000u);
 
    this->checkSetting("unicast_base_port", 1u, 65535u);
    this->checkSetting("multicast_port", 1u, 65535u);
    this->checkSetting("multicast_ttl", 1u, 255u);
    this->checkSetting("max_udp_datagram_size", 255u, 65535u);
    this->checkSetting("udp_read_buffer_size", 255u, 6684672u);
+   this->checkSetting("udp_batch_size", 1u, 1024u);
    this->checkSetting("number_of_hashes_sent_imalive", 1u, 1000u);
    this->checkSetting("max_number_of_search_result_to_send", 1u, 10000u);
    this->checkSetting("max_number_of_result_shown", 1u, 100000u);
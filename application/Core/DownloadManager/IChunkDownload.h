@@ -37,6 +37,7 @@ namespace DM
 
       /**
         * Define (or redefine) the peers which have the chunk.
+        * When called from another thread the change is queued to the thread of the chunk download.
         */
       virtual void addPeerID(const Common::Hash& peerID) = 0;
       virtual void rmPeerID(const Common::Hash& peerID) = 0;
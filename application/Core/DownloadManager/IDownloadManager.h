@@ -75,6 +75,13 @@ namespace DM
         * @return Byte/s.
         */
       virtual int getDownloadRate() = 0;
+
+      /**
+        * Limit the download rate for all the peers and for each peer.
+        * @param rate [B/s], 0 means no limit.
+        * @param ratePerPeer [B/s], 0 means no limit.
+        */
+      virtual void setDownloadRateLimit(quint32 rate, quint32 ratePerPeer) = 0;
    };
 }
 #endif
@@ -36,13 +36,15 @@ using namespace DM;
 
 const int ChunkDownload::MINIMUM_DELTA_TIME_TO_COMPUTE_SPEED(100); // [ms]
 
-ChunkDownload::ChunkDownload(QSharedPointer<PM::IPeerManager> peerManager, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash) :
+ChunkDownload::ChunkDownload(QSharedPointer<PM::IPeerManager> peerManager, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::BandwidthLimiter& bandwidthLimiter, Common::ThreadPool& threadPool, Common::Hash chunkHash) :
    peerManager(peerManager),
    occupiedPeersDownloadingChunk(occupiedPeersDownloadingChunk),
    transferRateCalculator(transferRateCalculator),
+   bandwidthLimiter(bandwidthLimiter),
    threadPool(threadPool),
    chunkHash(chunkHash),
    socket(0),
+   compressed(false),
    downloading(false),
    networkTransferStatus(PM::ISocket::SFS_OK),
    lastTransfertStatus(QUEUED),
@@ -83,6 +85,12 @@ Common::Hash ChunkDownload::getHash() const
 
 void ChunkDownload::addPeerID(const Common::Hash& peerID)
 {
+   if (QThread::currentThread() != this->thread())
+   {
+      QMetaObject::invokeMethod(this, "addPeerID", Qt::QueuedConnection, Q_ARG(Common::Hash, peerID));
+      return;
+   }
+
    QMutexLocker locker(&this->mutex);
    PM::IPeer* peer = this->peerManager->getPeer(peerID);
    if (peer && !this->peers.contains(peer))
@@ -95,6 +103,12 @@ void ChunkDownload::addPeerID(const Common::Hash& peerID)
 
 void ChunkDownload::rmPeerID(const Common::Hash& peerID)
 {
+   if (QThread::currentThread() != this->thread())
+   {
+      QMetaObject::invokeMethod(this, "rmPeerID", Qt::QueuedConnection, Q_ARG(Common::Hash, peerID));
+      return;
+   }
+
    QMutexLocker locker(&this->mutex);
    PM::IPeer* peer = this->peerManager->getPeer(peerID);
    if (peer)
@@ -126,6 +140,12 @@ void ChunkDownload::run()
       static const int BUFFER_SIZE = SETTINGS.get<quint32>("buffer_size_writing");
       char buffer[BUFFER_SIZE];
 
+      // The socket is read by small slices when the rate is limited, the remote uploader is then slowed down by the TCP flow control.
+      QSharedPointer<Common::TokenBucket> tokenBucket = this->bandwidthLimiter.getPeerBucket(this->currentDownloadingPeer->getID());
+
+      // The data may be compressed by the uploader, they are decompressed before being written thus the hash is computed on the original data.
+      Common::BlockDecompressor decompressor;
+
       const int initialKnownBytes = this->chunk->getKnownBytes();
       int bytesToRead = this->chunkSize - initialKnownBytes;
       int bytesToWrite = 0;
@@ -143,11 +163,18 @@ void ChunkDownload::run()
          }
          this->mutex.unlock();
 
-         int bytesRead = this->socket->read(buffer + bytesToWrite, bytesToRead < BUFFER_SIZE - bytesToWrite ? bytesToRead : BUFFER_SIZE - bytesToWrite);
+         const int maxSize = bytesToRead < BUFFER_SIZE - bytesToWrite ? bytesToRead : BUFFER_SIZE - bytesToWrite;
+         int bytesRead = this->compressed ?
+            this->readBlocks(buffer + bytesToWrite, maxSize, decompressor, *tokenBucket) :
+            this->socket->read(buffer + bytesToWrite, tokenBucket->getSliceSize(maxSize));
          bytesToRead -= bytesRead;
 
          if (bytesRead == 0)
          {
+            // 'readBlocks(..)' returns 0 when the download is stopped while waiting for some tokens.
+            if (!this->isDownloading())
+               continue;
+
             if (!this->socket->waitForReadyRead(SOCKET_TIMEOUT))
             {
                L_WARN(QString("Connection dropped, error = %1, bytesAvailable = %2").arg(socket->errorString()).arg(socket->bytesAvailable()));
@@ -198,7 +225,11 @@ void ChunkDownload::run()
             bytesToWrite = 0;
          }
 
-         this->transferRateCalculator.addData(bytesRead);
+         if (!this->compressed) // The received blocks are counted by 'readBlocks(..)'.
+         {
+            this->transferRateCalculator.addData(bytesRead);
+            this->consumeTokens(*tokenBucket, bytesRead);
+         }
 
          if (initialKnownBytes + bytesWritten >= this->chunkSize)
             break;
@@ -236,6 +267,12 @@ void ChunkDownload::run()
    if (timer.elapsed() > MINIMUM_DELTA_TIME_TO_COMPUTE_SPEED)
       this->currentDownloadingPeer->setSpeed(deltaRead / timer.elapsed() * 1000);
 
+   // Only the errors caused by the peer are taken into account.
+   if (this->lastTransfertStatus == TRANSFERT_ERROR || this->lastTransfertStatus == GOT_TOO_MUCH_DATA || this->lastTransfertStatus == HASH_MISSMATCH)
+      this->currentDownloadingPeer->setTransferResult(false);
+   else if (this->chunk->isComplete())
+      this->currentDownloadingPeer->setTransferResult(true);
+
    this->socket->setReadBufferSize(0);
    this->socket->moveToThread(this->mainThread);
 }
@@ -385,11 +422,14 @@ bool ChunkDownload::startDownloading()
    Protos::Core::GetChunk getChunkMess;
    getChunkMess.mutable_chunk()->set_hash(this->chunkHash.getData(), Common::Hash::HASH_SIZE);
    getChunkMess.set_offset(this->chunk->getKnownBytes());
+   getChunkMess.set_compression_supported(true);
+   this->compressed = false;
    this->getChunkResult = this->currentDownloadingPeer->getChunk(getChunkMess);
    connect(this->getChunkResult.data(), SIGNAL(result(const Protos::Core::GetChunkResult&)), this, SLOT(result(const Protos::Core::GetChunkResult&)), Qt::DirectConnection);
    connect(this->getChunkResult.data(), SIGNAL(stream(QSharedPointer<PM::ISocket>)), this, SLOT(stream(QSharedPointer<PM::ISocket>)), Qt::DirectConnection);
    connect(this->getChunkResult.data(), SIGNAL(timeout()), this, SLOT(getChunkTimeout()), Qt::DirectConnection);
 
+   this->getChunkTimer.start();
    this->getChunkResult->start();
    return true;
 }
@@ -407,7 +447,13 @@ void ChunkDownload::reset()
 
 void ChunkDownload::result(const Protos::Core::GetChunkResult& result)
 {
-   if (result.status() != Protos::Core::GetChunkResult_Status_OK)
+   if (result.status() == Protos::Core::GetChunkResult_Status_TOO_MANY_CONNECTIONS)
+   {
+      // The peer keeps the chunk but is too busy, we will try another peer or this one later.
+      L_DEBU(QString("The peer %1 has no free upload slot, chunk : %2").arg(this->currentDownloadingPeer->toStringLog()).arg(this->chunk->toStringLog()));
+      this->downloadingEnded(SETTINGS.get<quint32>("too_many_connections_back_off"));
+   }
+   else if (result.status() != Protos::Core::GetChunkResult_Status_OK)
    {
       L_WARN(QString("Status error from GetChunkResult : %1. Download aborted.").arg(result.status()));
       if (this->peers.removeOne(this->currentDownloadingPeer))
@@ -425,6 +471,10 @@ void ChunkDownload::result(const Protos::Core::GetChunkResult& result)
       else
       {
          this->chunkSize = result.chunk_size();
+         this->compressed = result.compressed();
+
+         // The time waited in the upload queue of the peer depends on its other downloaders, it isn't counted.
+         this->currentDownloadingPeer->setLatency(static_cast<quint32>(qMax<qint64>(0, this->getChunkTimer.elapsed() - result.waiting_time())));
       }
    }
 }
@@ -439,10 +489,14 @@ void ChunkDownload::stream(QSharedPointer<PM::ISocket> socket)
 void ChunkDownload::getChunkTimeout()
 {
    L_WARN("Timeout from GetChunkResult, Download aborted.");
+   this->currentDownloadingPeer->setTransferResult(false);
    this->downloadingEnded();
 }
 
-void ChunkDownload::downloadingEnded()
+/**
+  * @param peerBackOff [ms] The current peer isn't asked for another chunk during this period.
+  */
+void ChunkDownload::downloadingEnded(int peerBackOff)
 {
    L_DEBU(QString("Downloading ended, chunk : %1%2").arg(this->chunk->toStringLog()).arg(this->chunk->isComplete() ? "" : " Not complete!"));
 
@@ -460,7 +514,61 @@ void ChunkDownload::downloadingEnded()
    PM::IPeer* currentPeer = this->currentDownloadingPeer;
    this->currentDownloadingPeer = 0;
 
-   this->occupiedPeersDownloadingChunk.setPeerAsFree(currentPeer);
+   this->occupiedPeersDownloadingChunk.setPeerAsFree(currentPeer, peerBackOff);
+}
+
+/**
+  * Read the data received as blocks, see 'Common::BlockDecompressor'.
+  * The received bytes are counted by the transfer rate calculator and consumed from the given token bucket.
+  * @return The number of decoded bytes, 0 if no block has been entirely received or if the download has been stopped, -1 if an error occurs.
+  */
+int ChunkDownload::readBlocks(char* buffer, int maxSize, Common::BlockDecompressor& decompressor, Common::TokenBucket& tokenBucket)
+{
+   static const int RECEIVING_BUFFER_SIZE = 65536; // [B].
+   char receivingBuffer[RECEIVING_BUFFER_SIZE];
+
+   if (maxSize <= 0)
+      return 0;
+
+   forever
+   {
+      const int bytesDecoded = decompressor.read(buffer, maxSize);
+      if (decompressor.hasError())
+      {
+         L_WARN(QString("Corrupted block received : %1").arg(this->chunk->toStringLog()));
+         return -1;
+      }
+
+      if (bytesDecoded > 0)
+         return bytesDecoded;
+
+      const int bytesReceived = this->socket->read(receivingBuffer, tokenBucket.getSliceSize(RECEIVING_BUFFER_SIZE));
+      if (bytesReceived <= 0)
+         return bytesReceived;
+
+      decompressor.feed(receivingBuffer, bytesReceived);
+      this->transferRateCalculator.addData(bytesReceived);
+      if (!this->consumeTokens(tokenBucket, bytesReceived))
+         return 0;
+   }
+}
+
+/**
+  * Consume the tokens of the received bytes and wait if there is not enough tokens.
+  * The delay is waited by steps to stop quickly even at a very low rate, see 'Common::TokenBucket::sleepStep(..)'.
+  * @return false if the download has been stopped during the wait.
+  */
+bool ChunkDownload::consumeTokens(Common::TokenBucket& tokenBucket, int bytes)
+{
+   for (int delay = tokenBucket.consume(bytes); delay > 0;)
+   {
+      delay = Common::TokenBucket::sleepStep(delay);
+
+      QMutexLocker locker(&this->mutex);
+      if (!this->downloading)
+         return false;
+   }
+   return true;
 }
 
 /**
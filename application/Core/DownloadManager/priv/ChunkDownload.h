@@ -27,6 +27,8 @@
 #include <Protos/core_protocol.pb.h>
 
 #include <Common/TransferRateCalculator.h>
+#include <Common/BandwidthLimiter.h>
+#include <Common/BlockDecompressor.h>
 #include <Common/Hash.h>
 #include <Common/Uncopyable.h>
 #include <Common/IRunnable.h>
@@ -51,15 +53,15 @@ namespace DM
 
       Q_OBJECT
    public:
-      ChunkDownload(QSharedPointer<PM::IPeerManager> peerManager, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::ThreadPool& threadPool, Common::Hash chunkHash);
+      ChunkDownload(QSharedPointer<PM::IPeerManager> peerManager, OccupiedPeers& occupiedPeersDownloadingChunk, Common::TransferRateCalculator& transferRateCalculator, Common::BandwidthLimiter& bandwidthLimiter, Common::ThreadPool& threadPool, Common::Hash chunkHash);
       ~ChunkDownload();
 
       void stop();
 
       Common::Hash getHash() const;
 
-      void addPeerID(const Common::Hash& peerID);
-      void rmPeerID(const Common::Hash& peerID);
+      Q_INVOKABLE void addPeerID(const Common::Hash& peerID);
+      Q_INVOKABLE void rmPeerID(const Common::Hash& peerID);
 
       void init(QThread* thread);
       void run();
@@ -98,15 +100,18 @@ namespace DM
       void stream(QSharedPointer<PM::ISocket> socket);
       void getChunkTimeout();
 
-      void downloadingEnded();
+      void downloadingEnded(int peerBackOff = 0);
 
    private:
+      int readBlocks(char* buffer, int maxSize, Common::BlockDecompressor& decompressor, Common::TokenBucket& tokenBucket);
+      bool consumeTokens(Common::TokenBucket& tokenBucket, int bytes);
       PM::IPeer* getTheFastestFreePeer();
       int getNumberOfFreePeer();
 
       QSharedPointer<PM::IPeerManager> peerManager; // To retrieve the peers from their ID.
       OccupiedPeers& occupiedPeersDownloadingChunk; // The peers from where we downloading.
       Common::TransferRateCalculator& transferRateCalculator;
+      Common::BandwidthLimiter& bandwidthLimiter;
       Common::ThreadPool& threadPool;
 
       Common::Hash chunkHash;
@@ -118,7 +123,9 @@ namespace DM
       QSharedPointer<PM::ISocket> socket;
 
       int chunkSize;
+      bool compressed; // The data are received as blocks, see 'Common::BlockDecompressor'.
       QSharedPointer<PM::IGetChunkResult> getChunkResult;
+      QElapsedTimer getChunkTimer; // To measure the latency of the peer, see 'result(..)'.
 
       bool downloading;
       PM::ISocket::FinishedStatus networkTransferStatus;
@@ -40,6 +40,7 @@ DownloadManager::DownloadManager(QSharedPointer<FM::IFileManager> fileManager, Q
    NUMBER_OF_DOWNLOADER(static_cast<int>(SETTINGS.get<quint32>("number_of_downloader"))),
    fileManager(fileManager),
    peerManager(peerManager),
+   bandwidthLimiter(SETTINGS.get<quint32>("download_rate_limit"), SETTINGS.get<quint32>("download_rate_limit_per_peer")),
    threadPool(NUMBER_OF_DOWNLOADER),
    numberOfDownloadThreadRunning(0),
    queueChanged(false)
@@ -167,6 +168,7 @@ Download* DownloadManager::addDownload(const Protos::Common::Entry& remoteEntry,
             remoteEntry,
             localEntry,
             this->transferRateCalculator,
+            this->bandwidthLimiter,
             status
          );
          newDownload = fileDownload;
@@ -262,6 +264,11 @@ int DownloadManager::getDownloadRate()
    return this->transferRateCalculator.getTransferRate();
 }
 
+void DownloadManager::setDownloadRateLimit(quint32 rate, quint32 ratePerPeer)
+{
+   this->bandwidthLimiter.setRates(rate, ratePerPeer);
+}
+
 void DownloadManager::peerBecomesAvailable(PM::IPeer* peer)
 {     
    this->downloadQueue.peerBecomesAvailable(peer);
@@ -26,6 +26,7 @@
 #include <QMultiHash>
 
 #include <Common/TransferRateCalculator.h>
+#include <Common/BandwidthLimiter.h>
 #include <Common/ThreadPool.h>
 
 #include <Core/FileManager/IFileManager.h>
@@ -75,6 +76,7 @@ namespace DM
       QList< QSharedPointer<IChunkDownload> > getUnfinishedChunks(int n) const;
 
       int getDownloadRate();
+      void setDownloadRateLimit(quint32 rate, quint32 ratePerPeer);
 
    private slots:
       void peerBecomesAvailable(PM::IPeer* peer);
@@ -108,6 +110,7 @@ namespace DM
       QSharedPointer<PM::IPeerManager> peerManager;
 
       Common::TransferRateCalculator transferRateCalculator;
+      Common::BandwidthLimiter bandwidthLimiter;
 
       OccupiedPeers occupiedPeersAskingForHashes;
       OccupiedPeers occupiedPeersAskingForEntries;
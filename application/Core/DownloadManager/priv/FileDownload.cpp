@@ -44,6 +44,7 @@ FileDownload::FileDownload(
    const Protos::Common::Entry& remoteEntry,
    const Protos::Common::Entry& localEntry,
    Common::TransferRateCalculator& transferRateCalculator,
+   Common::BandwidthLimiter& bandwidthLimiter,
    Protos::Queue::Queue::Entry::Status status
 ) :
    Download(peerSource, remoteEntry, localEntry),
@@ -54,7 +55,8 @@ FileDownload::FileDownload(
    occupiedPeersDownloadingChunk(occupiedPeersDownloadingChunk),
    threadPool(threadPool),
    nbHashesKnown(0),
-   transferRateCalculator(transferRateCalculator)
+   transferRateCalculator(transferRateCalculator),
+   bandwidthLimiter(bandwidthLimiter)
 {
    L_DEBU(QString("New FileDownload : peer source = %1, remoteEntry : \n%2\nlocalEntry : \n%3").
       arg(this->peerSource->toStringLog()).
@@ -68,7 +70,7 @@ FileDownload::FileDownload(
    for (int i = 0; i < this->remoteEntry.chunk_size(); i++)
    {
       Common::Hash chunkHash(this->remoteEntry.chunk(i).hash());
-      QSharedPointer<ChunkDownload> chunkDownload = QSharedPointer<ChunkDownload>(new ChunkDownload(this->peerManager, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, chunkHash));
+      QSharedPointer<ChunkDownload> chunkDownload = QSharedPointer<ChunkDownload>(new ChunkDownload(this->peerManager, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->bandwidthLimiter, this->threadPool, chunkHash));
 
       this->chunkDownloads << chunkDownload;
       this->connectChunkDownloadSignals(this->chunkDownloads.last());
@@ -457,7 +459,7 @@ void FileDownload::nextHash(const Common::Hash& hash)
    }
    else
    {
-      QSharedPointer<ChunkDownload> chunkDownload = QSharedPointer<ChunkDownload>(new ChunkDownload(this->peerManager, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->threadPool, hash));
+      QSharedPointer<ChunkDownload> chunkDownload = QSharedPointer<ChunkDownload>(new ChunkDownload(this->peerManager, this->occupiedPeersDownloadingChunk, this->transferRateCalculator, this->bandwidthLimiter, this->threadPool, hash));
 
       // If the file has already been created, the chunks are known.
       if (!this->chunksWithoutDownload.isEmpty())
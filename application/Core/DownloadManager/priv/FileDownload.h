@@ -54,6 +54,7 @@ namespace DM
          const Protos::Common::Entry& remoteEntry,
          const Protos::Common::Entry& localEntry,
          Common::TransferRateCalculator& transferRateCalculator,
+         Common::BandwidthLimiter& bandwidthLimiter,
          Protos::Queue::Queue::Entry::Status status = Protos::Queue::Queue::Entry::QUEUED
       );
       ~FileDownload();
@@ -114,6 +115,7 @@ namespace DM
       QSharedPointer<PM::IGetHashesResult> getHashesResult;
 
       Common::TransferRateCalculator& transferRateCalculator;
+      Common::BandwidthLimiter& bandwidthLimiter;
    };
 }
 #endif
@@ -23,6 +23,9 @@ using namespace DM;
 
 OccupiedPeers::OccupiedPeers()
 {
+   this->time.start();
+   this->delayedPeersTimer.setSingleShot(true);
+   connect(&this->delayedPeersTimer, SIGNAL(timeout()), this, SLOT(freeDelayedPeers()));
 }
 
 bool OccupiedPeers::isPeerFree(PM::IPeer* peer) const
@@ -44,11 +47,23 @@ bool OccupiedPeers::setPeerAsOccupied(PM::IPeer* peer)
    return true;
 }
 
-void OccupiedPeers::setPeerAsFree(PM::IPeer* peer)
+/**
+  * @param delay [ms] The peer stays occupied during this period, for example when it's too busy to serve us.
+  *  Must be called from the thread of the object when not null.
+  */
+void OccupiedPeers::setPeerAsFree(PM::IPeer* peer, int delay)
 {
    if (!peer)
       return;
 
+   if (delay > 0)
+   {
+      QMutexLocker locker(&this->mutex);
+      this->delayedPeers.insert(this->time.elapsed() + delay, peer);
+      this->delayedPeersTimer.start(qMax<qint64>(0, this->delayedPeers.begin().key() - this->time.elapsed()));
+      return;
+   }
+
    {
       QMutexLocker locker(&this->mutex);
       this->occupiedPeers.remove(peer);
@@ -71,6 +86,21 @@ void OccupiedPeers::newPeer(PM::IPeer* peer)
       this->mutex.unlock();
 }
 
+void OccupiedPeers::freeDelayedPeers()
+{
+   QList<PM::IPeer*> peersToFree;
+
+   this->mutex.lock();
+   while (!this->delayedPeers.isEmpty() && this->delayedPeers.begin().key() <= this->time.elapsed())
+      peersToFree << this->delayedPeers.take(this->delayedPeers.begin().key());
+   if (!this->delayedPeers.isEmpty())
+      this->delayedPeersTimer.start(qMax<qint64>(0, this->delayedPeers.begin().key() - this->time.elapsed()));
+   this->mutex.unlock();
+
+   foreach (PM::IPeer* peer, peersToFree)
+      this->setPeerAsFree(peer);
+}
+
 int OccupiedPeers::nbOccupiedPeers() const
 {
    return this->occupiedPeers.size();
@@ -21,7 +21,10 @@
 
 #include <QObject>
 #include <QSet>
+#include <QMap>
 #include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <Common/Uncopyable.h>
 
@@ -40,15 +43,22 @@ namespace DM
 
       bool isPeerFree(PM::IPeer* peer) const;
       bool setPeerAsOccupied(PM::IPeer* peer);
-      void setPeerAsFree(PM::IPeer* peer);
+      void setPeerAsFree(PM::IPeer* peer, int delay = 0);
       void newPeer(PM::IPeer* peer);
       int nbOccupiedPeers() const;
 
    signals:
       void newFreePeer(PM::IPeer*);
 
+   private slots:
+      void freeDelayedPeers();
+
    private:
       QSet<PM::IPeer*> occupiedPeers; // Peers currently occupied.
+
+      QMultiMap<qint64, PM::IPeer*> delayedPeers; // Occupied peers to free at a given time, see 'setPeerAsFree(..)'.
+      QElapsedTimer time;
+      QTimer delayedPeersTimer;
       mutable QMutex mutex;
    };
 }
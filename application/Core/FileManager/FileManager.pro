@@ -35,6 +35,7 @@ SOURCES += priv/Builder.cpp \
     priv/FileUpdater/FileUpdater.cpp \
     priv/FileUpdater/DirWatcherWin.cpp \
     priv/FileUpdater/DirWatcher.cpp \
+    priv/FileUpdater/DirLister.cpp \
     priv/Cache/Entry.cpp \
     priv/Cache/File.cpp \
     priv/Cache/Directory.cpp \
@@ -46,6 +47,9 @@ SOURCES += priv/Builder.cpp \
     priv/Cache/DataReader.cpp \
     priv/Cache/DataWriter.cpp \
     priv/Cache/Cache.cpp \
+    priv/Cache/CacheJournal.cpp \
+    priv/Cache/EntryFilter.cpp \
+    priv/WordIndex/Bitmap.cpp \
     ../../Protos/files_cache.pb.cc \
     priv/FileUpdater/WaitCondition.cpp \
     priv/GetHashesResult.cpp \
@@ -60,6 +64,7 @@ HEADERS += IGetHashesResult.h \
     priv/FileManager.h \
     priv/FileUpdater/FileUpdater.h \
     priv/FileUpdater/DirWatcher.h \
+    priv/FileUpdater/DirLister.h \
     priv/Cache/Entry.h \
     priv/Cache/File.h \
     priv/Cache/Directory.h \
@@ -67,6 +72,9 @@ HEADERS += IGetHashesResult.h \
     priv/ChunkIndex/Chunks.h \
     priv/WordIndex/WordIndex.h \
     priv/WordIndex/Node.h \
+    priv/WordIndex/Bitmap.h \
+    priv/WordIndex/SubstringIndex.h \
+    priv/WordIndex/ItemFilter.h \
     ../../Protos/core_protocol.pb.h \
     ../../Protos/common.pb.h \
     IDataReader.h \
@@ -75,6 +83,8 @@ HEADERS += IGetHashesResult.h \
     priv/Cache/DataReader.h \
     priv/Cache/DataWriter.h \
     priv/Cache/Cache.h \
+    priv/Cache/CacheJournal.h \
+    priv/Cache/EntryFilter.h \
     priv/Exceptions.h \
     Exceptions.h \
     ../../Protos/files_cache.pb.h \
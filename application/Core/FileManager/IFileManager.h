@@ -121,9 +121,17 @@ namespace FM
         * The result is sorted by level.
         * @param maxSize This is the size in bytes each 'FindResult' can't exceed. (Because UDP datagrams have a maximum size).
         * It should not be here but it's far more harder to split the result outside this method.
+        * @param filter The entries not matching it aren't returned and don't count in 'maxNbResult'.
         * @remarks Will not fill the fields 'FindResult.tag' and 'FindResult.peer_id'.
+        * @remarks The paths and the shared directories are put in the tables of each 'FindResult', see 'Common::ProtoHelper::expandFindResult(..)'.
         */
-      virtual QList<Protos::Common::FindResult> find(const QString& words, int maxNbResult, int maxSize) = 0;
+      virtual QList<Protos::Common::FindResult> find(const QString& words, const Protos::Common::FindFilter& filter, int maxNbResult, int maxSize) = 0;
+
+      /**
+        * Return a number changed each time an entry is added to or removed from the index.
+        * The result of 'find(..)' is the same as long as this number doesn't change.
+        */
+      virtual int getIndexGeneration() const = 0;
 
       /**
         * Ask if we have the given hashes. For each hashes a bit is set (1 if the hash is known or 0 otherwise) into the returned QBitArray.
@@ -33,6 +33,10 @@ namespace FM
       Q_OBJECT
    public:
       virtual ~IGetHashesResult() {}
+
+      /**
+        * The hashes already known are returned in 'GetHashesResult.hash', the following ones will be emitted by 'nextHash(..)'.
+        */
       virtual Protos::Core::GetHashesResult start() = 0;
 
    signals:
@@ -0,0 +1,700 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <Benchmarks.h>
+
+#include <limits>
+
+#include <QtDebug>
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLinkedList>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QUuid>
+#include <QDirIterator>
+#include <QThread>
+#include <QtAlgorithms>
+#include <QRegExp>
+#include <QtCore/QtCore> // For the Q_OS_* defines.
+
+#ifdef Q_OS_LINUX
+   #include <unistd.h>
+#endif
+
+#include <Protos/core_settings.pb.h>
+
+#include <Common/Settings.h>
+#include <Common/PersistentData.h>
+#include <Common/Constants.h>
+#include <Common/Global.h>
+#include <Common/LogManager/Builder.h>
+
+#include <Builder.h>
+#include <IFileManager.h>
+#include <priv/WordIndex/WordIndex.h>
+#include <priv/WordIndex/SubstringIndex.h>
+
+const int NB_TOP_DIRS = 10;
+const int NB_SUB_DIRS = 100; // For each top directory.
+const int NB_FILES_PER_DIR = 1000; // NB_TOP_DIRS * NB_SUB_DIRS * NB_FILES_PER_DIR = 10^6 files.
+const int SCAN_TIMEOUT = 30 * 60 * 1000; // [ms].
+
+const int NB_INDEXED_NAMES = 1000000;
+const int NB_SEARCHES = 100000;
+const QString SEARCH_CORPUS_DIR("sharedDirs/searchCorpus"); // The content of 'prototypes/03_Search/files.iso' can be put here.
+
+const int NB_INDEXED_ENTRIES_MULTIPLE_TERMS = 5000000;
+const int NB_VOCABULARY_WORDS = 50000;
+const int MAX_NB_WORDS_PER_ENTRY = 4;
+const int MAX_NB_TERMS = 6;
+const int NB_SEARCHES_MULTIPLE_TERMS = 1000; // For each number of terms.
+const int MAX_NB_RESULT = 300; // The default value of 'max_number_of_search_result_to_send'.
+
+/**
+  * Add some items to a word index from its own thread.
+  */
+class WordIndexFiller : public QThread
+{
+public:
+   WordIndexFiller(FM::WordIndex<IndexedItem>& index, const QList<QStringList>& words, QVector<IndexedItem>& items) :
+      index(index), words(words), items(items) {}
+
+protected:
+   void run()
+   {
+      for (int i = 0; i < this->words.size(); i++)
+         this->index.addItem(this->words[i], &this->items[i]);
+   }
+
+private:
+   FM::WordIndex<IndexedItem>& index;
+   const QList<QStringList>& words;
+   QVector<IndexedItem>& items;
+};
+
+Benchmarks::Benchmarks()
+{
+}
+
+void Benchmarks::initTestCase()
+{
+   LM::Builder::initMsgHandler();
+
+   qDebug() << "===== initTestCase() =====";
+
+   try
+   {
+      QString tempFolder = Common::Global::setCurrentDirToTemp("FileManagerBenchmarks");
+      qDebug() << "The file created during this test are put in : " << tempFolder;
+   }
+   catch(Common::Global::UnableToSetTempDirException& e)
+   {
+      QFAIL(e.errorMessage.toAscii().constData());
+   }
+
+   SETTINGS.setFilename("core_settings_file_manager_benchmarks.txt");
+   SETTINGS.setSettingsMessage(new Protos::Core::Settings());
+
+   this->treeDir = QDir::currentPath() + "/sharedDirs/tree";
+   this->createTree();
+}
+
+/**
+  * The way the shared directories were read before 'DirLister'.
+  */
+void Benchmarks::scanWithQDir()
+{
+   qDebug() << "===== scanWithQDir() =====";
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbDirs = 0;
+   int nbFiles = 0;
+   QLinkedList<QString> dirsToVisit;
+   dirsToVisit << this->treeDir;
+   while (!dirsToVisit.isEmpty())
+   {
+      nbDirs++;
+      foreach (QFileInfo entry, QDir(dirsToVisit.takeFirst()).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks))
+      {
+         if (entry.isDir())
+            dirsToVisit << entry.absoluteFilePath();
+         else if (entry.size() > 0 && entry.lastModified().isValid())
+            nbFiles++;
+      }
+   }
+
+   qDebug() << QString("%1 directories and %2 files read in %3 ms").arg(nbDirs).arg(nbFiles).arg(timer.elapsed());
+}
+
+void Benchmarks::scanWithFileManager_data()
+{
+   QTest::addColumn<int>("nbThreads");
+   QTest::newRow("1 thread") << 1;
+   QTest::newRow("2 threads") << 2;
+   QTest::newRow("4 threads") << 4;
+   QTest::newRow("8 threads") << 8;
+   QTest::newRow("16 threads") << 16;
+}
+
+/**
+  * Time to build the cache from an empty one, the hashing is not measured.
+  */
+void Benchmarks::scanWithFileManager()
+{
+   QFETCH(int, nbThreads);
+   qDebug() << "===== scanWithFileManager() : " << nbThreads << " thread(s) =====";
+
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL);
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE_JOURNAL, Common::Global::LOCAL);
+   SETTINGS.set("scan_number_of_threads", static_cast<quint32>(nbThreads));
+
+   QSharedPointer<FM::IFileManager> fileManager = FM::Builder::newFileManager();
+
+   QElapsedTimer timer;
+   timer.start();
+   fileManager->setSharedDirs(QStringList() << this->treeDir);
+
+   // Each file must be hashed after the scanning.
+   while (fileManager->getCacheStatus() != FM::IFileManager::HASHING_IN_PROGRESS && timer.elapsed() < SCAN_TIMEOUT)
+      QTest::qWait(10);
+   const qint64 elapsed = timer.elapsed();
+
+   QVERIFY(elapsed < SCAN_TIMEOUT);
+   qDebug() << QString("Scanning done in %1 ms").arg(elapsed);
+}
+
+/**
+  * Compare 'Common::Global::splitInWords(..)' with the regular expression it replaces, the two ways must give the same words.
+  */
+void Benchmarks::splitNamesInWords()
+{
+   qDebug() << "===== splitNamesInWords() =====";
+
+   this->loadSearchCorpus();
+
+   const QRegExp regExp("(\\W+|_)");
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbWords = 0;
+   foreach (QString name, this->names)
+      nbWords += Common::Global::toLowerAndRemoveAccents(name).split(regExp, QString::SkipEmptyParts).size();
+
+   qDebug() << QString("%1 names split with a regular expression in %2 ms, %3 words").arg(this->names.size()).arg(timer.elapsed()).arg(nbWords);
+
+   timer.start();
+   nbWords = 0;
+   foreach (QString name, this->names)
+      nbWords += Common::Global::splitInWords(name).size();
+
+   qDebug() << QString("%1 names split in %2 ms, %3 words").arg(this->names.size()).arg(timer.elapsed()).arg(nbWords);
+
+   timer.start();
+   nbWords = 0;
+   QString buffer;
+   QVector<QStringRef> words;
+   foreach (QString name, this->names)
+   {
+      Common::Global::splitInWords(name, buffer, words);
+      nbWords += words.size();
+   }
+
+   qDebug() << QString("%1 names split with a reused buffer in %2 ms, %3 words").arg(this->names.size()).arg(timer.elapsed()).arg(nbWords);
+
+   foreach (QString name, this->names)
+      QCOMPARE(Common::Global::splitInWords(name), Common::Global::toLowerAndRemoveAccents(name).split(regExp, QString::SkipEmptyParts));
+}
+
+/**
+  * Measure the time and the memory taken to index 'NB_INDEXED_NAMES' names.
+  */
+void Benchmarks::buildWordIndex()
+{
+   qDebug() << "===== buildWordIndex() =====";
+
+   this->loadSearchCorpus();
+
+   const qint64 memoryBefore = residentMemory();
+
+   QElapsedTimer timer;
+   timer.start();
+
+   FM::WordIndex<IndexedItem>* index = new FM::WordIndex<IndexedItem>();
+   for (int i = 0; i < this->words.size(); i++)
+      index->addItem(this->words[i], &this->items[i]);
+
+   qDebug() << QString("%1 names indexed in %2 ms, memory used : %3 KiB").arg(this->words.size()).arg(timer.elapsed()).arg((residentMemory() - memoryBefore) / 1024);
+
+   timer.start();
+   for (int i = 0; i < this->words.size(); i++)
+      index->rmItem(this->words[i], &this->items[i]);
+   qDebug() << QString("%1 names removed in %2 ms").arg(this->words.size()).arg(timer.elapsed());
+
+   delete index;
+}
+
+/**
+  * Measure the path of 'FileManager::entryAdded(..)' and 'FileManager::entryRemoved(..)' : each name is split into a reused buffer
+  * and its words are given as references to the word index and to the substring index. It's compared to the split of each name into a 'QStringList'.
+  */
+void Benchmarks::indexNamesWithReusedBuffer()
+{
+   qDebug() << "===== indexNamesWithReusedBuffer() =====";
+
+   this->loadSearchCorpus();
+
+   QElapsedTimer timer;
+   timer.start();
+
+   {
+      FM::WordIndex<IndexedItem> wordIndex;
+      FM::SubstringIndex<IndexedItem> substringIndex(std::numeric_limits<qint64>::max());
+      for (int i = 0; i < this->names.size(); i++)
+      {
+         const QStringList words = Common::Global::splitInWords(this->names[i]);
+         wordIndex.addItem(words, &this->items[i]);
+         substringIndex.addItem(words, &this->items[i]);
+      }
+
+      qDebug() << QString("%1 names split into a list and indexed in %2 ms").arg(this->names.size()).arg(timer.elapsed());
+
+      timer.start();
+      for (int i = 0; i < this->names.size(); i++)
+      {
+         wordIndex.rmItem(Common::Global::splitInWords(this->names[i]), &this->items[i]);
+         substringIndex.rmItem(&this->items[i]);
+      }
+
+      qDebug() << QString("%1 names split into a list and removed in %2 ms").arg(this->names.size()).arg(timer.elapsed());
+   }
+
+   FM::WordIndex<IndexedItem> wordIndex;
+   FM::SubstringIndex<IndexedItem> substringIndex(std::numeric_limits<qint64>::max());
+   QString buffer;
+   QVector<QStringRef> words;
+
+   timer.start();
+   for (int i = 0; i < this->names.size(); i++)
+   {
+      Common::Global::splitInWords(this->names[i], buffer, words);
+      wordIndex.addItem(words, &this->items[i]);
+      substringIndex.addItem(words, &this->items[i]);
+   }
+
+   qDebug() << QString("%1 names split into a reused buffer and indexed in %2 ms").arg(this->names.size()).arg(timer.elapsed());
+
+   // The same words must be found as with the lists.
+   for (int i = 0; i < 10; i++)
+   {
+      const QString& word = this->words[i * (this->words.size() / 10)].value(0);
+      if (word.isEmpty())
+         continue;
+
+      int nbExpected = 0;
+      foreach (QStringList nameWords, this->words)
+         foreach (QString nameWord, nameWords)
+            if (nameWord == word || word.size() >= 3 && nameWord.startsWith(word)) // See 'WordIndex::MIN_WORD_SIZE_PARTIAL_MATCH'.
+               nbExpected++;
+      QCOMPARE(wordIndex.search(word).size(), nbExpected);
+      QVERIFY(substringIndex.search(QStringList() << word).size() > 0 || word.size() < 3);
+   }
+
+   timer.start();
+   for (int i = 0; i < this->names.size(); i++)
+   {
+      Common::Global::splitInWords(this->names[i], buffer, words);
+      wordIndex.rmItem(words, &this->items[i]);
+      substringIndex.rmItem(&this->items[i]);
+   }
+
+   qDebug() << QString("%1 names split into a reused buffer and removed in %2 ms").arg(this->names.size()).arg(timer.elapsed());
+
+   for (int i = 0; i < this->items.size(); i++)
+      QCOMPARE(this->items[i].getWordIndexId(), 0u);
+}
+
+/**
+  * Each search is a prefix of an indexed name, from 1 to 8 letters.
+  * The result is compared to a linear search for some of them.
+  */
+void Benchmarks::searchInWordIndex()
+{
+   qDebug() << "===== searchInWordIndex() =====";
+
+   this->loadSearchCorpus();
+
+   FM::WordIndex<IndexedItem> index;
+   for (int i = 0; i < this->words.size(); i++)
+      index.addItem(this->words[i], &this->items[i]);
+
+   QStringList terms;
+   qsrand(42);
+   for (int i = 0; i < NB_SEARCHES; i++)
+   {
+      const QString word = this->words[qrand() % this->words.size()].value(0);
+      terms << word.left(qrand() % 8 + 1);
+   }
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbResults = 0;
+   foreach (QString term, terms)
+      nbResults += index.search(term).size();
+
+   qDebug() << QString("%1 searches in %2 ms, %3 results").arg(terms.size()).arg(timer.elapsed()).arg(nbResults);
+
+   for (int i = 0; i < 10; i++)
+   {
+      const QString& term = terms[i];
+      int nbExpected = 0;
+      foreach (QStringList nameWords, this->words)
+         foreach (QString word, nameWords)
+            if (word == term || term.size() >= 3 && word.startsWith(term)) // See 'WordIndex::MIN_WORD_SIZE_PARTIAL_MATCH'.
+               nbExpected++;
+      QCOMPARE(index.search(term).size(), nbExpected);
+   }
+}
+
+/**
+  * Measure the latency of the searches while all the names are added by another thread.
+  */
+void Benchmarks::searchInWordIndexDuringInsertion()
+{
+   qDebug() << "===== searchInWordIndexDuringInsertion() =====";
+
+   this->loadSearchCorpus();
+
+   FM::WordIndex<IndexedItem> index;
+   WordIndexFiller filler(index, this->words, this->items);
+
+   QElapsedTimer timer;
+   timer.start();
+   filler.start();
+
+   qsrand(42);
+   QVector<qint64> latencies; // [ns].
+   while (!filler.isFinished())
+   {
+      const QString term = this->words[qrand() % this->words.size()].value(0).left(qrand() % 8 + 1);
+
+      QElapsedTimer searchTimer;
+      searchTimer.start();
+      index.search(term);
+      latencies << searchTimer.nsecsElapsed();
+   }
+   filler.wait();
+
+   QVERIFY(!latencies.isEmpty());
+   qSort(latencies);
+   qDebug() << QString("%1 names indexed in %2 ms during %3 searches").arg(this->words.size()).arg(timer.elapsed()).arg(latencies.size());
+   qDebug() << QString("Search latency [us] : p50 = %1, p90 = %2, p99 = %3, p99.9 = %4, max = %5")
+      .arg(latencies[latencies.size() * 50 / 100] / 1000)
+      .arg(latencies[latencies.size() * 90 / 100] / 1000)
+      .arg(latencies[latencies.size() * 99 / 100] / 1000)
+      .arg(latencies[latencies.size() * 999 / 1000] / 1000)
+      .arg(latencies.last() / 1000);
+}
+
+/**
+  * Searches of 1 to 'MAX_NB_TERMS' terms among 'NB_INDEXED_ENTRIES_MULTIPLE_TERMS' names made of some words of a vocabulary,
+  * the first words of the vocabulary are much more common than the last ones.
+  * Each search is made without limit and with the limit used by the core, the ranking of the first one is compared to a linear search.
+  */
+void Benchmarks::searchMultipleTermsInWordIndex()
+{
+   qDebug() << "===== searchMultipleTermsInWordIndex() =====";
+
+   qsrand(42);
+   QStringList vocabulary;
+   for (int i = 0; i < NB_VOCABULARY_WORDS; i++)
+   {
+      QString word;
+      for (int j = qrand() % 8 + 3; j > 0; j--)
+         word.append(QChar('a' + qrand() % 26));
+      vocabulary << word;
+   }
+
+   // The words of the entry 'i' are 'entryWords[i * MAX_NB_WORDS_PER_ENTRY ..]', -1 if there is no more word.
+   QVector<IndexedItem> entries(NB_INDEXED_ENTRIES_MULTIPLE_TERMS);
+   QVector<int> entryWords(NB_INDEXED_ENTRIES_MULTIPLE_TERMS * MAX_NB_WORDS_PER_ENTRY, -1);
+   for (int i = 0; i < entryWords.size(); i += MAX_NB_WORDS_PER_ENTRY)
+      for (int j = qrand() % MAX_NB_WORDS_PER_ENTRY; j >= 0; j--)
+         entryWords[i + j] = static_cast<int>(static_cast<qint64>(qrand() % NB_VOCABULARY_WORDS) * (qrand() % NB_VOCABULARY_WORDS) / NB_VOCABULARY_WORDS);
+
+   QElapsedTimer timer;
+   timer.start();
+
+   FM::WordIndex<IndexedItem> index;
+   for (int i = 0; i < entries.size(); i++)
+   {
+      QStringList words;
+      for (int j = 0; j < MAX_NB_WORDS_PER_ENTRY && entryWords[i * MAX_NB_WORDS_PER_ENTRY + j] != -1; j++)
+         words << vocabulary[entryWords[i * MAX_NB_WORDS_PER_ENTRY + j]];
+      index.addItem(words, &entries[i]);
+   }
+   qDebug() << QString("%1 entries indexed in %2 ms").arg(entries.size()).arg(timer.elapsed());
+
+   for (int nbTerms = 1; nbTerms <= MAX_NB_TERMS; nbTerms++)
+   {
+      // The terms are some words or some prefixes of an indexed entry completed by some random words.
+      QList<QStringList> searches;
+      for (int i = 0; i < NB_SEARCHES_MULTIPLE_TERMS; i++)
+      {
+         const int entry = qrand() % entries.size();
+         QStringList terms;
+         for (int j = 0; j < nbTerms; j++)
+         {
+            const int word = j < MAX_NB_WORDS_PER_ENTRY && entryWords[entry * MAX_NB_WORDS_PER_ENTRY + j] != -1 ? entryWords[entry * MAX_NB_WORDS_PER_ENTRY + j] : qrand() % NB_VOCABULARY_WORDS;
+            terms << (qrand() % 2 ? vocabulary[word] : vocabulary[word].left(3));
+         }
+         searches << terms;
+      }
+
+      timer.start();
+      qint64 nbResults = 0;
+      foreach (QStringList terms, searches)
+         nbResults += index.search(terms).size();
+      const qint64 timeWithoutLimit = timer.nsecsElapsed();
+
+      timer.start();
+      foreach (QStringList terms, searches)
+         index.search(terms, MAX_NB_RESULT);
+      const qint64 timeWithLimit = timer.nsecsElapsed();
+
+      qDebug() << QString("%1 term(s) : %2 us per search without limit (%3 results on average), %4 us per search with a limit of %5")
+         .arg(nbTerms)
+         .arg(timeWithoutLimit / 1000 / searches.size())
+         .arg(nbResults / searches.size())
+         .arg(timeWithLimit / 1000 / searches.size())
+         .arg(MAX_NB_RESULT);
+
+      // Compare the first search to a linear search.
+      const QStringList& terms = searches.first();
+      QList<qint64> expected; // Level << 32 | entry.
+      QVector<int> matches(nbTerms); // 0 : no match, 1 : exact match, 2 : partial match.
+      for (int i = 0; i < entries.size(); i++)
+      {
+         for (int j = 0; j < nbTerms; j++)
+         {
+            matches[j] = 0;
+            for (int k = 0; k < MAX_NB_WORDS_PER_ENTRY && entryWords[i * MAX_NB_WORDS_PER_ENTRY + k] != -1 && matches[j] != 1; k++)
+            {
+               const QString& word = vocabulary[entryWords[i * MAX_NB_WORDS_PER_ENTRY + k]];
+               if (word == terms[j])
+                  matches[j] = 1;
+               else if (terms[j].size() >= 3 && word.startsWith(terms[j])) // See 'WordIndex::MIN_WORD_SIZE_PARTIAL_MATCH'.
+                  matches[j] = 2;
+            }
+         }
+
+         const int level = expectedLevel(matches);
+         if (level != -1)
+            expected << (static_cast<qint64>(level) << 32 | i);
+      }
+
+      QList<qint64> actual;
+      foreach (FM::NodeResult<IndexedItem*> result, index.search(terms))
+         actual << (static_cast<qint64>(result.level) << 32 | (result.value - entries.constData()));
+
+      qSort(expected);
+      qSort(actual);
+      QCOMPARE(actual, expected);
+   }
+}
+
+/**
+  * Compare the latency of the searches of some substrings with the one of the searches of some prefixes, from 3 to 8 letters.
+  * The result of some substring searches is compared to a linear search.
+  */
+void Benchmarks::searchSubstrings()
+{
+   qDebug() << "===== searchSubstrings() =====";
+
+   this->loadSearchCorpus();
+
+   FM::WordIndex<IndexedItem> wordIndex;
+   for (int i = 0; i < this->words.size(); i++)
+      wordIndex.addItem(this->words[i], &this->items[i]);
+
+   const qint64 memoryBefore = residentMemory();
+
+   QElapsedTimer timer;
+   timer.start();
+
+   FM::SubstringIndex<IndexedItem> substringIndex(std::numeric_limits<qint64>::max());
+   for (int i = 0; i < this->words.size(); i++)
+      substringIndex.addItem(this->words[i], &this->items[i]);
+
+   qDebug() << QString("%1 names indexed by their substrings in %2 ms, memory used : %3 KiB (%4 KiB estimated by the index)")
+      .arg(this->words.size()).arg(timer.elapsed()).arg((residentMemory() - memoryBefore) / 1024).arg(substringIndex.getMemoryUsed() / 1024);
+
+   QStringList prefixes;
+   QStringList substrings;
+   qsrand(42);
+   while (substrings.size() < NB_SEARCHES)
+   {
+      const QString word = this->words[qrand() % this->words.size()].value(0);
+      const int length = qrand() % 6 + 3;
+      if (word.size() < length)
+         continue;
+      prefixes << word.left(length);
+      substrings << word.mid(qrand() % (word.size() - length + 1), length);
+   }
+
+   foreach (int maxNbResult, QList<int>() << -1 << MAX_NB_RESULT)
+   {
+      timer.start();
+      qint64 nbResults = 0;
+      foreach (QString prefix, prefixes)
+         nbResults += wordIndex.search(QStringList() << prefix, maxNbResult).size();
+      qDebug() << QString("%1 prefix searches (limit : %2) in %3 ms, %4 results").arg(prefixes.size()).arg(maxNbResult).arg(timer.elapsed()).arg(nbResults);
+
+      timer.start();
+      nbResults = 0;
+      foreach (QString substring, substrings)
+         nbResults += substringIndex.search(QStringList() << substring, maxNbResult).size();
+      qDebug() << QString("%1 substring searches (limit : %2) in %3 ms, %4 results").arg(substrings.size()).arg(maxNbResult).arg(timer.elapsed()).arg(nbResults);
+   }
+
+   for (int i = 0; i < 10; i++)
+   {
+      int nbExpected = 0;
+      foreach (QStringList nameWords, this->words)
+         if (nameWords.join(" ").contains(substrings[i]))
+            nbExpected++;
+      QCOMPARE(substringIndex.search(QStringList() << substrings[i]).size(), nbExpected);
+   }
+}
+
+/**
+  * Create the directories and the files read by the scanning benchmarks, an existing tree is reused.
+  */
+void Benchmarks::createTree()
+{
+   if (QDir(this->treeDir).exists())
+      return;
+
+   qDebug() << "Creating " << NB_TOP_DIRS * NB_SUB_DIRS * NB_FILES_PER_DIR << " files in " << this->treeDir << " ..";
+
+   for (int i = 0; i < NB_TOP_DIRS; i++)
+      for (int j = 0; j < NB_SUB_DIRS; j++)
+      {
+         const QString dirPath = QString("%1/dir%2/subdir%3").arg(this->treeDir).arg(i).arg(j);
+         QDir::current().mkpath(dirPath);
+
+         for (int k = 0; k < NB_FILES_PER_DIR; k++)
+         {
+            QFile file(QString("%1/file%2.bin").arg(dirPath).arg(k));
+            file.open(QIODevice::WriteOnly);
+            file.write("x");
+         }
+      }
+}
+
+/**
+  * The names are read from 'SEARCH_CORPUS_DIR' if it exists, the remaining ones are generated like 'prototypes/03_Search' did (eight hexadecimal letters).
+  * Some names are composed of two words.
+  */
+void Benchmarks::loadSearchCorpus()
+{
+   if (!this->names.isEmpty())
+   {
+      this->items.fill(IndexedItem()); // The items may still have the identifiers given by the index of a previous benchmark.
+      return;
+   }
+
+   for (QDirIterator i(SEARCH_CORPUS_DIR, QDir::AllEntries | QDir::NoDotAndDotDot, QDirIterator::Subdirectories); i.hasNext() && this->names.size() < NB_INDEXED_NAMES;)
+   {
+      i.next();
+      this->names << i.fileName();
+   }
+   qDebug() << this->names.size() << " names read from " << SEARCH_CORPUS_DIR;
+
+   qsrand(42);
+   while (this->names.size() < NB_INDEXED_NAMES)
+   {
+      QString name = QUuid::createUuid().toString().mid(1, 8);
+      if (qrand() % 4 == 0)
+         name.append(' ').append(QUuid::createUuid().toString().mid(10, 4));
+      this->names << name;
+   }
+
+   foreach (QString name, this->names)
+      this->words << Common::Global::splitInWords(name);
+
+   this->items.resize(this->names.size());
+}
+
+/**
+  * @return The resident memory of the process [byte] or 0 if unknown.
+  */
+qint64 Benchmarks::residentMemory()
+{
+#ifdef Q_OS_LINUX
+   QFile statm("/proc/self/statm");
+   if (statm.open(QIODevice::ReadOnly))
+   {
+      const QList<QByteArray> values = statm.readAll().split(' ');
+      if (values.size() > 1)
+         return values[1].toLongLong() * sysconf(_SC_PAGESIZE);
+   }
+#endif
+   return 0;
+}
+
+/**
+  * Return the level given by 'WordIndex::search(..)' to an entry or -1 if the entry isn't found.
+  * @param matches For each term : 0 if the entry doesn't match, 1 if it matches exactly and 2 if it matches partially.
+  */
+int Benchmarks::expectedLevel(const QVector<int>& matches)
+{
+   const int n = matches.size();
+
+   QList<int> matchedTerms;
+   int nbPartialMatches = 0;
+   for (int i = 0; i < n; i++)
+      if (matches[i] != 0)
+      {
+         matchedTerms << i;
+         if (matches[i] == 2)
+            nbPartialMatches++;
+      }
+
+   const int nbIntersect = matchedTerms.size();
+   if (nbIntersect == 0)
+      return -1;
+
+   // The levels taken by the groups matching more terms.
+   int level = 0;
+   for (int i = n; i > nbIntersect; i--)
+      level += Common::Global::nCombinations(n, i) * (1 + i);
+
+   // The rank of the combination among the ones of its group, in lexicographic order.
+   for (int i = 0, previous = -1; i < nbIntersect; previous = matchedTerms[i++])
+      for (int v = previous + 1; v < matchedTerms[i]; v++)
+         level += Common::Global::nCombinations(n - 1 - v, nbIntersect - 1 - i);
+
+   return level + nbPartialMatches * Common::Global::nCombinations(n, nbIntersect);
+}
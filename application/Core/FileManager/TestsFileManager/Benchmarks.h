@@ -0,0 +1,80 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef TESTS_BENCHMARKS_H
+#define TESTS_BENCHMARKS_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/**
+  * An item of the word index benchmarks, see 'FM::WordIndex'.
+  */
+struct IndexedItem
+{
+   IndexedItem() : wordIndexId(0) {}
+   quint32 getWordIndexId() const { return this->wordIndexId; }
+   void setWordIndexId(quint32 id) { this->wordIndexId = id; }
+
+   quint32 wordIndexId;
+};
+
+/**
+  * Some measures of the FileManager performances, run with the argument '-bench'.
+  * The results are printed with 'qDebug()'.
+  */
+class Benchmarks : public QObject
+{
+   Q_OBJECT
+public:
+   Benchmarks();
+
+private slots:
+   void initTestCase();
+
+   /***** Scanning *****/
+   void scanWithQDir();
+   void scanWithFileManager_data();
+   void scanWithFileManager();
+
+   /***** Word index *****/
+   void splitNamesInWords();
+   void buildWordIndex();
+   void indexNamesWithReusedBuffer();
+   void searchInWordIndex();
+   void searchInWordIndexDuringInsertion();
+   void searchMultipleTermsInWordIndex();
+   void searchSubstrings();
+
+private:
+   void createTree();
+   void loadSearchCorpus();
+
+   static qint64 residentMemory();
+   static int expectedLevel(const QVector<int>& matches);
+
+   QString treeDir;
+
+   QStringList names; ///< The names of the entries indexed by the word index benchmarks.
+   QList<QStringList> words; ///< The words of each name.
+   QVector<IndexedItem> items; ///< The items indexed by their name.
+};
+
+#endif
@@ -343,7 +343,7 @@ void StressTest::doASearch()
    {
       QString terms = this->randGen.generateAName() + " " + this->randGen.generateAName();
 
-      QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, 65536);
+      QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, 65536);
 
       if (!results.isEmpty() && results.first().entry_size() != 0)
       {
@@ -576,8 +576,9 @@ void StressTest::getHashes()
    }
    else
    {
-      qDebug() << "Number of hashes : " << result2.nb_hash();
-      this->getHashesResults << HashesResult(result, result2.nb_hash(), entryToStr(entry));
+      qDebug() << "Number of hashes : " << result2.nb_hash() << ", already known : " << result2.hash_size();
+      if (static_cast<int>(result2.nb_hash()) > result2.hash_size())
+         this->getHashesResults << HashesResult(result, result2.nb_hash() - result2.hash_size(), entryToStr(entry));
    }
 }
 
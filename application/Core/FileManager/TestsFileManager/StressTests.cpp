@@ -20,8 +20,15 @@
 
 #include <QtDebug>
 #include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QList>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QSharedPointer>
 
 #include <Protos/core_settings.pb.h>
+#include <Protos/common.pb.h>
 
 #include <Common/Settings.h>
 #include <Common/PersistentData.h>
@@ -29,8 +36,15 @@
 #include <Common/Global.h>
 #include <Common/LogManager/Builder.h>
 
+#include <Builder.h>
+#include <IFileManager.h>
+
 #include <StressTest.h>
 
+const int NB_DIRS_BURST = 100;
+const int NB_FILES_PER_DIR_BURST = 1000;
+const int BURST_TIMEOUT = 10 * 60 * 1000; // [ms].
+
 StressTests::StressTests()
 {
 }
@@ -59,6 +73,64 @@ void StressTests::initTestCase()
    SETTINGS.set("check_received_data_integrity", false);
 }
 
+/**
+  * Create then delete 100 000 files in a watched directory as fast as possible and check that the cache follows.
+  * The inotify queue (16384 events by default) overflows, the cache must be synchronized anyway.
+  */
+void StressTests::createAndDeleteManyFiles()
+{
+   qDebug() << "===== createAndDeleteManyFiles() =====";
+
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL);
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE_JOURNAL, Common::Global::LOCAL);
+
+   const QString sharedDir = QDir::currentPath() + "/sharedDirs/burst";
+   QDir::current().mkpath(sharedDir);
+
+   QSharedPointer<FM::IFileManager> fileManager = FM::Builder::newFileManager();
+   fileManager->setSharedDirs(QStringList() << sharedDir);
+   QTest::qWait(1000); // Let the initial scanning be done.
+
+   const int nbFiles = NB_DIRS_BURST * NB_FILES_PER_DIR_BURST;
+
+   QElapsedTimer timer;
+   timer.start();
+   for (int i = 0; i < NB_DIRS_BURST; i++)
+   {
+      const QString dirPath = QString("%1/dir%2").arg(sharedDir).arg(i);
+      QDir::current().mkpath(dirPath);
+      for (int j = 0; j < NB_FILES_PER_DIR_BURST; j++)
+      {
+         QFile file(QString("%1/file%2.bin").arg(dirPath).arg(j));
+         file.open(QIODevice::WriteOnly);
+         file.write("x");
+      }
+   }
+   qDebug() << QString("%1 files created in %2 ms").arg(nbFiles).arg(timer.elapsed());
+
+   timer.start();
+   while (countFiles(fileManager.data()) != nbFiles && timer.elapsed() < BURST_TIMEOUT)
+      QTest::qWait(100);
+   QCOMPARE(countFiles(fileManager.data()), nbFiles);
+   qDebug() << QString("Cache synchronized after %1 ms").arg(timer.elapsed());
+
+   timer.start();
+   for (int i = 0; i < NB_DIRS_BURST; i++)
+   {
+      QDir dir(QString("%1/dir%2").arg(sharedDir).arg(i));
+      foreach (QString filename, dir.entryList(QDir::Files))
+         dir.remove(filename);
+      QDir(sharedDir).rmdir(dir.dirName());
+   }
+   qDebug() << QString("%1 files deleted in %2 ms").arg(nbFiles).arg(timer.elapsed());
+
+   timer.start();
+   while (countFiles(fileManager.data()) != 0 && timer.elapsed() < BURST_TIMEOUT)
+      QTest::qWait(100);
+   QCOMPARE(countFiles(fileManager.data()), 0);
+   qDebug() << QString("Cache synchronized after %1 ms").arg(timer.elapsed());
+}
+
 /**
   * Some tasks will be performed concurrently.
   */
@@ -67,5 +139,37 @@ void StressTests::stressTest()
    qDebug() << "===== stressTest() =====";
 
    Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL);
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE_JOURNAL, Common::Global::LOCAL);
    StressTest test;
 }
+
+/**
+  * Return the number of files indexed by the file manager, all the shared directories are browsed.
+  */
+int StressTests::countFiles(FM::IFileManager* fileManager)
+{
+   int nbFiles = 0;
+
+   QList<Protos::Common::Entry> dirs;
+   const Protos::Common::Entries sharedDirs = fileManager->getEntries();
+   for (int i = 0; i < sharedDirs.entry_size(); i++)
+      dirs << sharedDirs.entry(i);
+
+   while (!dirs.isEmpty())
+   {
+      const Protos::Common::Entry dir = dirs.takeFirst();
+      const Protos::Common::Entries entries = fileManager->getEntries(dir);
+      for (int i = 0; i < entries.entry_size(); i++)
+      {
+         if (entries.entry(i).type() == Protos::Common::Entry_Type_DIR)
+         {
+            dirs << entries.entry(i);
+            dirs.last().mutable_shared_dir()->CopyFrom(dir.shared_dir());
+         }
+         else
+            nbFiles++;
+      }
+   }
+
+   return nbFiles;
+}
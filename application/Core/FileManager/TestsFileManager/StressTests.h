@@ -21,6 +21,8 @@
 
 #include <QObject>
 
+namespace FM { class IFileManager; }
+
 class StressTests : public QObject
 {
    Q_OBJECT
@@ -30,8 +32,14 @@ public:
 private slots:
     void initTestCase();
 
+    /***** A burst of file system events, the watcher queue may overflow *****/
+    void createAndDeleteManyFiles();
+
     /***** Simulating of a real usage with all previous tests running concurrently *****/
-    void stressTest();
+    void stressTest(); // Never ends, must be the last one.
+
+private:
+    static int countFiles(FM::IFileManager* fileManager);
 };
 
 #endif
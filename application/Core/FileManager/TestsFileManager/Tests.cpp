@@ -20,17 +20,21 @@
 using namespace FM;
 
 #include <string>
+#include <limits>
 using namespace std;
 
 #include <QtDebug>
 #include <QRegExp>
 #include <QFile>
+#include <QFileInfo>
+#include <QPair>
 #include <QTextStream>
 #include <QDataStream>
 #include <QStringList>
 #include <QDirIterator>
 
 #include <Protos/core_settings.pb.h>
+#include <Protos/files_cache.pb.h>
 
 #include <Common/LogManager/Builder.h>
 #include <Common/PersistentData.h>
@@ -44,6 +48,8 @@ using namespace std;
 #include <IGetHashesResult.h>
 #include <Exceptions.h>
 #include <priv/Constants.h>
+#include <priv/Cache/CacheJournal.h>
+#include <priv/FileUpdater/DirLister.h>
 
 #include <HashesReceiver.h>
 
@@ -306,6 +312,40 @@ void Tests::removeADirectory()
    QTest::qSleep(100);
 }
 
+/**
+  * The unwatchable directories are periodically read only if they have changed, see 'DirLister::list(..)'.
+  * A file modified in place doesn't change the signature of its directory, only a complete reading of the directory
+  * can detect it, see the setting 'full_scan_period_unwatchable_dirs'.
+  */
+void Tests::modifyAFileInAnUnwatchableDirectory()
+{
+   qDebug() << "===== modifyAFileInAnUnwatchableDirectory() =====";
+
+   const QString dirPath = QDir::currentPath().append("/unwatchable/");
+   QVERIFY(Common::Global::createFile("unwatchable/v.txt"));
+   QTest::qSleep(MIN_DIR_SIGNATURE_AGE + 1000);
+
+   const DirSignature signature = DirLister::readSignature(dirPath);
+   QVERIFY(!signature.isNull());
+   const QList<FileSystemEntry> knownFiles = DirLister::readDir(dirPath);
+   QCOMPARE(knownFiles.size(), 1);
+
+   {
+      QFile file("unwatchable/v.txt");
+      QVERIFY(file.open(QIODevice::ReadWrite));
+      file.write("X"); // The size doesn't change.
+   }
+
+   QVERIFY(DirLister::readSignature(dirPath) == signature);
+
+   const QList<FileSystemEntry> files = DirLister::readDir(dirPath);
+   QCOMPARE(files.size(), 1);
+   QCOMPARE(files.first().size, knownFiles.first().size);
+   QVERIFY(files.first().dateLastModified != knownFiles.first().dateLastModified);
+
+   Common::Global::recursiveDeleteDirectory("unwatchable");
+}
+
 void Tests::createAnEmptyFile()
 {
    qDebug() << "===== createAnEmptyFile() =====";
@@ -376,8 +416,11 @@ void Tests::getHashesFromAFileEntry1()
 
    Protos::Core::GetHashesResult res = result->start();
 
+   // The hash is already known, it's given with the result.
    QCOMPARE(res.status(), Protos::Core::GetHashesResult_Status_OK);
-   QVERIFY(hashesReceiver.waitToReceive(QList<Common::Hash>() << Common::Hash::fromStr("97d464813598e2e4299b5fe7db29aefffdf2641d"), 500));
+   QCOMPARE(res.nb_hash(), 1u);
+   QCOMPARE(res.hash_size(), 1);
+   QVERIFY(Common::Hash(res.hash(0).hash()) == Common::Hash::fromStr("97d464813598e2e4299b5fe7db29aefffdf2641d"));
 }
 
 void Tests::getHashesFromAFileEntry2()
@@ -450,7 +493,7 @@ void Tests::findExistingFilesWithOneWord()
    expectedResult[0] << "aaaa cccc.txt" << "aaaa bbbb.txt" << "aaaa bbbb cccc.txt" << "aaaa dddddd.txt";
    expectedResult[1] << "aaaaaa dddddd.txt" << "aaaaaa bbbb.txt" << "aaaaaa bbbbbb.txt";
 
-   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, 65536);
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, 65536);
    QVERIFY(!results.isEmpty());
    this->printSearch(terms, results.first());
    this->compareExpectedResult(results.first(), expectedResult);
@@ -461,7 +504,7 @@ void Tests::findUnexistingFilesWithOneWord()
    qDebug() << "===== findUnexistingFilesWithOneWord() =====";
 
    QString terms("mmmm");
-   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, 65536);
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, 65536);
    QVERIFY(results.isEmpty());
 }
 
@@ -483,7 +526,7 @@ void Tests::findFilesWithSomeWords1()
    expectedResult[14] << "bbbb.txt" <<  "bbbb dddd.txt";
    expectedResult[16] << "aaaaaa dddddd.txt";
 
-   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, 65536);
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, 65536);
    QVERIFY(!results.isEmpty());
    this->printSearch(terms, results.first());
    this->compareExpectedResult(results.first(), expectedResult);
@@ -509,7 +552,7 @@ void Tests::findFilesWithSomeWords2()
    expectedResult[40] << "bbbb.txt";
    expectedResult[42] << "dddd.txt";
 
-   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, 65536);
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, 65536);
    QVERIFY(!results.isEmpty());
    this->printSearch(terms, results.first());
    this->compareExpectedResult(results.first(), expectedResult);
@@ -522,16 +565,58 @@ void Tests::findFilesWithResultFragmentation()
    const int FRAGMENT_MAX_SIZE = 200;
 
    QString terms("bbb");
-   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, 10000, FRAGMENT_MAX_SIZE);
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, Protos::Common::FindFilter(), 10000, FRAGMENT_MAX_SIZE);
    qDebug() << "Nb fragment : " << results.size();
    for (int i = 0; i < results.size(); i++)
    {
       qDebug() << "Fragment number " << i << ", size = " << results[i].ByteSize();
       QVERIFY(results[i].ByteSize() <= FRAGMENT_MAX_SIZE);
       this->printSearch(terms, results[i]);
+
+      // Each entry gets back its path and its shared directory.
+      Protos::Common::FindResult result = results[i];
+      Common::ProtoHelper::expandFindResult(result);
+      QCOMPARE(result.path_size(), 0);
+      for (int j = 0; j < result.entry_size(); j++)
+      {
+         QVERIFY(result.entry(j).entry().path().size() > 0);
+         QVERIFY(result.entry(j).entry().has_shared_dir());
+      }
    }
 }
 
+void Tests::findFilesWithFilter()
+{
+   qDebug() << "===== findFilesWithFilter() =====";
+
+   QString terms("aaaa");
+
+   FindResult expectedResult;
+   expectedResult[0] << "aaaa cccc.txt" << "aaaa bbbb.txt" << "aaaa bbbb cccc.txt" << "aaaa dddddd.txt";
+   expectedResult[1] << "aaaaaa dddddd.txt" << "aaaaaa bbbb.txt" << "aaaaaa bbbbbb.txt";
+
+   Protos::Common::FindFilter filter;
+   filter.set_type(Protos::Common::Entry_Type_FILE);
+   filter.add_extension("avi");
+   filter.add_extension("TXT");
+   QList<Protos::Common::FindResult> results = this->fileManager->find(terms, filter, 10000, 65536);
+   QVERIFY(!results.isEmpty());
+   this->printSearch(terms, results.first());
+   this->compareExpectedResult(results.first(), expectedResult);
+
+   filter.set_type(Protos::Common::Entry_Type_DIR);
+   QVERIFY(this->fileManager->find(terms, filter, 10000, 65536).isEmpty());
+
+   filter.clear_type();
+   filter.clear_extension();
+   filter.add_extension("avi");
+   QVERIFY(this->fileManager->find(terms, filter, 10000, 65536).isEmpty());
+
+   filter.clear_extension();
+   filter.set_min_size(std::numeric_limits<qint64>::max());
+   QVERIFY(this->fileManager->find("aaaa bbbb cccc", filter, 10000, 65536).isEmpty());
+}
+
 void Tests::haveChunks()
 {
    qDebug() << "===== haveChunks() =====";
@@ -566,6 +651,48 @@ void Tests::printAmount()
    qDebug() << "Sharing amount : " << this->fileManager->getAmount() << " bytes";
 }
 
+/**
+  * The files created, renamed and removed are appended to the journal, they must be found after a restart.
+  * Then the journal is compacted into the file cache.
+  */
+void Tests::persistTheCacheWithAJournal()
+{
+   qDebug() << "===== persistTheCacheWithAJournal() =====";
+
+   // The journal is opened after a restart, the changes below aren't persisted by a compaction.
+   this->restartFileManager();
+
+   QVERIFY(Common::Global::createFile("sharedDirs/share1/journal/a.txt"));
+   QVERIFY(Common::Global::createFile("sharedDirs/share1/journal/b.txt"));
+   QTest::qSleep(100);
+   this->waitTheFileManagerIsUpToDate();
+
+   this->restartFileManager();
+   QStringList files = getPersistedFiles();
+   QVERIFY(getCacheJournalSize() > qint64(sizeof(quint64)));
+   QVERIFY(files.contains("share1/journal/a.txt"));
+   QVERIFY(files.contains("share1/journal/b.txt"));
+
+   // A renaming is journaled as a removal followed by an addition.
+   QVERIFY(QDir::current().rename("sharedDirs/share1/journal/a.txt", "sharedDirs/share1/journal/c.txt"));
+   QVERIFY(QFile("sharedDirs/share1/journal/b.txt").remove());
+   QTest::qSleep(100);
+   this->waitTheFileManagerIsUpToDate();
+
+   this->restartFileManager();
+   files = getPersistedFiles();
+   QVERIFY(!files.contains("share1/journal/a.txt"));
+   QVERIFY(!files.contains("share1/journal/b.txt"));
+   QVERIFY(files.contains("share1/journal/c.txt"));
+
+   // Removing a shared directory persists the whole cache and resets the journal.
+   this->sharedDirs.removeAll(QDir::currentPath().append("/incoming/"));
+   this->fileManager->setSharedDirs(this->sharedDirs);
+   QCOMPARE(getCacheJournalSize(), qint64(sizeof(quint64)));
+   files = getPersistedFiles();
+   QVERIFY(files.contains("share1/journal/c.txt"));
+}
+
 void Tests::rmSharedDirectory()
 {
    qDebug() << "===== rmSharedDirectory() =====";
@@ -622,6 +749,57 @@ void Tests::deleteAllFiles()
    Common::Global::recursiveDeleteDirectory("incoming");
 }
 
+/**
+  * The current changes are persisted when the file manager is deleted.
+  */
+void Tests::restartFileManager()
+{
+   this->fileManager.clear();
+   this->fileManager = Builder::newFileManager();
+   this->waitTheFileManagerIsUpToDate();
+   QCOMPARE(this->fileManager->getSharedDirs().size(), this->sharedDirs.size());
+}
+
+void Tests::waitTheFileManagerIsUpToDate()
+{
+   // 'qWait(..)' is used to process the queued signal 'fileCacheLoaded()', the cache isn't persisted before.
+   for (int i = 0; i < 100 && this->fileManager->getCacheStatus() != IFileManager::UP_TO_DATE; i++)
+      QTest::qWait(100);
+   QTest::qWait(100);
+   QVERIFY(this->fileManager->getCacheStatus() == IFileManager::UP_TO_DATE);
+}
+
+/**
+  * Return the relative path of all the files found in the persisted cache and its journal, for example : "share1/journal/a.txt".
+  */
+QStringList Tests::getPersistedFiles()
+{
+   Protos::FileCache::Hashes hashes;
+   Common::PersistentData::getValue(Common::Constants::FILE_CACHE, hashes, Common::Global::LOCAL);
+   CacheJournal::applyTo(hashes);
+
+   QStringList files;
+   QList< QPair<const Protos::FileCache::Hashes_Dir*, QString> > dirs;
+   for (int i = 0; i < hashes.shareddir_size(); i++)
+      dirs << qMakePair(&hashes.shareddir(i).root(), QString());
+
+   while (!dirs.isEmpty())
+   {
+      const QPair<const Protos::FileCache::Hashes_Dir*, QString> dir = dirs.takeFirst();
+      for (int i = 0; i < dir.first->file_size(); i++)
+         files << dir.second + Common::ProtoHelper::getStr(dir.first->file(i), &Protos::FileCache::Hashes_File::filename);
+      for (int i = 0; i < dir.first->dir_size(); i++)
+         dirs << qMakePair(&dir.first->dir(i), dir.second + Common::ProtoHelper::getStr(dir.first->dir(i), &Protos::FileCache::Hashes_Dir::name) + '/');
+   }
+
+   return files;
+}
+
+qint64 Tests::getCacheJournalSize()
+{
+   return QFileInfo(Common::Global::getDataFolder(Common::Global::LOCAL) + '/' + Common::Constants::FILE_CACHE_JOURNAL).size();
+}
+
 void Tests::printSearch(const QString& terms, const Protos::Common::FindResult& result)
 {
    qDebug() << "Search : " << terms;
@@ -64,6 +64,7 @@ private slots:
    void moveAnEmptyDirectory();
    void moveADirectoryContainingFiles();
    void removeADirectory();
+   void modifyAFileInAnUnwatchableDirectory();
    void createAnEmptyFile();
 
    /***** Ask for chunks by hash *****/
@@ -85,6 +86,7 @@ private slots:
    void findFilesWithSomeWords1();
    void findFilesWithSomeWords2();
    void findFilesWithResultFragmentation();
+   void findFilesWithFilter();
 
    /***** Ask if the given hashes are known *****/
    void haveChunks();
@@ -92,6 +94,9 @@ private slots:
    /***** Ask for the amount of shared byte *****/
    void printAmount();
 
+   /***** Persist the changes to the journal and restore them *****/
+   void persistTheCacheWithAJournal();
+
    /***** Removing shared directories *****/
    void rmSharedDirectory();
 
@@ -106,6 +111,11 @@ private:
 
    void addSuperSharedDirectoriesAndMerge();
 
+   void restartFileManager();
+   void waitTheFileManagerIsUpToDate();
+   static QStringList getPersistedFiles();
+   static qint64 getCacheJournalSize();
+
    static void compareStrRegexp(const QString& regexp, const QString& str);
 
    QStringList sharedDirs;
@@ -18,26 +18,36 @@
   
 #include <QCoreApplication>
 #include <QTest>
+#include <QStringList>
 
 #include <Tests.h>
 #include <StressTests.h>
+#include <Benchmarks.h>
 
 int main(int argc, char *argv[])
 {
    QCoreApplication a(argc, argv);
 
    bool stressMode = false;
+   bool benchMode = false;
+   QStringList testArguments; // The arguments given to QTest, for example to choose a test by its name.
    foreach (QString arg, a.arguments())
       if (arg == "-stress")
-      {
          stressMode = true;
-         break;
-      }
+      else if (arg == "-bench")
+         benchMode = true;
+      else
+         testArguments << arg;
 
    if (stressMode)
    {
       StressTests tests;
-      return QTest::qExec(&tests);
+      return QTest::qExec(&tests, testArguments);
+   }
+   else if (benchMode)
+   {
+      Benchmarks benchmarks;
+      return QTest::qExec(&benchmarks, testArguments);
    }
    else
    {
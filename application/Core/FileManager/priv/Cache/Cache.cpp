@@ -572,6 +572,16 @@ void Cache::onEntryRemoved(Entry* entry)
    emit entryRemoved(entry);
 }
 
+void Cache::onEntryDeleting(Entry* entry)
+{
+   emit entryDeleting(entry);
+}
+
+void Cache::onFileCreated(File* file)
+{
+   emit fileCreated(file);
+}
+
 void Cache::onChunkHashKnown(QSharedPointer<Chunk> chunk)
 {
    emit chunkHashKnown(chunk);
@@ -73,12 +73,25 @@ namespace FM
 
       void onEntryAdded(Entry* entry);
       void onEntryRemoved(Entry* entry);
+      void onEntryDeleting(Entry* entry);
+      void onFileCreated(File* file);
       void onChunkHashKnown(QSharedPointer<Chunk> chunk);
       void onChunkRemoved(QSharedPointer<Chunk> chunk);
 
    signals:
       void entryAdded(Entry* entry);
       void entryRemoved(Entry* entry);
+
+      /**
+        * Emitted at the beginning of the destruction of an entry, unlike 'entryRemoved(..)' the entry is still entirely usable.
+        */
+      void entryDeleting(Entry* entry);
+
+      /**
+        * Emitted at the end of the construction of a file.
+        */
+      void fileCreated(File* file);
+
       void chunkHashKnown(QSharedPointer<Chunk> chunk);
       void chunkRemoved(QSharedPointer<Chunk> chunk);
 
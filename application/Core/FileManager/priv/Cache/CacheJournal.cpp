@@ -0,0 +1,273 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/Cache/CacheJournal.h>
+using namespace FM;
+
+#include <QDataStream>
+#include <QByteArray>
+#include <QHash>
+
+#include <Common/Constants.h>
+#include <Common/Global.h>
+#include <Common/PersistentData.h>
+
+#include <priv/Log.h>
+
+/**
+  * @class FM::CacheJournal
+  *
+  * An append-only file containing the changes made to the file cache since it was last entirely persisted.
+  * Each time the cache is persisted only the modified and removed entries are appended (see 'Protos::FileCache::JournalEntry'),
+  * the whole cache is rewritten only when the journal becomes too big compared to it (compaction).
+  *
+  * Format : <journal id : quint64> (<entry size : quint32> <Protos::FileCache::JournalEntry>)*
+  * The journal is applied to the file cache only if their ids match. An incomplete last entry (crash) is ignored.
+  */
+
+CacheJournal::CacheJournal()
+{
+}
+
+/**
+  * Read the journal and merge its entries into the given hashes.
+  * Does nothing if the journal doesn't exist or doesn't belong to 'hashes'.
+  */
+void CacheJournal::applyTo(Protos::FileCache::Hashes& hashes)
+{
+   QFile journalFile;
+   try
+   {
+      journalFile.setFileName(getFilepath());
+   }
+   catch (Common::Global::UnableToGetFolder& e)
+   {
+      L_ERRO(e.errorMessage);
+      return;
+   }
+
+   if (!journalFile.open(QIODevice::ReadOnly))
+      return;
+
+   QDataStream stream(&journalFile);
+   quint64 id = 0;
+   stream >> id;
+   if (stream.status() != QDataStream::Ok || !hashes.has_journal_id() || hashes.journal_id() != id)
+   {
+      L_WARN(QString("The file cache journal doesn't match the file cache, it will be ignored : %1").arg(journalFile.fileName()));
+      return;
+   }
+
+   // Index of the directories and files already reached, the pointers to the elements of a 'RepeatedPtrField' remain valid when it grows.
+   QHash<Protos::FileCache::Hashes_Dir*, QHash<QByteArray, Protos::FileCache::Hashes_Dir*> > subDirsIndex;
+   QHash<Protos::FileCache::Hashes_Dir*, QHash<QByteArray, Protos::FileCache::Hashes_File*> > filesIndex;
+
+   int nbEntries = 0;
+   while (!stream.atEnd())
+   {
+      QByteArray data;
+      stream >> data;
+      Protos::FileCache::JournalEntry entry;
+      if (stream.status() != QDataStream::Ok || !entry.ParseFromArray(data.constData(), data.size()))
+      {
+         L_WARN(QString("The file cache journal is truncated after %1 entries").arg(nbEntries));
+         break;
+      }
+      nbEntries++;
+
+      Protos::FileCache::Hashes_Dir* dir = 0;
+      for (int i = 0; i < hashes.shareddir_size(); i++)
+         if (hashes.shareddir(i).id().hash() == entry.shared_dir_id().hash())
+         {
+            dir = hashes.mutable_shareddir(i)->mutable_root();
+            break;
+         }
+
+      if (!dir) // The shared directory doesn't exist anymore.
+         continue;
+
+      // A removal (tombstone) doesn't create the missing directories. For a removed directory we stop at its parent.
+      const bool removal = !entry.has_file();
+      const bool dirRemoval = removal && !entry.has_removed_file();
+      const int nbDirs = dirRemoval ? entry.dir_size() - 1 : entry.dir_size();
+
+      for (int i = 0; dir && i < nbDirs; i++)
+      {
+         QHash<QByteArray, Protos::FileCache::Hashes_Dir*>& subDirs = subDirsIndex[dir];
+         if (subDirs.isEmpty())
+            for (int j = 0; j < dir->dir_size(); j++)
+               subDirs.insert(QByteArray(dir->dir(j).name().data(), dir->dir(j).name().size()), dir->mutable_dir(j));
+
+         const QByteArray name(entry.dir(i).data(), entry.dir(i).size());
+         Protos::FileCache::Hashes_Dir* subDir = subDirs.value(name);
+         if (!subDir && !removal)
+         {
+            subDir = dir->add_dir();
+            subDir->set_name(entry.dir(i));
+            subDirs.insert(name, subDir);
+         }
+         dir = subDir;
+      }
+
+      if (!dir || (dirRemoval && nbDirs < 0)) // The removed entry isn't known.
+         continue;
+
+      if (dirRemoval)
+      {
+         for (int j = 0; j < dir->dir_size(); j++)
+            if (dir->dir(j).name() == entry.dir(nbDirs))
+            {
+               // The last directory takes the place of the removed one.
+               dir->mutable_dir()->SwapElements(j, dir->dir_size() - 1);
+               dir->mutable_dir()->RemoveLast();
+
+               // The removed directories are kept by 'RepeatedPtrField' to be reused by the next added ones, the indexes may point to them.
+               subDirsIndex.clear();
+               filesIndex.clear();
+               break;
+            }
+         continue;
+      }
+
+      QHash<QByteArray, Protos::FileCache::Hashes_File*>& files = filesIndex[dir];
+      if (files.isEmpty())
+         for (int j = 0; j < dir->file_size(); j++)
+            files.insert(QByteArray(dir->file(j).filename().data(), dir->file(j).filename().size()), dir->mutable_file(j));
+
+      const std::string& filenameStr = removal ? entry.removed_file() : entry.file().filename();
+      const QByteArray filename(filenameStr.data(), filenameStr.size());
+      Protos::FileCache::Hashes_File* file = files.value(filename);
+
+      if (removal)
+      {
+         if (file)
+         {
+            // The last file takes the place of the removed one, the pointers to the other files remain valid.
+            for (int j = 0; j < dir->file_size(); j++)
+               if (dir->mutable_file(j) == file)
+               {
+                  dir->mutable_file()->SwapElements(j, dir->file_size() - 1);
+                  dir->mutable_file()->RemoveLast();
+                  break;
+               }
+            files.remove(filename);
+         }
+         continue;
+      }
+
+      if (!file)
+      {
+         file = dir->add_file();
+         files.insert(filename, file);
+      }
+      file->CopyFrom(entry.file());
+   }
+
+   L_DEBU(QString("%1 entries applied from the file cache journal").arg(nbEntries));
+}
+
+/**
+  * Open the journal to append some entries to it.
+  * If the existing journal doesn't have the given id it is reset.
+  * @exception PersistentDataIOException
+  */
+void CacheJournal::open(quint64 id)
+{
+   this->file.close();
+
+   try
+   {
+      this->file.setFileName(getFilepath());
+   }
+   catch (Common::Global::UnableToGetFolder& e)
+   {
+      throw Common::PersistentDataIOException(e.errorMessage);
+   }
+
+   if (this->file.open(QIODevice::ReadOnly))
+   {
+      QDataStream stream(&this->file);
+      quint64 currentId = 0;
+      stream >> currentId;
+      this->file.close();
+
+      if (stream.status() == QDataStream::Ok && currentId == id && this->file.open(QIODevice::WriteOnly | QIODevice::Append))
+         return;
+   }
+
+   this->reset(id);
+}
+
+/**
+  * Remove all the entries, called after the file cache has been entirely persisted.
+  * @exception PersistentDataIOException
+  */
+void CacheJournal::reset(quint64 id)
+{
+   this->file.close();
+
+   try
+   {
+      this->file.setFileName(getFilepath());
+   }
+   catch (Common::Global::UnableToGetFolder& e)
+   {
+      throw Common::PersistentDataIOException(e.errorMessage);
+   }
+
+   if (!this->file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+      throw Common::PersistentDataIOException(QString("Unable to open the file in write mode : %1, error : %2").arg(this->file.fileName()).arg(this->file.errorString()));
+
+   QDataStream stream(&this->file);
+   stream << id;
+   this->file.flush();
+}
+
+/**
+  * @exception PersistentDataIOException
+  */
+void CacheJournal::append(const QList<Protos::FileCache::JournalEntry>& entries)
+{
+   if (!this->file.isOpen())
+      throw Common::PersistentDataIOException("The file cache journal isn't opened");
+
+   QDataStream stream(&this->file);
+   for (QListIterator<Protos::FileCache::JournalEntry> i(entries); i.hasNext();)
+   {
+      const Protos::FileCache::JournalEntry& entry = i.next();
+      QByteArray data(entry.ByteSize(), 0);
+      entry.SerializeToArray(data.data(), data.size());
+      stream << data;
+   }
+
+   if (stream.status() != QDataStream::Ok || !this->file.flush())
+      throw Common::PersistentDataIOException(QString("Unable to write the file cache journal : %1, error : %2").arg(this->file.fileName()).arg(this->file.errorString()));
+}
+
+qint64 CacheJournal::size() const
+{
+   return this->file.size();
+}
+
+/**
+  * @exception Common::Global::UnableToGetFolder
+  */
+QString CacheJournal::getFilepath()
+{
+   return Common::Global::getDataFolder(Common::Global::LOCAL) + '/' + Common::Constants::FILE_CACHE_JOURNAL;
+}
@@ -307,6 +307,15 @@ bool Chunk::isOwnedBy(File* file) const
    return this->file == file;
 }
 
+/**
+  * Returns 0 if the file has been deleted.
+  */
+File* Chunk::getFile() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->file;
+}
+
 bool Chunk::matchesEntry(const Protos::Common::Entry& entry) const
 {
    QMutexLocker locker(&this->mutex);
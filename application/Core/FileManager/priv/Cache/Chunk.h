@@ -88,6 +88,7 @@ namespace FM
       bool isComplete() const;
 
       bool isOwnedBy(File* file) const;
+      File* getFile() const;
 
       bool matchesEntry(const Protos::Common::Entry& entry) const;
 
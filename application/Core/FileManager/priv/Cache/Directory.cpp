@@ -56,10 +56,9 @@ Directory::~Directory()
 {
    QMutexLocker locker(&this->mutex);
 
-   foreach (File* f, this->files)
-      delete f;
-   foreach (Directory* d, this->subDirs)
-      delete d;
+   this->cache->onEntryDeleting(this);
+
+   this->deleteContent();
 
    if (this->parent)
       this->parent->subDirDeleted(this);
@@ -68,9 +67,21 @@ Directory::~Directory()
 }
 
 /**
-  * Retore the hashes from the cache.
-  * All file which are not complete and not in the cache are physically removed.
-  * Only files ending with the setting "unfinished_suffix_term" will be removed.
+  * Delete the files and the sub directories, they remove themselves from 'files' and 'subDirs'.
+  */
+void Directory::deleteContent()
+{
+   QMutexLocker locker(&this->mutex);
+
+   foreach (File* f, this->files)
+      delete f;
+   foreach (Directory* d, this->subDirs)
+      delete d;
+}
+
+/**
+  * Build the sub directories and the files from the cache and restore their hashes.
+  * The file system isn't read here, it will be synchronized afterwards (see 'FileUpdater::scan(..)').
   * @return The files which have all theirs hashes (complete).
   */
 QList<File*> Directory::restoreFromFileCache(const Protos::FileCache::Hashes::Dir& dir)
@@ -83,31 +94,23 @@ QList<File*> Directory::restoreFromFileCache(const Protos::FileCache::Hashes::Di
    {
       // Sub directories..
       for (int i = 0; i < dir.dir_size(); i++)
-         for (QListIterator<Directory*> d(this->subDirs); d.hasNext();)
-            ret << d.next()->restoreFromFileCache(dir.dir(i));
+      {
+         Directory* subDir = this->createSubDirectory(Common::ProtoHelper::getStr(dir.dir(i), &Protos::FileCache::Hashes_Dir::name));
+         ret << subDir->restoreFromFileCache(dir.dir(i));
+      }
 
       // .. And files.
-      QList<File*> filesNotInDir = this->files;
       for (int i = 0; i < dir.file_size(); i++)
-         for (QListIterator<File*> j(this->files); j.hasNext();)
-         {
-            File* f = j.next();
-            if (f->restoreFromFileCache(dir.file(i)) && f->hasAllHashes())
-            {
-               filesNotInDir.removeOne(f);
-               ret << f;
-            }
-         }
-
-      // Remove unfinished files not in 'dir'.
-      for (QListIterator<File*> i(filesNotInDir); i.hasNext();)
       {
-         File* file = i.next();
-         if (!file->isComplete())
-         {
-            file->removeUnfinishedFiles();
-            delete file;
-         }
+         const Protos::FileCache::Hashes_File& cachedFile = dir.file(i);
+         const QString filename = Common::ProtoHelper::getStr(cachedFile, &Protos::FileCache::Hashes_File::filename);
+
+         File* file = this->getFile(filename);
+         if (!file)
+            file = new File(this, filename, cachedFile.size(), QDateTime::fromMSecsSinceEpoch(cachedFile.date_last_modified()));
+
+         if (file->restoreFromFileCache(cachedFile) && file->hasAllHashes())
+            ret << file;
       }
    }
 
@@ -126,16 +129,9 @@ void Directory::populateHashesDir(Protos::FileCache::Hashes::Dir& dirToFill) con
       filesCopy = this->files;
    }
 
+   // All the files are persisted, even without hash, to be able to rebuild the whole tree without reading the file system.
    for (QListIterator<File*> i(filesCopy); i.hasNext();)
-   {
-      File* f = i.next();
-
-      if (f->hasOneOrMoreHashes())
-      {
-         Protos::FileCache::Hashes_File* file = dirToFill.add_file();
-         f->populateHashesFile(*file);
-      }
-   }
+      i.next()->populateHashesFile(*dirToFill.add_file());
 
    for (QListIterator<Directory*> dir(subDirsCopy); dir.hasNext();)
    {
@@ -143,6 +139,25 @@ void Directory::populateHashesDir(Protos::FileCache::Hashes::Dir& dirToFill) con
    }
 }
 
+/**
+  * Describe the removal of this directory and all its content.
+  * @return false if the directory is a root (a shared directory), its removal isn't journaled.
+  */
+bool Directory::populateJournalRemoval(Protos::FileCache::JournalEntry& entryToFill) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   if (!this->parent)
+      return false;
+
+   entryToFill.mutable_shared_dir_id()->set_hash(this->getRoot()->getId().getData(), Common::Hash::HASH_SIZE);
+   foreach (QString dirName, this->getPath().split('/', QString::SkipEmptyParts))
+      Common::ProtoHelper::addRepeatedStr(entryToFill, &Protos::FileCache::JournalEntry::add_dir, dirName);
+   Common::ProtoHelper::addRepeatedStr(entryToFill, &Protos::FileCache::JournalEntry::add_dir, this->getName());
+
+   return true;
+}
+
 void Directory::populateEntry(Protos::Common::Entry* dir, bool setSharedDir) const
 {
    QMutexLocker locker(&this->mutex);
@@ -245,6 +260,18 @@ bool Directory::isAChildOf(const Directory* dir) const
    return false;
 }
 
+DirSignature Directory::getSignature() const
+{
+   QMutexLocker locker(&this->mutex);
+   return this->signature;
+}
+
+void Directory::setSignature(const DirSignature& signature)
+{
+   QMutexLocker locker(&this->mutex);
+   this->signature = signature;
+}
+
 /**
   * @return Returns 0 if no one match.
   */
@@ -35,6 +35,22 @@ namespace FM
    class Cache;
    class SharedDirectory;
 
+   /**
+     * The state of a physical directory, it changes when an entry is added, removed or renamed in it.
+     * A null signature never matches another one.
+     */
+   struct DirSignature
+   {
+      DirSignature() : dateLastModified(0), nbLinks(0) {}
+
+      bool isNull() const { return this->dateLastModified == 0; }
+      bool operator==(const DirSignature& other) const { return !this->isNull() && this->dateLastModified == other.dateLastModified && this->nbLinks == other.nbLinks; }
+      bool operator!=(const DirSignature& other) const { return !(*this == other); }
+
+      qint64 dateLastModified; ///< [ms] since epoch.
+      quint32 nbLinks; ///< The number of sub-directories + 2 on most file systems, always 0 if not known.
+   };
+
    class Directory : public Entry
    {
       friend class DirIterator;
@@ -48,8 +64,14 @@ namespace FM
    public:
       virtual ~Directory();
 
+   protected:
+      void deleteContent();
+
+   public:
+
       QList<File*> restoreFromFileCache(const Protos::FileCache::Hashes::Dir& dir);
       void populateHashesDir(Protos::FileCache::Hashes::Dir& dirToFill) const;
+      bool populateJournalRemoval(Protos::FileCache::JournalEntry& entryToFill) const;
 
       virtual void populateEntry(Protos::Common::Entry* dir, bool setSharedDir = false) const;
 
@@ -68,6 +90,9 @@ namespace FM
       void changeName(const QString& newName);
       bool isAChildOf(const Directory* dir) const;
 
+      DirSignature getSignature() const;
+      void setSignature(const DirSignature& signature);
+
       Directory* getSubDir(const QString& name) const;
       QList<Directory*> getSubDirs() const;
       QList<File*> getFiles() const;
@@ -101,6 +126,8 @@ namespace FM
       QList<Directory*> subDirs; ///< Sorted by name.
       QList<File*> files; ///< Sorted by name.
 
+      DirSignature signature; ///< The state of the physical directory when its content was last read, see 'FileUpdater::scan(..)'.
+
       mutable QMutex mutex;
    };
 
@@ -28,7 +28,7 @@ using namespace FM;
 #include <priv/Cache/SharedDirectory.h>
 
 Entry::Entry(Cache* cache, const QString& name, qint64 size) :
-   cache(cache), name(name), size(size)
+   cache(cache), name(name), size(size), wordIndexId(0)
 {
    this->cache->onEntryAdded(this);
 }
@@ -85,3 +85,13 @@ qint64 Entry::getSize() const
 {
    return this->size;
 }
+
+quint32 Entry::getWordIndexId() const
+{
+   return this->wordIndexId;
+}
+
+void Entry::setWordIndexId(quint32 id)
+{
+   this->wordIndexId = id;
+}
@@ -66,11 +66,17 @@ namespace FM
 
       virtual qint64 getSize() const;
 
+      quint32 getWordIndexId() const;
+      void setWordIndexId(quint32 id);
+
    protected:
       Cache* cache;
 
       QString name;
       qint64 size;
+
+   private:
+      quint32 wordIndexId; ///< Given by the word index, 0 if the entry isn't indexed. See 'WordIndex'.
    };
 
    inline bool operator<(const Entry& e1, const Entry& e2)
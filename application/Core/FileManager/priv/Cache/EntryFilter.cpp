@@ -0,0 +1,80 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/Cache/EntryFilter.h>
+using namespace FM;
+
+#include <limits>
+
+#include <Common/ProtoHelper.h>
+
+#include <priv/Cache/Directory.h>
+
+/**
+  * @class FM::EntryFilter
+  *
+  * The entries matching a 'Protos::Common::FindFilter', given to the indexes to remove the entries during a search.
+  * The size is checked first because it's the cheapest criterion, the name is only read if some extensions are given.
+  */
+
+EntryFilter::EntryFilter(const Protos::Common::FindFilter& filter) :
+   onlyFiles(filter.has_type() && filter.type() == Protos::Common::Entry_Type_FILE),
+   onlyDirs(filter.has_type() && filter.type() == Protos::Common::Entry_Type_DIR),
+   minSize(filter.has_min_size() ? static_cast<qint64>(qMin(filter.min_size(), static_cast<quint64>(std::numeric_limits<qint64>::max()))) : 0),
+   maxSize(filter.has_max_size() ? static_cast<qint64>(qMin(filter.max_size(), static_cast<quint64>(std::numeric_limits<qint64>::max()))) : std::numeric_limits<qint64>::max())
+{
+   for (int i = 0; i < filter.extension_size(); i++)
+   {
+      const QString extension = Common::ProtoHelper::getRepeatedStr(filter, &Protos::Common::FindFilter::extension, i).trimmed();
+      if (!extension.isEmpty())
+         this->extensions << (extension.startsWith('.') ? extension : '.' + extension);
+   }
+}
+
+/**
+  * Return true if all the entries match.
+  */
+bool EntryFilter::isEmpty() const
+{
+   return !this->onlyFiles && !this->onlyDirs && this->extensions.isEmpty() && this->minSize == 0 && this->maxSize == std::numeric_limits<qint64>::max();
+}
+
+bool EntryFilter::match(const Entry* entry) const
+{
+   const qint64 size = entry->getSize();
+   if (size < this->minSize || size > this->maxSize)
+      return false;
+
+   if (!this->extensions.isEmpty() || this->onlyFiles || this->onlyDirs)
+   {
+      const bool isDir = dynamic_cast<const Directory*>(entry);
+      if (isDir ? this->onlyFiles : this->onlyDirs)
+         return false;
+
+      if (!isDir && !this->extensions.isEmpty())
+      {
+         const QString name = entry->getName();
+         for (QStringListIterator i(this->extensions); i.hasNext();)
+            if (name.endsWith(i.next(), Qt::CaseInsensitive))
+               return true;
+         return false;
+      }
+   }
+
+   return true;
+}
@@ -0,0 +1,48 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_ENTRYFILTER_H
+#define FILEMANAGER_ENTRYFILTER_H
+
+#include <QStringList>
+
+#include <Protos/common.pb.h>
+
+#include <priv/WordIndex/ItemFilter.h>
+#include <priv/Cache/Entry.h>
+
+namespace FM
+{
+   class EntryFilter : public ItemFilter<Entry>
+   {
+   public:
+      EntryFilter(const Protos::Common::FindFilter& filter);
+
+      bool isEmpty() const;
+      bool match(const Entry* entry) const;
+
+   private:
+      bool onlyFiles;
+      bool onlyDirs;
+      QStringList extensions; ///< With their dot, for example ".mkv".
+      qint64 minSize;
+      qint64 maxSize;
+   };
+}
+
+#endif
@@ -95,12 +95,16 @@ File::File(
    this->setHashes(hashes);
 
    this->dir->add(this);
+
+   this->cache->onFileCreated(this);
 }
 
 File::~File()
 {
    // QMutexLocker(&this->cache->getMutex()); // TODO: Is it necessary ?
 
+   this->cache->onEntryDeleting(this);
+
    this->dir->fileDeleted(this);
 
    foreach (QSharedPointer<Chunk> c, this->chunks)
@@ -189,6 +193,34 @@ void File::populateHashesFile(Protos::FileCache::Hashes_File& fileToFill) const
    }
 }
 
+/**
+  * Describe the file and its location to be appended to the file cache journal.
+  */
+void File::populateJournalEntry(Protos::FileCache::JournalEntry& entryToFill) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   entryToFill.mutable_shared_dir_id()->set_hash(this->getRoot()->getId().getData(), Common::Hash::HASH_SIZE);
+   foreach (QString dirName, this->getPath().split('/', QString::SkipEmptyParts))
+      Common::ProtoHelper::addRepeatedStr(entryToFill, &Protos::FileCache::JournalEntry::add_dir, dirName);
+
+   this->populateHashesFile(*entryToFill.mutable_file());
+}
+
+/**
+  * Describe the removal of this file, its current name and path are removed.
+  */
+void File::populateJournalRemoval(Protos::FileCache::JournalEntry& entryToFill) const
+{
+   QMutexLocker locker(&this->mutex);
+
+   entryToFill.mutable_shared_dir_id()->set_hash(this->getRoot()->getId().getData(), Common::Hash::HASH_SIZE);
+   foreach (QString dirName, this->getPath().split('/', QString::SkipEmptyParts))
+      Common::ProtoHelper::addRepeatedStr(entryToFill, &Protos::FileCache::JournalEntry::add_dir, dirName);
+
+   Common::ProtoHelper::setStr(entryToFill, &Protos::FileCache::JournalEntry::set_removed_file, this->getName());
+}
+
 /**
   * Will add the hashes to the entry.
   */
@@ -224,7 +256,12 @@ bool File::matchesEntry(const Protos::Common::Entry& entry) const
   */
 bool File::correspondTo(const QFileInfo& fileInfo, bool checkTheDateToo)
 {
-   return this->getSize() == fileInfo.size() && (!checkTheDateToo || this->getDateLastModified() == fileInfo.lastModified());
+   return this->correspondTo(fileInfo.size(), fileInfo.lastModified(), checkTheDateToo);
+}
+
+bool File::correspondTo(qint64 size, const QDateTime& dateLastModified, bool checkTheDateToo)
+{
+   return this->getSize() == size && (!checkTheDateToo || this->getDateLastModified() == dateLastModified);
 }
 
 QString File::getPath() const
@@ -63,11 +63,14 @@ namespace FM
 
       bool restoreFromFileCache(const Protos::FileCache::Hashes_File& file);
       void populateHashesFile(Protos::FileCache::Hashes_File& fileToFill) const;
+      void populateJournalEntry(Protos::FileCache::JournalEntry& entryToFill) const;
+      void populateJournalRemoval(Protos::FileCache::JournalEntry& entryToFill) const;
 
       void populateEntry(Protos::Common::Entry* entry, bool setSharedDir = false) const;
       bool matchesEntry(const Protos::Common::Entry& entry) const;
 
       bool correspondTo(const QFileInfo& fileInfo, bool checkTheDateToo = true);
+      bool correspondTo(qint64 size, const QDateTime& dateLastModified, bool checkTheDateToo = true);
 
       QString getPath() const;
       QString getFullPath() const;
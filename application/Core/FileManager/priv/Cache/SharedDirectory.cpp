@@ -96,6 +96,9 @@ void SharedDirectory::init()
 
 SharedDirectory::~SharedDirectory()
 {
+   // The content is deleted here to let the files reach their root during their deletion, see 'Cache::entryDeleting(..)'.
+   this->deleteContent();
+
    L_DEBU(QString("SharedDirectory deleted : %1").arg(this->path));
 }
 
@@ -24,7 +24,13 @@
 namespace FM
 {
    // 2 -> 3 : BLAKE -> Sha-1
-   const int FILE_CACHE_VERSION = 3;
+   // 3 -> 4 : All the files are persisted, not only the ones having at least one hash. A version 3 cache can still be read.
+   const int FILE_CACHE_VERSION = 4;
+   const int OLDEST_COMPATIBLE_FILE_CACHE_VERSION = 3;
+
+   const qint64 MIN_CACHE_JOURNAL_SIZE_TO_COMPACT = 1024 * 1024; ///< The file cache journal is never merged into the file cache below this size [byte].
+
+   const qint64 MIN_DIR_SIGNATURE_AGE = 2000; ///< A directory modified more recently than this may still change within the same date [ms], its signature isn't kept.
 }
 
 #endif
@@ -22,6 +22,8 @@ using namespace FM;
 #include <limits>
 
 #include <QSharedPointer>
+#include <QHash>
+#include <QByteArray>
 #include <QStringList>
 #include <QList>
 #include <QVector>
@@ -29,6 +31,7 @@ using namespace FM;
 #include <QMutableListIterator>
 
 #include <google/protobuf/text_format.h>
+#include <google/protobuf/io/coded_stream.h>
 
 #include <Protos/files_cache.pb.h>
 
@@ -45,25 +48,43 @@ using namespace FM;
 #include <priv/Cache/Directory.h>
 #include <priv/Cache/SharedDirectory.h>
 #include <priv/Cache/Chunk.h>
+#include <priv/Cache/EntryFilter.h>
 
 LOG_INIT_CPP(FileManager);
 
+/**
+  * The size taken by a message when it's put in a field of another message : the tag, the length and the message itself.
+  */
+static int embeddedMessageByteSize(const google::protobuf::Message& message)
+{
+   const int size = message.ByteSize();
+   return 1 + google::protobuf::io::CodedOutputStream::VarintSize32(size) + size;
+}
+
 FileManager::FileManager() :
    CHUNK_SIZE(SETTINGS.get<quint32>("chunk_size")),
    fileUpdater(this),
    cache(),
+   substringIndex(SETTINGS.get<quint32>("substring_index_max_memory")),
    mutexPersistCache(QMutex::Recursive),
    cacheLoading(true),
-   cacheChanged(false)
+   cacheRestored(false),
+   cacheChanged(false),
+   cacheJournalId(0),
+   cacheFileSize(0),
+   entryBeingPersisted(0)
 {
    connect(&this->cache, SIGNAL(entryAdded(Entry*)),     this, SLOT(entryAdded(Entry*)),     Qt::DirectConnection);
    connect(&this->cache, SIGNAL(entryRemoved(Entry*)),   this, SLOT(entryRemoved(Entry*)),   Qt::DirectConnection);
+   connect(&this->cache, SIGNAL(entryDeleting(Entry*)),  this, SLOT(entryDeleting(Entry*)),  Qt::DirectConnection);
+   connect(&this->cache, SIGNAL(fileCreated(File*)),     this, SLOT(fileCreated(File*)),     Qt::DirectConnection);
    connect(&this->cache, SIGNAL(chunkHashKnown(QSharedPointer<Chunk>)), this, SLOT(chunkHashKnown(QSharedPointer<Chunk>)), Qt::DirectConnection);
    connect(&this->cache, SIGNAL(chunkRemoved(QSharedPointer<Chunk>)),   this, SLOT(chunkRemoved(QSharedPointer<Chunk>)),   Qt::DirectConnection);
 
    connect(&this->cache, SIGNAL(newSharedDirectory(SharedDirectory*)),                 this, SLOT(newSharedDirectory(SharedDirectory*)),                 Qt::DirectConnection);
    connect(&this->cache, SIGNAL(sharedDirectoryRemoved(SharedDirectory*, Directory*)), this, SLOT(sharedDirectoryRemoved(SharedDirectory*, Directory*)), Qt::DirectConnection);
 
+   connect(&this->fileUpdater, SIGNAL(fileCacheLoaded()), this, SLOT(fileCacheRestored()),  Qt::DirectConnection);
    connect(&this->fileUpdater, SIGNAL(fileCacheLoaded()), this, SLOT(fileCacheLoadingComplete()),  Qt::QueuedConnection);
 
    this->timerPersistCache.setInterval(SETTINGS.get<quint32>("save_cache_period"));
@@ -78,8 +99,7 @@ FileManager::~FileManager()
 {
    L_DEBU("~FileManager : Stopping the file updater..");
    this->fileUpdater.stop();
-   this->cacheChanged = true;
-   this->forcePersistCacheToFile();
+   this->persistCacheToFile();
    this->timerPersistCache.stop();
    this->cache.disconnect(this);
    L_DEBU("FileManager deleted");
@@ -173,19 +193,32 @@ Protos::Common::Entries FileManager::getEntries()
 }
 
 /**
-  * @see http://dev.euphorik.ch/wiki/pmp/Algorithms#Word-indexing for more information.
-  * TODO: A large part of this function code should be owned by 'WordIndex'.
+  * The results are ranked by 'WordIndex::search(..)' and split in some 'FindResult' to not exceed 'maxSize' bytes each.
+  * If there is some room left the entries whose name contains all the terms are added after, with the worst level.
   */
-QList<Protos::Common::FindResult> FileManager::find(const QString& words, int maxNbResult, int maxSize)
+QList<Protos::Common::FindResult> FileManager::find(const QString& words, const Protos::Common::FindFilter& filter, int maxNbResult, int maxSize)
 {
-   QStringList terms = Common::Global::splitInWords(words);
-   const int n = terms.size();
+   const EntryFilter entryFilter(filter);
+   const ItemFilter<Entry>* itemFilter = entryFilter.isEmpty() ? 0 : &entryFilter;
 
-   // Launch a search for each term.
-   QVector<QSet< NodeResult<Entry> > > results(n);
-   for (int i = 0; i < n; i++)
-      // We can only limit the number of result for one term. When there is more than one term and thus some results set, say [a, b, c] for example, some good result may be contained in intersect, for example a & b or a & c.
-      results[i] += this->wordIndex.search(terms[i], n == 1 ? maxNbResult : -1).toSet();
+   const QStringList terms = Common::Global::splitInWords(words);
+   QList< NodeResult<Entry*> > results = this->wordIndex.search(terms, maxNbResult, itemFilter);
+
+   if (results.size() < maxNbResult && this->substringIndex.isEnabled())
+   {
+      QSet<Entry*> entriesFound;
+      for (QListIterator< NodeResult<Entry*> > i(results); i.hasNext();)
+         entriesFound.insert(i.next().value);
+
+      const int level = results.isEmpty() ? 0 : results.last().level + 1;
+      foreach (Entry* entry, this->substringIndex.search(terms, maxNbResult, itemFilter))
+         if (!entriesFound.contains(entry))
+         {
+            results << NodeResult<Entry*>(entry, level);
+            if (results.size() == maxNbResult)
+               break;
+         }
+   }
 
    QList<Protos::Common::FindResult> findResults;
    findResults << Protos::Common::FindResult();
@@ -194,105 +227,86 @@ QList<Protos::Common::FindResult> FileManager::find(const QString& words, int ma
    const int constantFindResultsSize = findResults.last().ByteSize();
    int findResultCurrentSize = constantFindResultsSize; // [Byte].
 
-   int numberOfResult = 0;
-   bool end = false;
-
-   int level = 0;
-   // For each group of intersection number.
-   // For example, [a, b, c] :
-   //  * a & b & c
-   //  * (a & b) \ c
-   //    (a & c) \ b
-   //    (b & c) \ a
-   //  * a \ b \ c
-   for (int i = 0; i < n && !end; i++)
+   // The paths and the shared directories are put once in each result and referenced by the entries, see 'Protos::Common::FindResult'.
+   QHash<QByteArray, int> pathIndexes;
+   QHash<const SharedDirectory*, int> sharedDirIndexes;
+   QByteArray previousPath; // The last path put in the current result.
+
+   // Populate the result.
+   for (QListIterator< NodeResult<Entry*> > i(results); i.hasNext();)
    {
-      const int nbIntersect = n - i; // Number of set intersected.
-      int intersect[nbIntersect]; // A array of the results wich will be intersected.
-      for (int j = 0; j < nbIntersect; j++)
-         intersect[j] = j;
-
-      // For each combination of the current intersection group.
-      // For 2 intersections (nbIntersect == 2) among 3 elements [a, b, c] :
-      //  * (a, b)
-      //  * (a, c)
-      //  * (b, c)
-      QList< NodeResult<Entry> > nodesToSort;
-      const int nCombinations = Common::Global::nCombinations(n, nbIntersect);
-      for (int j = 0; j < nCombinations && !end; j++)
+      const NodeResult<Entry*>& entry = i.next();
+      const SharedDirectory* root = entry.value->getRoot();
+
+      Protos::Common::FindResult_EntryLevel entryLevel;
+      entryLevel.set_level(entry.level);
+      entry.value->populateEntry(entryLevel.mutable_entry());
+      const QByteArray path(entryLevel.entry().path().data(), entryLevel.entry().path().size());
+      entryLevel.mutable_entry()->mutable_path()->clear(); // The field is required, it stays defined.
+
+      forever
       {
-         QSet< NodeResult<Entry> > currentLevelSet;
+         Protos::Common::FindResult& findResult = findResults.last();
 
-         // Apply intersects.
-         currentLevelSet = results[intersect[0]];
+         // We wouldn't use 'findResult.ByteSize()' because is too slow. Instead we sum the size of the entry and of its path and shared directory if they are new.
+         int entryByteSize = 0;
 
-         for (QSetIterator< NodeResult<Entry> > k(currentLevelSet); k.hasNext();)
+         Protos::Common::FindResult_Path newPath;
+         const bool isNewPath = !pathIndexes.contains(path);
+         if (isNewPath)
          {
-            NodeResult<Entry>& node = const_cast<NodeResult<Entry>&>(k.next());
-            node.level = node.level ? nCombinations : 0;
+            int commonPrefix = 0;
+            while (commonPrefix < path.size() && commonPrefix < previousPath.size() && path[commonPrefix] == previousPath[commonPrefix])
+               commonPrefix++;
+            if (commonPrefix > 0)
+               newPath.set_common_prefix(commonPrefix);
+            newPath.set_suffix(path.constData() + commonPrefix, path.size() - commonPrefix);
+            entryByteSize += embeddedMessageByteSize(newPath);
+            entryLevel.set_path_index(findResult.path_size());
          }
+         else
+            entryLevel.set_path_index(pathIndexes.value(path));
 
-         for (int k = 1; k < nbIntersect; k++)
-            NodeResult<Entry>::intersect(currentLevelSet, results[intersect[k]], nCombinations);
-
-         // Apply substracts.
-         for (int k = -1; k < nbIntersect; k++)
-            for (int l = (k == -1 ? 0 : intersect[k] + 1); l < (k == nbIntersect - 1 ? n : intersect[k+1]); l++)
-               currentLevelSet -= results[l];
-
-         for (QSetIterator< NodeResult<Entry> > k(currentLevelSet); k.hasNext();)
-            const_cast<NodeResult<Entry>&>(k.next()).level += level;
-
-         // Sort by level.
-         nodesToSort << currentLevelSet.toList();
-
-         // Define positions of each intersect term.
-         for (int k = nbIntersect - 1; k >= 0; k--)
-            if  (intersect[k] < n - nbIntersect + k)
-            {
-               intersect[k] += 1;
-               for (int l = k + 1; l < nbIntersect; l++)
-                  intersect[l] = intersect[k] + (l - k);
-               break;
-            }
-
-         level += 1;
-      }
-
-      qSort(nodesToSort); // Sort by level
-
-      // Populate the result.
-      for (QListIterator< NodeResult<Entry> > k(nodesToSort); k.hasNext();)
-      {
-         NodeResult<Entry> entry = k.next();
-         Protos::Common::FindResult_EntryLevel* entryLevel = findResults.last().add_entry();
-         entryLevel->set_level(entry.level);
-         entry.value->populateEntry(entryLevel->mutable_entry(), true);
+         Protos::Common::Entry newSharedDir;
+         const bool isNewSharedDir = root && !sharedDirIndexes.contains(root);
+         if (isNewSharedDir)
+         {
+            entry.value->populateEntrySharedDir(&newSharedDir);
+            entryByteSize += embeddedMessageByteSize(newSharedDir.shared_dir());
+            entryLevel.set_shared_dir_index(findResult.shared_dir_size());
+         }
+         else if (root)
+            entryLevel.set_shared_dir_index(sharedDirIndexes.value(root));
 
-         // We wouldn't use 'findResults.last().ByteSize()' because is too slow. Instead we call 'ByteSize()' for each entry and sum it.
-         const int entryByteSize = entryLevel->ByteSize() + 8; // Each entry take a bit of memory... (Value found with an empiric way..).
-         findResultCurrentSize += entryByteSize;
+         entryByteSize += embeddedMessageByteSize(entryLevel);
 
-         if (findResultCurrentSize > maxSize)
+         if (findResultCurrentSize + entryByteSize > maxSize && findResult.entry_size() > 0)
          {
-            google::protobuf::RepeatedPtrField<Protos::Common::FindResult_EntryLevel>* entries = findResults.last().mutable_entry();
             findResults << Protos::Common::FindResult();
-            if (entries->size() > 0)
-            {
-               findResults.last().add_entry()->CopyFrom(entries->Get(entries->size()-1));
-               entries->RemoveLast();
-            }
-            findResultCurrentSize = constantFindResultsSize + entryByteSize;
+            findResultCurrentSize = constantFindResultsSize;
+            pathIndexes.clear();
+            sharedDirIndexes.clear();
+            previousPath.clear();
+            continue;
          }
 
-         if (++numberOfResult >= maxNbResult)
+         if (isNewPath)
          {
-            end = true;
-            break;
+            pathIndexes.insert(path, findResult.path_size());
+            findResult.add_path()->Swap(&newPath);
+            previousPath = path;
+         }
+
+         if (isNewSharedDir)
+         {
+            sharedDirIndexes.insert(root, findResult.shared_dir_size());
+            findResult.add_shared_dir()->Swap(newSharedDir.mutable_shared_dir());
          }
-      }
 
-      level += nCombinations * nbIntersect;
+         findResult.add_entry()->Swap(&entryLevel);
+         findResultCurrentSize += entryByteSize;
+         break;
+      }
    }
 
    if (findResults.last().entry_size() == 0)
@@ -300,6 +314,11 @@ QList<Protos::Common::FindResult> FileManager::find(const QString& words, int ma
    return findResults;
 }
 
+int FileManager::getIndexGeneration() const
+{
+   return this->indexGeneration;
+}
+
 QBitArray FileManager::haveChunks(const QList<Common::Hash>& hashes)
 {
    QBitArray result(hashes.size()); // All bits to 0 by default.
@@ -368,30 +387,82 @@ void FileManager::sharedDirectoryRemoved(SharedDirectory* sharedDir, Directory*
 
 void FileManager::entryAdded(Entry* entry)
 {
+   // The entries are not yet fully constructed when they are created, the casts only succeed when an existing entry is renamed or completed.
+   if (File* file = dynamic_cast<File*>(entry))
+      this->setFileChanged(file);
+   else if (Directory* dir = dynamic_cast<Directory*>(entry))
+   {
+      // The path of all the files contained in a renamed directory has changed.
+      QList<File*> files = dir->getFiles();
+      DirIterator i(dir);
+      while (Directory* subDir = i.next())
+         files << subDir->getFiles();
+      foreach (File* file, files)
+         this->setFileChanged(file);
+   }
+
    if (entry->getName().isEmpty() || Global::isFileUnfinished(entry->getName()))
       return;
 
    L_DEBU(QString("Adding entry '%1' to the index ..").arg(entry->getName()));
-   this->wordIndex.addItem(Common::Global::splitInWords(entry->getName()), entry);
+   QMutexLocker locker(&this->mutexIndexWords);
+   Common::Global::splitInWords(entry->getName(), this->indexWordsBuffer, this->indexWords);
+   this->wordIndex.addItem(this->indexWords, entry);
+   if (this->substringIndex.isEnabled())
+   {
+      this->substringIndex.addItem(this->indexWords, entry);
+      if (!this->substringIndex.isEnabled())
+         L_WARN(QString("The substring index exceeds %1, it's disabled. See the setting 'substring_index_max_memory'").arg(Common::Global::formatByteSize(SETTINGS.get<quint32>("substring_index_max_memory"))));
+   }
+   locker.unlock();
+   this->indexGeneration.fetchAndAddOrdered(1);
    L_DEBU("Entry added to the index ..");
 }
 
 void FileManager::entryRemoved(Entry* entry)
 {
+   this->setEntryRemoved(entry);
+
    if (entry->getName().isEmpty())
       return;
 
    L_DEBU(QString("Removing entry '%1' from the index..").arg(entry->getName()));
-   this->wordIndex.rmItem(Common::Global::splitInWords(entry->getName()), entry);
+   QMutexLocker locker(&this->mutexIndexWords);
+   Common::Global::splitInWords(entry->getName(), this->indexWordsBuffer, this->indexWords);
+   this->wordIndex.rmItem(this->indexWords, entry);
+   locker.unlock();
+   this->substringIndex.rmItem(entry);
+   this->indexGeneration.fetchAndAddOrdered(1);
    L_DEBU("Entry removed from the index..");
 }
 
+/**
+  * A file can't be deleted while 'persistCacheToFile()' is reading it.
+  */
+void FileManager::entryDeleting(Entry* entry)
+{
+   this->setEntryRemoved(entry);
+
+   QMutexLocker locker(&this->mutexCacheChanged);
+   while (this->entryBeingPersisted == entry)
+      this->entryPersisted.wait(&this->mutexCacheChanged);
+}
+
+/**
+  * A new file is journaled even if it has no hash yet, an empty file won't have any.
+  */
+void FileManager::fileCreated(File* file)
+{
+   this->setFileChanged(file);
+}
+
 void FileManager::chunkHashKnown(QSharedPointer<Chunk> chunk)
 {
    L_DEBU(QString("Adding chunk '%1' to the index..").arg(chunk->getHash().toStr()));
    this->chunks.add(chunk);
    L_DEBU("Chunk added to the index..");
-   this->setCacheChanged();
+   if (File* file = chunk->getFile())
+      this->setFileChanged(file);
 }
 
 void FileManager::chunkRemoved(QSharedPointer<Chunk> chunk)
@@ -399,24 +470,28 @@ void FileManager::chunkRemoved(QSharedPointer<Chunk> chunk)
    L_DEBU(QString("Removing chunk '%1' from the index ..").arg(chunk->getHash().toStr()));
    this->chunks.rm(chunk);
    L_DEBU("Chunk removed from the index..");
-   this->setCacheChanged();
+   if (File* file = chunk->getFile())
+      this->setFileChanged(file);
 }
 
 /**
   * Load the cache from a file. Called at start, by the constructor.
   * It will give the file cache to the fileUpdater and ask it
   * to load the cache.
-  * It will also start the timer to persist the cache.
+  * The changes appended to the journal since the cache has been persisted are merged into it.
   */
 void FileManager::loadCacheFromFile()
 {
    // This hashes will be unallocated by the fileUpdater.
    Protos::FileCache::Hashes* savedCache = new Protos::FileCache::Hashes();
 
+   // If there is no usable journal the whole cache will be persisted the first time.
+   this->cacheChanged = true;
+
    try
    {
       Common::PersistentData::getValue(Common::Constants::FILE_CACHE, *savedCache, Common::Global::LOCAL);
-      if (static_cast<int>(savedCache->version()) != FILE_CACHE_VERSION)
+      if (static_cast<int>(savedCache->version()) < OLDEST_COMPATIBLE_FILE_CACHE_VERSION || static_cast<int>(savedCache->version()) > FILE_CACHE_VERSION)
       {
          L_ERRO(QString("The version (%1) of the file cache \"%2\" doesn't match the current version (%3)").arg(savedCache->version()).arg(Common::Constants::FILE_CACHE).arg(FILE_CACHE_VERSION));
          Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL);
@@ -424,7 +499,25 @@ void FileManager::loadCacheFromFile()
          return;
       }
 
-      // Scan the shared directories and try to match the files against the saved cache.
+      this->cacheFileSize = savedCache->ByteSize();
+
+      if (savedCache->has_journal_id())
+      {
+         this->cacheJournalId = savedCache->journal_id();
+         CacheJournal::applyTo(*savedCache);
+
+         try
+         {
+            this->cacheJournal.open(this->cacheJournalId);
+            this->cacheChanged = false;
+         }
+         catch (Common::PersistentDataIOException& err)
+         {
+            L_ERRO(err.message);
+         }
+      }
+
+      // Create the shared directories, their content will be restored from the saved cache by the file updater.
       try
       {
          this->cache.createSharedDirs(*savedCache);
@@ -448,37 +541,71 @@ void FileManager::loadCacheFromFile()
 }
 
 /**
-  * Save the cache to a file.
-  * Called by the fileUpdater when it needs to persist the cache.
+  * Append the files changed since the last call to the journal. Thus, the cost depends only of the amount of changes.
+  * The whole cache is persisted when it's needed or when the journal becomes too big compared to it.
+  * Called periodically by 'timerPersistCache'.
   */
 void FileManager::persistCacheToFile()
 {
    QMutexLocker locker(&this->mutexPersistCache);
 
+   if (this->cacheLoading)
+      return;
+
    QMutexLocker lockerCacheChanged(&this->mutexCacheChanged);
-   if (this->cacheChanged && !this->cacheLoading)
+   if (this->cacheChanged)
    {
       lockerCacheChanged.unlock();
+      this->compactCacheFile();
+      return;
+   }
 
-      L_DEBU("Persisting cache..");
+   if (this->changedEntries.isEmpty() && this->removedEntries.isEmpty())
+      return;
 
-      Protos::FileCache::Hashes hashes;
-      this->cache.populateHashes(hashes);
+   L_DEBU(QString("Persisting %1 changed entries and %2 removed entries to the cache journal..").arg(this->changedEntries.size()).arg(this->removedEntries.size()));
 
-      try
-      {
-         Common::PersistentData::setValue(Common::Constants::FILE_CACHE, hashes, Common::Global::LOCAL);
-      }
-      catch (Common::PersistentDataIOException& err)
-      {
-         L_ERRO(err.message);
-      }
+   // The removals come first : a changed entry is still alive, its state replaces any removed entry with the same path.
+   QList<Protos::FileCache::JournalEntry> journalEntries = this->removedEntries;
+   this->removedEntries.clear();
+
+   // The files are read one by one without holding 'mutexCacheChanged' (see its description), a file being read can't be deleted, see 'entryDeleting(..)'.
+   while (!this->changedEntries.isEmpty())
+   {
+      Entry* entry = *this->changedEntries.begin();
+      this->changedEntries.erase(this->changedEntries.begin());
+
+      File* file = dynamic_cast<File*>(entry);
+      if (!file)
+         continue;
+
+      this->entryBeingPersisted = file;
+      lockerCacheChanged.unlock();
+
+      journalEntries << Protos::FileCache::JournalEntry();
+      file->populateJournalEntry(journalEntries.last());
 
       lockerCacheChanged.relock();
-      this->cacheChanged = false;
+      this->entryBeingPersisted = 0;
+      this->entryPersisted.wakeAll();
+   }
+   lockerCacheChanged.unlock();
 
-      L_DEBU("Persisting cache finished");
+   try
+   {
+      this->cacheJournal.append(journalEntries);
+   }
+   catch (Common::PersistentDataIOException& err)
+   {
+      L_ERRO(err.message);
+      this->compactCacheFile();
+      return;
    }
+
+   if (this->cacheJournal.size() > qMax(MIN_CACHE_JOURNAL_SIZE_TO_COMPACT, static_cast<qint64>(SETTINGS.get<double>("cache_journal_compaction_factor") * this->cacheFileSize)))
+      this->compactCacheFile();
+
+   L_DEBU("Persisting cache journal finished");
 }
 
 void FileManager::forcePersistCacheToFile()
@@ -492,13 +619,82 @@ void FileManager::forcePersistCacheToFile()
    this->timerPersistCache.start();
 }
 
+/**
+  * Persist the whole cache and reset the journal.
+  */
+void FileManager::compactCacheFile()
+{
+   QMutexLocker locker(&this->mutexPersistCache);
+
+   L_DEBU("Persisting cache..");
+
+   this->mutexCacheChanged.lock();
+   this->cacheChanged = false;
+   this->changedEntries.clear(); // They will be persisted with the whole cache.
+   this->removedEntries.clear();
+   this->mutexCacheChanged.unlock();
+
+   Protos::FileCache::Hashes hashes;
+   this->cache.populateHashes(hashes);
+   hashes.set_journal_id(++this->cacheJournalId);
+
+   try
+   {
+      Common::PersistentData::setValue(Common::Constants::FILE_CACHE, hashes, Common::Global::LOCAL);
+      this->cacheFileSize = hashes.ByteSize();
+      this->cacheJournal.reset(this->cacheJournalId);
+   }
+   catch (Common::PersistentDataIOException& err)
+   {
+      L_ERRO(err.message);
+      QMutexLocker lockerCacheChanged(&this->mutexCacheChanged);
+      this->cacheChanged = true;
+   }
+
+   L_DEBU("Persisting cache finished");
+}
+
 /**
   * @warning Can be called from differents thread like a 'Downloader' or the 'FileUpdater'.
   */
-void FileManager::setCacheChanged()
+void FileManager::setFileChanged(Entry* entry)
 {
    QMutexLocker locker(&this->mutexCacheChanged);
-   this->cacheChanged = true;
+   if (this->cacheRestored)
+      this->changedEntries.insert(entry);
+}
+
+/**
+  * Record the removal of a file or a directory, called before its renaming or its deletion.
+  * During the destruction of an entry (see 'Entry::~Entry()') the casts fail, it has already been recorded by 'entryDeleting(..)'.
+  * @warning Can be called from differents thread like a 'Downloader' or the 'FileUpdater'.
+  */
+void FileManager::setEntryRemoved(Entry* entry)
+{
+   // The entry is read without holding 'mutexCacheChanged', see its description.
+   Protos::FileCache::JournalEntry journalEntry;
+   bool removalDescribed = false;
+   if (File* file = dynamic_cast<File*>(entry))
+   {
+      file->populateJournalRemoval(journalEntry);
+      removalDescribed = true;
+   }
+   else if (Directory* dir = dynamic_cast<Directory*>(entry))
+      removalDescribed = dir->populateJournalRemoval(journalEntry);
+
+   QMutexLocker locker(&this->mutexCacheChanged);
+   this->changedEntries.remove(entry);
+   if (removalDescribed && this->cacheRestored)
+      this->removedEntries << journalEntry;
+}
+
+/**
+  * Called from the 'FileUpdater' thread once the cache is restored, the changes made before are already in the persisted cache.
+  */
+void FileManager::fileCacheRestored()
+{
+   QMutexLocker locker(&this->mutexCacheChanged);
+   this->cacheRestored = true;
 }
 
 void FileManager::fileCacheLoadingComplete()
@@ -22,9 +22,14 @@
 #include <QObject>
 #include <QSharedPointer>
 #include <QList>
+#include <QVector>
+#include <QString>
 #include <QBitArray>
 #include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 #include <QTimer>
+#include <QSet>
 
 #include <Protos/common.pb.h>
 #include <Protos/core_protocol.pb.h>
@@ -35,8 +40,10 @@
 #include <priv/Log.h>
 #include <priv/FileUpdater/FileUpdater.h>
 #include <priv/Cache/Cache.h>
+#include <priv/Cache/CacheJournal.h>
 #include <priv/ChunkIndex/Chunks.h>
 #include <priv/WordIndex/WordIndex.h>
+#include <priv/WordIndex/SubstringIndex.h>
 
 namespace FM
 {
@@ -66,7 +73,8 @@ namespace FM
       Protos::Common::Entries getEntries(const Protos::Common::Entry& dir);
       Protos::Common::Entries getEntries();
 
-      QList<Protos::Common::FindResult> find(const QString& words, int maxNbResult, int maxSize);
+      QList<Protos::Common::FindResult> find(const QString& words, const Protos::Common::FindFilter& filter, int maxNbResult, int maxSize);
+      int getIndexGeneration() const;
       QBitArray haveChunks(const QList<Common::Hash>& hashes);
       quint64 getAmount();
       CacheStatus getCacheStatus() const;
@@ -80,16 +88,21 @@ namespace FM
       void sharedDirectoryRemoved(SharedDirectory*, Directory*);
       void entryAdded(Entry* entry);
       void entryRemoved(Entry* entry);
+      void entryDeleting(Entry* entry);
+      void fileCreated(File* file);
       void chunkHashKnown(QSharedPointer<Chunk> chunk);
       void chunkRemoved(QSharedPointer<Chunk> chunk);
 
    private:
       void loadCacheFromFile();
+      void compactCacheFile();
+      void setFileChanged(Entry* entry);
+      void setEntryRemoved(Entry* entry);
 
    private slots:
       void persistCacheToFile();
       void forcePersistCacheToFile();
-      void setCacheChanged();
+      void fileCacheRestored();
       void fileCacheLoadingComplete();
 
    private:
@@ -101,12 +114,28 @@ namespace FM
       Cache cache; ///< The files and directories.
       Chunks chunks; ///< The indexed chunks. It contains only completed chunks.
       WordIndex<Entry> wordIndex; ///< The word index.
+      SubstringIndex<Entry> substringIndex; ///< To find the names containing the terms of a search, see 'find(..)'.
+      QAtomicInt indexGeneration; ///< Incremented after each modification of the indexes.
+
+      // The words of the names added to or removed from the indexes, reused to not allocate each word. See 'entryAdded(..)' and 'entryRemoved(..)'.
+      QMutex mutexIndexWords; ///< The entries can be added or removed by different threads, the writers of the indexes are serialized anyway.
+      QString indexWordsBuffer;
+      QVector<QStringRef> indexWords;
 
       QTimer timerPersistCache;
       QMutex mutexPersistCache;
       QMutex mutexCacheChanged; ///< We use a second mutex (instead of using 'mutexPersistCache') to avoid deadlock created by "File -> chunkHashKnown()" and "persistCacheToFile() -> File".
       bool cacheLoading; ///< Set to 'true' during cache loading. It avoids to persist the cache during loading.
-      bool cacheChanged;
+      bool cacheRestored; ///< Set to 'true' when the file updater has restored the cache, the changes made before are already in the persisted cache.
+      bool cacheChanged; ///< The whole cache must be persisted, for example when a shared directory is added or removed.
+
+      CacheJournal cacheJournal;
+      quint64 cacheJournalId; ///< Identify the current persisted cache and its journal.
+      qint64 cacheFileSize; ///< The size of the persisted cache when the journal has been reset [byte].
+      QSet<Entry*> changedEntries; ///< The files changed since the last time the journal has been written.
+      QList<Protos::FileCache::JournalEntry> removedEntries; ///< The files and directories removed or renamed since the last time the journal has been written.
+      Entry* entryBeingPersisted; ///< The file read by 'persistCacheToFile()' without holding 'mutexCacheChanged', it can't be deleted meanwhile.
+      QWaitCondition entryPersisted;
    };
 }
 #endif
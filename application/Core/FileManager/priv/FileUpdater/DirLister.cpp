@@ -0,0 +1,274 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FileUpdater/DirLister.h>
+using namespace FM;
+
+#include <QtCore/QtCore> // For the Q_OS_* defines.
+#include <QThread>
+#include <QFile>
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+   #include <sys/types.h>
+   #include <sys/stat.h>
+   #include <fcntl.h>
+   #include <dirent.h>
+   #include <unistd.h>
+#endif
+
+#include <priv/Log.h>
+#include <priv/Constants.h>
+
+/**
+  * Same order as the one given by 'QDir::entryInfoList(..)'.
+  */
+bool fileSystemEntryLessThan(const FileSystemEntry& e1, const FileSystemEntry& e2)
+{
+   return e1.name.compare(e2.name, Qt::CaseInsensitive) < 0;
+}
+
+class DirLister::Worker : public QThread
+{
+public:
+   Worker(DirLister* lister) : lister(lister) { this->start(); }
+
+protected:
+   void run() { this->lister->work(); }
+
+private:
+   DirLister* lister;
+};
+
+/**
+  * @class FM::DirLister
+  *
+  * Read the content of some directories concurrently with a pool of threads.
+  * On a network share or a spinning disk the latency of each 'stat' dominates, reading several directories at the same time hides it.
+  * The listings are given back one by one to a single thread (see 'next(..)') which owns the modification of the cache.
+  * If the signature of a directory is known its content is read only if the signature has changed.
+  * A file modified in place changes neither the modification date of its directory nor its number of links, thus it isn't detected in this case.
+  */
+
+DirLister::DirLister(int nbThreads) :
+   nbDirsBeingListed(0), generation(0), toStop(false)
+{
+   for (int i = 0; i < qMax(1, nbThreads); i++)
+      this->workers << new Worker(this);
+}
+
+DirLister::~DirLister()
+{
+   this->mutex.lock();
+   this->toStop = true;
+   this->dirToListAdded.wakeAll();
+   this->mutex.unlock();
+
+   foreach (Worker* worker, this->workers)
+   {
+      worker->wait();
+      delete worker;
+   }
+}
+
+/**
+  * Ask to read the content of the given directory, the result will be returned later by 'next(..)'.
+  * @param knownSignature If the directory still has this signature its content isn't read, see 'Listing::unchanged'.
+  */
+void DirLister::list(Directory* dir, const DirSignature& knownSignature)
+{
+   DirToList dirToList;
+   dirToList.dir = dir;
+   dirToList.path = dir->getFullPath();
+   dirToList.knownSignature = knownSignature;
+
+   QMutexLocker locker(&this->mutex);
+   this->dirsToList.enqueue(dirToList);
+   this->dirToListAdded.wakeOne();
+}
+
+/**
+  * Wait for the content of a directory previously given to 'list(..)'.
+  * The order of the listings is not the order of the calls to 'list(..)'.
+  * @return false if there is no more directory to list.
+  */
+bool DirLister::next(Listing& listing)
+{
+   QMutexLocker locker(&this->mutex);
+
+   while (this->listings.isEmpty())
+   {
+      if (this->dirsToList.isEmpty() && this->nbDirsBeingListed == 0)
+         return false;
+      this->listingDone.wait(&this->mutex);
+   }
+
+   listing = this->listings.dequeue();
+   return true;
+}
+
+/**
+  * Forget all the directories to list and the listings not yet taken, used when a scanning is aborted.
+  */
+void DirLister::clear()
+{
+   QMutexLocker locker(&this->mutex);
+   this->dirsToList.clear();
+   this->listings.clear();
+   this->generation++;
+}
+
+/**
+  * A null signature is returned if the directory doesn't exist or if it has been modified too recently,
+  * see 'MIN_DIR_SIGNATURE_AGE'.
+  */
+DirSignature DirLister::readSignature(const QString& path)
+{
+   DirSignature signature;
+
+#ifdef Q_OS_LINUX
+   struct stat dirStat;
+   if (::stat(QFile::encodeName(path).constData(), &dirStat) == -1 || !S_ISDIR(dirStat.st_mode))
+      return signature;
+
+   signature.dateLastModified = static_cast<qint64>(dirStat.st_mtim.tv_sec) * 1000 + dirStat.st_mtim.tv_nsec / 1000000;
+   signature.nbLinks = dirStat.st_nlink;
+#else
+   QFileInfo dirInfo(path);
+   if (!dirInfo.isDir())
+      return signature;
+
+   signature.dateLastModified = dirInfo.lastModified().toMSecsSinceEpoch();
+#endif
+
+   if (QDateTime::currentMSecsSinceEpoch() - signature.dateLastModified < MIN_DIR_SIGNATURE_AGE)
+      return DirSignature();
+
+   return signature;
+}
+
+/**
+  * Read the directories and the files contained in the given directory. The hidden entries and the symlinks are ignored.
+  * The entries are sorted by name (case insensitive).
+  */
+QList<FileSystemEntry> DirLister::readDir(const QString& path)
+{
+   QList<FileSystemEntry> entries;
+
+#ifdef Q_OS_LINUX
+   // The entries are read with 'readdir' ('getdents64') and stated relatively to the directory descriptor ('fstatat'),
+   // thus the path isn't resolved again for each entry. The type of the directories is known without any 'stat'.
+   const int dirFd = ::open(QFile::encodeName(path).constData(), O_RDONLY | O_DIRECTORY);
+   if (dirFd == -1)
+   {
+      L_DEBU(QString("DirLister::readDir(..) : unable to open the directory : %1").arg(path));
+      return entries;
+   }
+
+   DIR* dir = ::fdopendir(dirFd);
+   if (!dir)
+   {
+      ::close(dirFd);
+      return entries;
+   }
+
+   while (struct dirent* dirEntry = ::readdir(dir))
+   {
+      if (dirEntry->d_name[0] == '.' || dirEntry->d_type == DT_LNK) // '.', '..', the hidden entries and the symlinks.
+         continue;
+
+      FileSystemEntry entry;
+      entry.name = QFile::decodeName(dirEntry->d_name);
+
+      if (dirEntry->d_type == DT_DIR)
+      {
+         entry.isDir = true;
+         entries << entry;
+         continue;
+      }
+
+      struct stat entryStat;
+      if (::fstatat(dirFd, dirEntry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == -1)
+         continue;
+
+      if (S_ISDIR(entryStat.st_mode))
+         entry.isDir = true;
+      else if (S_ISREG(entryStat.st_mode))
+      {
+         entry.size = entryStat.st_size;
+         entry.dateLastModified = QDateTime::fromTime_t(entryStat.st_mtime); // Same precision as 'QFileInfo::lastModified()'.
+      }
+      else
+         continue;
+
+      entries << entry;
+   }
+
+   ::closedir(dir); // Close 'dirFd' too.
+
+   qSort(entries.begin(), entries.end(), fileSystemEntryLessThan);
+#else
+   foreach (QFileInfo fileInfo, QDir(path).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks)) // TODO: Add an option to follow or not symlinks.
+   {
+      FileSystemEntry entry;
+      entry.name = fileInfo.fileName();
+      entry.isDir = fileInfo.isDir();
+      if (!entry.isDir)
+      {
+         entry.size = fileInfo.size();
+         entry.dateLastModified = fileInfo.lastModified();
+      }
+      entries << entry;
+   }
+#endif
+
+   return entries;
+}
+
+void DirLister::work()
+{
+   QMutexLocker locker(&this->mutex);
+
+   forever
+   {
+      while (this->dirsToList.isEmpty() && !this->toStop)
+         this->dirToListAdded.wait(&this->mutex);
+
+      if (this->toStop)
+         return;
+
+      const DirToList dirToList = this->dirsToList.dequeue();
+      const quint32 currentGeneration = this->generation;
+      this->nbDirsBeingListed++;
+      locker.unlock();
+
+      Listing listing;
+      listing.dir = dirToList.dir;
+      listing.signature = readSignature(dirToList.path); // Read before the content, thus a modification made during the reading will change the next signature.
+      listing.unchanged = listing.signature == dirToList.knownSignature;
+      if (!listing.unchanged)
+         listing.entries = readDir(dirToList.path);
+
+      locker.relock();
+      this->nbDirsBeingListed--;
+      if (currentGeneration == this->generation)
+         this->listings.enqueue(listing);
+      this->listingDone.wakeAll();
+   }
+}
@@ -0,0 +1,97 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_DIRLISTER_H
+#define FILEMANAGER_DIRLISTER_H
+
+#include <QString>
+#include <QList>
+#include <QQueue>
+#include <QDateTime>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <Common/Uncopyable.h>
+
+#include <priv/Cache/Directory.h>
+
+namespace FM
+{
+   /**
+     * A directory or a file read from the file system by 'DirLister'.
+     */
+   struct FileSystemEntry
+   {
+      FileSystemEntry() : isDir(false), size(0) {}
+
+      QString name;
+      bool isDir;
+      qint64 size;
+      QDateTime dateLastModified;
+   };
+
+   class DirLister : Common::Uncopyable
+   {
+      class Worker;
+
+   public:
+      struct Listing
+      {
+         Listing() : dir(0), unchanged(false) {}
+
+         Directory* dir;
+         DirSignature signature;
+         bool unchanged; ///< The directory has the known signature given to 'list(..)', its content isn't read.
+         QList<FileSystemEntry> entries;
+      };
+
+      DirLister(int nbThreads);
+      ~DirLister();
+
+      void list(Directory* dir, const DirSignature& knownSignature = DirSignature());
+      bool next(Listing& listing);
+      void clear();
+
+      static DirSignature readSignature(const QString& path);
+      static QList<FileSystemEntry> readDir(const QString& path);
+
+   private:
+      struct DirToList
+      {
+         Directory* dir;
+         QString path;
+         DirSignature knownSignature;
+      };
+
+      void work();
+
+      QList<Worker*> workers;
+
+      QQueue<DirToList> dirsToList;
+      QQueue<Listing> listings;
+      int nbDirsBeingListed;
+      quint32 generation; ///< Incremented by 'clear()' to discard the directories being listed.
+      bool toStop;
+
+      QMutex mutex;
+      QWaitCondition dirToListAdded;
+      QWaitCondition listingDone;
+   };
+}
+
+#endif
@@ -20,6 +20,9 @@
 using namespace FM;
 
 #include <QtCore/QtDebug>
+#include <QVector>
+#include <QHash>
+#include <QSet>
 
 #include <priv/Log.h>
 
@@ -41,6 +44,71 @@ DirWatcher* DirWatcher::getNewWatcher()
 #endif
 }
 
+/**
+  * Remove the redundant events of a burst before they are treated :
+  *  - A NEW or CONTENT_CHANGED event on a path already new or changed.
+  *  - A NEW or CONTENT_CHANGED event followed by a DELETED event on the same path.
+  *  - A RESCAN event already present.
+  * A MOVE event is never removed and the previous events aren't coalesced with the following ones.
+  * The order of the remaining events is kept.
+  */
+QList<WatcherEvent> DirWatcher::coalesce(const QList<WatcherEvent>& events)
+{
+   QVector<bool> kept(events.size(), true);
+   QHash<QString, int> changedPaths; // Path -> index of its NEW or CONTENT_CHANGED event.
+   QSet<QString> rescanPaths;
+
+   for (int i = 0; i < events.size(); i++)
+   {
+      const WatcherEvent& event = events[i];
+      switch (event.type)
+      {
+      case WatcherEvent::NEW:
+      case WatcherEvent::CONTENT_CHANGED:
+         if (changedPaths.contains(event.path1))
+            kept[i] = false;
+         else
+            changedPaths.insert(event.path1, i);
+         break;
+
+      case WatcherEvent::DELETED:
+         {
+            const int j = changedPaths.value(event.path1, -1);
+            if (j != -1)
+            {
+               kept[j] = false;
+               changedPaths.remove(event.path1);
+            }
+         }
+         break;
+
+      case WatcherEvent::MOVE:
+         changedPaths.clear();
+         break;
+
+      case WatcherEvent::RESCAN:
+         if (rescanPaths.contains(event.path1))
+            kept[i] = false;
+         else
+            rescanPaths.insert(event.path1);
+         break;
+
+      default:;
+      }
+   }
+
+   if (!kept.contains(false))
+      return events;
+
+   QList<WatcherEvent> coalescedEvents;
+   for (int i = 0; i < events.size(); i++)
+      if (kept[i])
+         coalescedEvents << events[i];
+
+   L_DEBU(QString("DirWatcher::coalesce(..) : %1 events -> %2 events").arg(events.size()).arg(coalescedEvents.size()));
+   return coalescedEvents;
+}
+
 WatcherEvent::WatcherEvent() :
    type(WatcherEvent::UNKNOWN)
 {}
@@ -70,6 +138,7 @@ QString WatcherEvent::toStr()
    case NEW: str += "NEW"; break;
    case DELETED: str += "DELETED"; break;
    case CONTENT_CHANGED: str += "CONTENT_CHANGED"; break;
+   case RESCAN: str += "RESCAN"; break;
    case TIMEOUT: str += "TIMEOUT"; break;
    case UNKNOWN: default : str += "UNKNOWN"; break;
    }
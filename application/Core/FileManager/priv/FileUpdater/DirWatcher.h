@@ -41,6 +41,7 @@ namespace FM
      *  - New file
      *  - Delete file
      *  - The content of a file changed
+     *  - Some events have been lost
      */
    class DirWatcher
    {
@@ -85,6 +86,9 @@ namespace FM
         * @param timeout A timeout in milliseconds. -1 means forever.
         */
       virtual const QList<WatcherEvent> waitEvent(int timeout, QList<WaitCondition*> ws = QList<WaitCondition*>()) = 0;
+
+   protected:
+      static QList<WatcherEvent> coalesce(const QList<WatcherEvent>& events);
    };
 
    /**
@@ -104,6 +108,8 @@ namespace FM
          NEW,
          DELETED,
          CONTENT_CHANGED,
+         // Some events have been lost, the whole directory must be checked.
+         RESCAN,
          TIMEOUT,
          UNKNOWN
       };
@@ -29,8 +29,9 @@ using namespace FM;
 #include <priv/FileUpdater/WaitConditionLinux.h>
 #include <priv/Log.h>
 
-#include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/inotify.h>
+#include <unistd.h>
 #include <errno.h>
 
 /**
@@ -38,10 +39,14 @@ using namespace FM;
  * @author Hervé Martinet
  *
  * Implementation of 'DirWatcher' for the linux platform with inotify.
+ * The inotify descriptor and the wait conditions are waited with epoll, there is no limit on the descriptor values as with select.
+ * If the inotify queue overflows the watched tree is resynchronized and a 'RESCAN' event is returned for each root directory.
  */
 
 const int DirWatcherLinux::EVENT_SIZE = (sizeof (struct inotify_event));
-const size_t DirWatcherLinux::BUF_LEN = (1024 * (EVENT_SIZE + 16));
+const size_t DirWatcherLinux::BUF_LEN = 512 * 1024;
+const int DirWatcherLinux::MAX_READS_PER_WAIT = 64;
+const int DirWatcherLinux::MAX_EPOLL_EVENTS = 8;
 const uint32_t DirWatcherLinux::EVENTS_OBS = IN_MOVE|IN_DELETE|IN_CREATE|IN_CLOSE_WRITE;
 const uint32_t DirWatcherLinux::ROOT_EVENTS_OBS = EVENTS_OBS|IN_MOVE_SELF|IN_DELETE_SELF;
 
@@ -50,14 +55,24 @@ const uint32_t DirWatcherLinux::ROOT_EVENTS_OBS = EVENTS_OBS|IN_MOVE_SELF|IN_DEL
  * Constructor.
  */
 DirWatcherLinux::DirWatcherLinux()
-   : mutex(QMutex::Recursive)
+   : epollFileDescriptor(-1), buffer(new char[BUF_LEN])
 {
    // Initialize inotify
    initialized = true;
-   fileDescriptor = inotify_init();
+   fileDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
    if (fileDescriptor < 0) {
       L_WARN(QString("Unable to initialize inotify, DirWatcher not used."));
       initialized = false;
+      return;
+   }
+
+   epollFileDescriptor = epoll_create1(EPOLL_CLOEXEC);
+   struct epoll_event event;
+   event.events = EPOLLIN;
+   event.data.fd = fileDescriptor;
+   if (epollFileDescriptor < 0 || epoll_ctl(epollFileDescriptor, EPOLL_CTL_ADD, fileDescriptor, &event) < 0) {
+      L_WARN(QString("Unable to initialize epoll, DirWatcher not used."));
+      initialized = false;
    }
 }
 
@@ -68,10 +83,15 @@ DirWatcherLinux::~DirWatcherLinux ()
 {
    QMutexLocker locker(&this->mutex);
 
-   // Close file descriptor
-   if (close(fileDescriptor) < 0) {
+   // Close file descriptors
+   if (epollFileDescriptor >= 0 && close(epollFileDescriptor) < 0) {
+       L_ERRO(QString("DirWatcherLinux::~DirWatcherLinux : Unable to close file descriptor (epoll)."));
+   }
+   if (fileDescriptor >= 0 && close(fileDescriptor) < 0) {
        L_ERRO(QString("DirWatcherLinux::~DirWatcherLinux : Unable to close file descriptor (inotify)."));
    }
+
+   delete[] buffer;
 }
 
 /**
@@ -103,11 +123,10 @@ void DirWatcherLinux::rmDir(const QString& path)
 
 /**
  * Return the full path of the file notified by an inotify event.
+ * The mutex must be locked.
  * @param path the full path
  */
 QString DirWatcherLinux::getEventPath(inotify_event *event) {
-   QMutexLocker locker(&this->mutex);
-
    QString p = dirs.value(event->wd)->getFullPath();
    if (event->len)
       p.append('/').append(event->name);
@@ -139,87 +158,142 @@ const QList<WatcherEvent> DirWatcherLinux::waitEvent(int timeout, QList<WaitCond
 {
    QMutexLocker locker(&this->mutex);
 
-   fd_set fds;
-   int fd_max;
-   char buf[BUF_LEN];
-   struct timeval time;
-
-   // Convert timeout in timeval.
-   time.tv_sec = timeout / 1000;
-   time.tv_usec = (timeout % 1000) * 1000;
+   if (!initialized) return QList<WatcherEvent>();
 
-   // Zero-out the fd_set.
-   FD_ZERO(&fds);
-
-   // Add the inotify fd to the fd_set.
-   FD_SET(this->fileDescriptor, &fds);
-   fd_max = this->fileDescriptor;
-
-   // Add fd for all WaitCondition in fd_set and ajust fd_max if needed.
+   // Add the fd of each WaitCondition to the epoll set, they stay in it for the next calls.
+   QSet<int> wsFds;
    for (int i = 0; i < ws.size(); i++)
    {
       int wcfd = dynamic_cast<WaitConditionLinux*>(ws[i])->getFd();
-      L_DEBU(QString("DirWatcherLinux::waitEvent : add WaitCondition(fd=%1) to select fd_set").arg(wcfd));
-      FD_SET(wcfd, &fds);
-      if (wcfd > fd_max) fd_max = wcfd;
+      wsFds.insert(wcfd);
+      if (!this->waitConditionFds.contains(wcfd))
+      {
+         L_DEBU(QString("DirWatcherLinux::waitEvent : add WaitCondition(fd=%1) to the epoll set").arg(wcfd));
+         struct epoll_event event;
+         event.events = EPOLLIN;
+         event.data.fd = wcfd;
+         if (epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_ADD, wcfd, &event) == 0 || errno == EEXIST)
+            this->waitConditionFds.insert(wcfd);
+         else
+            L_ERRO(QString("DirWatcherLinux::waitEvent : unable to add a WaitCondition(fd=%1) to the epoll set").arg(wcfd));
+      }
    }
 
-   // Active select to wait events in unlocked mode.
-   L_DEBU("DirWatcherLinux::waitEvent : active select");
+   // Wait events in unlocked mode.
+   struct epoll_event readyEvents[MAX_EPOLL_EVENTS];
    locker.unlock();
-   int sel = select(fd_max + 1, &fds, NULL, NULL, (timeout==-1 ? 0 : &time));
+   int nbReady = epoll_wait(this->epollFileDescriptor, readyEvents, MAX_EPOLL_EVENTS, timeout);
    locker.relock();
 
-   if (sel < 0)
+   if (nbReady < 0)
    {
-      L_ERRO(QString("DirWatcherLinux::waitEvent : select error."));
+      if (errno != EINTR)
+         L_ERRO(QString("DirWatcherLinux::waitEvent : epoll_wait error."));
       return QList<WatcherEvent>();
    }
-   else if (!sel)
+   else if (!nbReady)
    {
-      // select is released by timeout.
-      L_DEBU("DirWatcherLinux::waitEvent : exit select by timeout");
+      // epoll_wait is released by timeout.
+      L_DEBU("DirWatcherLinux::waitEvent : exit epoll_wait by timeout");
       QList<WatcherEvent> events;
       events.append(WatcherEvent(WatcherEvent::TIMEOUT));
       return events;
    }
 
-   // Test if select is released by a WaitCondition.
+   // Test if epoll_wait is released by a WaitCondition.
    bool wsReleased = false;
-   for (int i = 0; i < ws.size(); i++)
+   for (int i = 0; i < nbReady; i++)
    {
-      int wcfd = dynamic_cast<WaitConditionLinux*>(ws[i])->getFd();
-      if(FD_ISSET(wcfd, &fds))
+      int fd = readyEvents[i].data.fd;
+      if (fd == this->fileDescriptor)
+         continue;
+
+      if (wsFds.contains(fd))
       {
-         L_DEBU(QString("DirWatcherLinux::waitEvent : exit select by WaitCondition release (fd=%1)").arg(wcfd));
+         L_DEBU(QString("DirWatcherLinux::waitEvent : exit epoll_wait by WaitCondition release (fd=%1)").arg(fd));
          static char dummy[4096];
-         while (read(wcfd, dummy, sizeof(dummy)) > 0);
+         while (read(fd, dummy, sizeof(dummy)) > 0);
          wsReleased = true;
       }
+      else
+      {
+         // A WaitCondition not waited by this call, it would be reported again and again. It will be added back by the next call waiting it.
+         epoll_ctl(this->epollFileDescriptor, EPOLL_CTL_DEL, fd, 0);
+         this->waitConditionFds.remove(fd);
+      }
    }
    if (wsReleased) return QList<WatcherEvent>();
 
-   L_DEBU("DirWatcherLinux::waitEvent : exit select by inotify");
-   int len = read(fileDescriptor, buf, BUF_LEN);
-   if (len < 0)
+   return coalesce(this->readEvents());
+}
+
+/**
+ * Read all the pending inotify events. The mutex must be locked.
+ */
+QList<WatcherEvent> DirWatcherLinux::readEvents()
+{
+   QList<WatcherEvent> events;
+   bool overflow = false;
+
+   for (int n = 0; n < MAX_READS_PER_WAIT; n++)
    {
-      if (errno == EINTR)
-         /* Need to reissue system call */
-         return QList<WatcherEvent>();
-      else
-         L_ERRO(QString("DirWatcherLinux::waitEvent : read inotify event failed."));
+      int len = read(fileDescriptor, buffer, BUF_LEN);
+      if (len < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         if (errno != EAGAIN && errno != EWOULDBLOCK)
+            L_ERRO(QString("DirWatcherLinux::readEvents : read inotify event failed."));
+         break;
+      }
+      else if (!len)
+         break;
+
+      if (this->processEvents(len, events))
+         overflow = true;
    }
-   else if (!len)
-         L_ERRO(QString("DirWatcherLinux::waitEvent : BUF_LEN to small ?"));
+
+   if (overflow)
+   {
+      // Some events have been lost : the watchers of the created directories are added,
+      // the file tree must be checked by the caller from each root.
+      L_WARN(QString("DirWatcherLinux::readEvents : the inotify queue has overflowed, the watched directories will be rescanned"));
+      foreach (Dir* dir, this->rootDirs)
+      {
+         dir->sync();
+         events << WatcherEvent(WatcherEvent::RESCAN, dir->getFullPath());
+      }
+   }
+
+   return events;
+}
+
+/**
+ * Convert the inotify events of 'buffer' into 'WatcherEvent'.
+ * @return true if an 'IN_Q_OVERFLOW' event has been read.
+ */
+bool DirWatcherLinux::processEvents(int len, QList<WatcherEvent>& events)
+{
+   bool overflow = false;
 
    int i = 0;
-   QList<WatcherEvent> events;
    QList<inotify_event*> movedFromEvents;
    while (i < len)
    {
       struct inotify_event *event;
 
-      event = (struct inotify_event *) &buf[i];
+      event = (struct inotify_event *) &buffer[i];
+      i += EVENT_SIZE + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+         overflow = true;
+         continue;
+      }
+
+      // The watcher of a removed directory may still have some queued events.
+      if (!dirs.contains(event->wd))
+         continue;
 
       if (event->mask & IN_MOVED_FROM)
       {
@@ -247,13 +321,16 @@ const QList<WatcherEvent> DirWatcherLinux::waitEvent(int timeout, QList<WaitCond
                   // because actually the name hasn't changed.
                   Dir* movedDir = dirs.value(fromEvent->wd)->childs.value(fromEvent->name);
 
-                  // If the name of moved directory has changed, rename it.
-                  if (fromEvent->name != event->name)
-                     movedDir->rename(event->name);
+                  if (movedDir)
+                  {
+                     // If the name of moved directory has changed, rename it.
+                     if (fromEvent->name != event->name)
+                        movedDir->rename(event->name);
 
-                  // If the path of moved directosy has changed, move it.
-                  if (movedDir->parent->getFullPath() != toDir->getFullPath())
-                     movedDir->move(toDir);
+                     // If the path of moved directosy has changed, move it.
+                     if (movedDir->parent->getFullPath() != toDir->getFullPath())
+                        movedDir->move(toDir);
+                  }
                }
                i.remove();
                // exit the IN_MOVED_TO process
@@ -284,8 +361,6 @@ const QList<WatcherEvent> DirWatcherLinux::waitEvent(int timeout, QList<WaitCond
 //            // TODO: Process only for root directory move.
 //         if (event->mask & IN_DELETE_SELF)
 //            // TODO: Process only for root directory delete.
-
-      i += EVENT_SIZE + event->len;
    }
 
    // Cause every IN_MOVED_FROM event with a linked IN_MOVED_TO event was removed of
@@ -296,7 +371,7 @@ const QList<WatcherEvent> DirWatcherLinux::waitEvent(int timeout, QList<WaitCond
       events << WatcherEvent(WatcherEvent::DELETED, getEventPath(e));
    }
 
-   return events;
+   return overflow;
 }
 
 /**
@@ -332,6 +407,9 @@ DirWatcherLinux::Dir::Dir(DirWatcherLinux* dwl, Dir* parent, const QString& name
  */
 DirWatcherLinux::Dir::~Dir()
 {
+   if (this->parent && this->parent->childs.value(this->name) == this)
+      this->parent->childs.remove(this->name);
+
    dwl->dirs.remove(wd);
    if (inotify_rm_watch(dwl->fileDescriptor, wd))
        L_ERRO(QString("DirWatcherLinux::~DirWatcherLinux : Unable to remove an inotify watcher."));
@@ -376,4 +454,25 @@ void DirWatcherLinux::Dir::move(Dir* to)
    to->childs.insert(this->name, this);
 }
 
+/**
+ * Watch the sub-directories created and forget the ones removed since they have been read,
+ * used when some events have been lost.
+ */
+void DirWatcherLinux::Dir::sync()
+{
+   const QStringList subDirNames = QDir(this->getFullPath()).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+
+   foreach (Dir* child, this->childs.values())
+      if (!subDirNames.contains(child->name))
+         delete child;
+
+   foreach (QString subDirName, subDirNames)
+   {
+      if (Dir* child = this->childs.value(subDirName))
+         child->sync();
+      else
+         new Dir(this->dwl, this, subDirName);
+   }
+}
+
 #endif
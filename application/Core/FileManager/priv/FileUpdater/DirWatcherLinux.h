@@ -21,6 +21,8 @@
 #if !defined(FILEMANAGER_DIRWATCHERLINUX_H) and defined(Q_OS_LINUX)
 #define FILEMANAGER_DIRWATCHERLINUX_H
 
+#include <QSet>
+
 #include <priv/FileUpdater/DirWatcher.h>
 
 #include <sys/inotify.h>
@@ -41,7 +43,9 @@ namespace FM
 
    private:
        static const int EVENT_SIZE; // Size of the event structure, not counting name.
-       static const size_t BUF_LEN; // Reasonable guess as to size of 1024 events.
+       static const size_t BUF_LEN; // Large enough to read a burst of events (untarring an archive for example) with a few calls.
+       static const int MAX_READS_PER_WAIT; // The events are read until the queue is empty or after this number of 'read' calls.
+       static const int MAX_EPOLL_EVENTS; // Inotify + the wait conditions.
        static const uint32_t EVENTS_OBS; // Inotify events catched for subdirectories.
        static const uint32_t ROOT_EVENTS_OBS; // Inotify events catched for root directories.
 
@@ -58,18 +62,23 @@ namespace FM
           QString getFullPath();
           void rename(const QString& newName);
           void move(Dir* to);
+          void sync();
        };
 
        QMap<int, Dir*> dirs; // The watched dirs, indexed by watch descriptor.
        QMap<QString, Dir*> rootDirs; // The watched root dirs, indexed by full path.
 
-       void rmWatcher(int watcher);
+       QList<WatcherEvent> readEvents();
+       bool processEvents(int len, QList<WatcherEvent>& events);
        QString getEventPath(inotify_event *event);
 
        QMutex mutex;
 
        bool initialized;
        int fileDescriptor;
+       int epollFileDescriptor;
+       QSet<int> waitConditionFds; // The wait conditions added to 'epollFileDescriptor'.
+       char* buffer; // Size : BUF_LEN.
    };
 }
 
@@ -19,8 +19,7 @@
 #include <priv/FileUpdater/FileUpdater.h>
 using namespace FM;
 
-#include <QLinkedList>
-#include <QDir>
+#include <QFile>
 #include <QElapsedTimer>
 
 #include <Common/Settings.h>
@@ -43,8 +42,10 @@ using namespace FM;
 
 FileUpdater::FileUpdater(FileManager* fileManager) :
    SCAN_PERIOD_UNWATCHABLE_DIRS(SETTINGS.get<quint32>("scan_period_unwatchable_dirs")),
+   FULL_SCAN_PERIOD_UNWATCHABLE_DIRS(SETTINGS.get<quint32>("full_scan_period_unwatchable_dirs")),
    fileManager(fileManager),
    dirWatcher(DirWatcher::getNewWatcher()),
+   dirLister(SETTINGS.get<quint32>("scan_number_of_threads")),
    fileCache(0),
    toStop(false),
    progress(0),
@@ -209,6 +210,7 @@ int FileUpdater::getProgress() const
 void FileUpdater::run()
 {
    this->timerScanUnwatchable.start();
+   this->timerFullScanUnwatchable.start();
 
    QString threadName = "FileUpdater";
 #if DEBUG
@@ -216,25 +218,42 @@ void FileUpdater::run()
 #endif
    QThread::currentThread()->setObjectName(threadName);
 
-   // First : retrieve the directories and file from the file cache and
-   // synchronize it with the file system.
+   // First : build the directories and files from the file cache, they can be browsed and searched right away.
    if (this->fileCache)
    {
-      const int nbDirsToScan = this->dirsToScan.size();
-      // TODO: the mutex should be used ?
-      while (!this->dirsToScan.isEmpty())
-      {
-         Directory* dir = this->dirsToScan.takeFirst();
-         this->scan(dir, true);
+      this->mutex.lock();
+      const QList<Directory*> dirsToRestore = this->dirsToScan;
+      this->mutex.unlock();
+
+      foreach (Directory* dir, dirsToRestore)
          this->restoreFromFileCache(static_cast<SharedDirectory*>(dir));
-         this->progress = 10000 * (nbDirsToScan - this->dirsToScan.size()) / nbDirsToScan;
-      }
 
       delete this->fileCache;
       this->fileCache = 0;
-   }
 
-   emit fileCacheLoaded();
+      emit fileCacheLoaded();
+
+      // Second : synchronize the restored directories with the file system.
+      const int nbDirsToScan = dirsToRestore.size();
+      forever
+      {
+         this->mutex.lock();
+         if (this->dirsToScan.isEmpty() || this->toStop)
+         {
+            this->mutex.unlock();
+            break;
+         }
+         Directory* dir = this->dirsToScan.takeFirst();
+         const int nbDirsScanned = nbDirsToScan - this->dirsToScan.size();
+         this->mutex.unlock();
+
+         this->scan(dir, true);
+         if (nbDirsScanned > 0)
+            this->progress = 10000 * nbDirsScanned / nbDirsToScan;
+      }
+   }
+   else
+      emit fileCacheLoaded();
 
    this->progress = 0;
 
@@ -302,11 +321,16 @@ void FileUpdater::run()
          QList<Directory*> unwatchableDirsCopy = this->unwatchableDirs;
          this->mutex.unlock();
 
-         // Synchronize the new directory.
+         // Only the directories modified since the last scanning are read again. Less often all the directories
+         // are read to detect the files modified in place, they don't change the signature of their directory.
+         const bool fullScan = this->timerFullScanUnwatchable.elapsed() >= FULL_SCAN_PERIOD_UNWATCHABLE_DIRS;
+         if (fullScan)
+            this->timerFullScanUnwatchable.start();
+
          for (QListIterator<Directory*> i(unwatchableDirsCopy); i.hasNext();)
          {
             Directory* dir = i.next();
-               this->scan(dir);
+            this->scan(dir, false, !fullScan);
          }
       }
 
@@ -457,8 +481,12 @@ void FileUpdater::stopHashing()
   * in dir. Create the associated cached tree structure under the
   * given 'Directory*'.
   * The directories may already exist in the cache.
+  * @param withUnfinished Used after the cache has been restored : the unfinished files are synchronized too,
+  *  the ones unknown by the cache are physically removed and the ones which don't exist anymore are removed from the cache.
+  * @param onlyChangedDirs Only the directories whose signature has changed since the last scanning are read (see 'DirSignature'),
+  *  the other ones are only checked for their sub-directories. A file modified in place isn't detected in this mode.
   */
-void FileUpdater::scan(Directory* dir, bool addUnfinished)
+void FileUpdater::scan(Directory* dir, bool withUnfinished, bool onlyChangedDirs)
 {
    L_DEBU("Start scanning a shared directory : " + dir->getFullPath());
 
@@ -466,47 +494,73 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
    this->currentScanningDir = dir;
    this->scanningMutex.unlock();
 
-   QLinkedList<Directory*> dirsToVisit;
-   dirsToVisit << dir;
+   QElapsedTimer timer;
+   timer.start();
+   int nbDirsScanned = 0;
+   int nbDirsUnchanged = 0;
+
+   // The directories are read concurrently by 'dirLister', the cache is only modified by this thread.
+   this->dirLister.list(dir, onlyChangedDirs ? dir->getSignature() : DirSignature());
 
-   while (!dirsToVisit.isEmpty())
+   DirLister::Listing listing;
+   while (this->dirLister.next(listing))
    {
-      Directory* currentDir = dirsToVisit.takeFirst();
+      Directory* currentDir = listing.dir;
+      nbDirsScanned++;
+
+      if (listing.unchanged)
+      {
+         nbDirsUnchanged++;
+         foreach (Directory* subDir, currentDir->getSubDirs())
+            this->dirLister.list(subDir, subDir->getSignature());
+         continue;
+      }
 
       QList<Directory*> currentSubDirs = currentDir->getSubDirs();
-      QList<File*> currentFiles = currentDir->getCompleteFiles(); // We don't care about the unfinished files.
+      QList<File*> currentFiles = withUnfinished ? currentDir->getFiles() : currentDir->getCompleteFiles(); // Usually we don't care about the unfinished files.
 
-      foreach (QFileInfo entry, QDir(currentDir->getFullPath()).entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::NoSymLinks)) // TODO: Add an option to follow or not symlinks.
+      foreach (const FileSystemEntry& entry, listing.entries)
       {
          QMutexLocker locker(&this->scanningMutex);
 
          if (!this->currentScanningDir || this->toStop)
          {
             L_DEBU("Scanning aborted : " + dir->getFullPath());
+            this->dirLister.clear();
             this->currentScanningDir = 0;
             this->scanningStopped.wakeOne();
             return;
          }
 
-         if (entry.isDir())
+         if (entry.isDir)
          {
-            Directory* dir = currentDir->createSubDirectory(entry.fileName());
-            dirsToVisit << dir;
+            Directory* subDir = currentDir->createSubDirectory(entry.name);
+            this->dirLister.list(subDir, onlyChangedDirs ? subDir->getSignature() : DirSignature());
 
-            currentSubDirs.removeOne(dir);
+            currentSubDirs.removeOne(subDir);
          }
-         else if (entry.size() > 0 && (addUnfinished || !Global::isFileUnfinished(entry.fileName())))
+         else if (entry.size > 0 && (withUnfinished || !Global::isFileUnfinished(entry.name)))
          {
-            File* file = currentDir->getFile(entry.fileName());
+            File* file = currentDir->getFile(entry.name);
             QMutexLocker locker(&this->mutex);
 
+            // An unfinished file which isn't in the cache can't be resumed.
+            if (!file && Global::isFileUnfinished(entry.name))
+            {
+               const QString absoluteFilePath = currentDir->getFullPath().append(entry.name);
+               L_DEBU(QString("Removing an unknown unfinished file : %1").arg(absoluteFilePath));
+               if (!QFile::remove(absoluteFilePath))
+                  L_WARN(QString("Unable to remove an unknown unfinished file : %1").arg(absoluteFilePath));
+               continue;
+            }
+
             if (file)
             {
                if (
                    !this->filesWithoutHashes.contains(file) && // The case where a file is being copied and a lot of modification event is thrown (thus the file is in this->filesWithoutHashes).
                    !this->filesWithoutHashesPrioritized.contains(file) &&
                    file->isComplete() &&
-                   !file->correspondTo(entry, file->hasAllHashes()) // If the hashes of a file can't be computed (IO error, the file is being written for example) we only compare their sizes.
+                   !file->correspondTo(entry.size, entry.dateLastModified, file->hasAllHashes()) // If the hashes of a file can't be computed (IO error, the file is being written for example) we only compare their sizes.
                )
                   file = 0;
                else
@@ -518,9 +572,9 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
                // Very special case : there is a file 'a' without File* in cache and a file 'a.unfinished'.
                // This case occure when a file is redownloaded, the File* 'a' is renamed as 'a.unfinished' but the physical file 'a'
                // is not deleted.
-               File* unfinishedFile = currentDir->getFile(entry.fileName().append(Global::getUnfinishedSuffix()));
+               File* unfinishedFile = currentDir->getFile(QString(entry.name).append(Global::getUnfinishedSuffix()));
                if (!unfinishedFile)
-                  file = new File(currentDir, entry.fileName(), entry.size(), entry.lastModified());
+                  file = new File(currentDir, entry.name, entry.size, entry.dateLastModified);
                else
                {
                   currentFiles.removeOne(unfinishedFile);
@@ -543,6 +597,8 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
 
       foreach (Directory* d, currentSubDirs)
          this->deleteEntry(d);
+
+      currentDir->setSignature(listing.signature); // Set at the end, thus an aborted scanning leaves the previous signature.
    }
 
    this->scanningMutex.lock();
@@ -555,7 +611,7 @@ void FileUpdater::scan(Directory* dir, bool addUnfinished)
       this->timerScanUnwatchable.start();
    this->mutex.unlock();
 
-   L_DEBU("Scanning terminated : " + dir->getFullPath());
+   L_DEBU(QString("Scanning terminated : %1 (%2 directories in %3 ms, %4 unchanged)").arg(dir->getFullPath()).arg(nbDirsScanned).arg(timer.elapsed()).arg(nbDirsUnchanged));
 }
 
 /**
@@ -703,6 +759,8 @@ bool FileUpdater::treatEvents(const QList<WatcherEvent>& events)
    if (events.isEmpty())
       return false;
 
+   QList<Directory*> dirsToRescan;
+
    foreach (WatcherEvent event, events)
    {
       if (event.type == WatcherEvent::TIMEOUT)
@@ -742,11 +800,24 @@ bool FileUpdater::treatEvents(const QList<WatcherEvent>& events)
             break;
          }
 
+      case WatcherEvent::RESCAN:
+         {
+            Directory* dir = this->fileManager->getFittestDirectory(event.path1);
+            if (dir && !dirsToRescan.contains(dir))
+               dirsToRescan << dir;
+            break;
+         }
+
       case WatcherEvent::UNKNOWN:
       case WatcherEvent::TIMEOUT:
          break; // Do nothing.
       }
    }
 
+   // The lost events may concern files modified in place, they don't change the signature of their directory (see 'DirSignature'),
+   // thus all the directories are read and all the files are compared.
+   foreach (Directory* dir, dirsToRescan)
+      this->scan(dir);
+
    return false;
 }
@@ -29,6 +29,7 @@
 #include <Protos/files_cache.pb.h>
 
 #include <priv/FileUpdater/DirWatcher.h>
+#include <priv/FileUpdater/DirLister.h>
 
 namespace FM
 {
@@ -71,7 +72,7 @@ namespace FM
 
       void stopHashing();
 
-      void scan(Directory* dir, bool addUnfinished = false);
+      void scan(Directory* dir, bool withUnfinished = false, bool onlyChangedDirs = false);
 
       void stopScanning(Directory* dir = 0);
 
@@ -84,9 +85,11 @@ namespace FM
       bool treatEvents(const QList<WatcherEvent>& events);
 
       const int SCAN_PERIOD_UNWATCHABLE_DIRS;
+      const int FULL_SCAN_PERIOD_UNWATCHABLE_DIRS;
 
       FileManager* fileManager;
       DirWatcher* dirWatcher;
+      DirLister dirLister; ///< Read the directories concurrently during a scanning.
 
       const Protos::FileCache::Hashes* fileCache; ///< The hashes from the saved file cache. Used only temporally at the begining of 'run()'.
 
@@ -99,6 +102,7 @@ namespace FM
 
       QList<Directory*> unwatchableDirs;
       QElapsedTimer timerScanUnwatchable;
+      QElapsedTimer timerFullScanUnwatchable; ///< See the setting 'full_scan_period_unwatchable_dirs'.
       QList<Directory*> dirsToScan; ///< When a new shared directory is added, it is put in this list until it is scanned.
       Directory* currentScanningDir;
       QWaitCondition scanningStopped;
@@ -69,12 +69,15 @@ Protos::Core::GetHashesResult GetHashesResult::start()
       return result;
    }
 
+   QMutexLocker locker(&this->mutex); // 'chunkHashKnown(..)' can be called by the FileUpdater thread as soon as the signal is connected.
+
    connect(&this->cache, SIGNAL(chunkHashKnown(QSharedPointer<Chunk>)), this, SLOT(chunkHashKnown(QSharedPointer<Chunk>)), Qt::DirectConnection);
    this->nbHash = chunks.size() - this->fileEntry.chunk_size();
    this->lastHashNumSent = this->fileEntry.chunk_size() - 1;
 
    result.set_nb_hash(this->nbHash);
 
+   // The hashes already known are all put in the result, only the ones not yet computed will be emitted by 'nextHash(..)'.
    for (QListIterator< QSharedPointer<Chunk> > i(chunks); i.hasNext();)
    {
       QSharedPointer<Chunk> chunk(i.next());
@@ -83,7 +86,10 @@ Protos::Core::GetHashesResult GetHashesResult::start()
 
       if (chunk->hasHash())
       {
-         this->sendNextHash(chunk);
+         const Common::Hash hash = chunk->getHash();
+         result.add_hash()->set_hash(hash.getData(), Common::Hash::HASH_SIZE);
+         this->lastHashNumSent = chunk->getNum();
+         this->nbHash--;
       }
       else // If only one hash is missing we tell the FileUpdater to compute the remaining ones.
       {
@@ -92,6 +98,9 @@ Protos::Core::GetHashesResult GetHashesResult::start()
       }
    }
 
+   if (!this->nbHash)
+      disconnect(&this->cache, SIGNAL(chunkHashKnown(QSharedPointer<Chunk>)), this, SLOT(chunkHashKnown(QSharedPointer<Chunk>)));
+
    result.set_status(Protos::Core::GetHashesResult_Status_OK);
    return result;
 }
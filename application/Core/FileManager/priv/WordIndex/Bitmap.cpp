@@ -0,0 +1,399 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/WordIndex/Bitmap.h>
+using namespace FM;
+
+#include <QtAlgorithms>
+
+/**
+  * @class FM::Bitmap
+  *
+  * The operations on two bitsets are made word by word on contiguous arrays, the compiler can vectorize them.
+  * An operation between two arrays or between an array and a bitset only reads the values of the arrays.
+  */
+
+const int Bitmap::MAX_ARRAY_SIZE(4096);
+const int Bitmap::BITSET_SIZE(1024);
+
+inline int popCount(quint64 word)
+{
+#ifdef __GNUC__
+   return __builtin_popcountll(word);
+#else
+   word = word - ((word >> 1) & Q_UINT64_C(0x5555555555555555));
+   word = (word & Q_UINT64_C(0x3333333333333333)) + ((word >> 2) & Q_UINT64_C(0x3333333333333333));
+   word = (word + (word >> 4)) & Q_UINT64_C(0x0F0F0F0F0F0F0F0F);
+   return static_cast<int>((word * Q_UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+Bitmap::Bitmap()
+{
+}
+
+Bitmap::Bitmap(QVector<quint32>& values)
+{
+   qSort(values);
+
+   for (int i = 0; i < values.size(); i++)
+   {
+      const quint16 key = values[i] >> 16;
+      if (this->containers.isEmpty() || this->containers.last().key != key)
+      {
+         if (!this->containers.isEmpty())
+            this->containers.last().shrink();
+         this->containers << Container(key);
+      }
+
+      Container& container = this->containers.last();
+      const quint16 low = values[i] & 0xFFFF;
+      if (container.array.isEmpty() || container.array.last() != low)
+         container.array << low;
+   }
+
+   if (!this->containers.isEmpty())
+      this->containers.last().shrink();
+
+   for (int i = 0; i < this->containers.size(); i++)
+   {
+      this->containers[i].size = this->containers[i].array.size();
+      if (this->containers[i].size > MAX_ARRAY_SIZE)
+         this->containers[i].toBitset();
+   }
+}
+
+Bitmap& Bitmap::operator&=(const Bitmap& other)
+{
+   QVector<Container> result;
+   for (int i = 0, j = 0; i < this->containers.size() && j < other.containers.size();)
+   {
+      if (this->containers[i].key < other.containers[j].key)
+         i++;
+      else if (this->containers[i].key > other.containers[j].key)
+         j++;
+      else
+      {
+         Container container = intersect(this->containers[i++], other.containers[j++]);
+         if (container.size > 0)
+            result << container;
+      }
+   }
+
+   this->containers = result;
+   return *this;
+}
+
+Bitmap& Bitmap::operator|=(const Bitmap& other)
+{
+   QVector<Container> result;
+   result.reserve(this->containers.size() + other.containers.size());
+   int i = 0, j = 0;
+   while (i < this->containers.size() && j < other.containers.size())
+   {
+      if (this->containers[i].key < other.containers[j].key)
+         result << this->containers[i++];
+      else if (this->containers[i].key > other.containers[j].key)
+         result << other.containers[j++];
+      else
+         result << unite(this->containers[i++], other.containers[j++]);
+   }
+   while (i < this->containers.size())
+      result << this->containers[i++];
+   while (j < other.containers.size())
+      result << other.containers[j++];
+
+   this->containers = result;
+   return *this;
+}
+
+Bitmap& Bitmap::operator-=(const Bitmap& other)
+{
+   QVector<Container> result;
+   int j = 0;
+   for (int i = 0; i < this->containers.size(); i++)
+   {
+      while (j < other.containers.size() && other.containers[j].key < this->containers[i].key)
+         j++;
+
+      if (j < other.containers.size() && other.containers[j].key == this->containers[i].key)
+      {
+         Container container = subtract(this->containers[i], other.containers[j]);
+         if (container.size > 0)
+            result << container;
+      }
+      else
+         result << this->containers[i];
+   }
+
+   this->containers = result;
+   return *this;
+}
+
+bool Bitmap::isEmpty() const
+{
+   return this->containers.isEmpty();
+}
+
+int Bitmap::size() const
+{
+   int size = 0;
+   for (int i = 0; i < this->containers.size(); i++)
+      size += this->containers[i].size;
+   return size;
+}
+
+/**
+  * Return the values in ascending order.
+  * @param maxNbValues Only the 'maxNbValues' first values are returned, -1 means all the values.
+  */
+QVector<quint32> Bitmap::values(int maxNbValues) const
+{
+   QVector<quint32> values;
+   values.reserve(maxNbValues == -1 ? this->size() : qMin(maxNbValues, this->size()));
+
+   for (int i = 0; i < this->containers.size() && values.size() != maxNbValues; i++)
+   {
+      const Container& container = this->containers[i];
+      const quint32 high = static_cast<quint32>(container.key) << 16;
+
+      if (container.isBitset())
+      {
+         for (int j = 0; j < BITSET_SIZE && values.size() != maxNbValues; j++)
+            for (quint64 word = container.bitset[j]; word != 0 && values.size() != maxNbValues; word &= word - 1)
+               values << (high | (j * 64 + popCount((word & (~word + 1)) - 1))); // The position of the lowest bit set.
+      }
+      else
+      {
+         for (int j = 0; j < container.array.size() && values.size() != maxNbValues; j++)
+            values << (high | container.array[j]);
+      }
+   }
+
+   return values;
+}
+
+bool Bitmap::Container::contains(quint16 value) const
+{
+   if (this->isBitset())
+      return this->bitset[value >> 6] & (Q_UINT64_C(1) << (value & 63));
+
+   QVector<quint16>::const_iterator i = qBinaryFind(this->array.constBegin(), this->array.constEnd(), value);
+   return i != this->array.constEnd();
+}
+
+void Bitmap::Container::toBitset()
+{
+   this->bitset.fill(0, BITSET_SIZE);
+   for (int i = 0; i < this->array.size(); i++)
+      this->bitset[this->array[i] >> 6] |= Q_UINT64_C(1) << (this->array[i] & 63);
+   this->array.clear();
+}
+
+void Bitmap::Container::toArray()
+{
+   this->array.clear();
+   this->array.reserve(this->size);
+   for (int i = 0; i < BITSET_SIZE; i++)
+      for (quint64 word = this->bitset[i]; word != 0; word &= word - 1)
+         this->array << static_cast<quint16>(i * 64 + popCount((word & (~word + 1)) - 1));
+   this->bitset.clear();
+}
+
+/**
+  * Convert a bitset to an array if it has become small enough.
+  */
+void Bitmap::Container::shrink()
+{
+   if (this->isBitset())
+   {
+      if (this->size <= MAX_ARRAY_SIZE)
+         this->toArray();
+   }
+   else
+      this->array.squeeze();
+}
+
+Bitmap::Container Bitmap::intersect(const Container& c1, const Container& c2)
+{
+   Container result(c1.key);
+
+   if (c1.isBitset() && c2.isBitset())
+   {
+      result.bitset.resize(BITSET_SIZE);
+      const quint64* w1 = c1.bitset.constData();
+      const quint64* w2 = c2.bitset.constData();
+      quint64* w = result.bitset.data();
+      for (int i = 0; i < BITSET_SIZE; i++)
+         w[i] = w1[i] & w2[i];
+      for (int i = 0; i < BITSET_SIZE; i++)
+         result.size += popCount(w[i]);
+      result.shrink();
+   }
+   else if (c1.isBitset() || c2.isBitset())
+   {
+      const Container& array = c1.isBitset() ? c2 : c1;
+      const Container& bitset = c1.isBitset() ? c1 : c2;
+      for (int i = 0; i < array.array.size(); i++)
+         if (bitset.contains(array.array[i]))
+            result.array << array.array[i];
+      result.size = result.array.size();
+   }
+   else
+   {
+      const quint16* a1 = c1.array.constData();
+      const quint16* a2 = c2.array.constData();
+      for (int i = 0, j = 0; i < c1.array.size() && j < c2.array.size();)
+      {
+         if (a1[i] < a2[j])
+            i++;
+         else if (a1[i] > a2[j])
+            j++;
+         else
+         {
+            result.array << a1[i];
+            i++;
+            j++;
+         }
+      }
+      result.size = result.array.size();
+   }
+
+   return result;
+}
+
+Bitmap::Container Bitmap::unite(const Container& c1, const Container& c2)
+{
+   Container result(c1.key);
+
+   if (c1.isBitset() && c2.isBitset())
+   {
+      result.bitset.resize(BITSET_SIZE);
+      const quint64* w1 = c1.bitset.constData();
+      const quint64* w2 = c2.bitset.constData();
+      quint64* w = result.bitset.data();
+      for (int i = 0; i < BITSET_SIZE; i++)
+         w[i] = w1[i] | w2[i];
+      for (int i = 0; i < BITSET_SIZE; i++)
+         result.size += popCount(w[i]);
+   }
+   else if (c1.isBitset() || c2.isBitset())
+   {
+      const Container& array = c1.isBitset() ? c2 : c1;
+      result = c1.isBitset() ? c1 : c2;
+      result.key = c1.key;
+      for (int i = 0; i < array.array.size(); i++)
+      {
+         quint64& word = result.bitset[array.array[i] >> 6];
+         const quint64 bit = Q_UINT64_C(1) << (array.array[i] & 63);
+         if (!(word & bit))
+         {
+            word |= bit;
+            result.size++;
+         }
+      }
+   }
+   else
+   {
+      result.array.reserve(c1.array.size() + c2.array.size());
+      const quint16* a1 = c1.array.constData();
+      const quint16* a2 = c2.array.constData();
+      int i = 0, j = 0;
+      while (i < c1.array.size() && j < c2.array.size())
+      {
+         if (a1[i] < a2[j])
+            result.array << a1[i++];
+         else if (a1[i] > a2[j])
+            result.array << a2[j++];
+         else
+         {
+            result.array << a1[i++];
+            j++;
+         }
+      }
+      while (i < c1.array.size())
+         result.array << a1[i++];
+      while (j < c2.array.size())
+         result.array << a2[j++];
+
+      result.size = result.array.size();
+      if (result.size > MAX_ARRAY_SIZE)
+         result.toBitset();
+   }
+
+   return result;
+}
+
+/**
+  * c1 \ c2.
+  */
+Bitmap::Container Bitmap::subtract(const Container& c1, const Container& c2)
+{
+   Container result(c1.key);
+
+   if (c1.isBitset() && c2.isBitset())
+   {
+      result.bitset.resize(BITSET_SIZE);
+      const quint64* w1 = c1.bitset.constData();
+      const quint64* w2 = c2.bitset.constData();
+      quint64* w = result.bitset.data();
+      for (int i = 0; i < BITSET_SIZE; i++)
+         w[i] = w1[i] & ~w2[i];
+      for (int i = 0; i < BITSET_SIZE; i++)
+         result.size += popCount(w[i]);
+      result.shrink();
+   }
+   else if (c1.isBitset())
+   {
+      result = c1;
+      for (int i = 0; i < c2.array.size(); i++)
+      {
+         quint64& word = result.bitset[c2.array[i] >> 6];
+         const quint64 bit = Q_UINT64_C(1) << (c2.array[i] & 63);
+         if (word & bit)
+         {
+            word &= ~bit;
+            result.size--;
+         }
+      }
+      result.shrink();
+   }
+   else if (c2.isBitset())
+   {
+      for (int i = 0; i < c1.array.size(); i++)
+         if (!c2.contains(c1.array[i]))
+            result.array << c1.array[i];
+      result.size = result.array.size();
+   }
+   else
+   {
+      const quint16* a1 = c1.array.constData();
+      const quint16* a2 = c2.array.constData();
+      int j = 0;
+      for (int i = 0; i < c1.array.size(); i++)
+      {
+         while (j < c2.array.size() && a2[j] < a1[i])
+            j++;
+         if (j == c2.array.size() || a2[j] != a1[i])
+            result.array << a1[i];
+      }
+      result.size = result.array.size();
+   }
+
+   return result;
+}
@@ -0,0 +1,78 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_BITMAP_H
+#define FILEMANAGER_BITMAP_H
+
+#include <QVector>
+
+namespace FM
+{
+   /**
+     * A set of 32 bits values compressed like a Roaring bitmap.
+     * The values are grouped by their 16 high bits in some containers, a container is either a sorted array of the 16 low bits
+     * or a bitset of 2^16 bits when it has more than 'MAX_ARRAY_SIZE' values.
+     * Used by 'WordIndex' to combine the items found for each term of a search.
+     */
+   class Bitmap
+   {
+      static const int MAX_ARRAY_SIZE; ///< Above this number of values a bitset (8 KiB) is smaller than an array.
+      static const int BITSET_SIZE; ///< The number of 64 bits words of a bitset.
+
+   public:
+      Bitmap();
+
+      /**
+        * The given values are sorted in place, they can contain some duplicates.
+        */
+      Bitmap(QVector<quint32>& values);
+
+      Bitmap& operator&=(const Bitmap& other);
+      Bitmap& operator|=(const Bitmap& other);
+      Bitmap& operator-=(const Bitmap& other);
+
+      bool isEmpty() const;
+      int size() const;
+      QVector<quint32> values(int maxNbValues = -1) const;
+
+   private:
+      struct Container
+      {
+         Container(quint16 key = 0) : key(key), size(0) {}
+
+         bool isBitset() const { return !this->bitset.isEmpty(); }
+         bool contains(quint16 value) const;
+         void toBitset();
+         void toArray();
+         void shrink();
+
+         quint16 key; ///< The 16 high bits of the values.
+         int size; ///< The number of values.
+         QVector<quint16> array; ///< The sorted 16 low bits of the values if the container isn't a bitset.
+         QVector<quint64> bitset; ///< 'BITSET_SIZE' words or empty.
+      };
+
+      static Container intersect(const Container& c1, const Container& c2);
+      static Container unite(const Container& c1, const Container& c2);
+      static Container subtract(const Container& c1, const Container& c2);
+
+      QVector<Container> containers; ///< Sorted by key, a container is never empty.
+   };
+}
+
+#endif
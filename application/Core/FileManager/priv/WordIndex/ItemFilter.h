@@ -0,0 +1,36 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_ITEMFILTER_H
+#define FILEMANAGER_ITEMFILTER_H
+
+namespace FM
+{
+   /**
+     * Restrict the items returned by a search, see 'WordIndex::search(..)' and 'SubstringIndex::search(..)'.
+     */
+   template<typename T>
+   class ItemFilter
+   {
+   public:
+      virtual ~ItemFilter() {}
+      virtual bool match(const T* item) const = 0;
+   };
+}
+
+#endif
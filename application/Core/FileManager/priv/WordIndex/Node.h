@@ -20,8 +20,10 @@
 #define FILEMANAGER_NODE_H
 
 #include <QList>
-#include <QSet>
+#include <QVector>
 #include <QChar>
+#include <QString>
+#include <QMap>
 
 #include <Common/Uncopyable.h>
 
@@ -31,31 +33,12 @@ namespace FM
    struct NodeResult
    {
       NodeResult() : level(0) {}
-      NodeResult(T* v, bool level = 0) : value(v), level(level) {}
-      static void intersect(QSet< NodeResult<T> >& s1, const QSet< NodeResult<T> >& s2, int matchValue);
+      NodeResult(T v, int level = 0) : value(v), level(level) {}
 
-      T* value; // Should be const but QList must be able to change a NodeResult in place...
+      T value; // Should be const but QList must be able to change a NodeResult in place...
       int level;
    };
 
-   /**
-     * s1 <- s1 & s2.
-     * For all common items the 'level' fields are summed.
-     */
-   template <typename T>
-   void NodeResult<T>::intersect(QSet< NodeResult<T> >& s1, const QSet< NodeResult<T> >& s2, int matchValue)
-   {
-      for (QMutableSetIterator< NodeResult<T> > i(s1); i.hasNext();)
-      {
-         const NodeResult<T>& node = i.next();
-         typename QSet< NodeResult<T> >::const_iterator j = s2.find(node);
-         if (j == s2.constEnd())
-            i.remove();
-         else
-            const_cast<NodeResult<T>&>(node).level += j->level ? matchValue : 0;
-      }
-   }
-
    /**
      * To sort from the best level (the lowest value) to the worse (the hightest value).
      */
@@ -67,6 +50,13 @@ namespace FM
 
    /////
 
+   /**
+     * A node of a compressed radix trie (path compression) : a node is created only where some words diverge or end,
+     * the letters between two nodes are stored as a label in the child.
+     * The children are kept in a contiguous array sorted by their first letter, a lookup is a binary search on this array
+     * without reaching the child nodes.
+     * Each node knows the number of items of its subtree, see 'count(..)'.
+     */
    template<typename T>
    class Node : Common::Uncopyable
    {
@@ -79,58 +69,56 @@ namespace FM
       ~Node();
 
       /**
-        * Add a child node and return it.
-        * If the node already exists it will returned.
+        * Add an item indexed by the given word.
+        * The item is added even if it already exists.
         */
-      Node<T>& addNode(const QChar& letter);
+      void addItem(const QStringRef& word, T item);
 
       /**
-        * Remove a node for their children.
-        * If the node doesn't exist nothing happen.
+        * Remove the item indexed by the given word.
+        * If the item doesn't exist nothing happen. The nodes left without item are removed.
         */
-      void rmNode(Node<T>* const node);
+      void rmItem(const QStringRef& word, T item);
 
       /**
-        * Get a children node.
-        * /!\ If no one exists 0 is returned.
+        * Return all items indexed by the given word and if 'alsoFromSubNodes' is true the ones indexed by a word beginning by 'word'.
+        * NodeResult::level is set to 0 for the items indexed by 'word' exactly, for the others it is set to 1.
+        * The items are returned best first : the exact ones then by the length of their word. If 'maxNbResult' is reached
+        * the remaining nodes aren't visited.
         */
-      Node<T>* getNode(const QChar& letter) const;
+      QList< NodeResult<T> > getItems(const QString& word, bool alsoFromSubNodes = false, int maxNbResult = -1) const;
 
       /**
-        * Does the node have some children?
+        * Return the number of items 'getItems(word, alsoFromSubNodes)' would return without building them.
         */
-      bool haveChildren() const;
+      int count(const QString& word, bool alsoFromSubNodes = false) const;
 
       /**
-        * Add an item to the node.
-        * If the item already exists (using operator==) nothing is added.
+        * Same as 'getItems(..)' but the items indexed by 'word' exactly are put in 'exactItems' and the others in 'otherItems', in no particular order.
         */
-      void addItem(T* item);
+      void getItems(const QString& word, bool alsoFromSubNodes, QVector<T>& exactItems, QVector<T>& otherItems) const;
 
-      /**
-        * Remove the item from the node.
-        * If the item doesn'exist nothing happen.
-        */
-      void rmItem(T* item);
-
-      /**
-        * Return all items from the current node and its sub nodes (recursively) if 'alsoFromSubNodes' is true.
-        * For all direct sub nodes NodeResult::level is set to 0, for other sub nodes level is set to 1.
-        */
-      QList< NodeResult<T> > getItems(bool alsoFromSubNodes = false, int maxNbResult = -1) const;
+   private:
+      struct Child
+      {
+         QChar letter; ///< The first letter of the label of 'node'.
+         Node<T>* node;
+      };
 
-      /**
-        * Does the node own some items?
-        */
-      bool haveItems() const;
+      Node(const QString& label);
 
-   private:
-      Node(const QChar& letter);
+      int indexOf(const QChar& letter) const;
+      void insertChild(Node<T>* node);
+      void split(int position);
+      void mergeWithChild();
+      int commonPrefixLength(const QStringRef& word, int position) const;
+      const Node<T>* find(const QString& word, bool& exactMatch) const;
 
-      const QChar letter; ///< The letter from an indexed word.
+      QString label; ///< The letters from the parent to this node, empty for the root.
 
-      QList<Node<T>*> children; ///< The children nodes.
-      QList<T*> items; ///< The indexed items.
+      QVector<Child> children; ///< Sorted by letter.
+      QVector<T> items; ///< The indexed items.
+      int nbItems; ///< The number of items of this node and of all its sub nodes.
    };
 
    template <typename T>
@@ -142,93 +130,139 @@ namespace FM
    template <typename T>
    inline uint qHash(const NodeResult<T>& r)
    {
-      // TODO: if sizeof(void*) != sizeof(T) it can be a bit dangerous.
-      return (uint)(intptr_t)r.value;
+      return qHash(r.value);
    }
 }
 
-/***** Definition *****/
+/***** Definitions *****/
 using namespace FM;
 
 template <typename T>
 Node<T>::Node() :
-   letter('\0')
+   nbItems(0)
 {
 }
 
 template <typename T>
 Node<T>::~Node()
 {
-   for (QListIterator<Node<T>*>i(this->children); i.hasNext();)
-      delete i.next();
+   for (int i = 0; i < this->children.size(); i++)
+      delete this->children[i].node;
 }
 
 template <typename T>
-Node<T>& Node<T>::addNode(const QChar& letter)
+void Node<T>::addItem(const QStringRef& word, T item)
 {
-   // Search if the letter already exists.
-   for (int i = 0; i < this->children.size(); i++)
+   Node<T>* current = this;
+   current->nbItems++;
+
+   int position = 0;
+   while (position < word.size())
    {
-      if (this->children[i]->letter == letter)
-         return *this->children[i];
+      const int i = current->indexOf(word.at(position));
+      if (i == -1)
+      {
+         Node<T>* leaf = new Node<T>(QString(word.constData() + position, word.size() - position));
+         current->insertChild(leaf);
+         current = leaf;
+         current->nbItems++;
+         break;
+      }
+
+      Node<T>* child = current->children[i].node;
+      const int length = child->commonPrefixLength(word, position);
+      if (length < child->label.size())
+         child->split(length);
+
+      current = child;
+      current->nbItems++;
+      position += length;
    }
-   Node<T>* n = new Node(letter);
-   this->children.append(n);
-   return *n;
-}
 
-template <typename T>
-void Node<T>::rmNode(Node<T>* const node)
-{
-   this->children.removeOne(node);
+   current->items << item;
 }
 
 template <typename T>
-Node<T>* Node<T>::getNode(const QChar& letter) const
+void Node<T>::rmItem(const QStringRef& word, T item)
 {
-   for (QListIterator<Node<T>*>i(this->children); i.hasNext();)
+   QVector<Node<T>*> path; // From the root to the node indexing 'word'.
+   Node<T>* current = this;
+   path << current;
+
+   int position = 0;
+   while (position < word.size())
    {
-      Node<T>* node = i.next();
-      if (node->letter == letter)
-         return node;
+      const int i = current->indexOf(word.at(position));
+      if (i == -1)
+         return;
+
+      current = current->children[i].node;
+      const int length = current->commonPrefixLength(word, position);
+      if (length < current->label.size())
+         return;
+
+      path << current;
+      position += length;
    }
-   return 0;
-}
 
-template <typename T>
-bool Node<T>::haveChildren() const
-{
-   return !this->children.empty();
-}
+   int nbRemoved = 0;
+   for (int i = current->items.size() - 1; i >= 0; i--)
+      if (current->items[i] == item)
+      {
+         current->items.remove(i);
+         nbRemoved++;
+      }
 
-template <typename T>
-void Node<T>::addItem(T* item)
-{
-   this->items << item;
-}
+   if (nbRemoved == 0)
+      return;
 
-template <typename T>
-void Node<T>::rmItem(T* item)
-{
-   this->items.removeAll(item);
+   for (int i = 0; i < path.size(); i++)
+      path[i]->nbItems -= nbRemoved;
+
+   // Remove the nodes without item and child then merge the last one with its child if it's the only one.
+   int n = path.size() - 1;
+   while (n > 0 && path[n]->nbItems == 0)
+   {
+      Node<T>* parent = path[n - 1];
+      parent->children.remove(parent->indexOf(path[n]->label[0]));
+      delete path[n];
+      n--;
+   }
+
+   if (n > 0)
+      path[n]->mergeWithChild();
 }
 
 template <typename T>
-QList< NodeResult<T> > Node<T>::getItems(bool alsoFromSubNodes, int maxNbResult) const
+QList< NodeResult<T> > Node<T>::getItems(const QString& word, bool alsoFromSubNodes, int maxNbResult) const
 {
    QList< NodeResult<T> > result;
-   QList<Node<T>*> nodesToVisit;
 
-   nodesToVisit.append(const_cast<Node<T>*>(this));
+   bool exactMatch;
+   const Node<T>* node = this->find(word, exactMatch);
+   if (!node || !exactMatch && !alsoFromSubNodes)
+      return result;
 
-   while (!nodesToVisit.empty())
-   {
-      const Node<T>* current = nodesToVisit.takeFirst();
+   const int nbResult = alsoFromSubNodes ? node->nbItems : node->items.size();
+   result.reserve(maxNbResult == -1 ? nbResult : qMin(maxNbResult, nbResult));
+
+   // Best-first : the nodes are visited by the length of their word, the shortest being the nearest from 'word'.
+   QMap<int, QList<const Node<T>*> > nodesToVisit; // Length of the word -> nodes.
+   nodesToVisit[0] << node;
 
-      for (QListIterator<T*> i(current->items); i.hasNext();)
+   while (!nodesToVisit.isEmpty())
+   {
+      typename QMap<int, QList<const Node<T>*> >::iterator first = nodesToVisit.begin();
+      const int length = first.key();
+      const Node<T>* current = first.value().takeFirst();
+      if (first.value().isEmpty())
+         nodesToVisit.erase(first);
+
+      // 'level' == 0 means the item matches exactly, it's a bit tricky..
+      const int level = exactMatch && current == node ? 0 : 1;
+      for (int i = 0; i < current->items.size(); i++)
       {
-         // 'level' == 0 means the item matches exactly, it's a bit tricky..
-         result << NodeResult<T>(i.next(), current == this ? 0 : 1);
+         result << NodeResult<T>(current->items[i], level);
          if (result.size() == maxNbResult)
             return result;
       }
@@ -236,21 +270,178 @@ QList< NodeResult<T> > Node<T>::getItems(bool alsoFromSubNodes, int maxNbResult)
       if (!alsoFromSubNodes)
          break;
 
-      nodesToVisit.append(current->children);
+      for (int i = 0; i < current->children.size(); i++)
+      {
+         const Node<T>* child = current->children[i].node;
+         nodesToVisit[length + child->label.size()] << child;
+      }
    }
 
    return result;
 }
 
 template <typename T>
-bool Node<T>::haveItems() const
+void Node<T>::getItems(const QString& word, bool alsoFromSubNodes, QVector<T>& exactItems, QVector<T>& otherItems) const
+{
+   bool exactMatch;
+   const Node<T>* node = this->find(word, exactMatch);
+   if (!node)
+      return;
+
+   if (exactMatch)
+      exactItems += node->items;
+   else if (alsoFromSubNodes)
+      otherItems += node->items;
+
+   if (!alsoFromSubNodes)
+      return;
+
+   otherItems.reserve(otherItems.size() + node->nbItems - node->items.size());
+   QVector<const Node<T>*> nodesToVisit;
+   for (int i = 0; i < node->children.size(); i++)
+      nodesToVisit << node->children[i].node;
+
+   while (!nodesToVisit.isEmpty())
+   {
+      const Node<T>* current = nodesToVisit.last();
+      nodesToVisit.pop_back();
+      otherItems += current->items;
+      for (int i = 0; i < current->children.size(); i++)
+         nodesToVisit << current->children[i].node;
+   }
+}
+
+template <typename T>
+int Node<T>::count(const QString& word, bool alsoFromSubNodes) const
 {
-   return !this->items.empty();
+   bool exactMatch;
+   const Node<T>* node = this->find(word, exactMatch);
+   if (!node)
+      return 0;
+
+   if (alsoFromSubNodes)
+      return node->nbItems;
+
+   return exactMatch ? node->items.size() : 0;
 }
 
 template <typename T>
-Node<T>::Node(const QChar& letter) :
-   letter(letter)
+Node<T>::Node(const QString& label) :
+   label(label), nbItems(0)
 {}
 
+/**
+  * Binary search of the child beginning with the given letter.
+  * @return -1 if there is no such child.
+  */
+template <typename T>
+int Node<T>::indexOf(const QChar& letter) const
+{
+   int begin = 0;
+   int end = this->children.size();
+   while (begin < end)
+   {
+      const int middle = (begin + end) / 2;
+      const QChar& middleLetter = this->children[middle].letter;
+      if (middleLetter == letter)
+         return middle;
+      else if (middleLetter < letter)
+         begin = middle + 1;
+      else
+         end = middle;
+   }
+   return -1;
+}
+
+template <typename T>
+void Node<T>::insertChild(Node<T>* node)
+{
+   Child child;
+   child.letter = node->label[0];
+   child.node = node;
+
+   int i = 0;
+   while (i < this->children.size() && this->children[i].letter < child.letter)
+      i++;
+   this->children.insert(i, child);
+}
+
+/**
+  * The node keeps the first 'position' letters of its label, the others go in a new child which takes all the children and the items.
+  */
+template <typename T>
+void Node<T>::split(int position)
+{
+   Node<T>* tail = new Node<T>(this->label.mid(position));
+   tail->children = this->children;
+   tail->items = this->items;
+   tail->nbItems = this->nbItems;
+
+   this->children.clear();
+   this->items.clear();
+   this->label.truncate(position);
+   this->insertChild(tail);
+}
+
+/**
+  * If the node has no item and only one child they are merged together.
+  */
+template <typename T>
+void Node<T>::mergeWithChild()
+{
+   if (!this->items.isEmpty() || this->children.size() != 1)
+      return;
+
+   Node<T>* child = this->children[0].node;
+   this->label.append(child->label);
+   this->children = child->children;
+   this->items = child->items;
+
+   child->children.clear();
+   delete child;
+}
+
+/**
+  * Return the number of letters of the label equal to the letters of 'word' from 'position'.
+  */
+template <typename T>
+int Node<T>::commonPrefixLength(const QStringRef& word, int position) const
+{
+   int length = 0;
+   while (length < this->label.size() && position + length < word.size() && this->label[length] == word.at(position + length))
+      length++;
+   return length;
+}
+
+/**
+  * Return the node indexing 'word' or the node whose label contains the end of 'word' (in this case 'exactMatch' is set to false).
+  * Return 0 if no word begins by 'word'.
+  */
+template <typename T>
+const Node<T>* Node<T>::find(const QString& word, bool& exactMatch) const
+{
+   const Node<T>* current = this;
+   exactMatch = true;
+
+   int position = 0;
+   while (position < word.size())
+   {
+      const int i = current->indexOf(word[position]);
+      if (i == -1)
+         return 0;
+
+      current = current->children[i].node;
+      const int length = current->commonPrefixLength(QStringRef(&word), position);
+      position += length;
+      if (length < current->label.size())
+      {
+         if (position < word.size())
+            return 0;
+         exactMatch = false; // 'word' ends inside the label of 'current'.
+      }
+   }
+
+   return current;
+}
+
 #endif
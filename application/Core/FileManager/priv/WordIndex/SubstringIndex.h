@@ -0,0 +1,314 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef FILEMANAGER_SUBSTRINGINDEX_H
+#define FILEMANAGER_SUBSTRINGINDEX_H
+
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QReadWriteLock>
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+#include <Common/Uncopyable.h>
+#include <Common/Global.h>
+
+#include <priv/WordIndex/ItemFilter.h>
+
+namespace FM
+{
+   /**
+     * An index of the trigrams of some names to find the items whose name contains some strings, for example "remaster" in "TheRemastered_Edition".
+     * The names are given as the words of 'Common::Global::splitInWords(..)', the trigrams are taken inside each word.
+     * The trigrams of a term only give some candidates, each candidate is verified against its name.
+     *
+     * The memory taken by the index is bounded : if it's exceeded the index is cleared and disabled, see 'isEnabled()'.
+     * A search only waits for the modification of one name.
+     */
+   template<typename T>
+   class SubstringIndex : Common::Uncopyable
+   {
+      static const int TRIGRAM_SIZE;
+      static const int ITEM_MEMORY; ///< The memory taken by an item without its name [byte], approximate.
+      static const int TRIGRAM_MEMORY; ///< The memory taken by a trigram without its items [byte], approximate.
+
+   public:
+      SubstringIndex(qint64 maxMemory);
+
+      bool isEnabled() const;
+      qint64 getMemoryUsed() const;
+
+      void addItem(const QVector<QStringRef>& words, T* item);
+      void addItem(const QStringList& words, T* item);
+      void rmItem(T* item);
+      QList<T*> search(const QStringList& terms, int maxNbResult = -1, const ItemFilter<T>* filter = 0) const;
+
+   private:
+      typedef quint64 Trigram;
+      static QList<Trigram> getTrigrams(const QStringRef& word);
+      static QList<Trigram> getTrigrams(const QVector<QStringRef>& words);
+      void clear();
+
+      struct Item
+      {
+         Item() : item(0) {}
+         T* item; ///< 0 if the identifier is free.
+         QString name; ///< The words separated by a space.
+      };
+
+      QVector<Item> items; ///< The items by their identifier.
+      QVector<quint32> freeIds;
+      QHash<T*, quint32> ids;
+      QHash<Trigram, QVector<quint32> > trigrams; ///< The sorted identifiers of the items containing each trigram.
+
+      const qint64 maxMemory; ///< [byte].
+      qint64 memoryUsed; ///< [byte].
+      bool enabled;
+
+      mutable QReadWriteLock lock;
+   };
+}
+
+/***** Definitions *****/
+using namespace FM;
+
+template<typename T>
+const int SubstringIndex<T>::TRIGRAM_SIZE(3);
+
+template<typename T>
+const int SubstringIndex<T>::ITEM_MEMORY(64);
+
+template<typename T>
+const int SubstringIndex<T>::TRIGRAM_MEMORY(64);
+
+/**
+  * @param maxMemory 0 to disable the index.
+  */
+template<typename T>
+SubstringIndex<T>::SubstringIndex(qint64 maxMemory) :
+   maxMemory(maxMemory), memoryUsed(0), enabled(maxMemory > 0)
+{
+}
+
+template<typename T>
+bool SubstringIndex<T>::isEnabled() const
+{
+   QReadLocker locker(&this->lock);
+   return this->enabled;
+}
+
+template<typename T>
+qint64 SubstringIndex<T>::getMemoryUsed() const
+{
+   QReadLocker locker(&this->lock);
+   return this->memoryUsed;
+}
+
+/**
+  * If the item is already indexed its name is replaced.
+  * The words can reference a buffer reused by the caller, see 'Common::Global::splitInWords(const QString&, QString&, QVector<QStringRef>&)'.
+  */
+template<typename T>
+void SubstringIndex<T>::addItem(const QVector<QStringRef>& words, T* item)
+{
+   this->rmItem(item);
+
+   QWriteLocker locker(&this->lock);
+   if (!this->enabled)
+      return;
+
+   quint32 id;
+   if (!this->freeIds.isEmpty())
+   {
+      id = this->freeIds.last();
+      this->freeIds.pop_back();
+   }
+   else
+   {
+      id = this->items.size();
+      this->items.resize(id + 1);
+   }
+
+   this->items[id].item = item;
+   for (int i = 0; i < words.size(); i++)
+   {
+      if (i != 0)
+         this->items[id].name.append(' ');
+      this->items[id].name.append(words[i]);
+   }
+   this->ids.insert(item, id);
+   this->memoryUsed += ITEM_MEMORY + this->items[id].name.size() * sizeof(QChar);
+
+   foreach (Trigram trigram, getTrigrams(words))
+   {
+      typename QHash<Trigram, QVector<quint32> >::iterator i = this->trigrams.find(trigram);
+      if (i == this->trigrams.end())
+      {
+         i = this->trigrams.insert(trigram, QVector<quint32>());
+         this->memoryUsed += TRIGRAM_MEMORY;
+      }
+      i.value().insert(qLowerBound(i.value().begin(), i.value().end(), id), id);
+      this->memoryUsed += sizeof(quint32);
+   }
+
+   if (this->memoryUsed > this->maxMemory)
+   {
+      this->clear();
+      this->enabled = false;
+   }
+}
+
+template<typename T>
+void SubstringIndex<T>::addItem(const QStringList& words, T* item)
+{
+   this->addItem(Common::Global::toStringRefs(words), item);
+}
+
+/**
+  * Do nothing if the item isn't indexed.
+  */
+template<typename T>
+void SubstringIndex<T>::rmItem(T* item)
+{
+   QWriteLocker locker(&this->lock);
+
+   typename QHash<T*, quint32>::iterator i = this->ids.find(item);
+   if (i == this->ids.end())
+      return;
+
+   const quint32 id = i.value();
+   this->ids.erase(i);
+
+   const QStringList words = this->items[id].name.split(' ');
+   foreach (Trigram trigram, getTrigrams(Common::Global::toStringRefs(words)))
+   {
+      typename QHash<Trigram, QVector<quint32> >::iterator j = this->trigrams.find(trigram);
+      if (j == this->trigrams.end())
+         continue;
+
+      QVector<quint32>::iterator k = qBinaryFind(j.value().begin(), j.value().end(), id);
+      if (k != j.value().end())
+      {
+         j.value().erase(k);
+         this->memoryUsed -= sizeof(quint32);
+      }
+
+      if (j.value().isEmpty())
+      {
+         this->trigrams.erase(j);
+         this->memoryUsed -= TRIGRAM_MEMORY;
+      }
+   }
+
+   this->memoryUsed -= ITEM_MEMORY + this->items[id].name.size() * sizeof(QChar);
+   this->items[id] = Item();
+   this->freeIds << id;
+}
+
+/**
+  * Return the items whose name contains all the terms. The terms shorter than a trigram are only used to verify the candidates,
+  * if all the terms are shorter than a trigram nothing is returned.
+  * @param filter If given, only the items matching it are returned.
+  */
+template<typename T>
+QList<T*> SubstringIndex<T>::search(const QStringList& terms, int maxNbResult, const ItemFilter<T>* filter) const
+{
+   QList<T*> result;
+
+   QReadLocker locker(&this->lock);
+
+   // The items of each trigram of the terms, the shortest list first.
+   QList<const QVector<quint32>*> itemsByTrigram;
+   foreach (Trigram trigram, getTrigrams(Common::Global::toStringRefs(terms)))
+   {
+      typename QHash<Trigram, QVector<quint32> >::const_iterator i = this->trigrams.find(trigram);
+      if (i == this->trigrams.end())
+         return result;
+
+      int position = 0;
+      while (position < itemsByTrigram.size() && itemsByTrigram[position]->size() < i.value().size())
+         position++;
+      itemsByTrigram.insert(position, &i.value());
+   }
+
+   if (itemsByTrigram.isEmpty())
+      return result;
+
+   // Each candidate of the shortest list must be in all the others.
+   const QVector<quint32>& candidates = *itemsByTrigram.first();
+   for (int i = 0; i < candidates.size() && result.size() != maxNbResult; i++)
+   {
+      bool isCandidate = true;
+      for (int j = 1; j < itemsByTrigram.size() && isCandidate; j++)
+         isCandidate = qBinaryFind(itemsByTrigram[j]->begin(), itemsByTrigram[j]->end(), candidates[i]) != itemsByTrigram[j]->end();
+
+      const Item& item = this->items[candidates[i]];
+      for (QListIterator<QString> j(terms); j.hasNext() && isCandidate;)
+         isCandidate = item.name.contains(j.next());
+
+      if (isCandidate && (!filter || filter->match(item.item)))
+         result << item.item;
+   }
+
+   return result;
+}
+
+template<typename T>
+QList<typename SubstringIndex<T>::Trigram> SubstringIndex<T>::getTrigrams(const QStringRef& word)
+{
+   QList<Trigram> result;
+   for (int i = 0; i + TRIGRAM_SIZE <= word.size(); i++)
+   {
+      Trigram trigram = 0;
+      for (int j = 0; j < TRIGRAM_SIZE; j++)
+         trigram = trigram << 16 | word.at(i + j).unicode();
+      result << trigram;
+   }
+   return result;
+}
+
+/**
+  * Return the trigrams of all the words without duplicate.
+  */
+template<typename T>
+QList<typename SubstringIndex<T>::Trigram> SubstringIndex<T>::getTrigrams(const QVector<QStringRef>& words)
+{
+   QList<Trigram> result;
+   for (int i = 0; i < words.size(); i++)
+      result << getTrigrams(words[i]);
+
+   qSort(result);
+   result.erase(std::unique(result.begin(), result.end()), result.end());
+   return result;
+}
+
+template<typename T>
+void SubstringIndex<T>::clear()
+{
+   this->items.clear();
+   this->freeIds.clear();
+   this->ids.clear();
+   this->trigrams.clear();
+   this->memoryUsed = 0;
+}
+
+#endif
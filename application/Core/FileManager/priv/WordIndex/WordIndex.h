@@ -20,34 +20,70 @@
 #define FILEMANAGER_WORDINDEX_H
 
 #include <QList>
+#include <QVector>
+#include <QSet>
 #include <QString>
 #include <QChar>
 #include <QMutex>
+#include <QAtomicInt>
+#include <QThread>
 
 #include <Common/Uncopyable.h>
+#include <Common/Global.h>
 
 #include <priv/WordIndex/Node.h>
+#include <priv/WordIndex/ItemFilter.h>
+#include <priv/WordIndex/Bitmap.h>
 
 namespace FM
 {
    /**
      * An collection of T indexed by word.
+     * A search never waits for a modification : the index is kept twice (left-right). The readers use one copy while
+     * the writer modifies the other one, then the roles are swapped and the modification is applied to the second copy
+     * once the readers have left it. The writers are serialized.
+     *
+     * Each item is given a dense identifier when it's added, the nodes only store these identifiers. They are stored by the
+     * items themselves, T must have the methods 'quint32 getWordIndexId() const' and 'void setWordIndexId(quint32)'.
+     * An item must be removed with the words it has been added with.
      */
    template<typename T>
    class WordIndex : Common::Uncopyable
    {
       static const int MIN_WORD_SIZE_PARTIAL_MATCH; ///< During a search, the words which have a size below this value must match entirely, for exemple 'of' match "conspiracy of one" and not "offspring".
+      static const int ITEM_BLOCK_SIZE; ///< The number of items of each block of 'items'.
+      static const int MAX_NB_ITEM_BLOCKS;
+
    public:
       WordIndex();
+      ~WordIndex();
 
+      void addItem(const QVector<QStringRef>& words, T* item);
       void addItem(const QStringList& words, T* item);
+      void rmItem(const QVector<QStringRef>& words, T* item);
       void rmItem(const QStringList& words, T* item);
-      QList< NodeResult<T> > search(const QStringList& words, int maxNbResultPerWord = -1) const;
-      QList< NodeResult<T> > search(const QString& word, int maxNbResult = -1) const;
+      QList< NodeResult<T*> > search(const QString& word, int maxNbResult = -1) const;
+      QList< NodeResult<T*> > search(const QStringList& terms, int maxNbResult = -1, const ItemFilter<T>* filter = 0) const;
 
    private:
-      Node<T> node;
-      mutable QMutex mutex;
+      int beginRead() const;
+      void endRead(int i) const;
+      void waitForReaders(int i) const;
+
+      T* getItem(quint32 id) const;
+      void filterIds(QVector<quint32>& ids, const ItemFilter<T>* filter) const;
+      quint32 newId(T* item);
+      void releaseId(quint32 id);
+
+      Node<quint32> nodes[2];
+      mutable QAtomicInt readIndex; ///< The copy used by the readers, 0 or 1.
+      mutable QAtomicInt nbReaders[2]; ///< The number of readers for each copy.
+      QMutex mutex; ///< Only taken by the writers.
+
+      // The items by their identifier. The blocks are never moved thus a reader can access them while a writer adds a new one.
+      T*** items;
+      quint32 nbIds; ///< The next identifier never given.
+      QVector<quint32> freeIds; ///< The identifiers released by 'rmItem(..)', reused first.
    };
 }
 
@@ -58,93 +94,335 @@ template<typename T>
 const int WordIndex<T>::MIN_WORD_SIZE_PARTIAL_MATCH(3);
 
 template<typename T>
-WordIndex<T>::WordIndex()
-{}
+const int WordIndex<T>::ITEM_BLOCK_SIZE(65536);
 
 template<typename T>
-void WordIndex<T>::addItem(const QStringList& words, T* item)
+const int WordIndex<T>::MAX_NB_ITEM_BLOCKS(4096); // 2^28 items.
+
+template<typename T>
+WordIndex<T>::WordIndex() :
+   items(new T**[MAX_NB_ITEM_BLOCKS]), nbIds(1) // 0 is reserved for the items which aren't indexed.
+{
+   for (int i = 0; i < MAX_NB_ITEM_BLOCKS; i++)
+      this->items[i] = 0;
+}
+
+template<typename T>
+WordIndex<T>::~WordIndex()
+{
+   for (int i = 0; i < MAX_NB_ITEM_BLOCKS; i++)
+      delete[] this->items[i];
+   delete[] this->items;
+}
+
+/**
+  * The words can reference a buffer reused by the caller, see 'Common::Global::splitInWords(const QString&, QString&, QVector<QStringRef>&)'.
+  */
+template<typename T>
+void WordIndex<T>::addItem(const QVector<QStringRef>& words, T* item)
 {
-   QMutexLocker locker(&mutex);
+   QMutexLocker locker(&this->mutex);
 
-   for (QListIterator<QString> i(words); i.hasNext();)
+   quint32 id = item->getWordIndexId();
+   if (id == 0)
    {
-      const QString& word = i.next();
-      Node<T>* currentNode = &this->node;
-      for (int j = 0; j < word.size(); j++)
-         currentNode = &currentNode->addNode(word[j]);
-      currentNode->addItem(item);
+      id = this->newId(item);
+      if (id == 0)
+         return;
+      item->setWordIndexId(id);
    }
+
+   // No reader can enter the other copy : they check 'readIndex' after being registered.
+   const int other = 1 - this->readIndex;
+   for (int i = 0; i < words.size(); i++)
+      this->nodes[other].addItem(words[i], id);
+
+   this->readIndex.fetchAndStoreOrdered(other);
+   this->waitForReaders(1 - other);
+
+   for (int i = 0; i < words.size(); i++)
+      this->nodes[1 - other].addItem(words[i], id);
+}
+
+template<typename T>
+void WordIndex<T>::addItem(const QStringList& words, T* item)
+{
+   this->addItem(Common::Global::toStringRefs(words), item);
+}
+
+template<typename T>
+void WordIndex<T>::rmItem(const QVector<QStringRef>& words, T* item)
+{
+   QMutexLocker locker(&this->mutex);
+
+   const quint32 id = item->getWordIndexId();
+   if (id == 0)
+      return;
+
+   const int other = 1 - this->readIndex;
+   for (int i = 0; i < words.size(); i++)
+      this->nodes[other].rmItem(words[i], id);
+
+   this->readIndex.fetchAndStoreOrdered(other);
+   this->waitForReaders(1 - other);
+
+   for (int i = 0; i < words.size(); i++)
+      this->nodes[1 - other].rmItem(words[i], id);
+
+   // No reader can find the identifier anymore.
+   item->setWordIndexId(0);
+   this->releaseId(id);
 }
 
 template<typename T>
 void WordIndex<T>::rmItem(const QStringList& words, T* item)
 {
-   QMutexLocker locker(&mutex);
+   this->rmItem(Common::Global::toStringRefs(words), item);
+}
+
+/**
+  * Return the items indexed by 'word', the same item can be returned more than once. See 'Node::getItems(..)'.
+  */
+template<typename T>
+QList< NodeResult<T*> > WordIndex<T>::search(const QString& word, int maxNbResult) const
+{
+   const int r = this->beginRead();
+
+   const QList< NodeResult<quint32> > nodeResults = this->nodes[r].getItems(word, word.size() >= MIN_WORD_SIZE_PARTIAL_MATCH, maxNbResult);
+   QList< NodeResult<T*> > result;
+   result.reserve(nodeResults.size());
+   for (int i = 0; i < nodeResults.size(); i++)
+      result << NodeResult<T*>(this->getItem(nodeResults[i].value), nodeResults[i].level);
 
-   for (QListIterator<QString> i(words); i.hasNext();)
+   this->endRead(r);
+   return result;
+}
+
+/**
+  * Return the items matching at least one term, the best first. Each item is returned once.
+  * The items matching the most terms come first, for the same number of terms matched the exact matches come first.
+  * @see http://dev.euphorik.ch/wiki/pmp/Algorithms#Word-indexing for more information.
+  *
+  * For example with [a, b, c] the groups of terms are :
+  *  * a & b & c
+  *  * (a & b) \ c
+  *    (a & c) \ b
+  *    (b & c) \ a
+  *  * a \ b \ c
+  * The level of an item is given by its group, its combination of terms in the group and the number of terms it matches partially.
+  * A group is computed only if the previous ones don't contain 'maxNbResult' items.
+  *
+  * @param filter If given, the items not matching it are removed from the items of each term, before they are combined.
+  * They don't take a place among the 'maxNbResult' items and don't change the level of the other ones.
+  */
+template<typename T>
+QList< NodeResult<T*> > WordIndex<T>::search(const QStringList& terms, int maxNbResult, const ItemFilter<T>* filter) const
+{
+   QList< NodeResult<T*> > result;
+   const int n = terms.size();
+   if (n == 0)
+      return result;
+
+   const int r = this->beginRead();
+
+   if (n == 1)
    {
-      const QString& word = i.next();
-      QList<Node<T>*> nodes;
-      Node<T>* currentNode = &this->node;
-      nodes.prepend(currentNode);
-      for (int j = 0; j < word.size(); j++)
+      // An item can be indexed by more than one word beginning by the term, the exact match is returned first.
+      // The duplicates are removed, some more items are asked if needed.
+      const bool alsoFromSubNodes = terms.first().size() >= MIN_WORD_SIZE_PARTIAL_MATCH;
+      int limit = maxNbResult;
+      forever
       {
-         if (!(currentNode = currentNode->getNode(word[j])))
-            goto nextWord;
-         nodes.prepend(currentNode);
+         const QList< NodeResult<quint32> > nodeResults = this->nodes[r].getItems(terms.first(), alsoFromSubNodes, limit);
+         QSet<quint32> ids;
+         for (int i = 0; i < nodeResults.size() && result.size() != maxNbResult; i++)
+            if (!ids.contains(nodeResults[i].value))
+            {
+               ids.insert(nodeResults[i].value);
+               T* item = this->getItem(nodeResults[i].value);
+               if (!filter || filter->match(item))
+                  result << NodeResult<T*>(item, nodeResults[i].level);
+            }
+
+         if (result.size() == maxNbResult || nodeResults.size() < limit || maxNbResult == -1)
+            break;
+
+         // The proportion of items rejected by a filter is unknown, the limit is doubled to avoid too many traversals.
+         limit += filter ? limit : maxNbResult - result.size();
+         result.clear();
+      }
+
+      this->endRead(r);
+      return result;
+   }
+
+   // The items matching each term : exactly and exactly or partially.
+   QVector<Bitmap> exact(n);
+   QVector<Bitmap> all(n);
+   for (int i = 0; i < n; i++)
+   {
+      QVector<quint32> exactIds;
+      QVector<quint32> otherIds;
+      this->nodes[r].getItems(terms[i], terms[i].size() >= MIN_WORD_SIZE_PARTIAL_MATCH, exactIds, otherIds);
+      if (filter)
+      {
+         this->filterIds(exactIds, filter);
+         this->filterIds(otherIds, filter);
       }
+      exact[i] = Bitmap(exactIds);
+      all[i] = Bitmap(otherIds);
+      all[i] |= exact[i];
+   }
 
-      currentNode->rmItem(item);
+   int level = 0;
+   // For each group of intersection number.
+   for (int nbIntersect = n; nbIntersect > 0 && result.size() != maxNbResult; nbIntersect--)
+   {
+      int intersect[nbIntersect]; // The terms of the current combination.
+      for (int j = 0; j < nbIntersect; j++)
+         intersect[j] = j;
 
-      if (!currentNode->haveChildren())
+      // For each combination of the current group the items by the number of terms they match partially.
+      const int nCombinations = Common::Global::nCombinations(n, nbIntersect);
+      QVector< QVector<Bitmap> > combinations(nCombinations);
+      for (int j = 0; j < nCombinations; j++)
       {
-         Node<T>* nodeToRemove = 0;
-         for (QListIterator<Node<T>*> i(nodes); i.hasNext();)
+         Bitmap items = all[intersect[0]];
+         for (int k = 1; k < nbIntersect && !items.isEmpty(); k++)
+            items &= all[intersect[k]];
+
+         if (!items.isEmpty())
          {
-            Node<T>* n = i.next();
-            if (nodeToRemove)
+            // Apply subtracts.
+            for (int k = -1; k < nbIntersect; k++)
+               for (int l = (k == -1 ? 0 : intersect[k] + 1); l < (k == nbIntersect - 1 ? n : intersect[k+1]); l++)
+                  items -= all[l];
+
+            QVector<Bitmap>& byNbPartialMatches = combinations[j];
+            byNbPartialMatches.resize(nbIntersect + 1);
+            byNbPartialMatches[0] = items;
+            for (int k = 0; k < nbIntersect; k++)
+               for (int m = k; m >= 0; m--)
+               {
+                  Bitmap partial = byNbPartialMatches[m];
+                  partial -= exact[intersect[k]];
+                  if (!partial.isEmpty())
+                  {
+                     byNbPartialMatches[m] -= partial;
+                     byNbPartialMatches[m + 1] |= partial;
+                  }
+               }
+         }
+
+         // Define positions of each intersect term.
+         for (int k = nbIntersect - 1; k >= 0; k--)
+            if  (intersect[k] < n - nbIntersect + k)
             {
-               n->rmNode(nodeToRemove);
-               delete nodeToRemove;
+               intersect[k] += 1;
+               for (int l = k + 1; l < nbIntersect; l++)
+                  intersect[l] = intersect[k] + (l - k);
+               break;
             }
+      }
 
-            if (n->haveItems() || n->haveChildren())
-               break;
-            else
-               nodeToRemove = n;
+      // Populate the result by level : each term matched partially costs 'nCombinations'.
+      for (int m = 0; m <= nbIntersect && result.size() != maxNbResult; m++)
+         for (int j = 0; j < nCombinations && result.size() != maxNbResult; j++)
+         {
+            if (combinations[j].isEmpty())
+               continue;
+
+            const QVector<quint32> ids = combinations[j][m].values(maxNbResult == -1 ? -1 : maxNbResult - result.size());
+            for (int k = 0; k < ids.size(); k++)
+               result << NodeResult<T*>(this->getItem(ids[k]), level + j + m * nCombinations);
          }
-      }
 
-      nextWord :;
+      level += nCombinations + nCombinations * nbIntersect;
+   }
+
+   this->endRead(r);
+   return result;
+}
+
+/**
+  * Register a reader on the current copy and return its index, it must be given to 'endRead(..)'.
+  */
+template<typename T>
+int WordIndex<T>::beginRead() const
+{
+   forever
+   {
+      const int i = this->readIndex;
+      this->nbReaders[i].fetchAndAddOrdered(1);
+      if (this->readIndex == i)
+         return i;
+      this->nbReaders[i].fetchAndAddOrdered(-1); // The copies have been swapped meanwhile.
    }
 }
 
 template<typename T>
-QList< NodeResult<T> > WordIndex<T>::search(const QStringList& words, int maxNbResultPerWord) const
+void WordIndex<T>::endRead(int i) const
+{
+   this->nbReaders[i].fetchAndAddOrdered(-1);
+}
+
+template<typename T>
+void WordIndex<T>::waitForReaders(int i) const
+{
+   while (this->nbReaders[i] != 0)
+      QThread::yieldCurrentThread();
+}
+
+template<typename T>
+T* WordIndex<T>::getItem(quint32 id) const
 {
-   QMutexLocker locker(&mutex);
+   return this->items[id / ITEM_BLOCK_SIZE][id % ITEM_BLOCK_SIZE];
+}
 
-   QList< NodeResult<T> > result;
-   for (QListIterator<QString> i(words); i.hasNext();)
+/**
+  * Remove the identifiers of the items not matching the given filter, the order is kept.
+  */
+template<typename T>
+void WordIndex<T>::filterIds(QVector<quint32>& ids, const ItemFilter<T>* filter) const
+{
+   int n = 0;
+   for (int i = 0; i < ids.size(); i++)
+      if (filter->match(this->getItem(ids[i])))
+         ids[n++] = ids[i];
+   ids.resize(n);
+}
+
+/**
+  * Return 0 if there is no more identifier available.
+  */
+template<typename T>
+quint32 WordIndex<T>::newId(T* item)
+{
+   quint32 id;
+   if (!this->freeIds.isEmpty())
    {
-      const QString& word = i.next();
-      const Node<T>* currentNode = &this->node;
-      for (int j = 0; j < word.size(); j++)
-      {
-         if (!(currentNode = currentNode->getNode(word[j])))
-            goto nextWord;
-      }
+      id = this->freeIds.last();
+      this->freeIds.pop_back();
+   }
+   else
+   {
+      if (this->nbIds == static_cast<quint32>(ITEM_BLOCK_SIZE * MAX_NB_ITEM_BLOCKS))
+         return 0;
 
-      result << currentNode->getItems(word.size() >= MIN_WORD_SIZE_PARTIAL_MATCH, maxNbResultPerWord);
-      nextWord :;
+      id = this->nbIds++;
+      if (!this->items[id / ITEM_BLOCK_SIZE])
+         this->items[id / ITEM_BLOCK_SIZE] = new T*[ITEM_BLOCK_SIZE];
    }
-   return result;
+
+   this->items[id / ITEM_BLOCK_SIZE][id % ITEM_BLOCK_SIZE] = item;
+   return id;
 }
 
 template<typename T>
-QList< NodeResult<T> > WordIndex<T>::search(const QString& word, int maxNbResult) const
+void WordIndex<T>::releaseId(quint32 id)
 {
-   return this->search(QStringList() << word, maxNbResult);
+   this->items[id / ITEM_BLOCK_SIZE][id % ITEM_BLOCK_SIZE] = 0;
+   this->freeIds << id;
 }
 
 #endif
@@ -34,9 +34,10 @@ namespace NL
 
       /**
         * Begin a new search. This function can be called only ONE time.
+        * @param filter Sent with the words, the peers only return the entries matching it.
         * @return An associated tag. This tag will be repeated in the result, see the signal 'found'.
         */
-      virtual quint64 search(const QString& words) = 0;
+      virtual quint64 search(const QString& words, const Protos::Common::FindFilter& filter = Protos::Common::FindFilter()) = 0;
 
       /**
         * @return ms elapsed from the call to 'search'.
@@ -24,7 +24,11 @@ SOURCES += priv/UDPListener.cpp \
     ../../Protos/common.pb.cc \
     ../../Protos/core_protocol.pb.cc \
     priv/Log.cpp \
-    priv/Utils.cpp
+    priv/Utils.cpp \
+    priv/FindResultCache.cpp \
+    priv/FindRequestHandler.cpp \
+    priv/DatagramBatch.cpp \
+    priv/LatencyMeter.cpp
 HEADERS += ISearch.h \
     INetworkListener.h \
     IChat.h \
@@ -37,4 +41,8 @@ HEADERS += ISearch.h \
     ../../Protos/common.pb.h \
     ../../Protos/core_protocol.pb.h \
     priv/Log.h \
-    priv/Utils.h
+    priv/Utils.h \
+    priv/FindResultCache.h \
+    priv/FindRequestHandler.h \
+    priv/DatagramBatch.h \
+    priv/LatencyMeter.h
@@ -0,0 +1,291 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <Benchmarks.h>
+
+#include <QtDebug>
+#include <QTest>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QThread>
+#include <QAtomicInt>
+
+#include <Protos/core_protocol.pb.h>
+#include <Protos/core_settings.pb.h>
+
+#include <Common/LogManager/Builder.h>
+#include <Common/Network/MessageHeader.h>
+#include <Common/PersistentData.h>
+#include <Common/Constants.h>
+#include <Common/Global.h>
+#include <Common/Settings.h>
+#include <Core/FileManager/Builder.h>
+#include <Core/PeerManager/Builder.h>
+#include <Core/UploadManager/Builder.h>
+#include <Core/DownloadManager/Builder.h>
+
+#include <priv/DatagramBatch.h>
+#include <priv/UDPListener.h>
+
+const int NB_DATAGRAMS = 200000;
+const int DATAGRAM_SIZE = 200; // About the size of an IMAlive message.
+const int BURST_SIZE = 64; // The datagrams are sent by bursts small enough to fit in the receive buffer of the socket.
+const int BATCH_SIZE = 16; // The default value of the setting 'udp_batch_size'.
+const int WAIT_TIMEOUT = 1000; // [ms].
+
+const int NB_PEERS = 200;
+const quint32 IMALIVE_PERIOD = 200; // [ms].
+const int NB_STALLS = 10;
+const quint16 UNICAST_PORT = 59491; // Different from the default ports to not disturb a running core.
+const quint16 MULTICAST_PORT = 59490;
+
+/**
+  * Send the IMAlive messages of some peers to the given port of the loopback each 'IMALIVE_PERIOD'.
+  */
+class IMAliveSender : public QThread
+{
+public:
+   IMAliveSender(const QList<Common::Hash>& peerIDs, quint16 port) : peerIDs(peerIDs), port(port) {}
+
+   void stop()
+   {
+      this->toStop = 1;
+      this->wait();
+   }
+
+protected:
+   void run()
+   {
+      QList<QByteArray> datagrams;
+      foreach (Common::Hash peerID, this->peerIDs)
+      {
+         Protos::Core::IMAlive IMAliveMessage;
+         IMAliveMessage.set_version(NL::UDPListener::PROTOCOL_VERSION);
+         IMAliveMessage.set_port(UNICAST_PORT);
+         IMAliveMessage.set_nick("peer");
+         IMAliveMessage.set_amount(42);
+
+         QByteArray datagram;
+         datagram.resize(Common::MessageHeader::HEADER_SIZE + IMAliveMessage.ByteSize());
+         Common::MessageHeader::writeHeader(datagram.data(), Common::MessageHeader(Common::MessageHeader::CORE_IM_ALIVE, IMAliveMessage.ByteSize(), peerID));
+         IMAliveMessage.SerializeToArray(datagram.data() + Common::MessageHeader::HEADER_SIZE, IMAliveMessage.ByteSize());
+         datagrams << datagram;
+      }
+
+      QUdpSocket socket;
+      while (!this->toStop)
+      {
+         // Ten bursts per period to not overflow the receive buffer of the listener.
+         for (int i = 0; i < datagrams.size(); i++)
+         {
+            socket.writeDatagram(datagrams[i], QHostAddress::LocalHost, this->port);
+            if ((i + 1) % (datagrams.size() / 10 + 1) == 0)
+               QThread::msleep(IMALIVE_PERIOD / 10);
+         }
+      }
+   }
+
+private:
+   const QList<Common::Hash> peerIDs;
+   const quint16 port;
+   QAtomicInt toStop;
+};
+
+Benchmarks::Benchmarks() :
+   nbDeadPeers(0)
+{
+}
+
+void Benchmarks::peerDead()
+{
+   this->nbDeadPeers++;
+}
+
+void Benchmarks::initTestCase()
+{
+   LM::Builder::initMsgHandler();
+   qDebug() << "===== initTestCase() =====";
+
+   QVERIFY(this->sender.bind(QHostAddress::LocalHost, 0));
+   QVERIFY(this->receiver.bind(QHostAddress::LocalHost, 0));
+
+   try
+   {
+      Common::Global::setCurrentDirToTemp("NetworkListenerBenchmarks");
+   }
+   catch(Common::Global::UnableToSetTempDirException& e)
+   {
+      QFAIL(e.errorMessage.toAscii().constData());
+   }
+
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL); // Reset the stored cache.
+
+   SETTINGS.setFilename("core_settings_network_listener_benchmarks.txt");
+   SETTINGS.setSettingsMessage(new Protos::Core::Settings());
+   SETTINGS.set("peer_imalive_period", IMALIVE_PERIOD);
+   SETTINGS.set("multicast_port", static_cast<quint32>(MULTICAST_PORT));
+
+   this->fileManager = FM::Builder::newFileManager();
+   this->peerManager = PM::Builder::newPeerManager(this->fileManager);
+   this->uploadManager = UM::Builder::newUploadManager(this->peerManager);
+   this->downloadManager = DM::Builder::newDownloadManager(this->fileManager, this->peerManager);
+}
+
+/**
+  * Each datagram is sent with 'QUdpSocket::writeDatagram(..)' and received with 'QUdpSocket::readDatagram(..)'.
+  */
+void Benchmarks::loopbackDatagramsOneByOne()
+{
+   qDebug() << "===== loopbackDatagramsOneByOne() =====";
+
+   char datagram[DATAGRAM_SIZE] = {};
+   char buffer[65536];
+   QHostAddress peerAddress;
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbReceived = 0;
+   for (int nbSent = 0; nbSent < NB_DATAGRAMS;)
+   {
+      for (int i = 0; i < BURST_SIZE; i++, nbSent++)
+         QVERIFY(this->sender.writeDatagram(datagram, DATAGRAM_SIZE, QHostAddress::LocalHost, this->receiver.localPort()) == DATAGRAM_SIZE);
+
+      while (nbReceived < nbSent)
+      {
+         if (!this->receiver.hasPendingDatagrams())
+            QVERIFY(this->receiver.waitForReadyRead(WAIT_TIMEOUT));
+
+         while (this->receiver.hasPendingDatagrams())
+            if (this->receiver.readDatagram(buffer, sizeof buffer, &peerAddress) == DATAGRAM_SIZE)
+               nbReceived++;
+      }
+   }
+
+   this->printRate("One by one", nbReceived, timer.elapsed());
+   QCOMPARE(nbReceived, NB_DATAGRAMS);
+}
+
+/**
+  * The datagrams are sent and received with 'NL::DatagramBatch' like 'NL::UDPListener' does.
+  */
+void Benchmarks::loopbackDatagramsByBatch()
+{
+   qDebug() << "===== loopbackDatagramsByBatch() =====";
+
+   NL::DatagramBatch datagramsToSend(BATCH_SIZE, DATAGRAM_SIZE);
+   NL::DatagramBatch receivedDatagrams(BATCH_SIZE, 65536);
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbReceived = 0;
+   for (int nbSent = 0; nbSent < NB_DATAGRAMS;)
+   {
+      for (int i = 0; i < BURST_SIZE; i++)
+      {
+         memset(datagramsToSend.add(DATAGRAM_SIZE), 0, DATAGRAM_SIZE);
+         if (datagramsToSend.isFull())
+            nbSent += datagramsToSend.send(this->sender, QHostAddress::LocalHost, this->receiver.localPort());
+      }
+      nbSent += datagramsToSend.send(this->sender, QHostAddress::LocalHost, this->receiver.localPort());
+
+      while (nbReceived < nbSent)
+      {
+         if (!this->receiver.hasPendingDatagrams())
+            QVERIFY(this->receiver.waitForReadyRead(WAIT_TIMEOUT));
+
+         do
+         {
+            receivedDatagrams.receive(this->receiver);
+            for (int i = 0; i < receivedDatagrams.getNbDatagrams(); i++)
+               if (receivedDatagrams.getDatagramSize(i) == DATAGRAM_SIZE)
+                  nbReceived++;
+         } while (receivedDatagrams.isFull());
+      }
+   }
+
+   this->printRate(QString("By batch of %1").arg(BATCH_SIZE), nbReceived, timer.elapsed());
+   QCOMPARE(nbReceived, NB_DATAGRAMS);
+}
+
+/**
+  * Some peers send their IMAlive messages while the main thread is regularly blocked longer than the peer timeout.
+  * The datagrams are still read by the thread of the listener and the peers stay alive : none of them is considered dead, even for a moment.
+  * The delay between the reception of an IMAlive message and its processing by the peer manager is printed.
+  */
+void Benchmarks::IMAliveLatencyUnderLoad()
+{
+   qDebug() << "===== IMAliveLatencyUnderLoad() =====";
+
+   const int peerTimeout = static_cast<int>(SETTINGS.get<double>("peer_timeout_factor") * IMALIVE_PERIOD);
+   const int stallDuration = 2 * peerTimeout;
+
+   NL::UDPListener listener(this->fileManager, this->peerManager, this->uploadManager, this->downloadManager, UNICAST_PORT);
+
+   QList<Common::Hash> peerIDs;
+   for (int i = 0; i < NB_PEERS; i++)
+      peerIDs << Common::Hash::rand();
+
+   IMAliveSender peers(peerIDs, MULTICAST_PORT); // The multicast socket of the listener receives the unicast datagrams sent to its port.
+   peers.start();
+
+   QTest::qWait(2 * peerTimeout);
+   QCOMPARE(this->peerManager->getPeers().size(), NB_PEERS);
+
+   // A peer considered dead then alive again by its next IMAlive message wouldn't be seen by counting the alive peers.
+   this->nbDeadPeers = 0;
+   foreach (PM::IPeer* peer, this->peerManager->getPeers())
+      QVERIFY(connect(dynamic_cast<QObject*>(peer), SIGNAL(dead()), this, SLOT(peerDead())));
+
+   for (int i = 0; i < NB_STALLS; i++)
+   {
+      QElapsedTimer stall;
+      stall.start();
+      while (stall.elapsed() < stallDuration); // The main thread is busy.
+
+      QTest::qWait(IMALIVE_PERIOD);
+      QCOMPARE(this->peerManager->getPeers().size(), NB_PEERS);
+   }
+
+   QCOMPARE(this->nbDeadPeers, 0);
+
+   foreach (PM::IPeer* peer, this->peerManager->getPeers())
+      disconnect(dynamic_cast<QObject*>(peer), SIGNAL(dead()), this, SLOT(peerDead()));
+
+   peers.stop();
+
+   const NL::LatencyMeter& latency = listener.getIMAliveLatency();
+   qDebug() << QString("%1 IMAlive messages from %2 peers, main thread blocked %3 times during %4 ms : average latency : %5 ms, max latency : %6 ms")
+      .arg(latency.getNbMeasures())
+      .arg(NB_PEERS)
+      .arg(NB_STALLS)
+      .arg(stallDuration)
+      .arg(latency.getAverageLatency())
+      .arg(latency.getMaxLatency());
+}
+
+void Benchmarks::printRate(const QString& name, int nbDatagrams, qint64 elapsed)
+{
+   qDebug() << QString("%1 : %2 datagrams of %3 bytes in %4 ms : %5 datagrams/s")
+      .arg(name)
+      .arg(nbDatagrams)
+      .arg(DATAGRAM_SIZE)
+      .arg(elapsed)
+      .arg(elapsed == 0 ? 0 : 1000 * static_cast<qint64>(nbDatagrams) / elapsed);
+}
@@ -20,6 +20,12 @@ LIBS += -L../../FileManager/output/debug \
 LIBS += -L../../NetworkListener/output/debug \
    -lNetworkListener
 
+LIBS += -L../../DownloadManager/output/debug \
+   -lDownloadManager
+
+LIBS += -L../../UploadManager/output/debug \
+   -lUploadManager
+
 LIBS += -L../../PeerManager/output/debug \
    -lPeerManager
 
@@ -42,5 +48,7 @@ CONFIG += console
 CONFIG -= app_bundle
 TEMPLATE = app
 SOURCES += main.cpp \
-    Tests.cpp
-HEADERS += Tests.h
+    Tests.cpp \
+    Benchmarks.cpp
+HEADERS += Tests.h \
+    Benchmarks.h
@@ -0,0 +1,279 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/DatagramBatch.h>
+using namespace NL;
+
+#ifdef Q_OS_LINUX
+   #include <sys/types.h>
+   #include <sys/socket.h>
+   #include <netinet/in.h>
+   #include <net/if.h>
+   #include <errno.h>
+   #include <string.h>
+#endif
+
+#include <priv/Log.h>
+
+/**
+  * @class NL::DatagramBatch
+  *
+  * A ring of buffers to receive or to send several datagrams at once.
+  * On Linux the datagrams are received with a single 'recvmmsg' and sent with a single 'sendmmsg',
+  * on the other platforms they are read and written one by one with 'QUdpSocket'.
+  */
+
+#ifdef Q_OS_LINUX
+namespace
+{
+   /**
+     * An IPv4 address is mapped to an IPv6 address if the socket is an IPv6 one, like 'QUdpSocket::writeDatagram(..)' does.
+     * @return The size of the written address or 0 if the address can't be used with the socket.
+     */
+   socklen_t toSockAddress(const QHostAddress& address, quint16 port, bool IPv6Socket, sockaddr_storage& sockAddress)
+   {
+      memset(&sockAddress, 0, sizeof sockAddress);
+
+      if (IPv6Socket)
+      {
+         sockaddr_in6* sockAddressIPv6 = reinterpret_cast<sockaddr_in6*>(&sockAddress);
+         sockAddressIPv6->sin6_family = AF_INET6;
+         sockAddressIPv6->sin6_port = htons(port);
+
+         if (address.protocol() == QAbstractSocket::IPv6Protocol)
+         {
+            const Q_IPV6ADDR IPv6Address = address.toIPv6Address();
+            memcpy(&sockAddressIPv6->sin6_addr, &IPv6Address, sizeof IPv6Address);
+
+            bool ok;
+            sockAddressIPv6->sin6_scope_id = address.scopeId().toUInt(&ok);
+            if (!ok && !address.scopeId().isEmpty())
+               sockAddressIPv6->sin6_scope_id = ::if_nametoindex(address.scopeId().toLatin1().constData());
+         }
+         else if (address.protocol() == QAbstractSocket::IPv4Protocol)
+         {
+            const quint32 IPv4Address = htonl(address.toIPv4Address());
+            sockAddressIPv6->sin6_addr.s6_addr[10] = 0xFF;
+            sockAddressIPv6->sin6_addr.s6_addr[11] = 0xFF;
+            memcpy(&sockAddressIPv6->sin6_addr.s6_addr[12], &IPv4Address, sizeof IPv4Address);
+         }
+         else
+            return 0;
+
+         return sizeof(sockaddr_in6);
+      }
+
+      if (address.protocol() != QAbstractSocket::IPv4Protocol)
+         return 0;
+
+      sockaddr_in* sockAddressIPv4 = reinterpret_cast<sockaddr_in*>(&sockAddress);
+      sockAddressIPv4->sin_family = AF_INET;
+      sockAddressIPv4->sin_port = htons(port);
+      sockAddressIPv4->sin_addr.s_addr = htonl(address.toIPv4Address());
+      return sizeof(sockaddr_in);
+   }
+}
+#endif
+
+/**
+  * @param capacity The maximum number of datagrams received or sent at once.
+  * @param datagramMaxSize The size of each buffer, a larger datagram is truncated when received.
+  */
+DatagramBatch::DatagramBatch(int capacity, int datagramMaxSize) :
+   CAPACITY(qMax(1, capacity)),
+   DATAGRAM_MAX_SIZE(datagramMaxSize),
+   buffers(new char[CAPACITY * DATAGRAM_MAX_SIZE]),
+   sizes(CAPACITY),
+   peerAddresses(CAPACITY),
+   nbDatagrams(0)
+#ifdef Q_OS_LINUX
+   ,
+   headers(new mmsghdr[CAPACITY]),
+   iovecs(new iovec[CAPACITY]),
+   addresses(new sockaddr_storage[CAPACITY])
+#endif
+{
+#ifdef Q_OS_LINUX
+   memset(this->headers, 0, CAPACITY * sizeof(mmsghdr));
+   for (int i = 0; i < CAPACITY; i++)
+   {
+      this->iovecs[i].iov_base = this->buffers + i * DATAGRAM_MAX_SIZE;
+      this->headers[i].msg_hdr.msg_iov = &this->iovecs[i];
+      this->headers[i].msg_hdr.msg_iovlen = 1;
+   }
+#endif
+}
+
+DatagramBatch::~DatagramBatch()
+{
+#ifdef Q_OS_LINUX
+   delete[] this->addresses;
+   delete[] this->iovecs;
+   delete[] this->headers;
+#endif
+   delete[] this->buffers;
+}
+
+int DatagramBatch::getCapacity() const
+{
+   return CAPACITY;
+}
+
+int DatagramBatch::getDatagramMaxSize() const
+{
+   return DATAGRAM_MAX_SIZE;
+}
+
+int DatagramBatch::getNbDatagrams() const
+{
+   return this->nbDatagrams;
+}
+
+bool DatagramBatch::isFull() const
+{
+   return this->nbDatagrams == CAPACITY;
+}
+
+void DatagramBatch::clear()
+{
+   this->nbDatagrams = 0;
+}
+
+const char* DatagramBatch::getDatagram(int i) const
+{
+   return this->buffers + i * DATAGRAM_MAX_SIZE;
+}
+
+int DatagramBatch::getDatagramSize(int i) const
+{
+   return this->sizes[i];
+}
+
+/**
+  * The address of the sender of a received datagram.
+  */
+const QHostAddress& DatagramBatch::getPeerAddress(int i) const
+{
+   return this->peerAddresses[i];
+}
+
+/**
+  * Take the next buffer of the ring to write a datagram to send.
+  * @return The buffer, 0 if the batch is full or if the datagram is too large.
+  */
+char* DatagramBatch::add(int datagramSize)
+{
+   if (this->isFull() || datagramSize > DATAGRAM_MAX_SIZE)
+      return 0;
+
+   this->sizes[this->nbDatagrams] = datagramSize;
+   return this->buffers + this->nbDatagrams++ * DATAGRAM_MAX_SIZE;
+}
+
+/**
+  * Replace the content of the batch by the pending datagrams of the given socket, at most 'getCapacity()' of them.
+  * Must be called again while it returns 'getCapacity()', a smaller number means there is no more pending datagram.
+  * @return The number of received datagrams.
+  */
+int DatagramBatch::receive(QUdpSocket& socket)
+{
+   this->clear();
+
+#ifdef Q_OS_LINUX
+   for (int i = 0; i < CAPACITY; i++)
+   {
+      this->headers[i].msg_hdr.msg_name = &this->addresses[i];
+      this->headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+      this->iovecs[i].iov_len = DATAGRAM_MAX_SIZE;
+   }
+
+   const int n = ::recvmmsg(socket.socketDescriptor(), this->headers, CAPACITY, MSG_DONTWAIT, 0);
+   if (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+      L_WARN(QString("Unable to receive the datagrams: %1").arg(::strerror(errno)));
+
+   for (; this->nbDatagrams < n; this->nbDatagrams++)
+   {
+      this->sizes[this->nbDatagrams] = this->headers[this->nbDatagrams].msg_len;
+      this->peerAddresses[this->nbDatagrams].setAddress(reinterpret_cast<sockaddr*>(&this->addresses[this->nbDatagrams]));
+   }
+
+   // Qt disables its read notifier while 'readyRead()' is emitted and enables it again only in 'QUdpSocket::readDatagram(..)'.
+   // Thus when there is no more pending datagram it's called once to keep receiving 'readyRead()', a datagram arrived in the meantime may be read.
+   if (this->nbDatagrams < CAPACITY)
+      this->readDatagram(socket);
+#else
+   while (this->nbDatagrams < CAPACITY && socket.hasPendingDatagrams() && this->readDatagram(socket));
+#endif
+
+   return this->nbDatagrams;
+}
+
+/**
+  * Send all the datagrams of the batch to the given address and clear the batch.
+  * @return The number of sent datagrams.
+  */
+int DatagramBatch::send(QUdpSocket& socket, const QHostAddress& address, quint16 port)
+{
+   int nbSent = 0;
+
+#ifdef Q_OS_LINUX
+   sockaddr_storage sockAddress;
+   if (const socklen_t sockAddressSize = toSockAddress(address, port, socket.localAddress().protocol() == QAbstractSocket::IPv6Protocol, sockAddress))
+   {
+      for (int i = 0; i < this->nbDatagrams; i++)
+      {
+         this->headers[i].msg_hdr.msg_name = &sockAddress;
+         this->headers[i].msg_hdr.msg_namelen = sockAddressSize;
+         this->iovecs[i].iov_len = this->sizes[i];
+      }
+
+      while (nbSent < this->nbDatagrams)
+      {
+         const int n = ::sendmmsg(socket.socketDescriptor(), this->headers + nbSent, this->nbDatagrams - nbSent, 0);
+         if (n <= 0)
+         {
+            L_WARN(QString("Unable to send the datagrams: %1").arg(::strerror(errno)));
+            break;
+         }
+         nbSent += n;
+      }
+   }
+   else
+#endif
+   {
+      for (; nbSent < this->nbDatagrams; nbSent++)
+         if (socket.writeDatagram(this->getDatagram(nbSent), this->sizes[nbSent], address, port) == -1)
+            break;
+   }
+
+   this->clear();
+   return nbSent;
+}
+
+/**
+  * Read one datagram with 'QUdpSocket::readDatagram(..)' into the next buffer.
+  */
+bool DatagramBatch::readDatagram(QUdpSocket& socket)
+{
+   const qint64 datagramSize = socket.readDatagram(this->buffers + this->nbDatagrams * DATAGRAM_MAX_SIZE, DATAGRAM_MAX_SIZE, &this->peerAddresses[this->nbDatagrams]);
+   if (datagramSize < 0)
+      return false;
+
+   this->sizes[this->nbDatagrams++] = static_cast<int>(datagramSize);
+   return true;
+}
@@ -0,0 +1,77 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef NETWORKLISTENER_DATAGRAMBATCH_H
+#define NETWORKLISTENER_DATAGRAMBATCH_H
+
+#include <QVector>
+#include <QHostAddress>
+#include <QUdpSocket>
+
+#include <Common/Uncopyable.h>
+
+#ifdef Q_OS_LINUX
+   struct mmsghdr;
+   struct iovec;
+   struct sockaddr_storage;
+#endif
+
+namespace NL
+{
+   class DatagramBatch : Common::Uncopyable
+   {
+   public:
+      DatagramBatch(int capacity, int datagramMaxSize);
+      ~DatagramBatch();
+
+      int getCapacity() const;
+      int getDatagramMaxSize() const;
+
+      int getNbDatagrams() const;
+      bool isFull() const;
+      void clear();
+
+      const char* getDatagram(int i) const;
+      int getDatagramSize(int i) const;
+      const QHostAddress& getPeerAddress(int i) const;
+
+      char* add(int datagramSize);
+
+      int receive(QUdpSocket& socket);
+      int send(QUdpSocket& socket, const QHostAddress& address, quint16 port);
+
+   private:
+      bool readDatagram(QUdpSocket& socket);
+
+      const int CAPACITY;
+      const int DATAGRAM_MAX_SIZE;
+
+      char* buffers; ///< The ring of buffers, 'CAPACITY' * 'DATAGRAM_MAX_SIZE' bytes.
+      QVector<int> sizes;
+      QVector<QHostAddress> peerAddresses;
+      int nbDatagrams;
+
+#ifdef Q_OS_LINUX
+      mmsghdr* headers;
+      iovec* iovecs;
+      sockaddr_storage* addresses;
+#endif
+   };
+}
+
+#endif
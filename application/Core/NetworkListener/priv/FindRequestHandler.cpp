@@ -0,0 +1,196 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FindRequestHandler.h>
+using namespace NL;
+
+#include <QThread>
+
+#include <Common/Settings.h>
+#include <Common/Network/MessageHeader.h>
+
+#include <priv/Log.h>
+
+class FindRequestHandler::Worker : public QThread
+{
+public:
+   Worker(FindRequestHandler* handler) : handler(handler) { this->start(); }
+
+protected:
+   void run() { this->handler->work(); }
+
+private:
+   FindRequestHandler* handler;
+};
+
+/**
+  * @class NL::FindRequestHandler
+  *
+  * Run the searches asked by the other peers with a few threads, the thread receiving the datagrams is never blocked by a search.
+  * The peers are served in turn, a peer sending a lot of searches only delays its own ones.
+  * The number of pending searches is bounded : when it's reached the oldest search of the peer having the most is dropped.
+  * The results of the last searches are cached, a cached search is answered directly by 'addRequest(..)'.
+  */
+
+FindRequestHandler::FindRequestHandler(QSharedPointer<FM::IFileManager> fileManager) :
+   fileManager(fileManager),
+   cache(SETTINGS.get<quint32>("find_result_cache_size")),
+   maxNbPendingRequests(SETTINGS.get<quint32>("max_number_of_pending_searches")),
+   nbPendingRequests(0),
+   toStop(false)
+{
+   for (int i = 0; i < qMax(1, static_cast<int>(SETTINGS.get<quint32>("number_of_search_threads"))); i++)
+      this->workers << new Worker(this);
+}
+
+FindRequestHandler::~FindRequestHandler()
+{
+   this->mutex.lock();
+   this->toStop = true;
+   this->requestAdded.wakeAll();
+   this->mutex.unlock();
+
+   foreach (Worker* worker, this->workers)
+   {
+      worker->wait();
+      delete worker;
+   }
+}
+
+/**
+  * The signal 'findResults(..)' will be emitted with the results, directly if they are cached.
+  */
+void FindRequestHandler::addRequest(const Common::Hash& peerID, quint64 tag, const QString& pattern, const Protos::Common::FindFilter& filter)
+{
+   Request request;
+   request.peerID = peerID;
+   request.tag = tag;
+   request.pattern = pattern;
+   request.filter = filter;
+
+   if (this->cache.get(pattern, filter, this->fileManager->getIndexGeneration(), SETTINGS.get<quint32>("max_number_of_search_result_to_send"), SETTINGS.get<quint32>("max_udp_datagram_size") - Common::MessageHeader::HEADER_SIZE, request.results))
+   {
+      emit findResults(request.peerID, request.tag, request.results);
+      return;
+   }
+
+   QMutexLocker locker(&this->mutex);
+
+   if (this->nbPendingRequests >= this->maxNbPendingRequests)
+   {
+      Common::Hash busiestPeerID = peerID;
+      foreach (Common::Hash otherPeerID, this->peers)
+         if (this->pendingRequests[otherPeerID].size() > this->pendingRequests.value(busiestPeerID).size())
+            busiestPeerID = otherPeerID;
+
+      if (busiestPeerID == peerID && this->pendingRequests.value(peerID).isEmpty())
+      {
+         L_DEBU(QString("Too many pending searches, the search '%1' from %2 is dropped").arg(pattern).arg(peerID.toStr()));
+         return;
+      }
+
+      QQueue<Request>& requests = this->pendingRequests[busiestPeerID];
+      L_DEBU(QString("Too many pending searches, the search '%1' from %2 is dropped").arg(requests.head().pattern).arg(busiestPeerID.toStr()));
+      requests.dequeue();
+      this->nbPendingRequests--;
+      if (requests.isEmpty())
+      {
+         this->pendingRequests.remove(busiestPeerID);
+         this->peers.removeOne(busiestPeerID);
+      }
+   }
+
+   QHash<Common::Hash, QQueue<Request> >::iterator i = this->pendingRequests.find(peerID);
+   if (i == this->pendingRequests.end())
+   {
+      i = this->pendingRequests.insert(peerID, QQueue<Request>());
+      this->peers << peerID;
+   }
+   i.value().enqueue(request);
+   this->nbPendingRequests++;
+
+   this->requestAdded.wakeOne();
+}
+
+void FindRequestHandler::emitFindResults()
+{
+   this->mutex.lock();
+   const QList<Request> requests = this->doneRequests;
+   this->doneRequests.clear();
+   this->mutex.unlock();
+
+   foreach (Request request, requests)
+      emit findResults(request.peerID, request.tag, request.results);
+}
+
+/**
+  * Take the oldest request of the first peer, the peer is then put at the end of the list.
+  * The mutex must be locked.
+  * @return false if there is no pending request.
+  */
+bool FindRequestHandler::takeNextRequest(Request& request)
+{
+   if (this->peers.isEmpty())
+      return false;
+
+   const Common::Hash peerID = this->peers.takeFirst();
+   QQueue<Request>& requests = this->pendingRequests[peerID];
+   request = requests.dequeue();
+   this->nbPendingRequests--;
+
+   if (requests.isEmpty())
+      this->pendingRequests.remove(peerID);
+   else
+      this->peers << peerID;
+
+   return true;
+}
+
+void FindRequestHandler::work()
+{
+   QMutexLocker locker(&this->mutex);
+
+   forever
+   {
+      Request request;
+      while (!this->toStop && !this->takeNextRequest(request))
+         this->requestAdded.wait(&this->mutex);
+
+      if (this->toStop)
+         return;
+
+      locker.unlock();
+
+      const int maxNbResult = SETTINGS.get<quint32>("max_number_of_search_result_to_send");
+      const int maxSize = SETTINGS.get<quint32>("max_udp_datagram_size") - Common::MessageHeader::HEADER_SIZE;
+
+      // Read before the search : an entry changed during the search will invalidate its result.
+      const int generation = this->fileManager->getIndexGeneration();
+
+      // The same search may have been made by another worker meanwhile.
+      if (!this->cache.get(request.pattern, request.filter, generation, maxNbResult, maxSize, request.results))
+      {
+         request.results = FindResultCache::serialize(this->fileManager->find(request.pattern, request.filter, maxNbResult, maxSize));
+         this->cache.insert(request.pattern, request.filter, generation, maxNbResult, maxSize, request.results);
+      }
+
+      locker.relock();
+      this->doneRequests << request;
+      QMetaObject::invokeMethod(this, "emitFindResults", Qt::QueuedConnection);
+   }
+}
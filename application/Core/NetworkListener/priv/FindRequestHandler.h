@@ -0,0 +1,90 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef NETWORKLISTENER_FINDREQUESTHANDLER_H
+#define NETWORKLISTENER_FINDREQUESTHANDLER_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QQueue>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <Common/Uncopyable.h>
+#include <Common/Hash.h>
+#include <Core/FileManager/IFileManager.h>
+
+#include <priv/FindResultCache.h>
+
+namespace NL
+{
+   class FindRequestHandler : public QObject, Common::Uncopyable
+   {
+      Q_OBJECT
+      class Worker;
+
+   public:
+      FindRequestHandler(QSharedPointer<FM::IFileManager> fileManager);
+      ~FindRequestHandler();
+
+      void addRequest(const Common::Hash& peerID, quint64 tag, const QString& pattern, const Protos::Common::FindFilter& filter);
+
+   signals:
+      /**
+        * The results are serialized without their tag, see 'FindResultCache::serialize(..)'.
+        */
+      void findResults(const Common::Hash& peerID, quint64 tag, const QList<QByteArray>& results);
+
+   private slots:
+      void emitFindResults();
+
+   private:
+      struct Request
+      {
+         Common::Hash peerID;
+         quint64 tag;
+         QString pattern;
+         Protos::Common::FindFilter filter;
+         QList<QByteArray> results;
+      };
+
+      bool takeNextRequest(Request& request);
+      void work();
+
+      QSharedPointer<FM::IFileManager> fileManager;
+      FindResultCache cache;
+
+      const int maxNbPendingRequests;
+      int nbPendingRequests;
+      QHash<Common::Hash, QQueue<Request> > pendingRequests; ///< The requests waiting for a worker by peer.
+      QList<Common::Hash> peers; ///< The peers having some pending requests, the next one to be served is the first.
+      QList<Request> doneRequests; ///< The requests with their results, waiting to be sent.
+      bool toStop;
+
+      QList<Worker*> workers;
+
+      QMutex mutex;
+      QWaitCondition requestAdded;
+   };
+}
+
+#endif
@@ -0,0 +1,106 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/FindResultCache.h>
+using namespace NL;
+
+#include <QStringList>
+
+#include <Common/Global.h>
+
+/**
+  * @class NL::FindResultCache
+  *
+  * Keep the results of the last searches received from the other peers, the same searches often come from a lot of peers in a short time.
+  * The results are serialized without their tag, see 'FindResult.tag'. They are valid as long as the index generation of the file manager
+  * hasn't changed. The least recently used results are removed first.
+  * The cache can be used by more than one thread.
+  */
+
+/**
+  * @param maxSize The maximum size of the serialized results [byte].
+  */
+FindResultCache::FindResultCache(int maxSize) :
+   cache(maxSize)
+{
+}
+
+/**
+  * Return false if the results of the given search aren't known or if they are outdated.
+  * The searches are compared by their words, see 'Common::Global::splitInWords(..)', and by their filter.
+  */
+bool FindResultCache::get(const QString& pattern, const Protos::Common::FindFilter& filter, int generation, int maxNbResult, int maxSize, QList<QByteArray>& results)
+{
+   const QString key = getKey(pattern, filter, maxNbResult, maxSize);
+
+   QMutexLocker locker(&this->mutex);
+   CachedResults* cachedResults = this->cache.object(key);
+   if (!cachedResults)
+      return false;
+
+   if (cachedResults->generation != generation)
+   {
+      this->cache.remove(key);
+      return false;
+   }
+
+   results = cachedResults->results;
+   return true;
+}
+
+/**
+  * @param generation The index generation read before the search was made.
+  */
+void FindResultCache::insert(const QString& pattern, const Protos::Common::FindFilter& filter, int generation, int maxNbResult, int maxSize, const QList<QByteArray>& results)
+{
+   const QString key = getKey(pattern, filter, maxNbResult, maxSize);
+
+   int cost = key.size() * sizeof(QChar);
+   foreach (QByteArray result, results)
+      cost += result.size();
+
+   CachedResults* cachedResults = new CachedResults();
+   cachedResults->generation = generation;
+   cachedResults->results = results;
+
+   QMutexLocker locker(&this->mutex);
+   this->cache.insert(key, cachedResults, cost); // Deleted by the cache if it's too big.
+}
+
+/**
+  * The tags of the results are removed, a tag can be prepended to each of them later, see 'Protos::Common::FindResult'.
+  */
+QList<QByteArray> FindResultCache::serialize(const QList<Protos::Common::FindResult>& results)
+{
+   QList<QByteArray> serializedResults;
+   foreach (Protos::Common::FindResult result, results)
+   {
+      result.clear_tag();
+      QByteArray serializedResult(result.ByteSize(), 0);
+      result.SerializePartialToArray(serializedResult.data(), serializedResult.size());
+      serializedResults << serializedResult;
+   }
+   return serializedResults;
+}
+
+QString FindResultCache::getKey(const QString& pattern, const Protos::Common::FindFilter& filter, int maxNbResult, int maxSize)
+{
+   // The serialized filter is put before the words, they can contain any character.
+   const std::string serializedFilter = filter.SerializeAsString();
+   return QString("%1 %2 %3 %4").arg(maxNbResult).arg(maxSize).arg(QString(QByteArray(serializedFilter.data(), serializedFilter.size()).toHex())).arg(Common::Global::splitInWords(pattern).join(" "));
+}
@@ -0,0 +1,58 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef NETWORKLISTENER_FINDRESULTCACHE_H
+#define NETWORKLISTENER_FINDRESULTCACHE_H
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+
+#include <Protos/common.pb.h>
+
+#include <Common/Uncopyable.h>
+
+namespace NL
+{
+   class FindResultCache : Common::Uncopyable
+   {
+   public:
+      FindResultCache(int maxSize);
+
+      bool get(const QString& pattern, const Protos::Common::FindFilter& filter, int generation, int maxNbResult, int maxSize, QList<QByteArray>& results);
+      void insert(const QString& pattern, const Protos::Common::FindFilter& filter, int generation, int maxNbResult, int maxSize, const QList<QByteArray>& results);
+
+      static QList<QByteArray> serialize(const QList<Protos::Common::FindResult>& results);
+
+   private:
+      static QString getKey(const QString& pattern, const Protos::Common::FindFilter& filter, int maxNbResult, int maxSize);
+
+      struct CachedResults
+      {
+         int generation; ///< See 'FM::IFileManager::getIndexGeneration()'.
+         QList<QByteArray> results;
+      };
+
+      QCache<QString, CachedResults> cache;
+      QMutex mutex;
+   };
+}
+
+#endif
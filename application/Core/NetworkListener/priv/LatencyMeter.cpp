@@ -0,0 +1,100 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/LatencyMeter.h>
+using namespace NL;
+
+#include <QElapsedTimer>
+
+#include <Common/LogManager/Builder.h>
+
+/**
+  * @class NL::LatencyMeter
+  *
+  * Measure the delay between an event and its processing by the thread of the meter.
+  * The event is timestamped with 'now()' in any thread, then 'measure(..)' is called once the event has been handed to the thread of the meter.
+  * Because the posted events of a thread are processed in order the measure is taken just after the processing of the event.
+  * The statistics are logged and reset periodically.
+  */
+
+/**
+  * @param reportPeriod [ms].
+  */
+LatencyMeter::LatencyMeter(QSharedPointer<LM::ILogger> logger, const QString& name, int reportPeriod) :
+   logger(logger), name(name), nbMeasures(0), totalLatency(0), maxLatency(0)
+{
+   connect(&this->reportTimer, SIGNAL(timeout()), this, SLOT(report()));
+   this->reportTimer.start(reportPeriod);
+}
+
+/**
+  * A monotonic time shared by all the threads, in [ms].
+  */
+qint64 LatencyMeter::now()
+{
+   return QElapsedTimer::msecsSinceReference();
+}
+
+/**
+  * Can be called from any thread.
+  * @param time The time of the event given by 'now()'.
+  */
+void LatencyMeter::measure(qint64 time)
+{
+   QMetaObject::invokeMethod(this, "addMeasure", Qt::QueuedConnection, Q_ARG(qint64, time));
+}
+
+/**
+  * The number of measures since the last report.
+  */
+int LatencyMeter::getNbMeasures() const
+{
+   return this->nbMeasures;
+}
+
+qint64 LatencyMeter::getAverageLatency() const
+{
+   return this->nbMeasures == 0 ? 0 : this->totalLatency / this->nbMeasures;
+}
+
+qint64 LatencyMeter::getMaxLatency() const
+{
+   return this->maxLatency;
+}
+
+void LatencyMeter::addMeasure(qint64 time)
+{
+   const qint64 latency = now() - time;
+
+   this->nbMeasures++;
+   this->totalLatency += latency;
+   if (latency > this->maxLatency)
+      this->maxLatency = latency;
+}
+
+void LatencyMeter::report()
+{
+   if (this->nbMeasures == 0)
+      return;
+
+   LOG_DEBU(this->logger, QString("%1 : %2 measures, average latency : %3 ms, max latency : %4 ms").arg(this->name).arg(this->nbMeasures).arg(this->getAverageLatency()).arg(this->maxLatency));
+
+   this->nbMeasures = 0;
+   this->totalLatency = 0;
+   this->maxLatency = 0;
+}
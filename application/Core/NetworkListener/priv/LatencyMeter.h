@@ -0,0 +1,62 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef NETWORKLISTENER_LATENCYMETER_H
+#define NETWORKLISTENER_LATENCYMETER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QSharedPointer>
+
+#include <Common/Uncopyable.h>
+#include <Common/LogManager/ILogger.h>
+
+namespace NL
+{
+   class LatencyMeter : public QObject, Common::Uncopyable
+   {
+      Q_OBJECT
+   public:
+      LatencyMeter(QSharedPointer<LM::ILogger> logger, const QString& name, int reportPeriod);
+
+      static qint64 now();
+
+      void measure(qint64 time);
+
+      int getNbMeasures() const;
+      qint64 getAverageLatency() const;
+      qint64 getMaxLatency() const;
+
+   private slots:
+      void addMeasure(qint64 time);
+      void report();
+
+   private:
+      QSharedPointer<LM::ILogger> logger;
+      const QString name;
+
+      int nbMeasures;
+      qint64 totalLatency; // [ms].
+      qint64 maxLatency; // [ms].
+
+      QTimer reportTimer;
+   };
+}
+
+#endif
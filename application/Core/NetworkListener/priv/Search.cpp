@@ -36,7 +36,7 @@ Search::Search(UDPListener& uDPListener) :
 {
 }
 
-quint64 Search::search(const QString& words)
+quint64 Search::search(const QString& words, const Protos::Common::FindFilter& filter)
 {
    if (this->tag != 0)
    {
@@ -53,6 +53,8 @@ quint64 Search::search(const QString& words)
    findMessage.set_tag(this->tag);
 
    Common::ProtoHelper::setStr(findMessage, &Protos::Core::Find::set_pattern, words);
+   if (filter.ByteSize() > 0)
+      findMessage.mutable_filter()->CopyFrom(filter);
 
    connect(&this->uDPListener, SIGNAL(newFindResultMessage(Protos::Common::FindResult)), this, SLOT(newFindResult(Protos::Common::FindResult)));
 
@@ -39,7 +39,7 @@ namespace NL
       Q_OBJECT
    public:
       Search(UDPListener& uDPListener);
-      quint64 search(const QString& words);
+      quint64 search(const QString& words, const Protos::Common::FindFilter& filter = Protos::Common::FindFilter());
       qint64 elapsed();
 
    private slots:
@@ -28,6 +28,8 @@ using namespace NL;
    #include <Winsock.h>
 #endif
 
+#include <QMetaType>
+
 #include <google/protobuf/message.h>
 
 #include <Common/Settings.h>
@@ -41,6 +43,13 @@ using namespace NL;
 
 /**
   * @class NL::UDPListener
+  *
+  * The sockets are used by a dedicated thread, thus the datagrams are read even when the main thread is busy
+  * and the peers don't look dead because their IMAlive messages are lost.
+  * The other managers aren't thread-safe, the received messages are handed to their thread,
+  * see 'PM::IPeerManager::updatePeer(..)' and 'DM::IChunkDownload::addPeerID(..)'.
+  * The delay between the reception of an IMAlive message and its processing by the peer manager is measured by 'getIMAliveLatency()'.
+  *
   * @author mcuony
   * @author gburri
   */
@@ -55,7 +64,9 @@ UDPListener::UDPListener(
    QSharedPointer<DM::IDownloadManager> downloadManager,
    quint16 unicastPort
 ) :
-   bodyBuffer(UDPListener::buffer + Common::MessageHeader::HEADER_SIZE),
+   receivedDatagrams(SETTINGS.get<quint32>("udp_batch_size"), BUFFER_SIZE),
+   datagramsToSend(SETTINGS.get<quint32>("udp_batch_size"), SETTINGS.get<quint32>("max_udp_datagram_size")),
+   receptionTime(0),
    UNICAST_PORT(unicastPort),
    MULTICAST_PORT(SETTINGS.get<quint32>("multicast_port")),
    multicastGroup(Utils::getMulticastGroup()),
@@ -64,17 +75,43 @@ UDPListener::UDPListener(
    uploadManager(uploadManager),
    downloadManager(downloadManager),
    currentIMAliveTag(0),
-   loggerIMAlive(LM::Builder::newLogger("NetworkListener (IMAlive)"))
+   findRequestHandler(fileManager),
+   loggerIMAlive(LM::Builder::newLogger("NetworkListener (IMAlive)")),
+   IMAliveLatency(loggerIMAlive, "IMAlive processing", IMALIVE_LATENCY_REPORT_PERIOD)
 {
-   this->initMulticastUDPSocket();
-   this->initUnicastUDPSocket();
+   qRegisterMetaType<Common::Hash>("Common::Hash");
+   qRegisterMetaType<QHostAddress>("QHostAddress");
+   qRegisterMetaType<Protos::Core::ChatMessage>("Protos::Core::ChatMessage");
+   qRegisterMetaType<Protos::Common::FindResult>("Protos::Common::FindResult");
+
+   this->moveToThread(&this->thread);
+   this->multicastSocket.moveToThread(&this->thread);
+   this->unicastSocket.moveToThread(&this->thread);
+   this->findRequestHandler.moveToThread(&this->thread);
+   this->thread.start();
+
+   this->rebindSockets();
 
-   connect(&this->timerIMAlive, SIGNAL(timeout()), this, SLOT(sendIMAliveMessage()));
+   connect(&this->findRequestHandler, SIGNAL(findResults(const Common::Hash&, quint64, const QList<QByteArray>&)), this, SLOT(sendFindResults(const Common::Hash&, quint64, const QList<QByteArray>&)), Qt::DirectConnection);
+
+   // The IMAlive messages are built by the main thread from the state of the other managers, the timer isn't moved.
+   connect(&this->timerIMAlive, SIGNAL(timeout()), this, SLOT(sendIMAliveMessage()), Qt::DirectConnection);
    this->timerIMAlive.start(static_cast<int>(SETTINGS.get<quint32>("peer_imalive_period")));
 
    this->sendIMAliveMessage();
 }
 
+UDPListener::~UDPListener()
+{
+   QMetaObject::invokeMethod(this, "closeSockets", Qt::BlockingQueuedConnection);
+   this->thread.quit();
+   this->thread.wait();
+}
+
+/**
+  * Send an UDP unicast message, can be called from any thread.
+  */
+
 void UDPListener::send(Common::MessageHeader::MessageType type, const Common::Hash& peerID, const google::protobuf::Message& message)
 {
    PM::IPeer* peer = this->peerManager->getPeer(peerID);
@@ -84,34 +121,33 @@ void UDPListener::send(Common::MessageHeader::MessageType type, const Common::Ha
       return;
    }
 
-   int messageSize;
-   if (!(messageSize = this->writeMessageToBuffer(type, message)))
+   const QByteArray datagram = this->writeMessage(type, message);
+   if (datagram.isEmpty())
       return;
 
    L_DEBU(QString("Send unicast UDP to %1 : header.getType() = %2, message size = %3 \n%4").
-      arg(peer->toStringLog()).
+      arg(peerID.toStr()).
       arg(Common::MessageHeader::messToStr(type)).
-      arg(messageSize).
+      arg(datagram.size()).
       arg(Common::ProtoHelper::getDebugStr(message))
    );
 
-   if (this->unicastSocket.writeDatagram(this->buffer, messageSize, peer->getIP(), peer->getPort()) == -1)
-      L_WARN("Unable to send datagram");
+   QMetaObject::invokeMethod(this, "writeUnicastDatagram", Q_ARG(QByteArray, datagram), Q_ARG(QHostAddress, peer->getIP()), Q_ARG(quint16, peer->getPort()));
 }
 
 /**
-  * Send an UDP multicast message.
+  * Send an UDP multicast message, can be called from any thread.
   */
 void UDPListener::send(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
 {
-   int messageSize;
-   if (!(messageSize = this->writeMessageToBuffer(type, message)))
+   const QByteArray datagram = this->writeMessage(type, message);
+   if (datagram.isEmpty())
       return;
 
 #if DEBUG
    QString logMess = QString("Send multicast UDP : header.getType() = %1, message size = %2 \n%3").
       arg(Common::MessageHeader::messToStr(type)).
-      arg(messageSize).
+      arg(datagram.size()).
       arg(Common::ProtoHelper::getDebugStr(message));
 
    if (type == Common::MessageHeader::CORE_IM_ALIVE)
@@ -120,10 +156,12 @@ void UDPListener::send(Common::MessageHeader::MessageType type, const google::pr
       L_DEBU(logMess);
 #endif
 
-   if (this->multicastSocket.writeDatagram(this->buffer, messageSize, this->multicastGroup, MULTICAST_PORT) == -1)
-      L_WARN("Unable to send datagram");
+   QMetaObject::invokeMethod(this, "writeMulticastDatagram", Q_ARG(QByteArray, datagram));
 }
 
+/**
+  * Called by the main thread, see the constructor.
+  */
 void UDPListener::sendIMAliveMessage()
 {
    Protos::Core::IMAlive IMAliveMessage;
@@ -136,6 +174,8 @@ void UDPListener::sendIMAliveMessage()
    IMAliveMessage.set_download_rate(this->downloadManager->getDownloadRate());
    IMAliveMessage.set_upload_rate(this->uploadManager->getUploadRate());
 
+   QMutexLocker locker(&this->IMAliveMutex);
+
    this->currentIMAliveTag = this->mtrand.randInt();
    this->currentIMAliveTag <<= 32;
    this->currentIMAliveTag |= this->mtrand.randInt();
@@ -149,6 +189,8 @@ void UDPListener::sendIMAliveMessage()
       IMAliveMessage.add_chunk()->set_hash(i.next()->getHash().getData(), Common::Hash::HASH_SIZE);
    }
 
+   locker.unlock();
+
    this->send(Common::MessageHeader::CORE_IM_ALIVE, IMAliveMessage);
 }
 
@@ -157,168 +199,188 @@ Common::Hash UDPListener::getOwnID() const
    return this->peerManager->getID();
 }
 
+/**
+  * Can be called from any thread, the sockets are rebound by the thread of the listener.
+  */
 void UDPListener::rebindSockets()
 {
-   this->initMulticastUDPSocket();
-   this->initUnicastUDPSocket();
+   QMetaObject::invokeMethod(this, "initMulticastUDPSocket", Qt::QueuedConnection);
+   QMetaObject::invokeMethod(this, "initUnicastUDPSocket", Qt::QueuedConnection);
 }
 
 /**
-  *
+  * Used by the benchmarks.
+  */
+const LatencyMeter& UDPListener::getIMAliveLatency() const
+{
+   return this->IMAliveLatency;
+}
+
+/**
+  * The pending datagrams are received by batches, see 'DatagramBatch'.
   */
 void UDPListener::processPendingMulticastDatagrams()
 {
-   while (this->multicastSocket.hasPendingDatagrams())
+   do
    {
-      QHostAddress peerAddress;
-      const Common::MessageHeader& header =  UDPListener::readDatagramToBuffer(this->multicastSocket, peerAddress);
-      if (header.isNull())
-         continue;
-
-      switch (header.getType())
+      this->receivedDatagrams.receive(this->multicastSocket);
+      this->receptionTime = LatencyMeter::now();
+      for (int i = 0; i < this->receivedDatagrams.getNbDatagrams(); i++)
       {
-      case Common::MessageHeader::CORE_IM_ALIVE:
-         {
-            Protos::Core::IMAlive IMAliveMessage;
-            const bool readOk = IMAliveMessage.ParseFromArray(this->bodyBuffer, header.getSize());
+         const char* datagram = this->receivedDatagrams.getDatagram(i);
+         const Common::MessageHeader& header = this->readHeader(datagram, this->receivedDatagrams.getDatagramSize(i));
+         if (!header.isNull())
+            this->processMulticastDatagram(header, datagram + Common::MessageHeader::HEADER_SIZE, this->receivedDatagrams.getPeerAddress(i));
+      }
+   } while (this->receivedDatagrams.isFull());
+}
 
-            if (!readOk)
-            {
-               L_WARN(QString("Unable to read the IMAlive message from peer %1 %2").arg(header.getSenderID().toStr()).arg(peerAddress.toString()));
-               break;
-            }
-            else if (IMAliveMessage.version() != PROTOCOL_VERSION) // If the protocol version doesn't match we don't add the peer.
-            {
-               L_WARN(
-                  QString("The peer %1 %2 %3 doesn't have the same protocol version (%4) as us (%5). It will be ignored.")
-                     .arg(Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::nick))
-                     .arg(header.getSenderID().toStr())
-                     .arg(peerAddress.toString())
-                     .arg(IMAliveMessage.version())
-                     .arg(PROTOCOL_VERSION)
-               );
-               break;
-            }
+/**
+  * Function called when data is recevied by the socket : The corresponding proto is created and the coresponding event is rised.
+  */
+void UDPListener::processPendingUnicastDatagrams()
+{
+   do
+   {
+      this->receivedDatagrams.receive(this->unicastSocket);
+      for (int i = 0; i < this->receivedDatagrams.getNbDatagrams(); i++)
+      {
+         const char* datagram = this->receivedDatagrams.getDatagram(i);
+         const Common::MessageHeader& header = this->readHeader(datagram, this->receivedDatagrams.getDatagramSize(i));
+         if (!header.isNull())
+            this->processUnicastDatagram(header, datagram + Common::MessageHeader::HEADER_SIZE);
+      }
+   } while (this->receivedDatagrams.isFull());
+}
 
-            this->peerManager->updatePeer(
-               header.getSenderID(),
-               peerAddress,
-               IMAliveMessage.port(),
-               Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::nick),
-               IMAliveMessage.amount(),
-               Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::core_version)
-            );
+void UDPListener::processMulticastDatagram(const Common::MessageHeader& header, const char* body, const QHostAddress& peerAddress)
+{
+   switch (header.getType())
+   {
+   case Common::MessageHeader::CORE_IM_ALIVE:
+      {
+         Protos::Core::IMAlive IMAliveMessage;
+         const bool readOk = IMAliveMessage.ParseFromArray(body, header.getSize());
 
-            if (IMAliveMessage.chunk_size() > 0)
-            {
-               QList<Common::Hash> hashes;
-               hashes.reserve(IMAliveMessage.chunk_size());
-               for (int i = 0; i < IMAliveMessage.chunk_size(); i++)
-                  hashes << IMAliveMessage.chunk(i).hash();
-
-               QBitArray bitArray = this->fileManager->haveChunks(hashes);
-
-               if (!bitArray.isNull()) // If we own at least one chunk we reply with a CHUNKS_OWNED message.
-               {
-                  Protos::Core::ChunksOwned chunkOwnedMessage;
-                  chunkOwnedMessage.set_tag(IMAliveMessage.tag());
-                  chunkOwnedMessage.mutable_chunk_state()->Reserve(bitArray.size());
-                  for (int i = 0; i < bitArray.size(); i++)
-                     chunkOwnedMessage.add_chunk_state(bitArray[i]);
-                  this->send(Common::MessageHeader::CORE_CHUNKS_OWNED, header.getSenderID(), chunkOwnedMessage);
-               }
-            }
+         if (!readOk)
+         {
+            L_WARN(QString("Unable to read the IMAlive message from peer %1 %2").arg(header.getSenderID().toStr()).arg(peerAddress.toString()));
+            break;
          }
-         break;
-
-      case Common::MessageHeader::CORE_CHAT_MESSAGE:
+         else if (IMAliveMessage.version() != PROTOCOL_VERSION) // If the protocol version doesn't match we don't add the peer.
          {
-            Protos::Core::ChatMessage chatMessage;
-            chatMessage.ParseFromArray(this->bodyBuffer, header.getSize());
-            emit newChatMessage(header.getSenderID(), chatMessage);
+            L_WARN(
+               QString("The peer %1 %2 %3 doesn't have the same protocol version (%4) as us (%5). It will be ignored.")
+                  .arg(Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::nick))
+                  .arg(header.getSenderID().toStr())
+                  .arg(peerAddress.toString())
+                  .arg(IMAliveMessage.version())
+                  .arg(PROTOCOL_VERSION)
+            );
+            break;
          }
-         break;
 
-      case Common::MessageHeader::CORE_FIND: // Find.
+         this->peerManager->updatePeer(
+            header.getSenderID(),
+            peerAddress,
+            IMAliveMessage.port(),
+            Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::nick),
+            IMAliveMessage.amount(),
+            Common::ProtoHelper::getStr(IMAliveMessage, &Protos::Core::IMAlive::core_version),
+            IMAliveMessage.upload_rate()
+         );
+         this->IMAliveLatency.measure(this->receptionTime); // Queued after the update of the peer.
+
+         if (IMAliveMessage.chunk_size() > 0)
          {
-            Protos::Core::Find findMessage;
-            findMessage.ParseFromArray(this->bodyBuffer, header.getSize());
+            QList<Common::Hash> hashes;
+            hashes.reserve(IMAliveMessage.chunk_size());
+            for (int i = 0; i < IMAliveMessage.chunk_size(); i++)
+               hashes << IMAliveMessage.chunk(i).hash();
 
-            QList<Protos::Common::FindResult> results =
-               this->fileManager->find(
-                  Common::ProtoHelper::getStr(findMessage, &Protos::Core::Find::pattern),
-                  SETTINGS.get<quint32>("max_number_of_search_result_to_send"),
-                  SETTINGS.get<quint32>("max_udp_datagram_size") - Common::MessageHeader::HEADER_SIZE
-               );
+            QBitArray bitArray = this->fileManager->haveChunks(hashes);
 
-            for (QMutableListIterator<Protos::Common::FindResult> i(results); i.hasNext();)
+            if (!bitArray.isNull()) // If we own at least one chunk we reply with a CHUNKS_OWNED message.
             {
-               Protos::Common::FindResult& result = i.next();
-               result.set_tag(findMessage.tag());
-               this->send(Common::MessageHeader::CORE_FIND_RESULT, header.getSenderID(), result);
+               Protos::Core::ChunksOwned chunkOwnedMessage;
+               chunkOwnedMessage.set_tag(IMAliveMessage.tag());
+               chunkOwnedMessage.mutable_chunk_state()->Reserve(bitArray.size());
+               for (int i = 0; i < bitArray.size(); i++)
+                  chunkOwnedMessage.add_chunk_state(bitArray[i]);
+               this->send(Common::MessageHeader::CORE_CHUNKS_OWNED, header.getSenderID(), chunkOwnedMessage);
             }
          }
-         break;
+      }
+      break;
 
-      default:
-         L_WARN(QString("Unkown header type from multicast socket : %1").arg(header.getType(), 0, 16));
+   case Common::MessageHeader::CORE_CHAT_MESSAGE:
+      {
+         Protos::Core::ChatMessage chatMessage;
+         chatMessage.ParseFromArray(body, header.getSize());
+         emit newChatMessage(header.getSenderID(), chatMessage);
       }
+      break;
+
+   case Common::MessageHeader::CORE_FIND: // Find.
+      {
+         Protos::Core::Find findMessage;
+         findMessage.ParseFromArray(body, header.getSize());
+
+         this->findRequestHandler.addRequest(header.getSenderID(), findMessage.tag(), Common::ProtoHelper::getStr(findMessage, &Protos::Core::Find::pattern), findMessage.filter());
+      }
+      break;
+
+   default:
+      L_WARN(QString("Unkown header type from multicast socket : %1").arg(header.getType(), 0, 16));
    }
 }
 
-/**
-  * Function called when data is recevied by the socket : The corresponding proto is created and the coresponding event is rised.
-  */
-void UDPListener::processPendingUnicastDatagrams()
+void UDPListener::processUnicastDatagram(const Common::MessageHeader& header, const char* body)
 {
-   while (this->unicastSocket.hasPendingDatagrams())
+   switch (header.getType())
    {
-      QHostAddress peerAddress;
-      const Common::MessageHeader& header =  UDPListener::readDatagramToBuffer(this->unicastSocket, peerAddress);
-      if (header.isNull())
-         continue;
-
-      switch (header.getType())
+   case Common::MessageHeader::CORE_CHUNKS_OWNED:
       {
-      case Common::MessageHeader::CORE_CHUNKS_OWNED:
-         {
-            Protos::Core::ChunksOwned chunksOwnedMessage;
-            chunksOwnedMessage.ParseFromArray(this->bodyBuffer, header.getSize());
+         Protos::Core::ChunksOwned chunksOwnedMessage;
+         chunksOwnedMessage.ParseFromArray(body, header.getSize());
 
-            if (chunksOwnedMessage.tag() != this->currentIMAliveTag)
-            {
-               L_WARN(QString("ChunksOwned : tag (%1) doesn't match current tag (%2)").arg(chunksOwnedMessage.tag()).arg(currentIMAliveTag));
-               continue;
-            }
+         QMutexLocker locker(&this->IMAliveMutex);
 
-            if (chunksOwnedMessage.chunk_state_size() != this->currentChunkDownloads.size())
-            {
-               L_WARN(QString("ChunksOwned : The size (%1) doesn't match the expected one (%2)").arg(chunksOwnedMessage.chunk_state_size()).arg(this->currentChunkDownloads.size()));
-               continue;
-            }
+         if (chunksOwnedMessage.tag() != this->currentIMAliveTag)
+         {
+            L_WARN(QString("ChunksOwned : tag (%1) doesn't match current tag (%2)").arg(chunksOwnedMessage.tag()).arg(currentIMAliveTag));
+            return;
+         }
 
-            for (int i = 0; i < chunksOwnedMessage.chunk_state_size(); i++)
-            {
-               if (chunksOwnedMessage.chunk_state(i))
-                  this->currentChunkDownloads[i]->addPeerID(header.getSenderID());
-               else
-                  this->currentChunkDownloads[i]->rmPeerID(header.getSenderID());
-            }
+         if (chunksOwnedMessage.chunk_state_size() != this->currentChunkDownloads.size())
+         {
+            L_WARN(QString("ChunksOwned : The size (%1) doesn't match the expected one (%2)").arg(chunksOwnedMessage.chunk_state_size()).arg(this->currentChunkDownloads.size()));
+            return;
          }
-         break;
 
-      case Common::MessageHeader::CORE_FIND_RESULT:
+         // The changes are queued to the thread of each chunk download.
+         for (int i = 0; i < chunksOwnedMessage.chunk_state_size(); i++)
          {
-            Protos::Common::FindResult findResultMessage;
-            findResultMessage.ParseFromArray(this->bodyBuffer, header.getSize());
-            findResultMessage.mutable_peer_id()->set_hash(header.getSenderID().getData(), Common::Hash::HASH_SIZE);
-            emit newFindResultMessage(findResultMessage);
+            if (chunksOwnedMessage.chunk_state(i))
+               this->currentChunkDownloads[i]->addPeerID(header.getSenderID());
+            else
+               this->currentChunkDownloads[i]->rmPeerID(header.getSenderID());
          }
-         break;
+      }
+      break;
 
-      default:
-         L_WARN(QString("Unkown header type from unicast socket : %1").arg(header.getType(), 0, 16));
+   case Common::MessageHeader::CORE_FIND_RESULT:
+      {
+         Protos::Common::FindResult findResultMessage;
+         findResultMessage.ParseFromArray(body, header.getSize());
+         Common::ProtoHelper::expandFindResult(findResultMessage);
+         findResultMessage.mutable_peer_id()->set_hash(header.getSenderID().getData(), Common::Hash::HASH_SIZE);
+         emit newFindResultMessage(findResultMessage);
       }
+      break;
+
+   default:
+      L_WARN(QString("Unkown header type from unicast socket : %1").arg(header.getType(), 0, 16));
    }
 }
 
@@ -383,33 +445,121 @@ void UDPListener::initUnicastUDPSocket()
    connect(&this->unicastSocket, SIGNAL(readyRead()), this, SLOT(processPendingUnicastDatagrams()));
 }
 
-int UDPListener::writeMessageToBuffer(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
+void UDPListener::closeSockets()
 {
-   const int bodySize = message.ByteSize();
-   Common::MessageHeader header(type, bodySize, this->peerManager->getID());
+   this->multicastSocket.close();
+   this->unicastSocket.close();
+}
+
+void UDPListener::writeUnicastDatagram(const QByteArray& datagram, const QHostAddress& address, quint16 port)
+{
+   if (this->unicastSocket.writeDatagram(datagram, address, port) == -1)
+      L_WARN("Unable to send datagram");
+}
+
+void UDPListener::writeMulticastDatagram(const QByteArray& datagram)
+{
+   if (this->multicastSocket.writeDatagram(datagram, this->multicastGroup, MULTICAST_PORT) == -1)
+      L_WARN("Unable to send datagram");
+}
+
+/**
+  * Send some results serialized by 'FindResultCache::serialize(..)', the tag is prepended to each of them.
+  */
+void UDPListener::sendFindResults(const Common::Hash& peerID, quint64 tag, const QList<QByteArray>& results)
+{
+   PM::IPeer* peer = this->peerManager->getPeer(peerID);
+   if (!peer)
+   {
+      L_WARN(QString("Unable to find the peer %1").arg(peerID.toStr()));
+      return;
+   }
+
+   Protos::Common::FindResult tagMessage;
+   tagMessage.set_tag(tag);
+   const int tagSize = tagMessage.ByteSize();
 
+   foreach (QByteArray result, results)
+   {
+      const int bodySize = tagSize + result.size();
+      if (Common::MessageHeader::HEADER_SIZE + bodySize > static_cast<int>(SETTINGS.get<quint32>("max_udp_datagram_size")))
+      {
+         L_ERRO(QString("Datagram size too big : %1").arg(Common::MessageHeader::HEADER_SIZE + bodySize));
+         continue;
+      }
+
+      if (this->datagramsToSend.isFull())
+         this->sendDatagrams(*peer);
+
+      char* datagram = this->datagramsToSend.add(Common::MessageHeader::HEADER_SIZE + bodySize);
+      if (!datagram)
+      {
+         L_ERRO(QString("Datagram size too big : %1").arg(Common::MessageHeader::HEADER_SIZE + bodySize));
+         continue;
+      }
+
+      Common::MessageHeader::writeHeader(datagram, Common::MessageHeader(Common::MessageHeader::CORE_FIND_RESULT, bodySize, this->peerManager->getID()));
+      tagMessage.SerializeToArray(datagram + Common::MessageHeader::HEADER_SIZE, tagSize);
+      memcpy(datagram + Common::MessageHeader::HEADER_SIZE + tagSize, result.constData(), result.size()); // The fields of a protocol buffer message can be concatenated.
+
+      L_DEBU(QString("Send unicast UDP to %1 : header.getType() = %2, message size = %3").
+         arg(peerID.toStr()).
+         arg(Common::MessageHeader::messToStr(Common::MessageHeader::CORE_FIND_RESULT)).
+         arg(Common::MessageHeader::HEADER_SIZE + bodySize)
+      );
+   }
+
+   this->sendDatagrams(*peer);
+}
+
+/**
+  * Send the datagrams of 'datagramsToSend' to the given peer, with one system call if possible.
+  */
+void UDPListener::sendDatagrams(const PM::IPeer& peer)
+{
+   const int nbDatagrams = this->datagramsToSend.getNbDatagrams();
+   if (nbDatagrams == 0)
+      return;
+
+   const int nbSent = this->datagramsToSend.send(this->unicastSocket, peer.getIP(), peer.getPort());
+   if (nbSent < nbDatagrams)
+      L_WARN(QString("Unable to send %1 datagram(s) to %2").arg(nbDatagrams - nbSent).arg(peer.getID().toStr()));
+}
+
+/**
+  * @return The datagram, empty if the message is too large.
+  */
+QByteArray UDPListener::writeMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
+{
+   const int bodySize = message.ByteSize();
    if (Common::MessageHeader::HEADER_SIZE + bodySize > static_cast<int>(SETTINGS.get<quint32>("max_udp_datagram_size")))
    {
       L_ERRO(QString("Datagram size too big : %1").arg(Common::MessageHeader::HEADER_SIZE + bodySize));
-      return 0;
+      return QByteArray();
    }
 
-   Common::MessageHeader::writeHeader(this->buffer, header);
-   message.SerializeToArray(this->bodyBuffer, BUFFER_SIZE - Common::MessageHeader::HEADER_SIZE);
+   QByteArray datagram;
+   datagram.resize(Common::MessageHeader::HEADER_SIZE + bodySize);
+   Common::MessageHeader::writeHeader(datagram.data(), Common::MessageHeader(type, bodySize, this->peerManager->getID()));
+   message.SerializeToArray(datagram.data() + Common::MessageHeader::HEADER_SIZE, bodySize);
 
-   return Common::MessageHeader::HEADER_SIZE + bodySize;
+   return datagram;
 }
 
 /**
   * @return A null header if error.
   */
-Common::MessageHeader UDPListener::readDatagramToBuffer(QUdpSocket& socket, QHostAddress& peerAddress)
+Common::MessageHeader UDPListener::readHeader(const char* datagram, int datagramSize)
 {
-   qint64 datagramSize = socket.readDatagram(this->buffer, BUFFER_SIZE, &peerAddress);
+   if (datagramSize < Common::MessageHeader::HEADER_SIZE)
+   {
+      L_ERRO("datagramSize < Common::MessageHeader::HEADER_SIZE");
+      return Common::MessageHeader();
+   }
 
-   Common::MessageHeader header = Common::MessageHeader::readHeader(buffer);
+   Common::MessageHeader header = Common::MessageHeader::readHeader(datagram);
 
-   if (header.getSize() > datagramSize - Common::MessageHeader::HEADER_SIZE)
+   if (header.getSize() > static_cast<quint32>(datagramSize - Common::MessageHeader::HEADER_SIZE))
    {
       L_ERRO("header.getSize() > datagramSize");
       header.setNull();
@@ -439,13 +589,9 @@ Common::MessageHeader UDPListener::readDatagramToBuffer(QUdpSocket& socket, QHos
          header.setNull();
          return header;
       }
-
-      L_DEBU(QString("Receive a datagram UDP from %1, %2").arg(peer->toStringLog()).arg(header.toStr()));
-   }
-   else
-   {
-      L_DEBU(QString("Receive a datagram UDP from %1, %2").arg(header.getSenderID().toStr()).arg(header.toStr()));
    }
+
+   L_DEBU(QString("Receive a datagram UDP from %1, %2").arg(header.getSenderID().toStr()).arg(header.toStr()));
    return header;
 }
 
@@ -20,6 +20,9 @@
 #define NETWORKLISTENER_UDPLISTENER_H
 
 #include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QByteArray>
 #include <QUdpSocket>
 #include <QTimer>
 #include <QSharedPointer>
@@ -42,19 +45,25 @@
 #include <Core/UploadManager/IUploadManager.h>
 #include <Core/DownloadManager/IDownloadManager.h>
 
+#include <priv/FindRequestHandler.h>
+#include <priv/DatagramBatch.h>
+#include <priv/LatencyMeter.h>
+
 namespace NL
 {
    class UDPListener : public QObject, Common::Uncopyable
    {
       Q_OBJECT
-      // The size max of an UDP datagram : 2^16.
+      // The size max of an UDP datagram : 2^16, it's the size of the receiving buffers.
       // Usually the size of an UDP datagram is smaller, see 'Protos::CoreSettings::max_udp_datagram_size'.
       static const int BUFFER_SIZE = 65536;
 
-      // 2 -> 3 : BLAKE -> Sha-1
-      static const quint32 PROTOCOL_VERSION = 3;
+      static const int IMALIVE_LATENCY_REPORT_PERIOD = 60000; // [ms].
 
    public:
+      // 2 -> 3 : BLAKE -> Sha-1
+      static const quint32 PROTOCOL_VERSION = 5;
+
       UDPListener(
          QSharedPointer<FM::IFileManager> fileManager,
          QSharedPointer<PM::IPeerManager> peerManager,
@@ -62,6 +71,7 @@ namespace NL
          QSharedPointer<DM::IDownloadManager> downloadManager,
          quint16 unicastPort
       );
+      ~UDPListener();
 
       void send(Common::MessageHeader::MessageType type, const Common::Hash& peerID, const google::protobuf::Message& message);
       void send(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
@@ -70,6 +80,8 @@ namespace NL
 
       void rebindSockets();
 
+      const LatencyMeter& getIMAliveLatency() const;
+
    signals:
       void newChatMessage(const Common::Hash&, const Protos::Core::ChatMessage& chatMessage);
       void newFindResultMessage(const Protos::Common::FindResult& findResult);
@@ -81,13 +93,26 @@ namespace NL
 
       void initMulticastUDPSocket();
       void initUnicastUDPSocket();
+      void closeSockets();
+
+      void writeUnicastDatagram(const QByteArray& datagram, const QHostAddress& address, quint16 port);
+      void writeMulticastDatagram(const QByteArray& datagram);
+
+      void sendFindResults(const Common::Hash& peerID, quint64 tag, const QList<QByteArray>& results);
 
    private:
-      int writeMessageToBuffer(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
-      Common::MessageHeader readDatagramToBuffer(QUdpSocket& socket, QHostAddress& peerAddress);
+      void processMulticastDatagram(const Common::MessageHeader& header, const char* body, const QHostAddress& peerAddress);
+      void processUnicastDatagram(const Common::MessageHeader& header, const char* body);
+
+      void sendDatagrams(const PM::IPeer& peer);
+      QByteArray writeMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+      Common::MessageHeader readHeader(const char* datagram, int datagramSize);
 
-      char buffer[BUFFER_SIZE]; // Buffer used when sending or receiving datagram.
-      char* const bodyBuffer;
+      QThread thread; // The listener, its sockets and 'findRequestHandler' belong to this thread.
+
+      DatagramBatch receivedDatagrams; // The datagrams received by a call to 'processPending*Datagrams()'.
+      DatagramBatch datagramsToSend; // The datagrams sent by 'sendFindResults(..)'.
+      qint64 receptionTime; // When the current batch has been received, see 'LatencyMeter::now()'.
 
       const quint16 UNICAST_PORT;
       const quint16 MULTICAST_PORT;
@@ -102,11 +127,15 @@ namespace NL
       QUdpSocket unicastSocket;
 
       MTRand mtrand;
+      QMutex IMAliveMutex; // Protect 'currentIMAliveTag' and 'currentChunkDownloads', set by the main thread.
       quint64 currentIMAliveTag;
       QList< QSharedPointer<DM::IChunkDownload> > currentChunkDownloads;
 
-      QTimer timerIMAlive;
+      FindRequestHandler findRequestHandler; ///< Run the searches received.
+
+      QTimer timerIMAlive; // Belongs to the main thread.
       QSharedPointer<LM::ILogger> loggerIMAlive; // A logger especially for the IMAlive message.
+      LatencyMeter IMAliveLatency; // Belongs to the main thread like the peer manager.
    };
 }
 #endif
@@ -66,9 +66,10 @@ namespace PM
       virtual quint64 getSharingAmount() const = 0;
 
       /**
-        * Return the average speed when downloading from this peer.
+        * Return the expected speed when downloading the next chunk from this peer.
         * [bytes/s].
-        * The default speed is 2^32-1.
+        * It takes into account the measured speeds and their variability, the latency of the requests, the rate of failed transfers
+        * and the upload rate advertised by the peer. The default speed is near to 2^32-1 when no speed is known.
         */
       virtual quint32 getSpeed() = 0;
 
@@ -79,6 +80,16 @@ namespace PM
         */
       virtual void setSpeed(quint32 newSpeed) = 0;
 
+      /**
+        * Set the time between a 'GetChunk' request and its answer when accepted, minus the time the request waited for a free upload slot [ms].
+        */
+      virtual void setLatency(quint32 latency) = 0;
+
+      /**
+        * Tell if a transfer from this peer has succeeded or has failed because of the peer (network error, corrupted data).
+        */
+      virtual void setTransferResult(bool succeeded) = 0;
+
       /**
         * Ban a peer for a given duration [ms].
         * 'isAvailable()' will return false while the duration.
@@ -107,6 +118,7 @@ namespace PM
         * Ask for the hashes of a given file.
         * This method is non-blocking, the hashes will be delivered by the signal 'nextHashResult' followed by
         * one or more 'nextHash' signal.
+        * The hashes already known by the peer come within the result, they are emitted by 'nextHash' too.
         */
       virtual QSharedPointer<IGetHashesResult> getHashes(const Protos::Common::Entry& file) = 0;
 
@@ -60,6 +60,7 @@ namespace PM
       /**
         * Return the IPeer* coresponding to ID.
         * Return 0 if the peer doesn't exist.
+        * This method is thread-safe.
         */
       virtual IPeer* getPeer(const Common::Hash& ID) = 0;
 
@@ -71,8 +72,9 @@ namespace PM
       /**
         * The method must be call frequently to tell that a peer (ID) is still alive.
         * @see The protobuf message 'Protos.Core.IMAlive' in "Protos/core_protocol.proto".
+        * When called from another thread the update is queued to the thread of the peer manager.
         */
-      virtual void updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion) = 0;
+      virtual void updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion, quint32 uploadRate = 0) = 0;
 
       /**
         * @param tcpSocket PeerManager will care about deleting the socket.
@@ -82,9 +84,11 @@ namespace PM
    signals:
       /**
         * When a remote peer want a chunk, this signal is emitted.
-        * The chunk will be sent using the socket object. Once the data is finished to send the method 'ISocket::finished()' must be called.
+        * The request must be answered with 'ISocket::sendGetChunkResult(..)', if the answer is 'OK' the chunk
+        * will be sent using the socket object. Once the data is finished to send the method 'ISocket::finished()' must be called.
+        * @param compressionSupported The remote peer can receive the data as compressed blocks, see 'Protos::Core::GetChunkResult::compressed'.
         */
-      void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket);
+      void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<PM::ISocket> socket);
 
       /**
         * Emitted when a peer becomes alive or is not banned anymore.
@@ -61,6 +61,12 @@ namespace PM
         */
       virtual Common::Hash getRemotePeerID() const = 0;
 
+      /**
+        * Answer to the 'GetChunk' request received on this socket, see the signal 'IPeerManager::getChunk(..)'.
+        * If the status is 'OK' the data of the chunk must be written afterwards, else the socket is released at once.
+        */
+      virtual void sendGetChunkResult(const Protos::Core::GetChunkResult& result) = 0;
+
       /**
         * Used by uploader to tell when an upload is finished.
         * TODO: should be removed and only be called by the peerManager (as with downloads).
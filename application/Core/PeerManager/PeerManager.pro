@@ -21,6 +21,7 @@ SOURCES += priv/PeerManager.cpp \
     priv/GetEntriesResult.cpp \
     priv/GetHashesResult.cpp \
     priv/GetChunkResult.cpp \
+    priv/SpeedEstimator.cpp \
     priv/Log.cpp
 HEADERS += IPeerManager.h \
     IPeer.h \
@@ -37,4 +38,5 @@ HEADERS += IPeerManager.h \
     ISocket.h \
     priv/GetEntriesResult.h \
     priv/GetHashesResult.h \
-    priv/GetChunkResult.h
+    priv/GetChunkResult.h \
+    priv/SpeedEstimator.h
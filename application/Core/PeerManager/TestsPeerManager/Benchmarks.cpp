@@ -0,0 +1,498 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <Benchmarks.h>
+
+#include <QtDebug>
+#include <QTest>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+
+#include <limits>
+
+#include <Libs/MersenneTwister.h>
+
+#include <Protos/core_settings.pb.h>
+
+#include <Common/LogManager/Builder.h>
+#include <Common/PersistentData.h>
+#include <Common/Constants.h>
+#include <Common/Global.h>
+#include <Common/Settings.h>
+#include <Common/BlockCompressor.h>
+#include <Common/BlockDecompressor.h>
+#include <Core/FileManager/Builder.h>
+
+#include <Builder.h>
+#include <IPeer.h>
+#include <priv/SpeedEstimator.h>
+
+const int NB_PEERS = 500;
+const int NB_IMALIVE_PER_PEER = 1000;
+const quint32 IMALIVE_PERIOD = 200; // [ms].
+
+namespace
+{
+   const double MIB = 1024.0 * 1024.0;
+   const double LAN_SPEED = 50.0 * MIB; // [B/s].
+   const double CHUNK_SIZE = 64.0 * MIB; // [B].
+   const double SPEED_VALIDITY_PERIOD = 60000.0; // [ms]. The value given by the default settings.
+   const double SOCKET_TIMEOUT = 5000.0; // [ms].
+   const quint32 MAX_SPEED = std::numeric_limits<quint32>::max();
+
+   /**
+     * A peer simulated by 'Benchmarks::peerSelectionSimulation()'.
+     * The speed is divided by the factor (LAN_SPEED + load) / LAN_SPEED when the peer uploads to other peers.
+     */
+   struct SyntheticPeer
+   {
+      double speed; // [MiB/s].
+      double jitter; // The speed of each chunk is 'speed' * (1 ± 'jitter').
+      double latency; // [ms].
+      double errorProbability; // A failed transfer stops at a random position and is detected after a socket timeout.
+      double load; // [MiB/s]. The upload rate to the other peers, during one period out of two.
+      double loadPeriod; // [ms]. 0 means the load is constant.
+   };
+
+   const SyntheticPeer SYNTHETIC_PEERS[] = {
+      { 60.0, 0.05,    2.0, 0.0,   0.0,     0.0 }, // Steady fast.
+      { 35.0, 0.05,    2.0, 0.0,   0.0,     0.0 }, // Steady medium.
+      { 70.0, 0.9,     2.0, 0.0,   0.0,     0.0 }, // Erratic.
+      { 80.0, 0.1,     2.0, 0.5,   0.0,     0.0 }, // Flaky.
+      { 90.0, 0.1,     2.0, 0.0, 150.0, 20000.0 }, // Loaded.
+      { 50.0, 0.1,  1500.0, 0.0,   0.0,     0.0 }, // Far.
+      { 5.0, 0.1,     2.0, 0.0,   0.0,     0.0 }, // Slow.
+      { 20.0, 0.3,    50.0, 0.1,   0.0,     0.0 } // Wifi.
+   };
+   const int NB_SYNTHETIC_PEERS = sizeof(SYNTHETIC_PEERS) / sizeof(SyntheticPeer);
+
+   double getLoad(const SyntheticPeer& peer, double time)
+   {
+      if (peer.loadPeriod == 0.0 || static_cast<qint64>(time / peer.loadPeriod) % 2 == 0)
+         return peer.load * MIB;
+      return 0.0;
+   }
+
+   /**
+     * The speed model used before 'PM::SpeedEstimator': the average of the last speed and the new one, forgotten after a while.
+     */
+   class HalfAverageSpeedModel
+   {
+   public:
+      HalfAverageSpeedModel() : speed(MAX_SPEED), lastSampleTime(-1.0) {}
+
+      quint32 getSpeed(double time, double)
+      {
+         if (this->lastSampleTime >= 0.0 && time - this->lastSampleTime > SPEED_VALIDITY_PERIOD)
+            this->speed = MAX_SPEED;
+         return this->speed;
+      }
+
+      void addTransfer(double time, quint32 speed, quint32, bool)
+      {
+         this->lastSampleTime = time;
+         this->speed = this->speed == MAX_SPEED ? speed : (this->speed + speed) / 2;
+      }
+
+   private:
+      quint32 speed;
+      double lastSampleTime;
+   };
+
+   /**
+     * The model of 'PM::Peer'.
+     */
+   class EstimatorSpeedModel
+   {
+   public:
+      EstimatorSpeedModel() : lastSampleTime(-1.0) {}
+
+      quint32 getSpeed(double time, double load)
+      {
+         if (this->lastSampleTime >= 0.0 && time - this->lastSampleTime > SPEED_VALIDITY_PERIOD)
+            this->estimator.reset();
+         return this->estimator.estimate(MAX_SPEED, static_cast<quint32>(load), static_cast<quint32>(LAN_SPEED), static_cast<quint32>(CHUNK_SIZE));
+      }
+
+      void addTransfer(double time, quint32 speed, quint32 latency, bool succeeded)
+      {
+         this->lastSampleTime = time;
+         this->estimator.addSpeed(speed);
+         this->estimator.addLatency(latency);
+         this->estimator.addTransferResult(succeeded);
+      }
+
+   private:
+      PM::SpeedEstimator estimator;
+      double lastSampleTime;
+   };
+
+   struct SimulatedTransfer
+   {
+      double end; // [ms].
+      int peer;
+      bool succeeded;
+      quint32 speed; // [B/s].
+   };
+
+   /**
+     * Download 'nbChunks' chunks with 'nbDownloaders' parallel downloads like 'DM::DownloadManager', each peer serves one chunk at a time.
+     * When a download is free it takes the fastest free peer according to the model.
+     * @return The aggregate throughput [B/s].
+     */
+   template <typename SpeedModel>
+   double simulateDownloads(quint32 seed, int nbChunks, int nbDownloaders)
+   {
+      MTRand mtrand(seed);
+      QList<SpeedModel> models;
+      QList<bool> occupied;
+      for (int i = 0; i < NB_SYNTHETIC_PEERS; i++)
+      {
+         models << SpeedModel();
+         occupied << false;
+      }
+
+      QList<SimulatedTransfer> transfers;
+      int nbChunksRemaining = nbChunks;
+      double time = 0.0;
+
+      forever
+      {
+         // Start new transfers.
+         while (nbChunksRemaining > 0 && transfers.size() < nbDownloaders)
+         {
+            int best = -1;
+            quint32 bestSpeed = 0;
+            for (int i = 0; i < NB_SYNTHETIC_PEERS; i++)
+            {
+               if (occupied[i])
+                  continue;
+               const quint32 speed = models[i].getSpeed(time, getLoad(SYNTHETIC_PEERS[i], time));
+               if (best == -1 || speed > bestSpeed)
+               {
+                  best = i;
+                  bestSpeed = speed;
+               }
+            }
+            if (best == -1)
+               break;
+
+            const SyntheticPeer& peer = SYNTHETIC_PEERS[best];
+            SimulatedTransfer transfer;
+            transfer.peer = best;
+            transfer.speed = static_cast<quint32>(peer.speed * MIB * LAN_SPEED / (LAN_SPEED + getLoad(peer, time)) * (1.0 + peer.jitter * (2.0 * mtrand.rand() - 1.0)));
+            transfer.succeeded = mtrand.rand() >= peer.errorProbability;
+            transfer.end = time + peer.latency + (transfer.succeeded ? 1.0 : mtrand.rand()) * 1000.0 * CHUNK_SIZE / transfer.speed + (transfer.succeeded ? 0.0 : SOCKET_TIMEOUT);
+            transfers << transfer;
+
+            occupied[best] = true;
+            nbChunksRemaining--;
+         }
+
+         if (transfers.isEmpty())
+            break;
+
+         // Finish the earliest transfer.
+         int first = 0;
+         for (int i = 1; i < transfers.size(); i++)
+            if (transfers[i].end < transfers[first].end)
+               first = i;
+         const SimulatedTransfer transfer = transfers.takeAt(first);
+
+         time = transfer.end;
+         occupied[transfer.peer] = false;
+         models[transfer.peer].addTransfer(time, transfer.speed, SYNTHETIC_PEERS[transfer.peer].latency, transfer.succeeded);
+         if (!transfer.succeeded)
+            nbChunksRemaining++;
+      }
+
+      return nbChunks * CHUNK_SIZE / (time / 1000.0);
+   }
+
+   const int LOOPBACK_DATA_SIZE = 64 * 1024 * 1024; // [B].
+   const double LOOPBACK_COMPRESSION_RATIO = 0.8; // The former default value of 'upload_compression_ratio'.
+
+   /**
+     * Send some data to a local port like 'UM::Upload' : read by buffers of 'buffer_size_reading' bytes,
+     * encoded by a 'Common::BlockCompressor' if the ratio isn't 0.
+     */
+   class LoopbackSender : public QThread
+   {
+   public:
+      LoopbackSender(quint16 port, const QByteArray& data, double compressionRatio) :
+         port(port), data(data), compressionRatio(compressionRatio), nbBytesSent(0) {}
+
+      qint64 getNbBytesSent() const { return this->nbBytesSent; }
+
+   protected:
+      void run()
+      {
+         const int BUFFER_SIZE = SETTINGS.get<quint32>("buffer_size_reading");
+         const qint64 SOCKET_BUFFER_SIZE = SETTINGS.get<quint32>("socket_buffer_size");
+         const int SOCKET_TIMEOUT = SETTINGS.get<quint32>("socket_timeout");
+
+         QTcpSocket socket;
+         socket.connectToHost(QHostAddress::LocalHost, this->port);
+         if (!socket.waitForConnected(SOCKET_TIMEOUT))
+            return;
+
+         Common::BlockCompressor compressor(this->compressionRatio, SETTINGS.get<quint32>("upload_compression_nb_blocks_to_skip"));
+
+         for (int offset = 0; offset < this->data.size(); offset += BUFFER_SIZE)
+         {
+            const int size = this->data.size() - offset < BUFFER_SIZE ? this->data.size() - offset : BUFFER_SIZE;
+            const QByteArray blocks = this->compressionRatio > 0.0 ? compressor.encode(this->data.constData() + offset, size) : QByteArray::fromRawData(this->data.constData() + offset, size);
+
+            if (socket.write(blocks) == -1)
+               return;
+            this->nbBytesSent += blocks.size();
+
+            while (socket.bytesToWrite() > SOCKET_BUFFER_SIZE)
+               if (!socket.waitForBytesWritten(SOCKET_TIMEOUT))
+                  return;
+         }
+
+         while (socket.bytesToWrite() > 0)
+            if (!socket.waitForBytesWritten(SOCKET_TIMEOUT))
+               return;
+
+         socket.disconnectFromHost();
+         if (socket.state() != QAbstractSocket::UnconnectedState)
+            socket.waitForDisconnected(SOCKET_TIMEOUT);
+      }
+
+   private:
+      const quint16 port;
+      const QByteArray& data;
+      const double compressionRatio;
+      qint64 nbBytesSent;
+   };
+}
+
+Benchmarks::Benchmarks()
+{
+}
+
+void Benchmarks::initTestCase()
+{
+   LM::Builder::initMsgHandler();
+   qDebug() << "===== initTestCase() =====";
+
+   try
+   {
+      Common::Global::setCurrentDirToTemp("PeerManagerBenchmarks");
+   }
+   catch(Common::Global::UnableToSetTempDirException& e)
+   {
+      QFAIL(e.errorMessage.toAscii().constData());
+   }
+
+   Common::PersistentData::rmValue(Common::Constants::FILE_CACHE, Common::Global::LOCAL); // Reset the stored cache.
+
+   SETTINGS.setFilename("core_settings_peer_manager_benchmarks.txt");
+   SETTINGS.setSettingsMessage(new Protos::Core::Settings());
+   SETTINGS.set("peer_imalive_period", IMALIVE_PERIOD); // The peers die quickly when they don't send any IMAlive message.
+
+   this->fileManager = FM::Builder::newFileManager();
+   this->peerManager = PM::Builder::newPeerManager(this->fileManager);
+
+   for (int i = 0; i < NB_PEERS; i++)
+      this->peerIDs << Common::Hash::rand();
+}
+
+/**
+  * Replay the IMAlive messages of 'NB_PEERS' peers, each message is followed by a lookup of the sender like for each received datagram.
+  * The same lookups are made with a linear search for comparison. Then the peers die and are removed from the alive peers.
+  */
+void Benchmarks::IMAliveStorm()
+{
+   qDebug() << "===== IMAliveStorm() =====";
+
+   const QHostAddress address(QHostAddress::LocalHost);
+
+   QElapsedTimer timer;
+   timer.start();
+
+   int nbFound = 0;
+   for (int i = 0; i < NB_IMALIVE_PER_PEER; i++)
+      foreach (Common::Hash peerID, this->peerIDs)
+      {
+         this->peerManager->updatePeer(peerID, address, 59487, "peer", 42, "1.0");
+         if (this->peerManager->getPeer(peerID))
+            nbFound++;
+      }
+
+   qDebug() << QString("%1 IMAlive messages from %2 peers in %3 ms").arg(NB_IMALIVE_PER_PEER * NB_PEERS).arg(NB_PEERS).arg(timer.elapsed());
+   QCOMPARE(nbFound, NB_IMALIVE_PER_PEER * NB_PEERS);
+   QCOMPARE(this->peerManager->getPeers().size(), NB_PEERS);
+
+   timer.start();
+   nbFound = 0;
+   for (int i = 0; i < NB_IMALIVE_PER_PEER; i++)
+      foreach (Common::Hash peerID, this->peerIDs)
+         for (QListIterator<Common::Hash> j(this->peerIDs); j.hasNext();)
+            if (j.next() == peerID)
+            {
+               nbFound++;
+               break;
+            }
+
+   qDebug() << QString("%1 linear searches among %2 peers in %3 ms").arg(NB_IMALIVE_PER_PEER * NB_PEERS).arg(NB_PEERS).arg(timer.elapsed());
+   QCOMPARE(nbFound, NB_IMALIVE_PER_PEER * NB_PEERS);
+
+   // Only the first half of the peers stay alive.
+   timer.start();
+   while (timer.elapsed() < 4 * SETTINGS.get<double>("peer_timeout_factor") * IMALIVE_PERIOD)
+   {
+      for (int i = 0; i < NB_PEERS / 2; i++)
+         this->peerManager->updatePeer(this->peerIDs[i], address, 59487, "peer", 42, "1.0");
+      QTest::qWait(IMALIVE_PERIOD);
+   }
+
+   QCOMPARE(this->peerManager->getPeers().size(), NB_PEERS / 2);
+   QVERIFY(this->peerManager->getPeer(this->peerIDs.last()));
+   QVERIFY(!this->peerManager->getPeer(this->peerIDs.last())->isAlive());
+
+   timer.start();
+   int nbAlivePeers = 0;
+   for (int i = 0; i < NB_IMALIVE_PER_PEER; i++)
+      nbAlivePeers += this->peerManager->getPeers().size();
+
+   qDebug() << QString("%1 calls to 'getPeers()' with %2 alive peers among %3 in %4 ms").arg(NB_IMALIVE_PER_PEER).arg(NB_PEERS / 2).arg(NB_PEERS).arg(timer.elapsed());
+}
+
+/**
+  * Simulate the download of some chunks from synthetic peers (steady, erratic, flaky, loaded, etc.) with a virtual clock.
+  * The aggregate throughput is compared between the former speed model (half average) and 'PM::SpeedEstimator'.
+  * The switching to a better peer during a transfer isn't simulated.
+  */
+void Benchmarks::peerSelectionSimulation()
+{
+   qDebug() << "===== peerSelectionSimulation() =====";
+
+   const int NB_RUNS = 10;
+   const int NB_CHUNKS = 200;
+   const int NB_DOWNLOADERS = 3;
+
+   double totalHalfAverage = 0.0;
+   double totalEstimator = 0.0;
+
+   for (int seed = 1; seed <= NB_RUNS; seed++)
+   {
+      const double throughputHalfAverage = simulateDownloads<HalfAverageSpeedModel>(seed, NB_CHUNKS, NB_DOWNLOADERS);
+      const double throughputEstimator = simulateDownloads<EstimatorSpeedModel>(seed, NB_CHUNKS, NB_DOWNLOADERS);
+      totalHalfAverage += throughputHalfAverage;
+      totalEstimator += throughputEstimator;
+
+      qDebug() << QString("Run %1: half average: %2/s, estimator: %3/s")
+         .arg(seed).arg(Common::Global::formatByteSize(static_cast<qint64>(throughputHalfAverage))).arg(Common::Global::formatByteSize(static_cast<qint64>(throughputEstimator)));
+   }
+
+   qDebug() << QString("Mean aggregate throughput of %1 chunks from %2 peers with %3 downloaders: half average: %4/s, estimator: %5/s")
+      .arg(NB_CHUNKS).arg(NB_SYNTHETIC_PEERS).arg(NB_DOWNLOADERS)
+      .arg(Common::Global::formatByteSize(static_cast<qint64>(totalHalfAverage / NB_RUNS))).arg(Common::Global::formatByteSize(static_cast<qint64>(totalEstimator / NB_RUNS)));
+
+   QVERIFY(totalEstimator > totalHalfAverage);
+}
+
+void Benchmarks::transferOnLoopback_data()
+{
+   QTest::addColumn<bool>("compressible");
+   QTest::addColumn<double>("compressionRatio");
+
+   QTest::newRow("compressible data, without compression") << true << 0.0;
+   QTest::newRow("compressible data, with compression") << true << LOOPBACK_COMPRESSION_RATIO;
+   QTest::newRow("incompressible data, without compression") << false << 0.0;
+   QTest::newRow("incompressible data, with compression") << false << LOOPBACK_COMPRESSION_RATIO;
+}
+
+/**
+  * Measure the throughput of a transfer of 'LOOPBACK_DATA_SIZE' bytes on the loopback interface, with and without the compression of the blocks,
+  * see 'upload_compression_ratio'. The compressible data are some text, the incompressible ones are random.
+  * The receiver decodes the blocks like 'DM::ChunkDownload' and checks the data.
+  * The loopback is much faster than a LAN, the throughput measured with the compression is the one of zlib on one core.
+  */
+void Benchmarks::transferOnLoopback()
+{
+   QFETCH(bool, compressible);
+   QFETCH(double, compressionRatio);
+
+   qDebug() << "===== transferOnLoopback() =====";
+
+   QByteArray data;
+   data.reserve(LOOPBACK_DATA_SIZE);
+   if (compressible)
+   {
+      const QByteArray line("2012-06-09 17:42:03 [DEBU] PeerManager: Peer::update(..) : the peer is alive, its IMAlive message has been received.\n");
+      while (data.size() < LOOPBACK_DATA_SIZE)
+         data.append(QByteArray::number(data.size())).append(' ').append(line);
+   }
+   else
+   {
+      MTRand mtrand(42);
+      data.resize(LOOPBACK_DATA_SIZE);
+      for (int i = 0; i < data.size(); i++)
+         data[i] = static_cast<char>(mtrand.randInt(255));
+   }
+   data.truncate(LOOPBACK_DATA_SIZE);
+
+   QTcpServer server;
+   QVERIFY(server.listen(QHostAddress::LocalHost));
+
+   LoopbackSender sender(server.serverPort(), data, compressionRatio);
+
+   QElapsedTimer timer;
+   timer.start();
+
+   sender.start();
+
+   QVERIFY(server.waitForNewConnection(SETTINGS.get<quint32>("socket_timeout")));
+   QTcpSocket* socket = server.nextPendingConnection();
+
+   Common::BlockDecompressor decompressor;
+   QByteArray received;
+   received.reserve(LOOPBACK_DATA_SIZE);
+   QByteArray buffer(SETTINGS.get<quint32>("buffer_size_reading"), 0);
+
+   while (received.size() < data.size() && socket->waitForReadyRead(SETTINGS.get<quint32>("socket_timeout")))
+   {
+      const QByteArray bytes = socket->readAll();
+      if (compressionRatio > 0.0)
+      {
+         decompressor.feed(bytes.constData(), bytes.size());
+         while (const int bytesRead = decompressor.read(buffer.data(), buffer.size()))
+            received.append(buffer.constData(), bytesRead);
+         QVERIFY(!decompressor.hasError());
+      }
+      else
+         received.append(bytes);
+   }
+
+   const qint64 elapsed = timer.elapsed();
+   sender.wait();
+   delete socket;
+
+   QCOMPARE(received.size(), data.size());
+   QVERIFY(received == data);
+
+   qDebug() << QString("%1 : %2 sent in %3 ms (%4/s), %5 on the wire").arg(QTest::currentDataTag())
+      .arg(Common::Global::formatByteSize(data.size())).arg(elapsed).arg(Common::Global::formatByteSize(elapsed == 0 ? 0 : 1000LL * data.size() / elapsed)).arg(Common::Global::formatByteSize(sender.getNbBytesSent()));
+}
@@ -0,0 +1,55 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef TESTS_PEERMANAGER_BENCHMARKS_H
+#define TESTS_PEERMANAGER_BENCHMARKS_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QList>
+
+#include <Common/Hash.h>
+#include <Core/FileManager/IFileManager.h>
+
+#include <IPeerManager.h>
+
+/**
+  * Some measures of the PeerManager performances, run with the argument '-bench'.
+  * The results are printed with 'qDebug()'.
+  */
+class Benchmarks : public QObject
+{
+   Q_OBJECT
+public:
+   Benchmarks();
+
+private slots:
+   void initTestCase();
+   void IMAliveStorm();
+   void peerSelectionSimulation();
+   void transferOnLoopback_data();
+   void transferOnLoopback();
+
+private:
+   QSharedPointer<FM::IFileManager> fileManager;
+   QSharedPointer<PM::IPeerManager> peerManager;
+
+   QList<Common::Hash> peerIDs;
+};
+
+#endif
@@ -0,0 +1,113 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <ChunkRequester.h>
+using namespace PM;
+
+#include <QtDebug>
+#include <QTest>
+#include <QElapsedTimer>
+
+#include <Common/ProtoHelper.h>
+
+/**
+  * @class ChunkRequester
+  *
+  * Ask some chunks to a peer and hold the received streams without reading them,
+  * thus the remote upload slots stay taken until the requests are released.
+  * The results are recorded in their arrival order.
+  */
+
+void ChunkRequester::ask(const QString& name, IPeer* peer, const Common::Hash& chunkHash)
+{
+   Protos::Core::GetChunk getChunkMessage;
+   getChunkMessage.mutable_chunk()->set_hash(chunkHash.getData(), Common::Hash::HASH_SIZE);
+   getChunkMessage.set_offset(0);
+
+   QSharedPointer<IGetChunkResult> result = peer->getChunk(getChunkMessage);
+   connect(result.data(), SIGNAL(result(const Protos::Core::GetChunkResult&)), this, SLOT(result(const Protos::Core::GetChunkResult&)));
+   connect(result.data(), SIGNAL(stream(QSharedPointer<PM::ISocket>)), this, SLOT(stream(QSharedPointer<PM::ISocket>)));
+   this->requests.insert(name, result);
+   result->start();
+}
+
+/**
+  * Forget the given request, if its stream has been received the connection is closed, it ends the remote upload.
+  */
+void ChunkRequester::release(const QString& name)
+{
+   QSharedPointer<IGetChunkResult> result = this->requests.take(name);
+   if (result.isNull())
+      return;
+
+   if (!this->streams.take(name).isNull())
+      result->setStatus(ISocket::SFS_TO_CLOSE);
+}
+
+void ChunkRequester::releaseAll()
+{
+   foreach (QString name, this->requests.keys())
+      this->release(name);
+}
+
+QStringList ChunkRequester::getResults() const
+{
+   return this->results;
+}
+
+/**
+  * Wait until at least 'n' results are received.
+  * @param timeout [ms]
+  * @return false if the results haven't been received in time.
+  */
+bool ChunkRequester::waitForNbResults(int n, int timeout)
+{
+   QElapsedTimer timer;
+   timer.start();
+
+   while (this->results.size() < n)
+   {
+      if (timer.elapsed() > timeout)
+         return false;
+      QTest::qWait(100);
+   }
+   return true;
+}
+
+void ChunkRequester::result(const Protos::Core::GetChunkResult& result)
+{
+   const QString name = this->getRequestName(this->sender());
+   qDebug() << "ChunkRequester::result : " << name << Common::ProtoHelper::getDebugStr(result);
+   this->results << QString("%1:%2").arg(name).arg(QString::fromStdString(Protos::Core::GetChunkResult_Status_Name(result.status())));
+}
+
+void ChunkRequester::stream(QSharedPointer<PM::ISocket> socket)
+{
+   this->streams.insert(this->getRequestName(this->sender()), socket);
+}
+
+QString ChunkRequester::getRequestName(QObject* getChunkResult) const
+{
+   for (QMapIterator<QString, QSharedPointer<IGetChunkResult> > i(this->requests); i.hasNext();)
+   {
+      i.next();
+      if (i.value().data() == getChunkResult)
+         return i.key();
+   }
+   return QString();
+}
@@ -0,0 +1,59 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef TESTS_PEERMANAGER_CHUNKREQUESTER_H
+#define TESTS_PEERMANAGER_CHUNKREQUESTER_H
+
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QMap>
+
+#include <Protos/core_protocol.pb.h>
+
+#include <Common/Hash.h>
+
+#include <IPeer.h>
+#include <IGetChunkResult.h>
+#include <ISocket.h>
+using namespace PM;
+
+class ChunkRequester : public QObject
+{
+   Q_OBJECT
+public:
+   void ask(const QString& name, IPeer* peer, const Common::Hash& chunkHash);
+   void release(const QString& name);
+   void releaseAll();
+
+   QStringList getResults() const;
+   bool waitForNbResults(int n, int timeout);
+
+private slots:
+   void result(const Protos::Core::GetChunkResult& result);
+   void stream(QSharedPointer<PM::ISocket> socket);
+
+private:
+   QString getRequestName(QObject* getChunkResult) const;
+
+   QMap<QString, QSharedPointer<IGetChunkResult> > requests;
+   QMap<QString, QSharedPointer<PM::ISocket> > streams; ///< The streams are kept unread, the upload continues until they are released.
+   QStringList results; ///< "<name>:<status>" in the order of reception.
+};
+
+#endif
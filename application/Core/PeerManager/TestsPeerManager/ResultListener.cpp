@@ -64,6 +64,11 @@ quint32 ResultListener::getNbHashReceivedFromLastGetHashes()
    return this->currentHash;
 }
 
+QList<Common::Hash> ResultListener::getHashesReceivedFromLastGetHashes() const
+{
+   return this->hashesReceived;
+}
+
 bool ResultListener::isStreamReceived()
 {
    return this->streamReceived;
@@ -77,14 +82,17 @@ void ResultListener::entriesResult(const Protos::Core::GetEntriesResult& result)
 
 void ResultListener::result(const Protos::Core::GetHashesResult& result)
 {
+   this->lastGesHashesResult = result;
    this->nbHashes = result.nb_hash();
    this->currentHash = 0;
+   this->hashesReceived.clear();
    qDebug() << "ResultListener::result : " << Common::ProtoHelper::getDebugStr(result);
 }
 
 void ResultListener::nextHash(const Common::Hash& hash)
 {
    this->lastHashReceived = hash;
+   this->hashesReceived << hash;
    qDebug() << "ResultListener::nextHash : [" << this->currentHash + 1 << "/" << this->nbHashes << "] " << hash.toStr();
    this->currentHash++;
 }
@@ -105,8 +113,13 @@ void ResultListener::stream(QSharedPointer<PM::ISocket> socket)
    this->streamReceived = true;
 }
 
-void ResultListener::getChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<ISocket> socket)
+void ResultListener::getChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<ISocket> socket)
 {
+   Protos::Core::GetChunkResult result;
+   result.set_status(Protos::Core::GetChunkResult_Status_OK);
+   result.set_chunk_size(CHUNK_DATA.size());
+   socket->sendGetChunkResult(result);
+
    socket->write(CHUNK_DATA);
    socket->finished(PM::ISocket::SFS_OK);
 }
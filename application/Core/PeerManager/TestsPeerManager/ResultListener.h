@@ -43,6 +43,7 @@ public:
    const Protos::Core::GetHashesResult& getLastGetHashesResult();
    const Common::Hash& getLastReceivedHash();
    quint32 getNbHashReceivedFromLastGetHashes();
+   QList<Common::Hash> getHashesReceivedFromLastGetHashes() const;
 
    bool isStreamReceived();
 
@@ -54,7 +55,7 @@ public slots:
 
    void result(const Protos::Core::GetChunkResult& result);
    void stream(QSharedPointer<PM::ISocket> socket);
-   void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket);
+   void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<PM::ISocket> socket);
 
 private:
    QList<Protos::Core::GetEntriesResult> entriesResultList;
@@ -64,6 +65,7 @@ private:
    quint32 nbHashes;
    quint32 currentHash;
    Common::Hash lastHashReceived;
+   QList<Common::Hash> hashesReceived;
 
    bool streamReceived;
 };
@@ -32,15 +32,21 @@
   */
 
 TestServer::TestServer(QSharedPointer<PM::IPeerManager> peerManager, int port) :
-   peerManager(peerManager)
+   peerManager(peerManager), nbConnections(0)
 {
    connect(&this->server, SIGNAL(newConnection()), this, SLOT(newConnection()));
    QVERIFY(this->server.listen(QHostAddress::Any, port));
 }
 
+int TestServer::getNbConnections() const
+{
+   return this->nbConnections;
+}
+
 void TestServer::newConnection()
 {
    qDebug() << "TestServer::newConnection()";
+   this->nbConnections++;
    QTcpSocket* socket = this->server.nextPendingConnection();
    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
    this->peerManager->newConnection(socket);
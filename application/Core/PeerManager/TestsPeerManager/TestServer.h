@@ -29,6 +29,8 @@ class TestServer : QObject
 public:
    TestServer(QSharedPointer<PM::IPeerManager> peerManager, int port);
 
+   int getNbConnections() const;
+
 private slots:
    void newConnection();
 
@@ -36,6 +38,7 @@ private:
    QSharedPointer<PM::IPeerManager> peerManager;
 
    QTcpServer server;
+   int nbConnections; ///< The number of connections accepted so far.
 };
 
 #endif
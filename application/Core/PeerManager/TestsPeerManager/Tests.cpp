@@ -33,11 +33,15 @@ using namespace PM;
 #include <Common/ZeroCopyStreamQIODevice.h>
 #include <Common/Settings.h>
 
+#include <Core/UploadManager/Builder.h>
+#include <Core/DownloadManager/priv/OccupiedPeers.h>
+
 #include <ResultListener.h>
 #include <IGetEntriesResult.h>
 #include <IGetHashesResult.h>
 
 const int Tests::PORT = 59487;
+const int Tests::UPLOAD_QUEUE_TIMEOUT = 6000;
 
 /**
   * @class Tests
@@ -71,12 +75,13 @@ void Tests::initTestCase()
 
    this->createInitialFiles();
 
-   this->fileManagers << FM::Builder::newFileManager() << FM::Builder::newFileManager();
+   this->fileManagers << FM::Builder::newFileManager() << FM::Builder::newFileManager() << FM::Builder::newFileManager();
 
    this->peerIDs << Hash::fromStr("11111111111111111111111111111111111111111111111111111111") <<
-                    Hash::fromStr("22222222222222222222222222222222222222222222222222222222");
+                    Hash::fromStr("22222222222222222222222222222222222222222222222222222222") <<
+                    Hash::fromStr("33333333333333333333333333333333333333333333333333333333");
 
-   this->peerSharedDirs << "/sharedDirs/peer1" << "/sharedDirs/peer2";
+   this->peerSharedDirs << "/sharedDirs/peer1" << "/sharedDirs/peer2" << "/sharedDirs/peer3";
 
    // 1) Create each peer manager.
    for (int i = 0; i < this->peerIDs.size(); i++)
@@ -182,7 +187,7 @@ void Tests::askForRootEntries()
    qDebug() << "===== askForRootEntries() =====";
 
    Protos::Core::GetEntries getEntriesMessage;
-   QSharedPointer<IGetEntriesResult> result = this->peerManagers[0]->getPeers()[0]->getEntries(getEntriesMessage);
+   QSharedPointer<IGetEntriesResult> result = this->peerManagers[0]->getPeer(this->peerIDs[1])->getEntries(getEntriesMessage);
    connect(result.data(), SIGNAL(result(Protos::Core::GetEntriesResult)), &this->resultListener, SLOT(entriesResult(Protos::Core::GetEntriesResult)));
    result->start();
 
@@ -211,7 +216,7 @@ void Tests::askForSomeEntries()
 
    Protos::Core::GetEntries getEntriesMessage1;
    getEntriesMessage1.mutable_dirs()->add_entry()->CopyFrom(this->resultListener.getEntriesResultList().last().entries(0).entry(0));
-   QSharedPointer<IGetEntriesResult> result1 = this->peerManagers[0]->getPeers()[0]->getEntries(getEntriesMessage1);
+   QSharedPointer<IGetEntriesResult> result1 = this->peerManagers[0]->getPeer(this->peerIDs[1])->getEntries(getEntriesMessage1);
    connect(result1.data(), SIGNAL(result(Protos::Core::GetEntriesResult)), &this->resultListener, SLOT(entriesResult(Protos::Core::GetEntriesResult)));
    result1->start();
 
@@ -227,7 +232,7 @@ void Tests::askForSomeEntries()
    Protos::Common::Entry* entry = getEntriesMessage2.mutable_dirs()->add_entry();
    entry->CopyFrom(this->resultListener.getEntriesResultList().last().entries(0).entry(0));
    entry->mutable_shared_dir()->CopyFrom(getEntriesMessage1.dirs().entry(0).shared_dir());
-   QSharedPointer<IGetEntriesResult> result2 = this->peerManagers[0]->getPeers()[0]->getEntries(getEntriesMessage2);
+   QSharedPointer<IGetEntriesResult> result2 = this->peerManagers[0]->getPeer(this->peerIDs[1])->getEntries(getEntriesMessage2);
    connect(result2.data(), SIGNAL(result(Protos::Core::GetEntriesResult)), &this->resultListener, SLOT(entriesResult(Protos::Core::GetEntriesResult)));
    result2->start();
 
@@ -240,6 +245,45 @@ void Tests::askForSomeEntries()
    }
 }
 
+/**
+  * Peer#1 asking several times for the root entries of peer#2 without waiting for the responses.
+  * The requests are pipelined over the same socket.
+  */
+void Tests::askForEntriesPipelined()
+{
+   qDebug() << "===== askForEntriesPipelined() =====";
+
+   const int NUMBER_OF_REQUEST = 8;
+   const int nbEntriesResultBefore = this->resultListener.getEntriesResultList().size();
+   const int nbConnectionsBefore = this->servers[1]->getNbConnections();
+   QVERIFY(nbConnectionsBefore > 0);
+
+   QList< QSharedPointer<IGetEntriesResult> > results;
+   for (int i = 0; i < NUMBER_OF_REQUEST; i++)
+   {
+      Protos::Core::GetEntries getEntriesMessage;
+      QSharedPointer<IGetEntriesResult> result = this->peerManagers[0]->getPeer(this->peerIDs[1])->getEntries(getEntriesMessage);
+      connect(result.data(), SIGNAL(result(Protos::Core::GetEntriesResult)), &this->resultListener, SLOT(entriesResult(Protos::Core::GetEntriesResult)));
+      result->start();
+      results << result;
+   }
+
+   QElapsedTimer timer;
+   timer.start();
+
+   while (this->resultListener.getEntriesResultList().size() != nbEntriesResultBefore + NUMBER_OF_REQUEST)
+   {
+      QTest::qWait(100);
+      if (timer.elapsed() > 3000)
+         QFAIL("We don't receive a response for each pipelined request.");
+   }
+
+   QCOMPARE(this->resultListener.getNbEntriesResultReceived(0), 1);
+
+   // The idle connection opened by the previous requests is shared by all the requests.
+   QCOMPARE(this->servers[1]->getNbConnections(), nbConnectionsBefore);
+}
+
 void Tests::askForHashes()
 {
    qDebug() << "===== askForHashes() =====";
@@ -278,7 +322,7 @@ void Tests::askForHashes()
    // Sets the root directory.
    fileEntry.mutable_shared_dir()->CopyFrom(this->resultListener.getEntriesResultList().first().entries(0).entry(0).shared_dir());
 
-   QSharedPointer<IGetHashesResult> result = this->peerManagers[0]->getPeers()[0]->getHashes(fileEntry);
+   QSharedPointer<IGetHashesResult> result = this->peerManagers[0]->getPeer(this->peerIDs[1])->getHashes(fileEntry);
    connect(result.data(), SIGNAL(result(const Protos::Core::GetHashesResult&)), &this->resultListener, SLOT(result(const Protos::Core::GetHashesResult&)));
    connect(result.data(), SIGNAL(nextHash(const Common::Hash&)), &this->resultListener, SLOT(nextHash(const Common::Hash&)));
    result->start();
@@ -301,16 +345,153 @@ void Tests::askForHashes()
    }
 }
 
+/**
+  * Ask again the hashes of 'big.bin', they are now all known by peer#2 and come within the result.
+  * They must be the same as the ones received one by one by 'askForHashes()'.
+  */
+void Tests::askForKnownHashes()
+{
+   qDebug() << "===== askForKnownHashes() =====";
+
+   const QList<Common::Hash> hashesStreamed = this->resultListener.getHashesReceivedFromLastGetHashes();
+   QVERIFY(!hashesStreamed.isEmpty());
+
+   Protos::Common::Entry fileEntry;
+   fileEntry.set_type(Protos::Common::Entry_Type_FILE);
+   fileEntry.set_path("/");
+   fileEntry.set_name("big.bin");
+   fileEntry.set_size(0);
+   fileEntry.mutable_shared_dir()->CopyFrom(this->resultListener.getEntriesResultList().first().entries(0).entry(0).shared_dir());
+
+   QSharedPointer<IGetHashesResult> result = this->peerManagers[0]->getPeer(this->peerIDs[1])->getHashes(fileEntry);
+   connect(result.data(), SIGNAL(result(const Protos::Core::GetHashesResult&)), &this->resultListener, SLOT(result(const Protos::Core::GetHashesResult&)));
+   connect(result.data(), SIGNAL(nextHash(const Common::Hash&)), &this->resultListener, SLOT(nextHash(const Common::Hash&)));
+   result->start();
+
+   QElapsedTimer timer;
+   timer.start();
+   while (this->resultListener.getNbHashReceivedFromLastGetHashes() != static_cast<quint32>(hashesStreamed.size()))
+   {
+      QTest::qWait(100);
+      if (timer.elapsed() > 3000)
+         QFAIL("We don't receive all the hashes");
+   }
+
+   QCOMPARE(this->resultListener.getLastGetHashesResult().hash_size(), hashesStreamed.size());
+   QVERIFY(this->resultListener.getHashesReceivedFromLastGetHashes() == hashesStreamed);
+}
+
+/**
+  * Peer#1 asking alternately for the hashes of a file being hashed by peer#2 and for the root entries of peer#2 without waiting for the responses.
+  * The hashes are streamed while they are computed, thus the entries are received before the end of the earlier requests.
+  * Each response must be matched with its request by its ID.
+  */
+void Tests::askForHashesAndEntriesPipelined()
+{
+   qDebug() << "===== askForHashesAndEntriesPipelined() =====";
+
+   const quint32 NUMBER_OF_CHUNK = 4;
+   const int NUMBER_OF_REQUEST = 4; // For each type.
+
+   const quint64 amountBefore = this->fileManagers[1]->getAmount();
+   const int nbConnectionsBefore = this->servers[1]->getNbConnections();
+
+   // 1) Create a big file, its hashes are computed while the requests are sent.
+   {
+      QFile file("sharedDirs/peer2/big2.bin");
+      file.open(QIODevice::WriteOnly);
+
+      for (quint32 i = 0; i < NUMBER_OF_CHUNK; i++)
+      {
+         QByteArray randomData(SETTINGS.get<quint32>("chunk_size"), NUMBER_OF_CHUNK + i);
+         file.write(randomData);
+      }
+   }
+
+   QElapsedTimer timer;
+
+   // Wait until the peer#2 knows 'big2.bin'.
+   timer.start();
+   while (this->fileManagers[1]->getAmount() <= amountBefore)
+   {
+      QTest::qWait(10);
+      if (timer.elapsed() > 3000)
+         QFAIL("After adding the big file 'big2.bin' the amount of data must increase");
+   }
+
+   Protos::Common::Entry fileEntry;
+   fileEntry.set_type(Protos::Common::Entry_Type_FILE);
+   fileEntry.set_path("/");
+   fileEntry.set_name("big2.bin");
+   fileEntry.set_size(0);
+   fileEntry.mutable_shared_dir()->CopyFrom(this->resultListener.getEntriesResultList().first().entries(0).entry(0).shared_dir());
+
+   // 2) Send the requests alternately, each one has its own listener.
+   QList< QSharedPointer<ResultListener> > hashesListeners;
+   QList< QSharedPointer<ResultListener> > entriesListeners;
+   QList< QSharedPointer<IGetHashesResult> > hashesResults;
+   QList< QSharedPointer<IGetEntriesResult> > entriesResults;
+
+   for (int i = 0; i < NUMBER_OF_REQUEST; i++)
+   {
+      QSharedPointer<ResultListener> hashesListener(new ResultListener());
+      QSharedPointer<IGetHashesResult> hashesResult = this->peerManagers[0]->getPeer(this->peerIDs[1])->getHashes(fileEntry);
+      connect(hashesResult.data(), SIGNAL(result(const Protos::Core::GetHashesResult&)), hashesListener.data(), SLOT(result(const Protos::Core::GetHashesResult&)));
+      connect(hashesResult.data(), SIGNAL(nextHash(const Common::Hash&)), hashesListener.data(), SLOT(nextHash(const Common::Hash&)));
+      hashesResult->start();
+      hashesListeners << hashesListener;
+      hashesResults << hashesResult;
+
+      Protos::Core::GetEntries getEntriesMessage;
+      QSharedPointer<ResultListener> entriesListener(new ResultListener());
+      QSharedPointer<IGetEntriesResult> entriesResult = this->peerManagers[0]->getPeer(this->peerIDs[1])->getEntries(getEntriesMessage);
+      connect(entriesResult.data(), SIGNAL(result(Protos::Core::GetEntriesResult)), entriesListener.data(), SLOT(entriesResult(Protos::Core::GetEntriesResult)));
+      entriesResult->start();
+      entriesListeners << entriesListener;
+      entriesResults << entriesResult;
+   }
+
+   // 3) The entries are received while the hashes are still being computed.
+   timer.start();
+   for (int i = 0; i < NUMBER_OF_REQUEST; i++)
+   {
+      while (entriesListeners[i]->getEntriesResultList().size() != 1)
+      {
+         QTest::qWait(10);
+         if (timer.elapsed() > 3000)
+            QFAIL("We don't receive a response for each pipelined 'GetEntries' request.");
+      }
+      QCOMPARE(entriesListeners[i]->getNbEntriesResultReceived(0), 1);
+   }
+   QVERIFY(hashesListeners.first()->getNbHashReceivedFromLastGetHashes() < NUMBER_OF_CHUNK);
+
+   // 4) Each 'GetHashes' request receives all the hashes of 'big2.bin', in the same order.
+   timer.start();
+   for (int i = 0; i < NUMBER_OF_REQUEST; i++)
+   {
+      while (hashesListeners[i]->getNbHashReceivedFromLastGetHashes() != NUMBER_OF_CHUNK)
+      {
+         QTest::qWait(100);
+         if (timer.elapsed() > 10000)
+            QFAIL("We don't receive all the hashes for each pipelined 'GetHashes' request.");
+      }
+      QCOMPARE(hashesListeners[i]->getLastGetHashesResult().status(), Protos::Core::GetHashesResult_Status_OK);
+      QVERIFY(hashesListeners[i]->getHashesReceivedFromLastGetHashes() == hashesListeners.first()->getHashesReceivedFromLastGetHashes());
+   }
+
+   QCOMPARE(this->servers[1]->getNbConnections(), nbConnectionsBefore);
+}
+
 void Tests::askForAChunk()
 {
    qDebug() << "===== askForAChunk() =====";
 
-   connect(this->peerManagers[1].data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, QSharedPointer<PM::ISocket>)), &this->resultListener, SLOT(getChunk(QSharedPointer<FM::IChunk>, int, QSharedPointer<PM::ISocket>)));
+   connect(this->peerManagers[1].data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)), &this->resultListener, SLOT(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)));
 
    Protos::Core::GetChunk getChunkMessage;
    getChunkMessage.mutable_chunk()->set_hash(this->resultListener.getLastReceivedHash().getData(), Common::Hash::HASH_SIZE);
    getChunkMessage.set_offset(0);
-   QSharedPointer<IGetChunkResult> result = this->peerManagers[0]->getPeers()[0]->getChunk(getChunkMessage);
+   QSharedPointer<IGetChunkResult> result = this->peerManagers[0]->getPeer(this->peerIDs[1])->getChunk(getChunkMessage);
    connect(result.data(), SIGNAL(result(const Protos::Core::GetChunkResult&)), &this->resultListener, SLOT(result(const Protos::Core::GetChunkResult&)));
    connect(result.data(), SIGNAL(stream(QSharedPointer<PM::ISocket>)), &this->resultListener, SLOT(stream(QSharedPointer<PM::ISocket>)));
    result->start();
@@ -325,6 +506,128 @@ void Tests::askForAChunk()
    }
 }
 
+/**
+  * Peer#1 and peer#3 asking for more chunks of 'big.bin' than peer#2 has upload slots.
+  * The streams aren't read, the uploads hold their slot until the requests are released.
+  */
+void Tests::askForMoreChunksThanUploadSlots()
+{
+   qDebug() << "===== askForMoreChunksThanUploadSlots() =====";
+
+   const int RESULT_TIMEOUT = 5000; // [ms].
+
+   // The chunks are now served by a real upload manager.
+   disconnect(this->peerManagers[1].data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)), &this->resultListener, SLOT(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)));
+
+   SETTINGS.set("number_of_uploader", static_cast<quint32>(2));
+   SETTINGS.set("upload_queue_size", static_cast<quint32>(2));
+   SETTINGS.set("socket_timeout", static_cast<quint32>(2 * UPLOAD_QUEUE_TIMEOUT)); // The queue timeout must stay below the socket timeout.
+   SETTINGS.set("upload_queue_timeout", static_cast<quint32>(UPLOAD_QUEUE_TIMEOUT));
+   this->uploadManager = UM::Builder::newUploadManager(this->peerManagers[1]);
+   this->uploadManager->setUploadRateLimit(0, 256 * 1024); // A chunk takes minutes to be uploaded.
+
+   const QList<Common::Hash> chunks = this->resultListener.getHashesReceivedFromLastGetHashes();
+   QCOMPARE(chunks.size(), 4);
+
+   IPeer* peer2FromPeer1 = this->peerManagers[0]->getPeer(this->peerIDs[1]);
+   IPeer* peer2FromPeer3 = this->peerManagers[2]->getPeer(this->peerIDs[1]);
+   QVERIFY(peer2FromPeer1);
+   QVERIFY(peer2FromPeer3);
+
+   QStringList expectedResults;
+
+   // 1) The two slots are taken by peer#1.
+   this->chunkRequester.ask("p1c0", peer2FromPeer1, chunks[0]);
+   QVERIFY(this->chunkRequester.waitForNbResults(1, RESULT_TIMEOUT));
+   this->chunkRequester.ask("p1c1", peer2FromPeer1, chunks[1]);
+   QVERIFY(this->chunkRequester.waitForNbResults(2, RESULT_TIMEOUT));
+   expectedResults << "p1c0:OK" << "p1c1:OK";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+   QCOMPARE(this->uploadManager->getUploads().size(), 2);
+
+   // 2) The next requests wait for a free slot.
+   this->chunkRequester.ask("p1c2", peer2FromPeer1, chunks[2]);
+   QTest::qWait(200);
+   this->chunkRequester.ask("p3c3", peer2FromPeer3, chunks[3]);
+   QTest::qWait(200);
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+
+   // 3) The queue is full, the request is refused at once.
+   this->chunkRequester.ask("p3c0", peer2FromPeer3, chunks[0]);
+   QVERIFY(this->chunkRequester.waitForNbResults(3, RESULT_TIMEOUT));
+   expectedResults << "p3c0:TOO_MANY_CONNECTIONS";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+   this->chunkRequester.release("p3c0");
+
+   // 4) Peer#3 has no upload in progress, its request is served before the older one of peer#1 even if the latter reads the next chunk.
+   this->chunkRequester.release("p1c0");
+   QVERIFY(this->chunkRequester.waitForNbResults(4, RESULT_TIMEOUT));
+   expectedResults << "p3c3:OK";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+
+   // 5) Peer#1 gets a slot back, then its request for the next chunk is preferred to its older one.
+   this->chunkRequester.release("p1c1");
+   QVERIFY(this->chunkRequester.waitForNbResults(5, RESULT_TIMEOUT));
+   expectedResults << "p1c2:OK";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+
+   this->chunkRequester.ask("p1c0", peer2FromPeer1, chunks[0]);
+   QTest::qWait(200);
+   this->chunkRequester.ask("p1c3", peer2FromPeer1, chunks[3]);
+   QTest::qWait(200);
+   this->chunkRequester.release("p3c3");
+   QVERIFY(this->chunkRequester.waitForNbResults(6, RESULT_TIMEOUT));
+   expectedResults << "p1c3:OK";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+
+   // 6) No slot is freed, the remaining request is refused after 'upload_queue_timeout'.
+   QVERIFY(this->chunkRequester.waitForNbResults(7, UPLOAD_QUEUE_TIMEOUT + RESULT_TIMEOUT));
+   expectedResults << "p1c0:TOO_MANY_CONNECTIONS";
+   QCOMPARE(this->chunkRequester.getResults(), expectedResults);
+   this->chunkRequester.release("p1c0");
+}
+
+/**
+  * As a downloader, peer#3 doesn't ask peer#2 for a chunk during a while after being refused, see 'DM::ChunkDownload::result(..)'.
+  * The upload slots of peer#2 are still taken by peer#1, see 'askForMoreChunksThanUploadSlots()'.
+  */
+void Tests::backOffFromABusyPeer()
+{
+   qDebug() << "===== backOffFromABusyPeer() =====";
+
+   const int BACK_OFF = 1000; // [ms].
+
+   const QList<Common::Hash> chunks = this->resultListener.getHashesReceivedFromLastGetHashes();
+   IPeer* peer2FromPeer3 = this->peerManagers[2]->getPeer(this->peerIDs[1]);
+
+   DM::OccupiedPeers occupiedPeers;
+   QVERIFY(occupiedPeers.setPeerAsOccupied(peer2FromPeer3));
+
+   const int nbResults = this->chunkRequester.getResults().size();
+   this->chunkRequester.ask("p3c1", peer2FromPeer3, chunks[1]);
+   QVERIFY(this->chunkRequester.waitForNbResults(nbResults + 1, 2 * UPLOAD_QUEUE_TIMEOUT));
+   QCOMPARE(this->chunkRequester.getResults().last(), QString("p3c1:TOO_MANY_CONNECTIONS"));
+   this->chunkRequester.release("p3c1");
+
+   QElapsedTimer timer;
+   timer.start();
+   occupiedPeers.setPeerAsFree(peer2FromPeer3, BACK_OFF);
+   QVERIFY(!occupiedPeers.isPeerFree(peer2FromPeer3));
+
+   QTest::qWait(BACK_OFF / 2);
+   QVERIFY(!occupiedPeers.isPeerFree(peer2FromPeer3));
+
+   while (!occupiedPeers.isPeerFree(peer2FromPeer3))
+   {
+      QTest::qWait(50);
+      if (timer.elapsed() > 3 * BACK_OFF)
+         QFAIL("The peer isn't free after its back-off period");
+   }
+   QVERIFY(timer.elapsed() >= BACK_OFF);
+
+   this->chunkRequester.releaseAll();
+}
+
 void Tests::cleanupTestCase()
 {
    qDebug() << "===== cleanupTestCase() =====";
@@ -351,6 +654,8 @@ void Tests::createInitialFiles()
    Common::Global::createFile("sharedDirs/peer2/i.txt");
    Common::Global::createFile("sharedDirs/peer2/j.txt");
    Common::Global::createFile("sharedDirs/peer2/k.txt");
+
+   Common::Global::createFile("sharedDirs/peer3/l.txt");
 }
 
 void Tests::deleteAllFiles()
@@ -30,6 +30,7 @@
 #include <Common/Hash.h>
 #include <Core/FileManager/Builder.h>
 #include <Core/FileManager/IFileManager.h>
+#include <Core/UploadManager/IUploadManager.h>
 
 #include <Builder.h>
 #include <IPeerManager.h>
@@ -38,11 +39,13 @@ using namespace PM;
 #include <TestServer.h>
 #include <PeerUpdater.h>
 #include <ResultListener.h>
+#include <ChunkRequester.h>
 
 class Tests : public QObject
 {
    Q_OBJECT
    static const int PORT;
+   static const int UPLOAD_QUEUE_TIMEOUT; ///< [ms].
 
 public:
    Tests();
@@ -53,8 +56,13 @@ private slots:
    void getPeerFromID();
    void askForRootEntries();
    void askForSomeEntries();
+   void askForEntriesPipelined();
    void askForHashes();
+   void askForKnownHashes();
+   void askForHashesAndEntriesPipelined();
    void askForAChunk();
+   void askForMoreChunksThanUploadSlots();
+   void backOffFromABusyPeer();
    void cleanupTestCase();
 
 private:
@@ -69,6 +77,9 @@ private:
 
    ResultListener resultListener;
 
+   QSharedPointer<UM::IUploadManager> uploadManager;
+   ChunkRequester chunkRequester;
+
    QList<Common::Hash> peerIDs;
    QList<QString> peerSharedDirs;
 };
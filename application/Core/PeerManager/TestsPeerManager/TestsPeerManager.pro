@@ -10,6 +10,14 @@ CONFIG -= app_bundle
 include(../../../Libs/protobuf.pri)
 include(../../../Common/common.pri)
 
+LIBS += -L../../DownloadManager/output/$$FOLDER \
+    -lDownloadManager
+POST_TARGETDEPS += ../../DownloadManager/output/$$FOLDER/libDownloadManager.a
+
+LIBS += -L../../UploadManager/output/$$FOLDER \
+    -lUploadManager
+POST_TARGETDEPS += ../../UploadManager/output/$$FOLDER/libUploadManager.a
+
 LIBS += -L../output/$$FOLDER \
     -lPeerManager
 POST_TARGETDEPS += ../output/$$FOLDER/libPeerManager.a
@@ -33,14 +41,18 @@ INCLUDEPATH += . \
 TEMPLATE = app
 SOURCES += main.cpp \
     Tests.cpp \
+    Benchmarks.cpp \
     ../../../Protos/common.pb.cc \
     TestServer.cpp \
     PeerUpdater.cpp \
     ResultListener.cpp \
+    ChunkRequester.cpp \
     ../../../Protos/core_settings.pb.cc
 HEADERS += Tests.h \
+    Benchmarks.h \
     ../../../Protos/common.pb.h \
     TestServer.h \
     PeerUpdater.h \
     ResultListener.h \
+    ChunkRequester.h \
     ../../../Protos/core_settings.pb.h
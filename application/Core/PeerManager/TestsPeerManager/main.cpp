@@ -20,11 +20,18 @@
 #include <QTest>
 
 #include <Tests.h>
+#include <Benchmarks.h>
 
 int main(int argc, char *argv[])
 {
    QCoreApplication a(argc, argv);
 
+   if (a.arguments().contains("-bench"))
+   {
+      Benchmarks benchmarks;
+      return QTest::qExec(&benchmarks);
+   }
+
    Tests tests;
    return QTest::qExec(&tests, argc, argv);
 }
@@ -38,8 +38,9 @@ using namespace PM;
   * When we want to send a message (for example 'GetHashes' to ask for some hashes) we must use the second kind.
   * This constraint exists to avoid sending two messages simultaneously, when one of the message (or both) is a 'GetChunk'.
   * The socket will be occupied for a moment to receive or send the stream of data and cannot handle others messages.
+  * The 'GetEntries' and 'GetHashes' requests don't have this constraint, they are pipelined over the same socket.
   *
-  * The method 'getASocket()' may reuse a existing socket or create a new connection to the peer.
+  * The methods 'getASocket()' and 'getASocketForRequest()' may reuse a existing socket or create a new connection to the peer.
   */
 
 ConnectionPool::ConnectionPool(PeerManager* peerManager, QSharedPointer<FM::IFileManager> fileManager, const Common::Hash& peerID) :
@@ -70,7 +71,7 @@ void ConnectionPool::newConnexion(QTcpSocket* tcpSocket)
 }
 
 /**
-  * Return an idle socket to the peer.
+  * Return an idle socket to the peer and set it as active, used by a transaction which can't share the socket (a 'GetChunk').
   * A new connection is made if there is no idle socket.
   */
 QSharedPointer<Socket> ConnectionPool::getASocket()
@@ -85,11 +86,32 @@ QSharedPointer<Socket> ConnectionPool::getASocket()
       }
    }
 
-   if (!this->peerIP.isNull())
-      return this->addNewSocket(QSharedPointer<Socket>(new Socket(this->peerManager, this->fileManager, this->peerID, this->peerIP, this->port)), TO_PEER);
+   QSharedPointer<Socket> socket = this->connectToPeer();
+   if (!socket.isNull())
+      socket->setActive();
+   return socket;
+}
 
-   L_ERRO("ConnectionPool::getASocket() : Unable to get a socket");
-   return QSharedPointer<Socket>();
+/**
+  * Return a socket to send a request which can be pipelined ('GetEntries' or 'GetHashes').
+  * The socket with the fewest requests in flight is chosen, a new connection is made only if all the sockets are
+  * used by a transaction or have too many requests in flight, see the setting 'max_number_pipelined_requests'.
+  */
+QSharedPointer<Socket> ConnectionPool::getASocketForRequest()
+{
+   QSharedPointer<Socket> bestSocket;
+
+   for (QListIterator< QSharedPointer<Socket> > i(this->socketsToPeer); i.hasNext();)
+   {
+      QSharedPointer<Socket> socket = i.next();
+      if (socket->canPipelineRequest() && (bestSocket.isNull() || socket->getNbRequestsInFlight() < bestSocket->getNbRequestsInFlight()))
+         bestSocket = socket;
+   }
+
+   if (!bestSocket.isNull())
+      return bestSocket;
+
+   return this->connectToPeer();
 }
 
 void ConnectionPool::closeAllSocket()
@@ -139,19 +161,28 @@ void ConnectionPool::socketClosed(Socket* socket)
    }
 }
 
-void ConnectionPool::socketGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, Socket* socket)
+void ConnectionPool::socketGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, Socket* socket)
 {
    for (QListIterator< QSharedPointer<Socket> > i(this->socketsFromPeer); i.hasNext();)
    {
       QSharedPointer<Socket> socketShared = i.next();
       if (socketShared.data() == socket)
       {
-         this->peerManager->onGetChunk(chunk, offset, socketShared);
+         this->peerManager->onGetChunk(chunk, offset, compressionSupported, socketShared);
          break;
       }
    }
 }
 
+QSharedPointer<Socket> ConnectionPool::connectToPeer()
+{
+   if (!this->peerIP.isNull())
+      return this->addNewSocket(QSharedPointer<Socket>(new Socket(this->peerManager, this->fileManager, this->peerID, this->peerIP, this->port)), TO_PEER);
+
+   L_ERRO("ConnectionPool::connectToPeer() : Unable to get a socket");
+   return QSharedPointer<Socket>();
+}
+
 /**
   * Add a newly created socket to the socket pool.
   */
@@ -164,7 +195,7 @@ QSharedPointer<Socket> ConnectionPool::addNewSocket(QSharedPointer<Socket> socke
       break;
    case FROM_PEER:
       this->socketsFromPeer << socket;
-      connect(socket.data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, Socket*)), this, SLOT(socketGetChunk(QSharedPointer<FM::IChunk>, int, Socket*)), Qt::DirectConnection);
+      connect(socket.data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, bool, Socket*)), this, SLOT(socketGetChunk(QSharedPointer<FM::IChunk>, int, bool, Socket*)), Qt::DirectConnection);
       break;
    }
 
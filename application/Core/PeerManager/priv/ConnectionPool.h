@@ -49,15 +49,17 @@ namespace PM
       void newConnexion(QTcpSocket* socket);
 
       QSharedPointer<Socket> getASocket();
+      QSharedPointer<Socket> getASocketForRequest();
       void closeAllSocket();
 
    private slots:
       void socketBecomeIdle(Socket* socket);
       void socketClosed(Socket* socket);
-      void socketGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, Socket* socket);
+      void socketGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, Socket* socket);
 
    private:
       enum Direction { TO_PEER, FROM_PEER };
+      QSharedPointer<Socket> connectToPeer();
       QSharedPointer<Socket> addNewSocket(QSharedPointer<Socket> socket, Direction direction);
       QList< QSharedPointer<Socket> > getAllSockets() const;
 
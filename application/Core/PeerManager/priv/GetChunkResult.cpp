@@ -63,7 +63,7 @@ void GetChunkResult::newMessage(Common::MessageHeader::MessageType type, const g
       socket->stopListening();
       emit stream(this->socket);
    }
-   else
+   else if (chunkResult.status() != Protos::Core::GetChunkResult_Status_TOO_MANY_CONNECTIONS) // The remote peer is only busy, the connection can be reused.
    {
       this->status = ISocket::SFS_ERROR;
       // Segfault, maybe we cannot disconnect a signal during a call to the connected slot (this method)!?.
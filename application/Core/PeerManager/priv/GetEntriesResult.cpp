@@ -24,31 +24,32 @@ using namespace PM;
 #include <priv/Log.h>
 
 GetEntriesResult::GetEntriesResult(const Protos::Core::GetEntries& dirs, QSharedPointer<Socket> socket) :
-   IGetEntriesResult(SETTINGS.get<quint32>("socket_timeout")), dirs(dirs), socket(socket)
+   IGetEntriesResult(SETTINGS.get<quint32>("socket_timeout")), dirs(dirs), socket(socket), requestID(0)
 {
 }
 
 void GetEntriesResult::start()
 {
-   connect(this->socket.data(), SIGNAL(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), Qt::DirectConnection);
-   socket->send(Common::MessageHeader::CORE_GET_ENTRIES, this->dirs);
+   connect(this->socket.data(), SIGNAL(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), Qt::DirectConnection);
+   this->requestID = this->socket->sendRequest(Common::MessageHeader::CORE_GET_ENTRIES, this->dirs);
    this->startTimer();
 }
 
 void GetEntriesResult::doDeleteLater()
 {
-   disconnect(this->socket.data(), SIGNAL(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)));
+   disconnect(this->socket.data(), SIGNAL(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)));
+   this->socket->finishRequest(this->requestID);
    this->deleteLater();
 }
 
-void GetEntriesResult::newMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
+void GetEntriesResult::newResponse(quint32 requestID, Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
 {
-   if (type != Common::MessageHeader::CORE_GET_ENTRIES_RESULT)
+   if (requestID != this->requestID || type != Common::MessageHeader::CORE_GET_ENTRIES_RESULT)
       return;
 
    this->stopTimer();
 
-   disconnect(this->socket.data(), SIGNAL(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)));
+   disconnect(this->socket.data(), SIGNAL(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)));
 
    const Protos::Core::GetEntriesResult& entries = dynamic_cast<const Protos::Core::GetEntriesResult&>(message);
    emit result(entries);
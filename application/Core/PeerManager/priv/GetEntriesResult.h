@@ -43,11 +43,12 @@ namespace PM
       void doDeleteLater();
 
    private slots:
-      void newMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+      void newResponse(quint32 requestID, Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
 
    private:
       const Protos::Core::GetEntries dirs;
       QSharedPointer<Socket> socket;
+      quint32 requestID;
    };
 }
 
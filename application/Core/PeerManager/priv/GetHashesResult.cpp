@@ -24,7 +24,7 @@ using namespace PM;
 #include <priv/Log.h>
 
 GetHashesResult::GetHashesResult(const Protos::Common::Entry& file, QSharedPointer<Socket> socket) :
-   IGetHashesResult(SETTINGS.get<quint32>("get_hashes_timeout")), file(file), socket(socket)
+   IGetHashesResult(SETTINGS.get<quint32>("get_hashes_timeout")), file(file), socket(socket), requestID(0)
 {
 }
 
@@ -32,20 +32,23 @@ void GetHashesResult::start()
 {
    Protos::Core::GetHashes message;
    message.mutable_file()->CopyFrom(this->file);
-   connect(this->socket.data(), SIGNAL(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), Qt::DirectConnection);
-   socket->send(Common::MessageHeader::CORE_GET_HASHES, message);
+   connect(this->socket.data(), SIGNAL(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), Qt::DirectConnection);
+   this->requestID = this->socket->sendRequest(Common::MessageHeader::CORE_GET_HASHES, message);
    this->startTimer();
 }
 
 void GetHashesResult::doDeleteLater()
 {
-   disconnect(this->socket.data(), SIGNAL(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newMessage(Common::MessageHeader::MessageType, const google::protobuf::Message&)));
-   this->socket->finished();
+   disconnect(this->socket.data(), SIGNAL(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)), this, SLOT(newResponse(quint32, Common::MessageHeader::MessageType, const google::protobuf::Message&)));
+   this->socket->finishRequest(this->requestID);
    this->deleteLater();
 }
 
-void GetHashesResult::newMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
+void GetHashesResult::newResponse(quint32 requestID, Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
 {
+   if (requestID != this->requestID)
+      return;
+
    switch (type)
    {
    case Common::MessageHeader::CORE_GET_HASHES_RESULT:
@@ -53,6 +56,10 @@ void GetHashesResult::newMessage(Common::MessageHeader::MessageType type, const
          const Protos::Core::GetHashesResult& hashesResult = dynamic_cast<const Protos::Core::GetHashesResult&>(message);
          this->startTimer(); // Restart the timer.
          emit result(hashesResult);
+
+         // The hashes already known by the remote peer are given with the result.
+         for (int i = 0; i < hashesResult.hash_size(); i++)
+            emit nextHash(Common::Hash(hashesResult.hash(i).hash()));
       }
       break;
 
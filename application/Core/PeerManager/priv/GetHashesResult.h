@@ -44,11 +44,12 @@ namespace PM
       void doDeleteLater();
 
    private slots:
-      void newMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+      void newResponse(quint32 requestID, Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
 
    private:
       const Protos::Common::Entry file;
       QSharedPointer<Socket> socket;
+      quint32 requestID;
    };
 }
 
@@ -42,10 +42,12 @@ Peer::Peer(PeerManager* peerManager, QSharedPointer<FM::IFileManager> fileManage
    port(0),
    nick(nick),
    sharingAmount(0),
-   speed(MAX_SPEED),
+   uploadRate(0),
    alive(false),
    banned(false)
 {
+   this->speedTimer.invalidate();
+
    this->aliveTimer.setSingleShot(true);
    this->aliveTimer.setInterval(SETTINGS.get<double>("peer_timeout_factor") * SETTINGS.get<quint32>("peer_imalive_period"));
    connect(&this->aliveTimer, SIGNAL(timeout()), this, SLOT(consideredDead()));
@@ -69,11 +71,13 @@ Common::Hash Peer::getID() const
 
 QHostAddress Peer::getIP() const
 {
+   QMutexLocker locker(&this->mutex);
    return this->IP;
 }
 
 quint16 Peer::getPort() const
 {
+   QMutexLocker locker(&this->mutex);
    return this->port;
 }
 
@@ -96,12 +100,25 @@ quint32 Peer::getSpeed()
 {
    QMutexLocker locker(&this->mutex);
 
+   static const quint32 LAN_SPEED = SETTINGS.get<quint32>("lan_speed");
+   static const quint32 CHUNK_SIZE = SETTINGS.get<quint32>("chunk_size");
+   static const quint32 IMALIVE_PERIOD = SETTINGS.get<quint32>("peer_imalive_period");
+
    // In [ms].
-   static const quint32 SPEED_VALIDITY_PERIOD = 1000 * SETTINGS.get<quint32>("download_rate_valid_time_factor") / (SETTINGS.get<quint32>("lan_speed") / 1024 / 1024);
+   static const quint32 SPEED_VALIDITY_PERIOD = 1000 * SETTINGS.get<quint32>("download_rate_valid_time_factor") / (LAN_SPEED / 1024 / 1024);
+
+   if (this->speedTimer.isValid() && this->speedTimer.elapsed() > SPEED_VALIDITY_PERIOD)
+   {
+      this->speedEstimator.reset();
+      this->speedTimer.invalidate();
+   }
+
+   // The upload rate advertised by the peer includes our own download if we are downloading or have downloaded recently from it.
+   quint32 othersUploadRate = this->uploadRate;
+   if (this->speedTimer.isValid() && this->speedTimer.elapsed() < 2 * IMALIVE_PERIOD)
+      othersUploadRate -= qMin(othersUploadRate, this->speedEstimator.getLastSpeed());
 
-   if (this->speedTimer.elapsed() > SPEED_VALIDITY_PERIOD)
-      this->speed = MAX_SPEED;
-   return this->speed;
+   return this->speedEstimator.estimate(MAX_SPEED, othersUploadRate, LAN_SPEED, CHUNK_SIZE);
 }
 
 void Peer::setSpeed(quint32 newSpeed)
@@ -109,10 +126,23 @@ void Peer::setSpeed(quint32 newSpeed)
    QMutexLocker locker(&this->mutex);
 
    this->speedTimer.start();
-   if (this->speed == MAX_SPEED)
-      this->speed = newSpeed;
-   else
-      this->speed = (this->speed + newSpeed) / 2;
+   this->speedEstimator.addSpeed(newSpeed);
+}
+
+void Peer::setLatency(quint32 latency)
+{
+   QMutexLocker locker(&this->mutex);
+
+   this->speedTimer.start();
+   this->speedEstimator.addLatency(latency);
+}
+
+void Peer::setTransferResult(bool succeeded)
+{
+   QMutexLocker locker(&this->mutex);
+
+   this->speedTimer.start();
+   this->speedEstimator.addTransferResult(succeeded);
 }
 
 void Peer::ban(int duration, const QString& reason)
@@ -143,25 +173,30 @@ void Peer::update(
    quint16 port,
    const QString& nick,
    const quint64& sharingAmount,
-   const QString& coreVersion
+   const QString& coreVersion,
+   quint32 uploadRate
 )
 {
-   this->alive = true;
    this->aliveTimer.start();
 
+   this->mutex.lock(); // The address of the peer is read by the thread of the UDP listener.
+   this->alive = true;
    this->IP = IP;
    this->port = port;
+   this->uploadRate = uploadRate;
+   this->mutex.unlock();
+
    this->nick = nick;
    this->coreVersion = coreVersion;
    this->sharingAmount = sharingAmount;
 
-   this->connectionPool.setIP(this->IP, this->port);
+   this->connectionPool.setIP(IP, port);
 }
 
 QSharedPointer<IGetEntriesResult> Peer::getEntries(const Protos::Core::GetEntries& dirs)
 {
    return QSharedPointer<IGetEntriesResult>(
-      new GetEntriesResult(dirs, this->connectionPool.getASocket()),
+      new GetEntriesResult(dirs, this->connectionPool.getASocketForRequest()),
       &IGetEntriesResult::doDeleteLater
    );
 }
@@ -169,7 +204,7 @@ QSharedPointer<IGetEntriesResult> Peer::getEntries(const Protos::Core::GetEntrie
 QSharedPointer<IGetHashesResult> Peer::getHashes(const Protos::Common::Entry& file)
 {
    return QSharedPointer<IGetHashesResult>(
-      new GetHashesResult(file, this->connectionPool.getASocket()),
+      new GetHashesResult(file, this->connectionPool.getASocketForRequest()),
       &IGetHashesResult::doDeleteLater
    );
 }
@@ -192,7 +227,10 @@ void Peer::consideredDead()
 {
    L_DEBU(QString("Peer \"%1\" is dead").arg(this->nick));
    this->connectionPool.closeAllSocket();
+   this->mutex.lock();
    this->alive = false;
+   this->mutex.unlock();
+   emit dead();
 }
 
 void Peer::unban()
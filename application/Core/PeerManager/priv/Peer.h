@@ -37,6 +37,7 @@
 
 #include <IPeer.h>
 #include <priv/ConnectionPool.h>
+#include <priv/SpeedEstimator.h>
 
 namespace PM
 {   
@@ -62,6 +63,8 @@ namespace PM
 
       quint32 getSpeed();
       void setSpeed(quint32 newSpeed);
+      void setLatency(quint32 latency);
+      void setTransferResult(bool succeeded);
 
       void ban(int duration, const QString& reason = QString());
 
@@ -72,7 +75,8 @@ namespace PM
          quint16 port,
          const QString& nick,
          const quint64& sharingAmount,
-         const QString& coreVersion
+         const QString& coreVersion,
+         quint32 uploadRate
       );
 
       QSharedPointer<IGetEntriesResult> getEntries(const Protos::Core::GetEntries& dirs);
@@ -83,6 +87,7 @@ namespace PM
 
    signals:
       void unbanned();
+      void dead();
 
    private slots:
       void consideredDead();
@@ -103,8 +108,9 @@ namespace PM
       QString coreVersion;
       quint64 sharingAmount;
 
-      QElapsedTimer speedTimer;
-      quint32 speed; // [bytes/s]
+      QElapsedTimer speedTimer; // Restarted each time a sample is given to 'speedEstimator'.
+      SpeedEstimator speedEstimator;
+      quint32 uploadRate; // [bytes/s]. Advertised by the peer.
 
       bool alive;
       QTimer aliveTimer;
@@ -19,6 +19,9 @@
 #include <priv/PeerManager.h>
 using namespace PM;
 
+#include <QThread>
+#include <QMetaType>
+
 #include <Protos/common.pb.h>
 
 #include <Common/Hash.h>
@@ -31,6 +34,8 @@ using namespace PM;
 /**
   * @class PM::PeerManager
   *
+  * The peers are indexed by their ID, 'getPeer(..)' is called for each received datagram and each new connection.
+  * The alive peers are kept in a separate list, the dead ones aren't visited by 'getPeers()'.
   */
 
 LOG_INIT_CPP(PeerManager);
@@ -38,6 +43,9 @@ LOG_INIT_CPP(PeerManager);
 PeerManager::PeerManager(QSharedPointer<FM::IFileManager> fileManager) :
    fileManager(fileManager)
 {
+   qRegisterMetaType<Common::Hash>("Common::Hash");
+   qRegisterMetaType<QHostAddress>("QHostAddress");
+
    this->timer.setInterval(SETTINGS.get<quint32>("pending_socket_timeout") / 10);
    connect(&this->timer, SIGNAL(timeout()), this, SLOT(checkIdlePendingSockets()));
 
@@ -61,8 +69,8 @@ PeerManager::PeerManager(QSharedPointer<FM::IFileManager> fileManager) :
 
 PeerManager::~PeerManager()
 {
-   for (QListIterator<Peer*> i(this->peers); i.hasNext();)
-      delete i.next();
+   foreach (Peer* peer, this->peers)
+      delete peer;
 
    L_DEBU("PeerManager deleted");
 }
@@ -99,13 +107,10 @@ QString PeerManager::getNick()
 QList<IPeer*> PeerManager::getPeers()
 {
    QList<IPeer*> peers;
+   peers.reserve(this->alivePeers.size());
 
-   for (QListIterator<Peer*> i(this->peers); i.hasNext();)
-   {
-      Peer* peer = i.next();
-      if (peer->isAlive())
-         peers << peer;
-   }
+   for (QListIterator<Peer*> i(this->alivePeers); i.hasNext();)
+      peers << i.next();
 
    return peers;
 }
@@ -120,14 +125,8 @@ Peer* PeerManager::getPeer_(const Common::Hash& ID)
    if (ID.isNull())
       return 0;
 
-   for (QListIterator<Peer*> i(this->peers); i.hasNext();)
-   {
-      Peer* peer = i.next();
-      if (peer->getID() == ID)
-         return peer;
-   }
-
-   return 0;
+   QReadLocker locker(&this->peersLock);
+   return this->peers.value(ID);
 }
 
 IPeer* PeerManager::createPeer(const Hash& ID, const QString& nick)
@@ -138,7 +137,10 @@ IPeer* PeerManager::createPeer(const Hash& ID, const QString& nick)
 
    Peer* peer = new Peer(this, this->fileManager, ID, nick);
    connect(peer, SIGNAL(unbanned()), this, SLOT(peerUnbanned()));
-   this->peers << peer;
+   connect(peer, SIGNAL(dead()), this, SLOT(peerDead()));
+
+   QWriteLocker locker(&this->peersLock);
+   this->peers.insert(ID, peer);
 
    return peer;
 }
@@ -146,11 +148,20 @@ IPeer* PeerManager::createPeer(const Hash& ID, const QString& nick)
 /**
   * A peer just send a IAmAlive packet, we update information about it
   */
-void PeerManager::updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion)
+void PeerManager::updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion, quint32 uploadRate)
 {
    if (ID.isNull() || ID == this->ID)
       return;
 
+   // The peers and their timers belong to the thread of the peer manager.
+   if (QThread::currentThread() != this->thread())
+   {
+      QMetaObject::invokeMethod(this, "updatePeer", Qt::QueuedConnection,
+         Q_ARG(Common::Hash, ID), Q_ARG(QHostAddress, IP), Q_ARG(quint16, port), Q_ARG(QString, nick), Q_ARG(quint64, sharingAmount), Q_ARG(QString, coreVersion), Q_ARG(quint32, uploadRate)
+      );
+      return;
+   }
+
    L_DEBU(QString("%1 (%2) is alive!").arg(ID.toStr()).arg(nick));
 
    Peer* peer = this->getPeer_(ID);
@@ -158,12 +169,18 @@ void PeerManager::updatePeer(const Common::Hash& ID, const QHostAddress& IP, qui
    {
       peer = new Peer(this, this->fileManager, ID);
       connect(peer, SIGNAL(unbanned()), this, SLOT(peerUnbanned()));
-      this->peers << peer;
+      connect(peer, SIGNAL(dead()), this, SLOT(peerDead()));
+
+      QWriteLocker locker(&this->peersLock);
+      this->peers.insert(ID, peer);
    }
 
    const bool wasDead = !peer->isAlive();
 
-   peer->update(IP, port, nick, sharingAmount, coreVersion);
+   peer->update(IP, port, nick, sharingAmount, coreVersion, uploadRate);
+
+   if (wasDead)
+      this->alivePeers << peer;
 
    if (wasDead && peer->isAvailable())
       emit peerBecomesAvailable(peer);
@@ -195,19 +212,18 @@ void PeerManager::newConnection(QTcpSocket* tcpSocket)
       this->dataReceived(tcpSocket); // The case where some data arrived before the 'connect' above.
 }
 
-void PeerManager::onGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<Socket> socket)
+void PeerManager::onGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<Socket> socket)
 {
-   if (this->receivers(SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, QSharedPointer<PM::ISocket>))) < 1)
+   if (this->receivers(SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>))) < 1)
    {
       Protos::Core::GetChunkResult mess;
       mess.set_status(Protos::Core::GetChunkResult_Status_ERROR_UNKNOWN);
-      socket->send(Common::MessageHeader::CORE_GET_CHUNK_RESULT, mess);
-      socket->finished();
+      socket->sendGetChunkResult(mess);
       L_ERRO("PeerManager::onGetChunk(..) : no slot connected to the signal 'getChunk(..)'");
       return;
    }
 
-   emit getChunk(chunk, offset, socket);
+   emit getChunk(chunk, offset, compressionSupported, socket);
 }
 
 void PeerManager::dataReceived(QTcpSocket* tcpSocket)
@@ -272,6 +288,15 @@ void PeerManager::peerUnbanned()
       emit peerBecomesAvailable(peer);
 }
 
+/**
+  * A peer hasn't sent any IMAlive message for a while, it's removed from the alive peers.
+  */
+void PeerManager::peerDead()
+{
+   Peer* peer = static_cast<Peer*>(this->sender());
+   this->alivePeers.removeOne(peer);
+}
+
 void PeerManager::removeFromPending(QTcpSocket* socket)
 {
    for (QMutableListIterator<PendingSocket> i(this->pendingSockets); i.hasNext();)
@@ -24,6 +24,8 @@
 #include <QTimer>
 #include <QTime>
 #include <QList>
+#include <QHash>
+#include <QReadWriteLock>
 #include <QTcpSocket>
 
 #include <Common/Hash.h>
@@ -64,16 +66,17 @@ namespace PM
       Peer* getPeer_(const Common::Hash& ID);
       IPeer* createPeer(const Common::Hash& ID, const QString& nick);
 
-      void updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion);
+      Q_INVOKABLE void updatePeer(const Common::Hash& ID, const QHostAddress& IP, quint16 port, const QString& nick, const quint64& sharingAmount, const QString& coreVersion, quint32 uploadRate = 0);
       void newConnection(QTcpSocket* tcpSocket);
 
-      void onGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<Socket> socket);
+      void onGetChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<Socket> socket);
 
    private slots:
       void dataReceived(QTcpSocket* tcpSocket = 0);
       void disconnected(QTcpSocket* tcpSocket = 0);
       void checkIdlePendingSockets();
       void peerUnbanned();
+      void peerDead();
 
    private:
       void removeFromPending(QTcpSocket* socket);
@@ -84,7 +87,9 @@ namespace PM
 
       Common::Hash ID;
       QString nick;
-      QList<Peer*> peers;
+      QHash<Common::Hash, Peer*> peers; ///< All the known peers. They are never deleted because the other modules keep some pointers to them.
+      mutable QReadWriteLock peersLock; ///< 'getPeer(..)' is called by the thread of the UDP listener.
+      QList<Peer*> alivePeers; ///< The dead peers are removed, see 'peerDead()'.
 
       QTimer timer; ///< Used to check periodically if some pending sockets have timeouted.
       QList<PendingSocket> pendingSockets;
@@ -32,6 +32,15 @@ using namespace PM;
 #include <priv/PeerManager.h>
 #include <priv/Constants.h>
 
+/**
+  * @class PM::Socket
+  *
+  * A connection to a remote peer.
+  * The 'GetEntries' and 'GetHashes' requests can be pipelined : several of them can be sent without waiting for the previous responses,
+  * the responses are matched with their request by the request ID carried by the message header, see 'sendRequest(..)' and the signal 'newResponse(..)'.
+  * A 'GetChunk' transaction uses the whole socket, it can't be mixed with some other requests, see 'setActive()' and 'finished(..)'.
+  */
+
 void Socket::Logger::logDebug(const QString& message)
 {
    L_DEBU(message);
@@ -43,13 +52,13 @@ void Socket::Logger::logError(const QString& message)
 }
 
 Socket::Socket(PeerManager* peerManager, QSharedPointer<FM::IFileManager> fileManager, const Common::Hash& remotePeerID, QTcpSocket* socket) :
-   MessageSocket(new Socket::Logger(), socket, peerManager->getID(), remotePeerID), fileManager(fileManager), active(true), nbError(0)
+   MessageSocket(new Socket::Logger(), socket, peerManager->getID(), remotePeerID), fileManager(fileManager), active(false), nbError(0), lastRequestID(0)
 {
    this->initUnactiveTimer();
 }
 
 Socket::Socket(PeerManager* peerManager, QSharedPointer<FM::IFileManager> fileManager, const Common::Hash& remotePeerID, const QHostAddress& address, quint16 port) :
-   MessageSocket(new Socket::Logger(), address, port, peerManager->getID(), remotePeerID), fileManager(fileManager), active(true), nbError(0)
+   MessageSocket(new Socket::Logger(), address, port, peerManager->getID(), remotePeerID), fileManager(fileManager), active(false), nbError(0), lastRequestID(0)
 {
    this->initUnactiveTimer();
 }
@@ -119,26 +128,82 @@ Common::Hash Socket::getRemotePeerID() const
    return this->MessageSocket::getRemoteID();
 }
 
+void Socket::sendGetChunkResult(const Protos::Core::GetChunkResult& result)
+{
+   this->send(Common::MessageHeader::CORE_GET_CHUNK_RESULT, result);
+
+   if (result.status() == Protos::Core::GetChunkResult_Status_OK)
+      this->stopListening();
+   else
+      this->finished();
+}
+
 void Socket::send(MessageHeader::MessageType type, const google::protobuf::Message& message)
+{
+   this->send(type, message, 0);
+}
+
+/**
+  * Send a message belonging to the request 'requestID', used to answer to a pipelined request.
+  */
+void Socket::send(MessageHeader::MessageType type, const google::protobuf::Message& message, quint32 requestID)
 {
    if (!this->isListening())
       return;
 
-   this->setActive();
+   this->inactiveTimer.start();
+
+   this->MessageSocket::send(type, message, requestID);
+}
+
+/**
+  * Send a request which can be pipelined ('GetEntries' or 'GetHashes').
+  * The responses are emitted by the signal 'newResponse(..)' with the returned ID.
+  * The request is automatically finished when all its responses have been received, it can also be finished earlier by calling 'finishRequest(..)'.
+  */
+quint32 Socket::sendRequest(MessageHeader::MessageType type, const google::protobuf::Message& message)
+{
+   if (++this->lastRequestID == 0) // 0 is not a valid request ID.
+      ++this->lastRequestID;
+
+   this->requestsInFlight.insert(this->lastRequestID, 1);
+   this->send(type, message, this->lastRequestID);
 
-   this->MessageSocket::send(type, message);
+   return this->lastRequestID;
 }
 
 /**
-  * Is the socket currently been used?
+  * Forget a request, its remaining responses will be ignored.
+  */
+void Socket::finishRequest(quint32 requestID)
+{
+   if (this->requestsInFlight.remove(requestID))
+      this->checkIdle();
+}
+
+int Socket::getNbRequestsInFlight() const
+{
+   return this->requestsInFlight.size();
+}
+
+/**
+  * Can a new request be pipelined with the requests already sent?
+  */
+bool Socket::canPipelineRequest() const
+{
+   return !this->active && this->requestsInFlight.size() < static_cast<int>(SETTINGS.get<quint32>("max_number_pipelined_requests"));
+}
+
+/**
+  * Is the socket currently been used? Either by a transaction or by some pipelined requests.
   */
 bool Socket::isActive() const
 {
-   return this->active;
+   return this->active || !this->requestsInFlight.isEmpty() || !this->hashesRequests.isEmpty();
 }
 
 /**
-  * Change the status of the socket to active. Automatically called when a message is sent.
+  * Reserve the socket for a transaction which can't share it, 'finished(..)' must be called at the end of the transaction.
   */
 void Socket::setActive()
 {
@@ -181,11 +246,10 @@ void Socket::finished(FinishedStatus status)
       return;
    }
 
-   this->socket->flush();
    this->active = false;
 
    this->startListening();
-   emit becomeIdle(this);
+   this->checkIdle();
 }
 
 /**
@@ -204,14 +268,22 @@ void Socket::close()
   */
 void Socket::nextAskedHash(Common::Hash hash)
 {
-   Protos::Common::Hash hashProto;
-   hashProto.set_hash(hash.getData(), Common::Hash::HASH_SIZE);
-   this->send(Common::MessageHeader::CORE_HASH, hashProto);
-
-   if (--this->nbHash == 0)
+   for (QMutableListIterator<HashesRequest> i(this->hashesRequests); i.hasNext();)
    {
-      this->currentHashesResult.clear();
-      this->finished();
+      HashesRequest& request = i.next();
+      if (request.result.data() == this->sender())
+      {
+         Protos::Common::Hash hashProto;
+         hashProto.set_hash(hash.getData(), Common::Hash::HASH_SIZE);
+         this->send(Common::MessageHeader::CORE_HASH, hashProto, request.requestID);
+
+         if (--request.nbHash == 0)
+         {
+            i.remove();
+            this->checkIdle();
+         }
+         return;
+      }
    }
 }
 
@@ -220,6 +292,8 @@ void Socket::nextAskedHash(Common::Hash hash)
   */
 void Socket::onNewMessage(Common::MessageHeader::MessageType type, const google::protobuf::Message& message)
 {
+   const quint32 requestID = this->getCurrentHeader().getRequestID();
+
    switch (type)
    {
    case Common::MessageHeader::CORE_GET_ENTRIES:
@@ -234,47 +308,54 @@ void Socket::onNewMessage(Common::MessageHeader::MessageType type, const google:
          if (getEntries.dirs().entry_size() == 0 || getEntries.get_roots())
             result.add_entries()->CopyFrom(this->fileManager->getEntries());
 
-         this->send(Common::MessageHeader::CORE_GET_ENTRIES_RESULT, result);
-
-         this->finished();
+         this->send(Common::MessageHeader::CORE_GET_ENTRIES_RESULT, result, requestID);
       }
       break;
 
    case Common::MessageHeader::CORE_GET_ENTRIES_RESULT:
-      this->finished();
+      if (this->requestsInFlight.contains(requestID))
+      {
+         emit newResponse(requestID, type, message);
+         this->finishRequest(requestID);
+      }
       break;
 
    case Common::MessageHeader::CORE_GET_HASHES:
       {
          const Protos::Core::GetHashes& getHashes = static_cast<const Protos::Core::GetHashes&>(message);
 
-         this->currentHashesResult = this->fileManager->getHashes(getHashes.file());
-         connect(this->currentHashesResult.data(), SIGNAL(nextHash(Common::Hash)), this, SLOT(nextAskedHash(Common::Hash)), Qt::QueuedConnection);
-         Protos::Core::GetHashesResult res = this->currentHashesResult->start();
+         QSharedPointer<FM::IGetHashesResult> hashesResult = this->fileManager->getHashes(getHashes.file());
+         connect(hashesResult.data(), SIGNAL(nextHash(Common::Hash)), this, SLOT(nextAskedHash(Common::Hash)), Qt::QueuedConnection);
+         Protos::Core::GetHashesResult res = hashesResult->start();
 
-         this->nbHash = res.nb_hash();
+         this->send(Common::MessageHeader::CORE_GET_HASHES_RESULT, res, requestID);
 
-         this->send(Common::MessageHeader::CORE_GET_HASHES_RESULT, res);
-
-         if (res.status() != Protos::Core::GetHashesResult_Status_OK)
-         {
-            this->currentHashesResult.clear();
-            this->finished();
-         }
+         // The hashes not given in the result are sent one by one when they are computed.
+         const int nbHashToStream = res.nb_hash() - res.hash_size();
+         if (res.status() == Protos::Core::GetHashesResult_Status_OK && nbHashToStream > 0)
+            this->hashesRequests << HashesRequest(hashesResult, requestID, nbHashToStream);
       }
       break;
 
    case Common::MessageHeader::CORE_GET_HASHES_RESULT:
+      if (this->requestsInFlight.contains(requestID))
       {
          const Protos::Core::GetHashesResult& getHashesResult = static_cast<const Protos::Core::GetHashesResult&>(message);
-         this->nbHash = getHashesResult.nb_hash();
+         this->requestsInFlight[requestID] = getHashesResult.status() == Protos::Core::GetHashesResult_Status_OK ? getHashesResult.nb_hash() - getHashesResult.hash_size() : 0;
+
+         emit newResponse(requestID, type, message);
+         if (this->requestsInFlight.value(requestID, -1) == 0)
+            this->finishRequest(requestID);
       }
       break;
 
    case Common::MessageHeader::CORE_HASH:
+      if (this->requestsInFlight.contains(requestID))
       {
-         if (--this->nbHash == 0)
-            this->finished();
+         emit newResponse(requestID, type, message);
+         QHash<quint32, int>::iterator i = this->requestsInFlight.find(requestID);
+         if (i != this->requestsInFlight.end() && --i.value() <= 0)
+            this->finishRequest(requestID);
       }
       break;
 
@@ -282,6 +363,18 @@ void Socket::onNewMessage(Common::MessageHeader::MessageType type, const google:
       {
          const Protos::Core::GetChunk& getChunkMessage = static_cast<const Protos::Core::GetChunk&>(message);
 
+         this->setActive();
+
+         if (!this->hashesRequests.isEmpty())
+         {
+            L_WARN("GET_CHUNK: Some hashes are still being sent on this socket");
+            Protos::Core::GetChunkResult result;
+            result.set_status(Protos::Core::GetChunkResult_Status_ERROR_UNKNOWN);
+            this->send(Common::MessageHeader::CORE_GET_CHUNK_RESULT, result);
+            this->finished(ISocket::SFS_ERROR);
+            break;
+         }
+
          const Common::Hash hash(getChunkMessage.chunk().hash());
          if (hash.isNull())
          {
@@ -302,14 +395,8 @@ void Socket::onNewMessage(Common::MessageHeader::MessageType type, const google:
          }
          else
          {
-            Protos::Core::GetChunkResult result;
-            result.set_status(Protos::Core::GetChunkResult_Status_OK);
-            result.set_chunk_size(chunk->getKnownBytes());
-            this->send(Common::MessageHeader::CORE_GET_CHUNK_RESULT, result);
-
-            this->stopListening();
-
-            emit getChunk(chunk, getChunkMessage.offset(), this);
+            // The upload manager answers when an upload slot is free, see 'sendGetChunkResult(..)'.
+            emit getChunk(chunk, getChunkMessage.offset(), getChunkMessage.compression_supported(), this);
          }
       }
       break;
@@ -320,7 +407,7 @@ void Socket::onNewMessage(Common::MessageHeader::MessageType type, const google:
 
 void Socket::onNewDataReceived()
 {
-   this->setActive();
+   this->inactiveTimer.start();
 }
 
 void Socket::onDisconnected()
@@ -335,3 +422,17 @@ void Socket::initUnactiveTimer()
    connect(&this->inactiveTimer, SIGNAL(timeout()), this, SLOT(close()));
    this->inactiveTimer.start();
 }
+
+/**
+  * Emit 'becomeIdle(..)' if there is no more transaction nor request using the socket.
+  */
+void Socket::checkIdle()
+{
+   if (this->isActive())
+      return;
+
+   if (this->socket->state() == QAbstractSocket::ConnectedState)
+      this->socket->flush();
+
+   emit becomeIdle(this);
+}
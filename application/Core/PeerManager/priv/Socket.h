@@ -24,6 +24,8 @@
 #include <QHostAddress>
 #include <QTimer>
 #include <QQueue>
+#include <QHash>
+#include <QList>
 #include <QSharedPointer>
 
 #include <google/protobuf/message.h>
@@ -78,8 +80,15 @@ namespace PM
       QString errorString() const;
 
       Common::Hash getRemotePeerID() const;
+      void sendGetChunkResult(const Protos::Core::GetChunkResult& result);
 
       void send(MessageHeader::MessageType type, const google::protobuf::Message& message);
+      void send(MessageHeader::MessageType type, const google::protobuf::Message& message, quint32 requestID);
+
+      quint32 sendRequest(MessageHeader::MessageType type, const google::protobuf::Message& message);
+      void finishRequest(quint32 requestID);
+      int getNbRequestsInFlight() const;
+      bool canPipelineRequest() const;
 
       bool isActive() const;
       void setActive();
@@ -90,7 +99,12 @@ namespace PM
       void close();
 
    signals:
-      void getChunk(QSharedPointer<FM::IChunk>, int, Socket*);
+      /**
+        * Emitted when a response to a request sent by 'sendRequest(..)' is received.
+        */
+      void newResponse(quint32 requestID, Common::MessageHeader::MessageType type, const google::protobuf::Message& message);
+
+      void getChunk(QSharedPointer<FM::IChunk>, int, bool, Socket*);
       void becomeIdle(Socket*);
 
       /**
@@ -106,16 +120,27 @@ namespace PM
       void onNewDataReceived();
       void onDisconnected();
       void initUnactiveTimer();
+      void checkIdle();
 
       QSharedPointer<FM::IFileManager> fileManager;
 
-      bool active;
+      bool active; ///< A transaction which can't share the socket, like 'GetChunk', is in progress.
       QTimer inactiveTimer;
       int nbError;
 
-      // Used when asking hashes to the fileManager.
-      QSharedPointer<FM::IGetHashesResult> currentHashesResult;
-      int nbHash;
+      // The requests sent by us waiting for some responses.
+      quint32 lastRequestID;
+      QHash<quint32, int> requestsInFlight; ///< Request ID -> number of responses still expected.
+
+      // The 'GetHashes' requests sent by the remote peer and being answered, we ask the hashes to the fileManager.
+      struct HashesRequest
+      {
+         HashesRequest(QSharedPointer<FM::IGetHashesResult> result, quint32 requestID, int nbHash) : result(result), requestID(requestID), nbHash(nbHash) {}
+         QSharedPointer<FM::IGetHashesResult> result;
+         quint32 requestID;
+         int nbHash;
+      };
+      QList<HashesRequest> hashesRequests;
    };
 }
 
@@ -0,0 +1,151 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#include <priv/SpeedEstimator.h>
+using namespace PM;
+
+#include <cmath>
+#include <limits>
+
+const double SpeedEstimator::ALPHA(0.25);
+const double SpeedEstimator::DEVIATION_WEIGHT(1.0);
+const double SpeedEstimator::MIN_SPEED_FACTOR(0.25);
+
+/**
+  * @class PM::SpeedEstimator
+  *
+  * Estimate the speed at which the next chunk will be downloaded from a peer.
+  * The measured speeds are averaged by an exponentially weighted moving average (EWMA), their variance too. The latency of the
+  * 'GetChunk' requests and the rate of failed transfers are also averaged the same way.
+  * See 'estimate(..)'.
+  */
+
+SpeedEstimator::SpeedEstimator()
+{
+   this->reset();
+}
+
+/**
+  * Forget all the samples.
+  */
+void SpeedEstimator::reset()
+{
+   this->nbSpeedSamples = 0;
+   this->meanSpeed = 0.0;
+   this->speedVariance = 0.0;
+   this->lastSpeed = 0;
+   this->latencyKnown = false;
+   this->latency = 0.0;
+   this->errorRate = 0.0;
+}
+
+/**
+  * @param speed [B/s].
+  */
+void SpeedEstimator::addSpeed(quint32 speed)
+{
+   this->lastSpeed = speed;
+
+   if (this->nbSpeedSamples++ == 0)
+   {
+      this->meanSpeed = speed;
+      return;
+   }
+
+   const double diff = speed - this->meanSpeed;
+   const double increment = ALPHA * diff;
+   this->meanSpeed += increment;
+   this->speedVariance = (1.0 - ALPHA) * (this->speedVariance + diff * increment);
+}
+
+/**
+  * @param latency The time between a request and its answer [ms].
+  */
+void SpeedEstimator::addLatency(quint32 latency)
+{
+   if (!this->latencyKnown)
+   {
+      this->latencyKnown = true;
+      this->latency = latency;
+   }
+   else
+      this->latency += ALPHA * (latency - this->latency);
+}
+
+void SpeedEstimator::addTransferResult(bool succeeded)
+{
+   this->errorRate += ALPHA * ((succeeded ? 0.0 : 1.0) - this->errorRate);
+}
+
+bool SpeedEstimator::isSpeedKnown() const
+{
+   return this->nbSpeedSamples > 0;
+}
+
+quint32 SpeedEstimator::getMeanSpeed() const
+{
+   return static_cast<quint32>(this->meanSpeed);
+}
+
+quint32 SpeedEstimator::getSpeedDeviation() const
+{
+   return static_cast<quint32>(std::sqrt(this->speedVariance));
+}
+
+quint32 SpeedEstimator::getLastSpeed() const
+{
+   return this->lastSpeed;
+}
+
+quint32 SpeedEstimator::getLatency() const
+{
+   return static_cast<quint32>(this->latency);
+}
+
+double SpeedEstimator::getErrorRate() const
+{
+   return this->errorRate;
+}
+
+/**
+  * Return the expected speed [B/s] of the next chunk download:
+  *  1) The mean speed minus 'DEVIATION_WEIGHT' standard deviation, thus a steady peer is preferred to an erratic one having the same mean.
+  *     If no speed is known 'defaultSpeed' is taken, it's usually high to give a chance to the unknown peers.
+  *  2) Reduced by the share of the bandwidth taken by the other uploads of the peer, relatively to the speed of the LAN.
+  *  3) Reduced by the rate of failed transfers.
+  *  4) Reduced by the time lost waiting the answer of the request, relatively to the size of a chunk.
+  * @param uploadRate The current upload rate of the peer to the other peers [B/s].
+  * @param lanSpeed [B/s].
+  * @param chunkSize [B].
+  */
+quint32 SpeedEstimator::estimate(quint32 defaultSpeed, quint32 uploadRate, quint32 lanSpeed, quint32 chunkSize) const
+{
+   double speed = defaultSpeed;
+   if (this->isSpeedKnown())
+      speed = qMax(this->meanSpeed - DEVIATION_WEIGHT * std::sqrt(this->speedVariance), MIN_SPEED_FACTOR * this->meanSpeed);
+
+   if (lanSpeed > 0)
+      speed *= static_cast<double>(lanSpeed) / (static_cast<double>(lanSpeed) + uploadRate);
+
+   speed *= 1.0 - this->errorRate;
+
+   if (speed > 0.0 && chunkSize > 0)
+      speed = chunkSize / (this->latency / 1000.0 + chunkSize / speed);
+
+   return static_cast<quint32>(qBound(1.0, speed, static_cast<double>(std::numeric_limits<quint32>::max())));
+}
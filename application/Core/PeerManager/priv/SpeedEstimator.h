@@ -0,0 +1,63 @@
+/**
+  * D-LAN - A decentralized LAN file sharing software.
+  * Copyright (C) 2010-2012 Greg Burri <greg.burri@gmail.com>
+  *
+  * This program is free software: you can redistribute it and/or modify
+  * it under the terms of the GNU General Public License as published by
+  * the Free Software Foundation, either version 3 of the License, or
+  * (at your option) any later version.
+  *
+  * This program is distributed in the hope that it will be useful,
+  * but WITHOUT ANY WARRANTY; without even the implied warranty of
+  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  * GNU General Public License for more details.
+  *
+  * You should have received a copy of the GNU General Public License
+  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  */
+  
+#ifndef PEERMANAGER_SPEEDESTIMATOR_H
+#define PEERMANAGER_SPEEDESTIMATOR_H
+
+#include <QtGlobal>
+
+namespace PM
+{
+   class SpeedEstimator
+   {
+      static const double ALPHA; ///< The weight of a new sample in the moving averages.
+      static const double DEVIATION_WEIGHT; ///< The number of standard deviations removed from the mean speed.
+      static const double MIN_SPEED_FACTOR; ///< The conservative speed is never below this factor of the mean speed.
+
+   public:
+      SpeedEstimator();
+
+      void reset();
+
+      void addSpeed(quint32 speed);
+      void addLatency(quint32 latency);
+      void addTransferResult(bool succeeded);
+
+      bool isSpeedKnown() const;
+      quint32 getMeanSpeed() const;
+      quint32 getSpeedDeviation() const;
+      quint32 getLastSpeed() const;
+      quint32 getLatency() const;
+      double getErrorRate() const;
+
+      quint32 estimate(quint32 defaultSpeed, quint32 uploadRate, quint32 lanSpeed, quint32 chunkSize) const;
+
+   private:
+      int nbSpeedSamples;
+      double meanSpeed; // [B/s].
+      double speedVariance;
+      quint32 lastSpeed; // [B/s].
+
+      bool latencyKnown;
+      double latency; // [ms].
+
+      double errorRate; // Between 0 and 1.
+   };
+}
+
+#endif
@@ -418,6 +418,18 @@ void RemoteConnection::onNewMessage(Common::MessageHeader::MessageType type, con
          if (coreSettingsMessage.has_enable_integrity_check())
             SETTINGS.set("check_received_data_integrity", coreSettingsMessage.enable_integrity_check());
 
+         if (coreSettingsMessage.has_download_rate_limit())
+            SETTINGS.set("download_rate_limit", coreSettingsMessage.download_rate_limit());
+         if (coreSettingsMessage.has_download_rate_limit_per_peer())
+            SETTINGS.set("download_rate_limit_per_peer", coreSettingsMessage.download_rate_limit_per_peer());
+         this->downloadManager->setDownloadRateLimit(SETTINGS.get<quint32>("download_rate_limit"), SETTINGS.get<quint32>("download_rate_limit_per_peer"));
+
+         if (coreSettingsMessage.has_upload_rate_limit())
+            SETTINGS.set("upload_rate_limit", coreSettingsMessage.upload_rate_limit());
+         if (coreSettingsMessage.has_upload_rate_limit_per_peer())
+            SETTINGS.set("upload_rate_limit_per_peer", coreSettingsMessage.upload_rate_limit_per_peer());
+         this->uploadManager->setUploadRateLimit(SETTINGS.get<quint32>("upload_rate_limit"), SETTINGS.get<quint32>("upload_rate_limit_per_peer"));
+
          try
          {
             QStringList sharedDirs;
@@ -458,7 +470,7 @@ void RemoteConnection::onNewMessage(Common::MessageHeader::MessageType type, con
          // Special syntax to search in your own files.
          if (pattern.startsWith('<'))
          {
-            QList<Protos::Common::FindResult> results = this->fileManager->find(pattern, SETTINGS.get<quint32>("max_number_of_result_shown"), std::numeric_limits<int>::max());
+            QList<Protos::Common::FindResult> results = this->fileManager->find(pattern, searchMessage.filter(), SETTINGS.get<quint32>("max_number_of_result_shown"), std::numeric_limits<int>::max());
 
             const quint64 tag = (static_cast<quint64>(this->mtrand.randInt()) << 32) | this->mtrand.randInt();
             Protos::GUI::Tag tagMess;
@@ -468,6 +480,7 @@ void RemoteConnection::onNewMessage(Common::MessageHeader::MessageType type, con
             if (!results.isEmpty())
             {
                Protos::Common::FindResult& result = results.first();
+               Common::ProtoHelper::expandFindResult(result);
                result.mutable_peer_id()->set_hash(this->peerManager->getID().getData(), Common::Hash::HASH_SIZE);
                result.set_tag(tag);
                this->searchFound(result);
@@ -478,7 +491,7 @@ void RemoteConnection::onNewMessage(Common::MessageHeader::MessageType type, con
             QSharedPointer<NL::ISearch> search = this->networkListener->newSearch();
             connect(search.data(), SIGNAL(found(const Protos::Common::FindResult&)), this, SLOT(searchFound(const Protos::Common::FindResult&)));
             this->currentSearches << search;
-            const quint64 tag = search->search(pattern);
+            const quint64 tag = search->search(pattern, searchMessage.filter());
 
             Protos::GUI::Tag tagMess;
             tagMess.set_tag(tag);
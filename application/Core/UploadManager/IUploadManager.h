@@ -35,6 +35,13 @@ namespace UM
         * @return Byte/s.
         */
       virtual int getUploadRate() = 0;
+
+      /**
+        * Limit the upload rate for all the peers and for each peer.
+        * @param rate [B/s], 0 means no limit.
+        * @param ratePerPeer [B/s], 0 means no limit.
+        */
+      virtual void setUploadRateLimit(quint32 rate, quint32 ratePerPeer) = 0;
    };
 }
 #endif
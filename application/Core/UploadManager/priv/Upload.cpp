@@ -27,8 +27,8 @@ using namespace UM;
 
 quint64 Upload::currentID(1);
 
-Upload::Upload(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket, Common::TransferRateCalculator& transferRateCalculator) :
-   Common::Timeoutable(SETTINGS.get<quint32>("upload_lifetime")), mainThread(QThread::currentThread()), ID(currentID++), chunk(chunk), offset(offset), socket(socket), transferRateCalculator(transferRateCalculator), networkError(false), toStop(false)
+Upload::Upload(QSharedPointer<FM::IChunk> chunk, int offset, bool compressed, QSharedPointer<PM::ISocket> socket, Common::TransferRateCalculator& transferRateCalculator, QSharedPointer<Common::TokenBucket> tokenBucket) :
+   Common::Timeoutable(SETTINGS.get<quint32>("upload_lifetime")), mainThread(QThread::currentThread()), ID(currentID++), chunk(chunk), offset(offset), compressed(compressed), socket(socket), transferRateCalculator(transferRateCalculator), tokenBucket(tokenBucket), networkError(false), toStop(false)
 {   
 }
 
@@ -84,37 +84,72 @@ void Upload::run()
       char buffer[BUFFER_SIZE];
       int bytesRead = 0;
 
+      Common::BlockCompressor compressor(SETTINGS.get<double>("upload_compression_ratio"), SETTINGS.get<quint32>("upload_compression_nb_blocks_to_skip"));
+      QByteArray blocks;
+
       while (bytesRead = reader->read(buffer, this->offset))
       {
-         int bytesSent = this->socket->write(buffer, bytesRead);
-
-         if (bytesSent == -1)
+         const char* data = buffer;
+         int dataSize = bytesRead;
+         if (this->compressed)
          {
-            L_WARN(QString("Socket : cannot send data : %1").arg(this->chunk->toStringLog()));
-            this->networkError = true;
-            goto end;
+            blocks = compressor.encode(buffer, bytesRead);
+            data = blocks.constData();
+            dataSize = blocks.size();
          }
 
-         this->mutex.lock();
-         if (this->toStop)
+         // When the rate is limited the data are sent by small slices to keep a steady pace.
+         for (int bytesSent = 0; bytesSent < dataSize;)
          {
-            this->mutex.unlock();
-            goto end;
-         }
-         this->offset += bytesSent;
-         this->mutex.unlock();
+            const int bytesWritten = this->socket->write(data + bytesSent, this->tokenBucket->getSliceSize(dataSize - bytesSent));
 
-         while (socket->bytesToWrite() > SOCKET_BUFFER_SIZE)
-         {
-            if (!socket->waitForBytesWritten(SOCKET_TIMEOUT))
+            if (bytesWritten == -1)
             {
-               L_WARN(QString("Socket : cannot write data, error : %1, chunk : %2").arg(socket->errorString()).arg(this->chunk->toStringLog()));
+               L_WARN(QString("Socket : cannot send data : %1").arg(this->chunk->toStringLog()));
                this->networkError = true;
                goto end;
             }
+
+            this->mutex.lock();
+            if (this->toStop)
+            {
+               this->mutex.unlock();
+               goto end;
+            }
+            this->mutex.unlock();
+            bytesSent += bytesWritten;
+
+            while (socket->bytesToWrite() > SOCKET_BUFFER_SIZE)
+            {
+               if (!socket->waitForBytesWritten(SOCKET_TIMEOUT))
+               {
+                  L_WARN(QString("Socket : cannot write data, error : %1, chunk : %2").arg(socket->errorString()).arg(this->chunk->toStringLog()));
+                  this->networkError = true;
+                  goto end;
+               }
+            }
+
+            this->transferRateCalculator.addData(bytesWritten);
+
+            // The delay is waited by steps to stop quickly even at a very low rate.
+            for (int delay = this->tokenBucket->consume(bytesWritten); delay > 0;)
+            {
+               delay = Common::TokenBucket::sleepStep(delay);
+
+               this->mutex.lock();
+               if (this->toStop)
+               {
+                  this->mutex.unlock();
+                  goto end;
+               }
+               this->mutex.unlock();
+            }
          }
 
-         this->transferRateCalculator.addData(bytesSent);
+         // The offset is relative to the data read, not to the data sent.
+         this->mutex.lock();
+         this->offset += bytesRead;
+         this->mutex.unlock();
       }
    }
    catch(FM::UnableToOpenFileInReadModeException&)
@@ -142,6 +177,7 @@ void Upload::finished()
 {
    this->socket->finished(this->networkError ? PM::ISocket::SFS_ERROR : PM::ISocket::SFS_OK);
    this->startTimer();
+   emit uploadFinished();
 }
 
 /**
@@ -24,6 +24,8 @@
 
 #include <Common/Timeoutable.h>
 #include <Common/TransferRateCalculator.h>
+#include <Common/TokenBucket.h>
+#include <Common/BlockCompressor.h>
 #include <Common/IRunnable.h>
 #include <Core/FileManager/Exceptions.h>
 #include <Core/FileManager/IChunk.h>
@@ -34,12 +36,13 @@
 
 namespace UM
 {
-   class Upload : public Common::IRunnable, public IUpload, public Common::Timeoutable
+   class Upload : public Common::Timeoutable, public Common::IRunnable, public IUpload
    {
       static quint64 currentID; ///< Used to generate the new upload ID.
 
+      Q_OBJECT
    public:
-      Upload(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket, Common::TransferRateCalculator& transferRateCalculator);
+      Upload(QSharedPointer<FM::IChunk> chunk, int offset, bool compressed, QSharedPointer<PM::ISocket> socket, Common::TransferRateCalculator& transferRateCalculator, QSharedPointer<Common::TokenBucket> tokenBucket);
       ~Upload();
 
       quint64 getID() const;
@@ -52,6 +55,12 @@ namespace UM
       void finished();
       void stop();
 
+   signals:
+      /**
+        * Emitted in the main thread when the data have been sent or when the upload has failed.
+        */
+      void uploadFinished();
+
    private:
       mutable QMutex mutex;
 
@@ -60,9 +69,11 @@ namespace UM
       const quint64 ID; ///< Each uploader has an ID to identified it.
       QSharedPointer<FM::IChunk> chunk; ///< The chunk uploaded.
       int offset; ///< The current offset into the chunk.
+      const bool compressed; ///< The data are sent as blocks, see 'Common::BlockCompressor'.
       QSharedPointer<PM::ISocket> socket;
 
       Common::TransferRateCalculator& transferRateCalculator;
+      QSharedPointer<Common::TokenBucket> tokenBucket; ///< To limit the upload rate to the peer, its parent limits the rate of all the uploads.
 
       bool networkError;
       bool toStop;
@@ -25,6 +25,7 @@ using namespace UM;
 
 #include <Common/ZeroCopyStreamQIODevice.h>
 #include <Common/Settings.h>
+#include <Common/ProtoHelper.h>
 #include <Core/FileManager/Exceptions.h>
 #include <Core/FileManager/IChunk.h>
 #include <Core/PeerManager/ISocket.h>
@@ -37,15 +38,37 @@ using namespace UM;
   * Will listen the signal 'getChunk' of the peerManager, when this signal is received an Uploader is created and data is sent to the peer.
   * After the chunk was sent to the peer the Uploader is deleted.
   *
+  * There is at most 'number_of_uploader' uploads at the same time, the other requests wait in a queue for a free slot.
+  * When a slot becomes free the next request is chosen as follows:
+  *  - Only the peers having the fewest uploads in progress are considered, thus each peer gets its share of the slots.
+  *  - The next chunk of the file read by the last upload is preferred, then a chunk of the same file, to keep the disk reads sequential.
+  *  - Then the peer served the least recently and finally the oldest request.
+  * The requests which can't be queued or which wait longer than 'upload_queue_timeout' are refused with 'TOO_MANY_CONNECTIONS',
+  * the downloader will then try another peer.
+  *
+  * If the downloader supports it the data are sent as blocks, the compressible ones are compressed (see 'Common::BlockCompressor').
+  *
   * We cannot use a QThreadPool object instead of the class 'Uploader' because we have to use the method 'PM::ISocket::moveToThread' when using a socket in a thread. This isn't possible with the 'QRunnable' class.
   */
 
 LOG_INIT_CPP(UploadManager);
 
 UploadManager::UploadManager(QSharedPointer<PM::IPeerManager> peerManager) :
-   peerManager(peerManager), threadPool(static_cast<int>(SETTINGS.get<quint32>("upload_min_nb_thread")), SETTINGS.get<quint32>("upload_thread_lifetime"))
+   NUMBER_OF_UPLOADER(static_cast<int>(SETTINGS.get<quint32>("number_of_uploader"))),
+   UPLOAD_QUEUE_SIZE(static_cast<int>(SETTINGS.get<quint32>("upload_queue_size"))),
+   UPLOAD_QUEUE_TIMEOUT(static_cast<int>(SETTINGS.get<quint32>("upload_queue_timeout"))),
+   UPLOAD_COMPRESSION_RATIO(SETTINGS.get<double>("upload_compression_ratio")),
+   bandwidthLimiter(SETTINGS.get<quint32>("upload_rate_limit"), SETTINGS.get<quint32>("upload_rate_limit_per_peer")),
+   peerManager(peerManager),
+   nbActiveUploads(0),
+   nbUploadsStarted(0),
+   lastChunkNum(-1),
+   threadPool(static_cast<int>(SETTINGS.get<quint32>("upload_min_nb_thread")), SETTINGS.get<quint32>("upload_thread_lifetime"))
 {
-   connect(this->peerManager.data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, QSharedPointer<PM::ISocket>)), this, SLOT(getChunk(QSharedPointer<FM::IChunk>, int, QSharedPointer<PM::ISocket>)), Qt::DirectConnection);
+   connect(this->peerManager.data(), SIGNAL(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)), this, SLOT(getChunk(QSharedPointer<FM::IChunk>, int, bool, QSharedPointer<PM::ISocket>)), Qt::DirectConnection);
+
+   this->queueTimer.setSingleShot(true);
+   connect(&this->queueTimer, SIGNAL(timeout()), this, SLOT(refuseTimedOutRequests()));
 }
 
 UploadManager::~UploadManager()
@@ -68,12 +91,53 @@ int UploadManager::getUploadRate()
    return this->transferRateCalculator.getTransferRate();
 }
 
-void UploadManager::getChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket)
+void UploadManager::setUploadRateLimit(quint32 rate, quint32 ratePerPeer)
 {
-   QSharedPointer<Upload> upload(new Upload(chunk, offset, socket, this->transferRateCalculator));
-   connect(upload.data(), SIGNAL(timeout()), this, SLOT(uploadTimeout()));
-   this->uploads << upload;
-   this->threadPool.run(upload.toWeakRef());
+   this->bandwidthLimiter.setRates(rate, ratePerPeer);
+}
+
+void UploadManager::getChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<PM::ISocket> socket)
+{
+   Request request;
+   request.chunk = chunk;
+   request.offset = offset;
+   request.compressionSupported = compressionSupported;
+   request.socket = socket;
+   request.peerID = socket->getRemotePeerID();
+   request.filePath = getFilePath(chunk);
+   request.waitingTime.invalidate(); // Started only if the request is queued.
+
+   if (this->queue.isEmpty() && this->nbActiveUploads < NUMBER_OF_UPLOADER)
+   {
+      this->startUpload(request);
+      return;
+   }
+
+   if (this->queue.size() >= UPLOAD_QUEUE_SIZE)
+   {
+      L_DEBU(QString("Upload queue full, request refused: %1").arg(chunk->toStringLog()));
+      this->refuseRequest(request);
+      return;
+   }
+
+   request.waitingTime.start();
+   this->queue << request;
+
+   if (!this->queueTimer.isActive())
+      this->queueTimer.start(UPLOAD_QUEUE_TIMEOUT);
+}
+
+void UploadManager::uploadFinished()
+{
+   Upload* upload = dynamic_cast<Upload*>(this->sender());
+
+   this->nbActiveUploads--;
+   const Common::Hash peerID = upload->getPeerID();
+   if (--this->nbActiveUploadsByPeer[peerID] <= 0)
+      this->nbActiveUploadsByPeer.remove(peerID);
+
+   // Deferred because this slot is called by the thread pool when a thread has finished, the thread isn't free yet.
+   QMetaObject::invokeMethod(this, "startQueuedUploads", Qt::QueuedConnection);
 }
 
 void UploadManager::uploadTimeout()
@@ -87,3 +151,106 @@ void UploadManager::uploadTimeout()
          break;
       }
 }
+
+void UploadManager::startQueuedUploads()
+{
+   while (!this->queue.isEmpty() && this->nbActiveUploads < NUMBER_OF_UPLOADER)
+      this->startUpload(this->queue.takeAt(this->chooseNextRequest()));
+
+   if (this->queue.isEmpty())
+      this->queueTimer.stop();
+}
+
+void UploadManager::refuseTimedOutRequests()
+{
+   // The oldest requests are at the beginning of the queue.
+   while (!this->queue.isEmpty() && this->queue.first().waitingTime.elapsed() >= UPLOAD_QUEUE_TIMEOUT)
+   {
+      L_DEBU(QString("No upload slot freed in time, request refused: %1").arg(this->queue.first().chunk->toStringLog()));
+      this->refuseRequest(this->queue.takeFirst());
+   }
+
+   if (!this->queue.isEmpty())
+      this->queueTimer.start(UPLOAD_QUEUE_TIMEOUT - this->queue.first().waitingTime.elapsed());
+}
+
+void UploadManager::startUpload(const Request& request)
+{
+   Protos::Core::GetChunkResult result;
+   result.set_status(Protos::Core::GetChunkResult_Status_OK);
+   result.set_chunk_size(request.chunk->getKnownBytes());
+   const bool compressed = request.compressionSupported && UPLOAD_COMPRESSION_RATIO > 0.0;
+   result.set_compressed(compressed);
+   if (request.waitingTime.isValid()) // Only the queued requests have waited.
+      result.set_waiting_time(request.waitingTime.elapsed());
+   request.socket->sendGetChunkResult(result);
+
+   this->nbActiveUploads++;
+   this->nbActiveUploadsByPeer[request.peerID]++;
+   this->lastUploadStartedByPeer[request.peerID] = ++this->nbUploadsStarted;
+   this->lastFilePath = request.filePath;
+   this->lastChunkNum = request.chunk->getNum();
+
+   QSharedPointer<Upload> upload(new Upload(request.chunk, request.offset, compressed, request.socket, this->transferRateCalculator, this->bandwidthLimiter.getPeerBucket(request.peerID)));
+   connect(upload.data(), SIGNAL(timeout()), this, SLOT(uploadTimeout()));
+   connect(upload.data(), SIGNAL(uploadFinished()), this, SLOT(uploadFinished()));
+   this->uploads << upload;
+   this->threadPool.run(upload.toWeakRef());
+}
+
+void UploadManager::refuseRequest(const Request& request)
+{
+   Protos::Core::GetChunkResult result;
+   result.set_status(Protos::Core::GetChunkResult_Status_TOO_MANY_CONNECTIONS);
+   request.socket->sendGetChunkResult(result);
+}
+
+/**
+  * Return the index in the queue of the next request to start, see the description of the class.
+  * The queue must not be empty.
+  */
+int UploadManager::chooseNextRequest() const
+{
+   int minNbActiveUploads = NUMBER_OF_UPLOADER;
+   foreach (const Request& request, this->queue)
+      minNbActiveUploads = qMin(minNbActiveUploads, this->nbActiveUploadsByPeer.value(request.peerID));
+
+   int best = -1;
+   int bestLocality = -1;
+   quint64 bestLastUploadStarted = 0;
+
+   for (int i = 0; i < this->queue.size(); i++)
+   {
+      const Request& request = this->queue[i];
+      if (this->nbActiveUploadsByPeer.value(request.peerID) != minNbActiveUploads)
+         continue;
+
+      int locality = 0;
+      if (!request.filePath.isNull() && request.filePath == this->lastFilePath)
+         locality = request.chunk->getNum() == this->lastChunkNum + 1 ? 2 : 1;
+
+      const quint64 lastUploadStarted = this->lastUploadStartedByPeer.value(request.peerID);
+
+      // For the same locality and the same peer the first (the oldest) request is kept.
+      if (locality > bestLocality || (locality == bestLocality && lastUploadStarted < bestLastUploadStarted))
+      {
+         best = i;
+         bestLocality = locality;
+         bestLastUploadStarted = lastUploadStarted;
+      }
+   }
+
+   return best;
+}
+
+/**
+  * Return the path of the file owning the given chunk, a null string if the chunk isn't part of a shared file anymore.
+  */
+QString UploadManager::getFilePath(const QSharedPointer<FM::IChunk>& chunk)
+{
+   Protos::Common::Entry entry;
+   if (!chunk->populateEntry(&entry))
+      return QString();
+
+   return chunk->getBasePath() + Common::ProtoHelper::getStr(entry, &Protos::Common::Entry::path) + Common::ProtoHelper::getStr(entry, &Protos::Common::Entry::name);
+}
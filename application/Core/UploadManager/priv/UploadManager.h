@@ -21,11 +21,15 @@
 
 #include <QSharedPointer>
 #include <QList>
+#include <QHash>
+#include <QTimer>
+#include <QElapsedTimer>
 
 #include <Common/Uncopyable.h>
 #include <Common/Hash.h>
 #include <Common/ThreadPool.h>
 #include <Common/TransferRateCalculator.h>
+#include <Common/BandwidthLimiter.h>
 #include <Core/PeerManager/IPeerManager.h>
 
 #include <IUploadManager.h>
@@ -45,20 +49,63 @@ namespace UM
       QList<IUpload*> getUploads() const;
 
       int getUploadRate();
+      void setUploadRateLimit(quint32 rate, quint32 ratePerPeer);
 
    private slots:
-      void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, QSharedPointer<PM::ISocket> socket);
+      void getChunk(QSharedPointer<FM::IChunk> chunk, int offset, bool compressionSupported, QSharedPointer<PM::ISocket> socket);
+      void uploadFinished();
       void uploadTimeout();
 
+      void startQueuedUploads();
+      void refuseTimedOutRequests();
+
    private:
       LOG_INIT_H("UploadManager");
 
+      /**
+        * A 'GetChunk' request waiting for a free upload slot.
+        */
+      struct Request
+      {
+         QSharedPointer<FM::IChunk> chunk;
+         int offset;
+         bool compressionSupported;
+         QSharedPointer<PM::ISocket> socket;
+         Common::Hash peerID;
+         QString filePath;
+         QElapsedTimer waitingTime;
+      };
+
+      void startUpload(const Request& request);
+      void refuseRequest(const Request& request);
+      int chooseNextRequest() const;
+
+      static QString getFilePath(const QSharedPointer<FM::IChunk>& chunk);
+
+      const int NUMBER_OF_UPLOADER;
+      const int UPLOAD_QUEUE_SIZE;
+      const int UPLOAD_QUEUE_TIMEOUT;
+      const double UPLOAD_COMPRESSION_RATIO;
+
       Common::TransferRateCalculator transferRateCalculator;
+      Common::BandwidthLimiter bandwidthLimiter;
 
       QSharedPointer<PM::IPeerManager> peerManager;
 
       QList< QSharedPointer<Upload> > uploads;
 
+      QList<Request> queue; ///< The requests waiting for a free upload slot, in their arrival order.
+      QTimer queueTimer; ///< To refuse the requests waiting for too long.
+
+      int nbActiveUploads;
+      QHash<Common::Hash, int> nbActiveUploadsByPeer;
+      QHash<Common::Hash, quint64> lastUploadStartedByPeer; ///< The number of the last upload started for each peer, see 'nbUploadsStarted'.
+      quint64 nbUploadsStarted;
+
+      // The last chunk started, the next chunk of the same file is preferred to avoid moving the disk heads.
+      QString lastFilePath;
+      int lastChunkNum;
+
       Common::ThreadPool threadPool;
    };
 }